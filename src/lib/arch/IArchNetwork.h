@@ -20,6 +20,7 @@
 
 #include "common/IInterface.h"
 #include "common/stdstring.h"
+#include "common/stdvector.h"
 
 class ArchThreadImpl;
 typedef ArchThreadImpl* ArchThread;
@@ -53,6 +54,21 @@ An opaque type representing a network address.
 */
 typedef ArchNetAddressImpl* ArchNetAddress;
 
+/*!      
+\class ArchPollSetImpl
+\brief Internal poll set data.
+An architecture dependent type holding the necessary data for a set of
+sockets registered with the kernel for readiness notification.
+*/
+class ArchPollSetImpl;
+
+/*!      
+\var ArchPollSet
+\brief Opaque poll set type.
+An opaque type representing a persistent poll set.
+*/
+typedef ArchPollSetImpl* ArchPollSet;
+
 //! Interface for architecture dependent networking
 /*!
 This interface defines the networking operations required by
@@ -102,6 +118,26 @@ public:
         unsigned short    m_revents;
     };
 
+    //! A ready socket reported by \c waitPollSet()
+    class PollSetEvent {
+    public:
+        //! The data passed when the socket was added to the poll set
+        void*            m_data;
+
+        //! The result events
+        unsigned short    m_revents;
+    };
+
+    //! A buffer for \c writevSocket()
+    class IoVector {
+    public:
+        //! The data to write
+        const void*        m_data;
+
+        //! The number of bytes to write
+        size_t            m_size;
+    };
+
     //! @name manipulators
     //@{
 
@@ -197,6 +233,69 @@ public:
     */
     virtual void        unblockPollSocket(ArchThread thread) = 0;
 
+    //! Create a poll set
+    /*!
+    Creates a persistent set of sockets to wait on.  Unlike \c pollSocket(),
+    sockets are registered once and their interest is changed individually
+    so waiting costs nothing per idle socket.  Returns NULL if the
+    platform has no such facility, in which case callers must use
+    \c pollSocket().
+    */
+    virtual ArchPollSet    newPollSet() = 0;
+
+    //! Destroy a poll set
+    /*!
+    Destroys a poll set created by \c newPollSet().  Sockets in the set
+    are not closed.
+    */
+    virtual void        closePollSet(ArchPollSet set) = 0;
+
+    //! Add socket to poll set
+    /*!
+    Adds socket \c s to \c set, waiting for \c events (any combination of
+    \c kPOLLIN and \c kPOLLOUT).  \c data is reported back by
+    \c waitPollSet() when the socket is ready.  A socket must be added to
+    a set at most once.
+    */
+    virtual void        addToPollSet(ArchPollSet set, ArchSocket s,
+                            unsigned short events, void* data) = 0;
+
+    //! Change socket events in poll set
+    /*!
+    Changes the events and data for socket \c s, which must have been
+    added to \c set.
+    */
+    virtual void        modifyPollSet(ArchPollSet set, ArchSocket s,
+                            unsigned short events, void* data) = 0;
+
+    //! Remove socket from poll set
+    /*!
+    Removes socket \c s from \c set.  This must be done before the
+    socket is closed.  Removing a socket that isn't in the set has no
+    effect.
+    */
+    virtual void        removeFromPollSet(ArchPollSet set, ArchSocket s) = 0;
+
+    //! Wait on poll set
+    /*!
+    Waits up to \c timeout seconds (or indefinitely if \c timeout < 0)
+    for sockets in \c set to become ready and fills in at most \c max
+    entries of \c events.  Returns the number of entries filled in, which
+    is 0 on timeout or if \c unblockPollSet() was called.  \c kPOLLERR is
+    set in \c m_revents for sockets in an error state.
+
+    (Cancellation point)
+    */
+    virtual int            waitPollSet(ArchPollSet set, PollSetEvent events[],
+                            int max, double timeout) = 0;
+
+    //! Unblock thread in waitPollSet()
+    /*!
+    Cause a thread that's in, or next enters, a waitPollSet() call on
+    \c set to return.  This may be called from any thread.
+    */
+    virtual void        unblockPollSet(ArchPollSet set) = 0;
+
     //! Read data from socket
     /*!
     Read up to \c len bytes from socket \c s in \c buf and return the
@@ -216,6 +315,15 @@ public:
     virtual size_t        writeSocket(ArchSocket s,
                             const void* buf, size_t len) = 0;
 
+    //! Write data from several buffers to socket
+    /*!
+    Like \c writeSocket() but writes the \c num buffers in \c vecs, in
+    order, with a single call.  Returns the number of bytes written, which
+    can end partway through any buffer.
+    */
+    virtual size_t        writevSocket(ArchSocket s,
+                            const IoVector* vecs, int num) = 0;
+
     //! Check error on socket
     /*!
     If the socket \c s is in an error state then throws an appropriate
@@ -249,6 +357,15 @@ public:
     //! Convert a name to a network address
     virtual ArchNetAddress    nameToAddr(const std::string&) = 0;
 
+    //! Convert a name to all of its network addresses
+    /*!
+    Returns every distinct stream address of the name, in the order the
+    system's resolver prefers them.  The caller must close each address.
+    Throws like \c nameToAddr().  May be called from any thread and
+    doesn't block other network calls while the name is looked up.
+    */
+    virtual std::vector<ArchNetAddress> nameToAddrs(const std::string&) = 0;
+
     //! Destroy a network address
     virtual void            closeAddr(ArchNetAddress) = 0;
 
@@ -32,6 +32,7 @@
 #endif
 #include <arpa/inet.h>
 #include <fcntl.h>
+#include <sys/uio.h>
 #include <errno.h>
 #include <string.h>
 
@@ -46,6 +47,13 @@
 #    endif
 #endif
 
+#if HAVE_SYS_EPOLL_H
+#    include <sys/epoll.h>
+#endif
+#if HAVE_SYS_EVENTFD_H
+#    include <sys/eventfd.h>
+#endif
+
 #if !HAVE_INET_ATON
 #    include <stdio.h>
 #endif
@@ -207,8 +215,9 @@ ArchNetworkBSD::listenOnSocket(ArchSocket s)
 {
     assert(s != NULL);
 
-    // hardcoding backlog
-    if (listen(s->m_fd, 3) == -1) {
+    // allow a long backlog so that clients reconnecting all at once
+    // don't have their connections dropped and retried
+    if (listen(s->m_fd, SOMAXCONN) == -1) {
         throwError(errno);
     }
 }
@@ -514,6 +523,228 @@ ArchNetworkBSD::unblockPollSocket(ArchThread thread)
     }
 }
 
+#if HAVE_SYS_EPOLL_H && HAVE_SYS_EVENTFD_H
+
+static
+uint32_t
+toEpollEvents(unsigned short events)
+{
+    uint32_t result = 0;
+    if ((events & IArchNetwork::kPOLLIN) != 0) {
+        result |= EPOLLIN;
+    }
+    if ((events & IArchNetwork::kPOLLOUT) != 0) {
+        result |= EPOLLOUT;
+    }
+    return result;
+}
+
+ArchPollSet
+ArchNetworkBSD::newPollSet()
+{
+    int fd = epoll_create1(EPOLL_CLOEXEC);
+    if (fd == -1) {
+        return NULL;
+    }
+
+    // the unblock eventfd is registered with NULL data, which can't be
+    // confused with a socket's data
+    int unblockFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (unblockFd == -1) {
+        close(fd);
+        return NULL;
+    }
+    struct epoll_event ev;
+    ev.events   = EPOLLIN;
+    ev.data.ptr = NULL;
+    if (epoll_ctl(fd, EPOLL_CTL_ADD, unblockFd, &ev) == -1) {
+        close(unblockFd);
+        close(fd);
+        return NULL;
+    }
+
+    ArchPollSetImpl* set = new ArchPollSetImpl;
+    set->m_fd            = fd;
+    set->m_unblockFd     = unblockFd;
+    return set;
+}
+
+void
+ArchNetworkBSD::closePollSet(ArchPollSet set)
+{
+    assert(set != NULL);
+
+    close(set->m_unblockFd);
+    close(set->m_fd);
+    delete set;
+}
+
+void
+ArchNetworkBSD::addToPollSet(ArchPollSet set, ArchSocket s,
+                unsigned short events, void* data)
+{
+    assert(set  != NULL);
+    assert(s    != NULL);
+    assert(data != NULL);
+
+    struct epoll_event ev;
+    ev.events   = toEpollEvents(events);
+    ev.data.ptr = data;
+    if (epoll_ctl(set->m_fd, EPOLL_CTL_ADD, s->m_fd, &ev) == -1) {
+        throwError(errno);
+    }
+}
+
+void
+ArchNetworkBSD::modifyPollSet(ArchPollSet set, ArchSocket s,
+                unsigned short events, void* data)
+{
+    assert(set  != NULL);
+    assert(s    != NULL);
+    assert(data != NULL);
+
+    struct epoll_event ev;
+    ev.events   = toEpollEvents(events);
+    ev.data.ptr = data;
+    if (epoll_ctl(set->m_fd, EPOLL_CTL_MOD, s->m_fd, &ev) == -1) {
+        throwError(errno);
+    }
+}
+
+void
+ArchNetworkBSD::removeFromPollSet(ArchPollSet set, ArchSocket s)
+{
+    assert(set != NULL);
+    assert(s   != NULL);
+
+    // kernels before 2.6.9 require a non-NULL event even though it's
+    // ignored
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    if (epoll_ctl(set->m_fd, EPOLL_CTL_DEL, s->m_fd, &ev) == -1) {
+        if (errno != ENOENT && errno != EBADF) {
+            throwError(errno);
+        }
+    }
+}
+
+int
+ArchNetworkBSD::waitPollSet(ArchPollSet set, PollSetEvent events[],
+                int max, double timeout)
+{
+    assert(set    != NULL);
+    assert(events != NULL || max == 0);
+
+    // epoll_wait() needs room for at least one event
+    static const int s_maxEvents = 64;
+    struct epoll_event ev[s_maxEvents];
+    if (max > s_maxEvents) {
+        max = s_maxEvents;
+    }
+    if (max <= 0) {
+        max = 1;
+    }
+
+    // prepare timeout
+    int t = (timeout < 0.0) ? -1 : static_cast<int>(1000.0 * timeout);
+
+    // do the wait
+    int n = epoll_wait(set->m_fd, ev, max, t);
+    if (n == -1) {
+        if (errno == EINTR) {
+            // interrupted system call
+            ARCH->testCancelThread();
+            return 0;
+        }
+        throwError(errno);
+    }
+
+    // translate results, dropping the unblock eventfd
+    int count = 0;
+    for (int i = 0; i < n; ++i) {
+        if (ev[i].data.ptr == NULL) {
+            // the unblock event was signalled.  reset it.
+            eventfd_t dummy;
+            ssize_t ignore = read(set->m_unblockFd, &dummy, sizeof(dummy));
+            (void)ignore;
+            continue;
+        }
+
+        PollSetEvent& event = events[count++];
+        event.m_data    = ev[i].data.ptr;
+        event.m_revents = 0;
+        if ((ev[i].events & (EPOLLIN | EPOLLHUP | EPOLLRDHUP)) != 0) {
+            event.m_revents |= kPOLLIN;
+        }
+        if ((ev[i].events & EPOLLOUT) != 0) {
+            event.m_revents |= kPOLLOUT;
+        }
+        if ((ev[i].events & EPOLLERR) != 0) {
+            event.m_revents |= kPOLLERR;
+        }
+    }
+
+    return count;
+}
+
+void
+ArchNetworkBSD::unblockPollSet(ArchPollSet set)
+{
+    assert(set != NULL);
+
+    eventfd_t one = 1;
+    ssize_t ignore = write(set->m_unblockFd, &one, sizeof(one));
+    (void)ignore;
+}
+
+#else
+
+ArchPollSet
+ArchNetworkBSD::newPollSet()
+{
+    // no scalable poll facility;  use pollSocket()
+    return NULL;
+}
+
+void
+ArchNetworkBSD::closePollSet(ArchPollSet)
+{
+    assert(0 && "poll sets not supported");
+}
+
+void
+ArchNetworkBSD::addToPollSet(ArchPollSet, ArchSocket, unsigned short, void*)
+{
+    assert(0 && "poll sets not supported");
+}
+
+void
+ArchNetworkBSD::modifyPollSet(ArchPollSet, ArchSocket, unsigned short, void*)
+{
+    assert(0 && "poll sets not supported");
+}
+
+void
+ArchNetworkBSD::removeFromPollSet(ArchPollSet, ArchSocket)
+{
+    assert(0 && "poll sets not supported");
+}
+
+int
+ArchNetworkBSD::waitPollSet(ArchPollSet, PollSetEvent[], int, double)
+{
+    assert(0 && "poll sets not supported");
+    return 0;
+}
+
+void
+ArchNetworkBSD::unblockPollSet(ArchPollSet)
+{
+    assert(0 && "poll sets not supported");
+}
+
+#endif
+
 size_t
 ArchNetworkBSD::readSocket(ArchSocket s, void* buf, size_t len)
 {
@@ -544,6 +775,32 @@ ArchNetworkBSD::writeSocket(ArchSocket s, const void* buf, size_t len)
     return n;
 }
 
+size_t
+ArchNetworkBSD::writevSocket(ArchSocket s, const IoVector* vecs, int num)
+{
+    assert(s != NULL);
+    assert(vecs != NULL || num == 0);
+
+    // the caller will write the rest once we've returned
+    struct iovec iov[16];
+    if (num > (int)(sizeof(iov) / sizeof(iov[0]))) {
+        num = (int)(sizeof(iov) / sizeof(iov[0]));
+    }
+    for (int i = 0; i < num; ++i) {
+        iov[i].iov_base = const_cast<void*>(vecs[i].m_data);
+        iov[i].iov_len  = vecs[i].m_size;
+    }
+
+    ssize_t n = writev(s->m_fd, iov, num);
+    if (n == -1) {
+        if (errno == EINTR || errno == EAGAIN) {
+            return 0;
+        }
+        throwError(errno);
+    }
+    return n;
+}
+
 void
 ArchNetworkBSD::throwErrorOnSocket(ArchSocket s)
 {
@@ -717,6 +974,59 @@ ArchNetworkBSD::nameToAddr(const std::string& name)
     return addr;
 }
 
+std::vector<ArchNetAddress>
+ArchNetworkBSD::nameToAddrs(const std::string& name)
+{
+    struct addrinfo hints;
+    struct addrinfo *p;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    // getaddrinfo() is thread safe, so unlike nameToAddr() this doesn't
+    // hold the mutex, which would stall other threads' socket calls
+    // for as long as the lookup takes
+    int ret = getaddrinfo(name.c_str(), NULL, &hints, &p);
+    if (ret != 0) {
+        throwNameError(ret);
+    }
+
+    std::vector<ArchNetAddress> addrs;
+    for (struct addrinfo* i = p; i != NULL; i = i->ai_next) {
+        if (i->ai_family != AF_INET && i->ai_family != AF_INET6) {
+            continue;
+        }
+
+        ArchNetAddressImpl* addr = new ArchNetAddressImpl;
+        if (i->ai_family == AF_INET) {
+            addr->m_len = (socklen_t)sizeof(struct sockaddr_in);
+        } else {
+            addr->m_len = (socklen_t)sizeof(struct sockaddr_in6);
+        }
+        memcpy(&addr->m_addr, i->ai_addr, addr->m_len);
+
+        bool duplicate = false;
+        for (size_t j = 0; j < addrs.size(); ++j) {
+            if (isEqualAddr(addrs[j], addr)) {
+                duplicate = true;
+                break;
+            }
+        }
+        if (duplicate) {
+            delete addr;
+        }
+        else {
+            addrs.push_back(addr);
+        }
+    }
+    freeaddrinfo(p);
+
+    if (addrs.empty()) {
+        throwNameError(NO_DATA);
+    }
+    return addrs;
+}
+
 void
 ArchNetworkBSD::closeAddr(ArchNetAddress addr)
 {
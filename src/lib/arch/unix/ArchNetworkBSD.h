@@ -46,6 +46,12 @@ public:
     int                    m_refCount;
 };
 
+class ArchPollSetImpl {
+public:
+    int                    m_fd;
+    int                    m_unblockFd;
+};
+
 class ArchNetAddressImpl {
 public:
     ArchNetAddressImpl() : m_len(sizeof(m_addr)) { }
@@ -74,9 +80,21 @@ public:
     virtual bool        connectSocket(ArchSocket s, ArchNetAddress name);
     virtual int            pollSocket(PollEntry[], int num, double timeout);
     virtual void        unblockPollSocket(ArchThread thread);
+    virtual ArchPollSet    newPollSet();
+    virtual void        closePollSet(ArchPollSet set);
+    virtual void        addToPollSet(ArchPollSet set, ArchSocket s,
+                            unsigned short events, void* data);
+    virtual void        modifyPollSet(ArchPollSet set, ArchSocket s,
+                            unsigned short events, void* data);
+    virtual void        removeFromPollSet(ArchPollSet set, ArchSocket s);
+    virtual int            waitPollSet(ArchPollSet set, PollSetEvent events[],
+                            int max, double timeout);
+    virtual void        unblockPollSet(ArchPollSet set);
     virtual size_t        readSocket(ArchSocket s, void* buf, size_t len);
     virtual size_t        writeSocket(ArchSocket s,
                             const void* buf, size_t len);
+    virtual size_t        writevSocket(ArchSocket s,
+                            const IoVector* vecs, int num);
     virtual void        throwErrorOnSocket(ArchSocket);
     virtual bool        setNoDelayOnSocket(ArchSocket, bool noDelay);
     virtual bool        setReuseAddrOnSocket(ArchSocket, bool reuse);
@@ -84,6 +102,7 @@ public:
     virtual ArchNetAddress    newAnyAddr(EAddressFamily);
     virtual ArchNetAddress    copyAddr(ArchNetAddress);
     virtual ArchNetAddress    nameToAddr(const std::string&);
+    virtual std::vector<ArchNetAddress> nameToAddrs(const std::string&);
     virtual void            closeAddr(ArchNetAddress);
     virtual std::string        addrToName(ArchNetAddress);
     virtual std::string        addrToString(ArchNetAddress);
@@ -64,6 +64,7 @@ static BOOL (PASCAL FAR *WSAResetEvent_winsock)(WSAEVENT);
 static int (PASCAL FAR *WSAEventSelect_winsock)(SOCKET, WSAEVENT, long);
 static DWORD (PASCAL FAR *WSAWaitForMultipleEvents_winsock)(DWORD, const WSAEVENT FAR*, BOOL, DWORD, BOOL);
 static int (PASCAL FAR *WSAEnumNetworkEvents_winsock)(SOCKET, WSAEVENT, LPWSANETWORKEVENTS);
+static int (PASCAL FAR *WSASend_winsock)(SOCKET, LPWSABUF, DWORD, LPDWORD, DWORD, LPWSAOVERLAPPED, LPWSAOVERLAPPED_COMPLETION_ROUTINE);
 
 #undef FD_ISSET
 #define FD_ISSET(fd, set) WSAFDIsSet_winsock((SOCKET)(fd), (fd_set FAR *)(set))
@@ -199,6 +200,7 @@ ArchNetworkWinsock::initModule(HMODULE module)
     setfunc(WSAEventSelect_winsock, WSAEventSelect, int (PASCAL FAR *)(SOCKET, WSAEVENT, long));
     setfunc(WSAWaitForMultipleEvents_winsock, WSAWaitForMultipleEvents, DWORD (PASCAL FAR *)(DWORD, const WSAEVENT FAR*, BOOL, DWORD, BOOL));
     setfunc(WSAEnumNetworkEvents_winsock, WSAEnumNetworkEvents, int (PASCAL FAR *)(SOCKET, WSAEVENT, LPWSANETWORKEVENTS));
+    setfunc(WSASend_winsock, WSASend, int (PASCAL FAR *)(SOCKET, LPWSABUF, DWORD, LPDWORD, DWORD, LPWSAOVERLAPPED, LPWSAOVERLAPPED_COMPLETION_ROUTINE));
 
     s_networkModule = module;
 }
@@ -310,8 +312,9 @@ ArchNetworkWinsock::listenOnSocket(ArchSocket s)
 {
     assert(s != NULL);
 
-    // hardcoding backlog
-    if (listen_winsock(s->m_socket, 3) == SOCKET_ERROR) {
+    // allow a long backlog so that clients reconnecting all at once
+    // don't have their connections dropped and retried
+    if (listen_winsock(s->m_socket, SOMAXCONN) == SOCKET_ERROR) {
         throwError(getsockerror_winsock());
     }
 }
@@ -550,6 +553,50 @@ ArchNetworkWinsock::unblockPollSocket(ArchThread thread)
     }
 }
 
+ArchPollSet
+ArchNetworkWinsock::newPollSet()
+{
+    // WSAWaitForMultipleEvents() has no persistent set;  use pollSocket()
+    return NULL;
+}
+
+void
+ArchNetworkWinsock::closePollSet(ArchPollSet)
+{
+    assert(0 && "poll sets not supported");
+}
+
+void
+ArchNetworkWinsock::addToPollSet(ArchPollSet, ArchSocket, unsigned short, void*)
+{
+    assert(0 && "poll sets not supported");
+}
+
+void
+ArchNetworkWinsock::modifyPollSet(ArchPollSet, ArchSocket, unsigned short, void*)
+{
+    assert(0 && "poll sets not supported");
+}
+
+void
+ArchNetworkWinsock::removeFromPollSet(ArchPollSet, ArchSocket)
+{
+    assert(0 && "poll sets not supported");
+}
+
+int
+ArchNetworkWinsock::waitPollSet(ArchPollSet, PollSetEvent[], int, double)
+{
+    assert(0 && "poll sets not supported");
+    return 0;
+}
+
+void
+ArchNetworkWinsock::unblockPollSet(ArchPollSet)
+{
+    assert(0 && "poll sets not supported");
+}
+
 size_t
 ArchNetworkWinsock::readSocket(ArchSocket s, void* buf, size_t len)
 {
@@ -586,6 +633,38 @@ ArchNetworkWinsock::writeSocket(ArchSocket s, const void* buf, size_t len)
     return static_cast<size_t>(n);
 }
 
+size_t
+ArchNetworkWinsock::writevSocket(ArchSocket s, const IoVector* vecs, int num)
+{
+    assert(s != NULL);
+    assert(vecs != NULL || num == 0);
+
+    // the caller will write the rest once we've returned
+    WSABUF bufs[16];
+    if (num > (int)(sizeof(bufs) / sizeof(bufs[0]))) {
+        num = (int)(sizeof(bufs) / sizeof(bufs[0]));
+    }
+    for (int i = 0; i < num; ++i) {
+        bufs[i].buf = static_cast<char*>(const_cast<void*>(vecs[i].m_data));
+        bufs[i].len = (ULONG)vecs[i].m_size;
+    }
+
+    DWORD n;
+    if (WSASend_winsock(s->m_socket, bufs, (DWORD)num, &n, 0,
+                                NULL, NULL) == SOCKET_ERROR) {
+        int err = getsockerror_winsock();
+        if (err == WSAEINTR) {
+            return 0;
+        }
+        if (err == WSAEWOULDBLOCK) {
+            s->m_pollWrite = true;
+            return 0;
+        }
+        throwError(err);
+    }
+    return static_cast<size_t>(n);
+}
+
 void
 ArchNetworkWinsock::throwErrorOnSocket(ArchSocket s)
 {
@@ -748,6 +827,59 @@ ArchNetworkWinsock::nameToAddr(const std::string& name)
     return addr;
 }
 
+std::vector<ArchNetAddress>
+ArchNetworkWinsock::nameToAddrs(const std::string& name)
+{
+    struct addrinfo hints;
+    struct addrinfo *p;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    // getaddrinfo() is thread safe, so unlike nameToAddr() this doesn't
+    // hold the mutex, which would stall other threads' socket calls
+    // for as long as the lookup takes
+    int ret = getaddrinfo(name.c_str(), NULL, &hints, &p);
+    if (ret != 0) {
+        throwNameError(ret);
+    }
+
+    std::vector<ArchNetAddress> addrs;
+    for (struct addrinfo* i = p; i != NULL; i = i->ai_next) {
+        if (i->ai_family != AF_INET && i->ai_family != AF_INET6) {
+            continue;
+        }
+
+        ArchNetAddressImpl* addr = new ArchNetAddressImpl;
+        if (i->ai_family == AF_INET) {
+            addr->m_len = (socklen_t)sizeof(struct sockaddr_in);
+        } else {
+            addr->m_len = (socklen_t)sizeof(struct sockaddr_in6);
+        }
+        memcpy(&addr->m_addr, i->ai_addr, addr->m_len);
+
+        bool duplicate = false;
+        for (size_t j = 0; j < addrs.size(); ++j) {
+            if (isEqualAddr(addrs[j], addr)) {
+                duplicate = true;
+                break;
+            }
+        }
+        if (duplicate) {
+            delete addr;
+        }
+        else {
+            addrs.push_back(addr);
+        }
+    }
+    freeaddrinfo(p);
+
+    if (addrs.empty()) {
+        throwNameError(WSANO_DATA);
+    }
+    return addrs;
+}
+
 void
 ArchNetworkWinsock::closeAddr(ArchNetAddress addr)
 {
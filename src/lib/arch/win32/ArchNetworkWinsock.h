@@ -76,9 +76,21 @@ public:
     virtual bool        connectSocket(ArchSocket s, ArchNetAddress name);
     virtual int            pollSocket(PollEntry[], int num, double timeout);
     virtual void        unblockPollSocket(ArchThread thread);
+    virtual ArchPollSet    newPollSet();
+    virtual void        closePollSet(ArchPollSet set);
+    virtual void        addToPollSet(ArchPollSet set, ArchSocket s,
+                            unsigned short events, void* data);
+    virtual void        modifyPollSet(ArchPollSet set, ArchSocket s,
+                            unsigned short events, void* data);
+    virtual void        removeFromPollSet(ArchPollSet set, ArchSocket s);
+    virtual int            waitPollSet(ArchPollSet set, PollSetEvent events[],
+                            int max, double timeout);
+    virtual void        unblockPollSet(ArchPollSet set);
     virtual size_t        readSocket(ArchSocket s, void* buf, size_t len);
     virtual size_t        writeSocket(ArchSocket s,
                             const void* buf, size_t len);
+    virtual size_t        writevSocket(ArchSocket s,
+                            const IoVector* vecs, int num);
     virtual void        throwErrorOnSocket(ArchSocket);
     virtual bool        setNoDelayOnSocket(ArchSocket, bool noDelay);
     virtual bool        setReuseAddrOnSocket(ArchSocket, bool reuse);
@@ -86,6 +98,7 @@ public:
     virtual ArchNetAddress    newAnyAddr(EAddressFamily);
     virtual ArchNetAddress    copyAddr(ArchNetAddress);
     virtual ArchNetAddress    nameToAddr(const std::string&);
+    virtual std::vector<ArchNetAddress> nameToAddrs(const std::string&);
     virtual void            closeAddr(ArchNetAddress);
     virtual std::string        addrToName(ArchNetAddress);
     virtual std::string        addrToString(ArchNetAddress);
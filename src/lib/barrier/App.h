@@ -185,7 +185,8 @@ private:
     " [--daemon|--no-daemon]"
 #  define HELP_SYS_INFO \
     "  -f, --no-daemon          run in the foreground.\n"    \
-    "      --daemon             run as a daemon. (*)\n"
+    "      --daemon             run as a daemon. (*)\n" \
+    "      --no-epoll           service sockets with poll() instead of epoll().\n"
 
 #elif SYSAPI_WIN32
 
@@ -193,6 +193,10 @@ ArgParser::parseGenericArgs(int argc, const char* const* argv, int& i)
         // daemonize
         argsBase().m_daemon = true;
     }
+    else if (isArg(i, argc, argv, NULL, "--no-epoll")) {
+        // use poll() in the socket multiplexer
+        argsBase().m_disableEpoll = true;
+    }
     else if (isArg(i, argc, argv, "-n", "--name", 1)) {
         // save screen name
         argsBase().m_name = argv[++i];
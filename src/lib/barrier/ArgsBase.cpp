@@ -39,6 +39,7 @@ m_display(NULL),
 m_disableTray(false),
 m_enableIpc(false),
 m_enableDragDrop(false),
+m_disableEpoll(false),
 m_shouldExit(false),
 m_barrierAddress(),
 m_enableCrypto(false),
@@ -445,7 +445,7 @@ ClientApp::mainLoop()
 {
     // create socket multiplexer.  this must happen after daemonization
     // on unix because threads evaporate across a fork().
-    setSocketMultiplexer(std::make_unique<SocketMultiplexer>());
+    setSocketMultiplexer(std::make_unique<SocketMultiplexer>(!argsBase().m_disableEpoll));
 
     // start client, etc
     appUtil().startNode();
@@ -18,6 +18,9 @@
 
 #include "barrier/Clipboard.h"
 
+#include <functional>
+#include <utility>
+
 //
 // Clipboard
 //
@@ -43,9 +46,11 @@ Clipboard::empty()
 
     // clear all data
     for (SInt32 index = 0; index < kNumFormats; ++index) {
-        m_data[index]  = "";
+        m_data[index].reset();
+        m_hash[index]  = 0;
         m_added[index] = false;
     }
+    m_marshalled.reset();
 
     // save time
     m_timeOwned = m_time;
@@ -62,8 +67,22 @@ Clipboard::add(EFormat format, const String& data)
     assert(m_open);
     assert(m_owner);
 
-    m_data[format]  = data;
+    m_data[format]  = std::make_shared<const String>(data);
+    m_hash[format]  = std::hash<String>()(data);
     m_added[format] = true;
+    m_marshalled.reset();
+}
+
+void
+Clipboard::add(EFormat format, String&& data)
+{
+    assert(m_open);
+    assert(m_owner);
+
+    m_hash[format]  = std::hash<String>()(data);
+    m_data[format]  = std::make_shared<const String>(std::move(data));
+    m_added[format] = true;
+    m_marshalled.reset();
 }
 
 bool
@@ -102,7 +121,10 @@ String
 Clipboard::get(EFormat format) const
 {
     assert(m_open);
-    return m_data[format];
+    if (!m_added[format]) {
+        return String();
+    }
+    return *m_data[format];
 }
 
 void
@@ -114,5 +136,97 @@ Clipboard::unmarshall(const String& data, Time time)
 String
 Clipboard::marshall() const
 {
-    return IClipboard::marshall(this);
+    return *marshallShared();
+}
+
+std::shared_ptr<const String>
+Clipboard::marshallShared() const
+{
+    if (m_marshalled) {
+        return m_marshalled;
+    }
+
+    // same layout as IClipboard::marshall() but without copying each
+    // format out through get()
+    UInt32 size = 4;
+    UInt32 numFormats = 0;
+    for (UInt32 format = 0; format != kNumFormats; ++format) {
+        if (m_added[format]) {
+            ++numFormats;
+            size += 4 + 4 + (UInt32)m_data[format]->size();
+        }
+    }
+
+    std::shared_ptr<String> data = std::make_shared<String>();
+    data->reserve(size);
+    writeUInt32(data.get(), numFormats);
+    for (UInt32 format = 0; format != kNumFormats; ++format) {
+        if (m_added[format]) {
+            writeUInt32(data.get(), format);
+            writeUInt32(data.get(), (UInt32)m_data[format]->size());
+            data->append(*m_data[format]);
+        }
+    }
+
+    m_marshalled = data;
+    return m_marshalled;
+}
+
+bool
+Clipboard::hasSameData(const Clipboard& clipboard) const
+{
+    for (SInt32 format = 0; format != kNumFormats; ++format) {
+        if (m_added[format] != clipboard.m_added[format]) {
+            return false;
+        }
+        if (m_added[format] && m_data[format] != clipboard.m_data[format] &&
+            (m_hash[format] != clipboard.m_hash[format] ||
+            m_data[format]->size() != clipboard.m_data[format]->size())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool
+Clipboard::copy(IClipboard* dst, const IClipboard* src)
+{
+    assert(dst != NULL);
+    assert(src != NULL);
+
+    return copy(dst, src, src->getTime());
+}
+
+bool
+Clipboard::copy(IClipboard* dst, const IClipboard* src, Time time)
+{
+    assert(dst != NULL);
+    assert(src != NULL);
+
+    Clipboard* memDst       = dynamic_cast<Clipboard*>(dst);
+    const Clipboard* memSrc = dynamic_cast<const Clipboard*>(src);
+    if (memDst == NULL || memSrc == NULL) {
+        return IClipboard::copy(dst, src, time);
+    }
+
+    assert(!memDst->m_open);
+    assert(!memSrc->m_open);
+
+    // build the marshalled data first so every copy shares it
+    memSrc->marshallShared();
+
+    if (memDst != memSrc) {
+        for (SInt32 index = 0; index < kNumFormats; ++index) {
+            memDst->m_data[index]  = memSrc->m_data[index];
+            memDst->m_hash[index]  = memSrc->m_hash[index];
+            memDst->m_added[index] = memSrc->m_added[index];
+        }
+        memDst->m_marshalled = memSrc->m_marshalled;
+    }
+
+    // same as opening at time and emptying
+    memDst->m_time      = time;
+    memDst->m_timeOwned = time;
+    memDst->m_owner     = true;
+    return true;
 }
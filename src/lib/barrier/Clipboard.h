@@ -20,9 +20,13 @@
 
 #include "barrier/IClipboard.h"
 
+#include <memory>
+
 //! Memory buffer clipboard
 /*!
-This class implements a clipboard that stores data in memory.
+This class implements a clipboard that stores data in memory.  Copies
+made with copy() or the copy constructor share the data rather than
+duplicating it, so passing a large clipboard around is cheap.
 */
 class Clipboard : public IClipboard {
 public:
@@ -39,6 +43,12 @@ public:
     */
     void                unmarshall(const String& data, Time time);
 
+    //! Add data without copying
+    /*!
+    Like add() but takes the data from \c data, leaving it empty.
+    */
+    void                add(EFormat, String&& data);
+
     //@}
     //! @name accessors
     //@{
@@ -50,6 +60,35 @@ public:
     */
     String                marshall() const;
 
+    //! Marshall clipboard data without copying
+    /*!
+    Like marshall() but returns the buffer itself.  It's built once and
+    shared with every copy of this clipboard until the data changes.
+    */
+    std::shared_ptr<const String> marshallShared() const;
+
+    //! Compare clipboard data
+    /*!
+    Returns true iff \c clipboard has the same formats as this clipboard
+    with the same data in each.  Only the hash of each format's data is
+    compared so this doesn't touch the data itself.
+    */
+    bool                hasSameData(const Clipboard& clipboard) const;
+
+    //! Copy clipboard
+    /*!
+    Like IClipboard::copy() except that if both clipboards are
+    Clipboard objects the data is shared rather than copied.
+    */
+    static bool            copy(IClipboard* dst, const IClipboard* src);
+
+    //! Copy clipboard
+    /*!
+    Like IClipboard::copy() except that if both clipboards are
+    Clipboard objects the data is shared rather than copied.
+    */
+    static bool            copy(IClipboard* dst, const IClipboard* src, Time);
+
     //@}
 
     // IClipboard overrides
@@ -62,10 +101,16 @@ public:
     virtual String        get(EFormat) const;
 
 private:
+    typedef std::shared_ptr<const String> SharedData;
+
     mutable bool        m_open;
     mutable Time        m_time;
     bool                m_owner;
     Time                m_timeOwned;
     bool                m_added[kNumFormats];
-    String                m_data[kNumFormats];
+    SharedData            m_data[kNumFormats];
+    size_t                m_hash[kNumFormats];
+
+    // the marshalled data, built on demand
+    mutable SharedData    m_marshalled;
 };
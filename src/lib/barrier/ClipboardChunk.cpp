@@ -17,14 +17,9 @@
 
 #include "barrier/ClipboardChunk.h"
 
-#include "barrier/ProtocolUtil.h"
 #include "barrier/protocol_types.h"
-#include "io/IStream.h"
-#include "base/Log.h"
 #include <cstring>
 
-size_t ClipboardChunk::s_expectedSize = 0;
-
 ClipboardChunk::ClipboardChunk(size_t size) :
     Chunk(size)
 {
@@ -82,73 +77,3 @@ ClipboardChunk::end(ClipboardID id, UInt32 sequence)
 
     return end;
 }
-
-int
-ClipboardChunk::assemble(barrier::IStream* stream,
-                    String& dataCached,
-                    ClipboardID& id,
-                    UInt32& sequence)
-{
-    UInt8 mark;
-    String data;
-
-    if (!ProtocolUtil::readf(stream, kMsgDClipboard + 4, &id, &sequence, &mark, &data)) {
-        return kError;
-    }
-    
-    if (mark == kDataStart) {
-        s_expectedSize = barrier::string::stringToSizeType(data);
-        LOG((CLOG_DEBUG "start receiving clipboard data"));
-        dataCached.clear();
-        return kStart;
-    }
-    else if (mark == kDataChunk) {
-        dataCached.append(data);
-        return kNotFinish;
-    }
-    else if (mark == kDataEnd) {
-        // validate
-        if (id >= kClipboardEnd) {
-            return kError;
-        }
-        else if (s_expectedSize != dataCached.size()) {
-            LOG((CLOG_ERR "corrupted clipboard data, expected size=%d actual size=%d", s_expectedSize, dataCached.size()));
-            return kError;
-        }
-        return kFinish;
-    }
-
-    LOG((CLOG_ERR "clipboard transmission failed: unknown error"));
-    return kError;
-}
-
-void
-ClipboardChunk::send(barrier::IStream* stream, void* data)
-{
-    ClipboardChunk* clipboardData = static_cast<ClipboardChunk*>(data);
-
-    LOG((CLOG_DEBUG1 "sending clipboard chunk"));
-
-    char* chunk = clipboardData->m_chunk;
-    ClipboardID id = chunk[0];
-    UInt32 sequence;
-    std::memcpy (&sequence, &chunk[1], 4);
-    UInt8 mark = chunk[5];
-    String dataChunk(&chunk[6], clipboardData->m_dataSize);
-
-    switch (mark) {
-    case kDataStart:
-        LOG((CLOG_DEBUG2 "sending clipboard chunk start: size=%s", dataChunk.c_str()));
-        break;
-
-    case kDataChunk:
-        LOG((CLOG_DEBUG2 "sending clipboard chunk data: size=%i", dataChunk.size()));
-        break;
-
-    case kDataEnd:
-        LOG((CLOG_DEBUG2 "sending clipboard finished"));
-        break;
-    }
-
-    ProtocolUtil::writef(stream, kMsgDClipboard, id, sequence, mark, &dataChunk);
-}
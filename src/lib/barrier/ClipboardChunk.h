@@ -24,10 +24,6 @@
 
 #define CLIPBOARD_CHUNK_META_SIZE 7
 
-namespace barrier {
-class IStream;
-};
-
 class ClipboardChunk : public Chunk {
 public:
     ClipboardChunk(size_t size);
@@ -44,17 +40,4 @@ public:
                             const String& data);
     static ClipboardChunk*
                         end(ClipboardID id, UInt32 sequence);
-
-    static int            assemble(
-                            barrier::IStream* stream,
-                            String& dataCached,
-                            ClipboardID& id,
-                            UInt32& sequence);
-
-    static void            send(barrier::IStream* stream, void* data);
-
-    static size_t        getExpectedSize() { return s_expectedSize; }
-
-private:
-    static size_t        s_expectedSize;
 };
@@ -0,0 +1,201 @@
+/*
+ * barrier -- mouse and keyboard sharing utility
+ * Copyright (C) 2018 Debauchee Open Source Group
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file LICENSE that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "barrier/ClipboardReceiver.h"
+
+#include "barrier/Clipboard.h"
+#include "barrier/ProtocolMessage.h"
+#include "barrier/protocol_types.h"
+#include "base/Log.h"
+
+#include <algorithm>
+#include <utility>
+
+//
+// ClipboardReceiver
+//
+
+ClipboardReceiver::ClipboardReceiver() :
+    m_id(0),
+    m_sequence(0),
+    m_receiving(false),
+    m_expectedSize(0),
+    m_size(0)
+{
+    reset();
+}
+
+int
+ClipboardReceiver::read(barrier::IStream* stream)
+{
+    ClipboardID id;
+    UInt32 sequence;
+    UInt8 mark;
+    if (!MsgDClipboard::read(stream, &id, &sequence, &mark, &m_chunk)) {
+        return kError;
+    }
+
+    if (mark == kDataStart) {
+        reset();
+        m_id           = id;
+        m_sequence     = sequence;
+        m_expectedSize = barrier::string::stringToSizeType(m_chunk);
+        m_receiving    = true;
+        LOG((CLOG_DEBUG "start receiving clipboard data"));
+        return kStart;
+    }
+
+    if (!m_receiving || id != m_id) {
+        LOG((CLOG_ERR "clipboard chunk for clipboard %d without a start", id));
+        return kError;
+    }
+
+    if (mark == kDataChunk) {
+        m_size += m_chunk.size();
+        if (m_size > m_expectedSize ||
+            !unmarshall(m_chunk.data(), m_chunk.size())) {
+            LOG((CLOG_ERR "corrupted clipboard data, expected size=%d actual size=%d", m_expectedSize, m_size));
+            m_receiving = false;
+            return kError;
+        }
+        return kNotFinish;
+    }
+    else if (mark == kDataEnd) {
+        m_receiving = false;
+
+        // validate
+        if (id >= kClipboardEnd) {
+            return kError;
+        }
+        else if (m_size != m_expectedSize || m_state != kDone) {
+            LOG((CLOG_ERR "corrupted clipboard data, expected size=%d actual size=%d", m_expectedSize, m_size));
+            return kError;
+        }
+        return kFinish;
+    }
+
+    LOG((CLOG_ERR "clipboard transmission failed: unknown error"));
+    m_receiving = false;
+    return kError;
+}
+
+void
+ClipboardReceiver::takeClipboard(Clipboard* clipboard, IClipboard::Time time)
+{
+    assert(clipboard != NULL);
+    assert(m_state == kDone);
+
+    clipboard->open(time);
+    clipboard->empty();
+    for (UInt32 format = 0; format != IClipboard::kNumFormats; ++format) {
+        if (m_added[format]) {
+            clipboard->add(static_cast<IClipboard::EFormat>(format),
+                            std::move(m_data[format]));
+        }
+    }
+    clipboard->close();
+
+    reset();
+}
+
+void
+ClipboardReceiver::reset()
+{
+    m_size        = 0;
+    m_state       = kNumFormats;
+    m_headerSize  = 0;
+    m_formatsLeft = 0;
+    m_format      = 0;
+    m_dataLeft    = 0;
+    for (UInt32 format = 0; format != IClipboard::kNumFormats; ++format) {
+        m_added[format] = false;
+        String().swap(m_data[format]);
+    }
+}
+
+bool
+ClipboardReceiver::unmarshall(const char* data, size_t n)
+{
+    while (n > 0) {
+        if (m_state == kDone) {
+            // more data than the formats say there is
+            return false;
+        }
+
+        if (m_state == kFormatData) {
+            const size_t count = std::min<size_t>(n, m_dataLeft);
+            if (m_format < IClipboard::kNumFormats) {
+                m_data[m_format].append(data, count);
+            }
+            data       += count;
+            n          -= count;
+            m_dataLeft -= static_cast<UInt32>(count);
+            if (m_dataLeft == 0) {
+                m_state = (--m_formatsLeft == 0) ? kDone : kFormat;
+            }
+            continue;
+        }
+
+        // collect the next integer
+        const size_t count = std::min<size_t>(n, 4 - m_headerSize);
+        std::copy(data, data + count, m_header + m_headerSize);
+        data         += count;
+        n            -= count;
+        m_headerSize += static_cast<UInt32>(count);
+        if (m_headerSize < 4) {
+            break;
+        }
+        m_headerSize = 0;
+        UInt32 value;
+        FieldInt<4>::decode(reinterpret_cast<const UInt8*>(m_header), &value);
+
+        switch (m_state) {
+        case kNumFormats:
+            m_formatsLeft = value;
+            m_state       = (m_formatsLeft == 0) ? kDone : kFormat;
+            break;
+
+        case kFormat:
+            m_format = value;
+            m_state  = kFormatSize;
+            break;
+
+        case kFormatSize:
+            if (value > m_expectedSize - m_size + n) {
+                // more data than is coming
+                return false;
+            }
+            m_dataLeft = value;
+            m_state    = kFormatData;
+
+            // formats the other side knows but we don't are skipped
+            if (m_format < IClipboard::kNumFormats) {
+                m_added[m_format] = true;
+                m_data[m_format].clear();
+                m_data[m_format].reserve(value);
+            }
+            if (m_dataLeft == 0) {
+                m_state = (--m_formatsLeft == 0) ? kDone : kFormat;
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+    return true;
+}
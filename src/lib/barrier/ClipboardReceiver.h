@@ -0,0 +1,113 @@
+/*
+ * barrier -- mouse and keyboard sharing utility
+ * Copyright (C) 2018 Debauchee Open Source Group
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file LICENSE that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "barrier/IClipboard.h"
+#include "barrier/clipboard_types.h"
+#include "base/String.h"
+
+class Clipboard;
+namespace barrier { class IStream; }
+
+//! Clipboard data receiver
+/*!
+Reads the clipboard chunk messages sent by a ClipboardSender.  Each
+chunk is unmarshalled as it arrives, straight into the data for its
+clipboard format, so the marshalled clipboard is never held in full.
+Keep one receiver per stream.
+*/
+class ClipboardReceiver {
+public:
+    ClipboardReceiver();
+
+    //! @name manipulators
+    //@{
+
+    //! Read a clipboard chunk
+    /*!
+    Reads a clipboard chunk message, whose code the caller has already
+    read, from \p stream.  Returns \c kStart for the first chunk of a
+    clipboard, \c kNotFinish for the data, \c kFinish when the clipboard
+    has been received and \c kError if the chunk can't be read or the
+    data is corrupt.  A start discards any clipboard partly received.
+    */
+    int                    read(barrier::IStream* stream);
+
+    //! Take the received clipboard
+    /*!
+    Moves the clipboard received when read() last returned \c kFinish
+    into \p clipboard, replacing its contents, and sets the clipboard
+    time to \p time.
+    */
+    void                takeClipboard(Clipboard* clipboard,
+                            IClipboard::Time time);
+
+    //@}
+    //! @name accessors
+    //@{
+
+    //! Get the id of the clipboard being received
+    ClipboardID            getID() const { return m_id; }
+
+    //! Get the sequence number of the clipboard being received
+    UInt32                getSequence() const { return m_sequence; }
+
+    //! Get the marshalled size of the clipboard being received
+    size_t                getExpectedSize() const { return m_expectedSize; }
+
+    //! Get the number of marshalled bytes received so far
+    size_t                getSize() const { return m_size; }
+
+    //@}
+
+private:
+    enum EState {
+        kNumFormats,
+        kFormat,
+        kFormatSize,
+        kFormatData,
+        kDone
+    };
+
+    void                reset();
+
+    // unmarshall the next n bytes of the clipboard.  returns false if
+    // they're not valid marshalled clipboard data.
+    bool                unmarshall(const char* data, size_t n);
+
+private:
+    ClipboardID            m_id;
+    UInt32                m_sequence;
+    bool                m_receiving;
+    size_t                m_expectedSize;
+    size_t                m_size;
+
+    // the chunk being read
+    String                m_chunk;
+
+    // unmarshalling state.  integers are collected in m_header in case
+    // they're split across chunks.
+    EState                m_state;
+    char                m_header[4];
+    UInt32                m_headerSize;
+    UInt32                m_formatsLeft;
+    UInt32                m_format;
+    UInt32                m_dataLeft;
+    bool                m_added[IClipboard::kNumFormats];
+    String                m_data[IClipboard::kNumFormats];
+};
@@ -0,0 +1,131 @@
+/*
+ * barrier -- mouse and keyboard sharing utility
+ * Copyright (C) 2018 Debauchee Open Source Group
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file LICENSE that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "barrier/ClipboardSender.h"
+
+#include "barrier/ProtocolMessage.h"
+#include "barrier/protocol_types.h"
+#include "io/IStream.h"
+#include "base/IEventQueue.h"
+#include "base/TMethodEventJob.h"
+#include "base/Log.h"
+
+#include <algorithm>
+
+static const size_t g_chunkSize  = 32 * 1024;   // 32kb
+static const size_t g_windowSize = 512 * 1024;  // 512kb
+
+//
+// ClipboardSender
+//
+
+ClipboardSender::ClipboardSender(barrier::IStream* stream, IEventQueue* events) :
+    m_stream(stream),
+    m_events(events),
+    m_target(stream->getEventTarget())
+{
+    m_events->adoptHandler(m_events->forIStream().outputFlushed(),
+                            m_target,
+                            new TMethodEventJob<ClipboardSender>(this,
+                                &ClipboardSender::handleOutputFlushed));
+}
+
+ClipboardSender::~ClipboardSender()
+{
+    m_events->removeHandler(m_events->forIStream().outputFlushed(), m_target);
+}
+
+void
+ClipboardSender::send(ClipboardID id, UInt32 sequence, const Data& data)
+{
+    // replace data that hasn't been sent for this clipboard.  if it's
+    // being sent then start it again; the receiver discards what it got
+    // so far when it sees the new start.
+    for (std::deque<Transfer>::iterator i = m_queue.begin();
+                            i != m_queue.end(); ++i) {
+        if (i->m_id == id) {
+            i->m_sequence = sequence;
+            i->m_data     = data;
+            i->m_sent     = 0;
+            i->m_started  = false;
+            return;
+        }
+    }
+
+    Transfer transfer;
+    transfer.m_id       = id;
+    transfer.m_sequence = sequence;
+    transfer.m_data     = data;
+    transfer.m_sent     = 0;
+    transfer.m_started  = false;
+    m_queue.push_back(transfer);
+
+    // if another transfer is in progress this one follows it when the
+    // stream has flushed
+    if (m_queue.size() == 1) {
+        sendWindow();
+    }
+}
+
+bool
+ClipboardSender::isSending() const
+{
+    return !m_queue.empty();
+}
+
+void
+ClipboardSender::sendWindow()
+{
+    size_t written = 0;
+    while (!m_queue.empty() && written < g_windowSize) {
+        Transfer& transfer = m_queue.front();
+        const size_t size  = transfer.m_data->size();
+
+        if (!transfer.m_started) {
+            LOG((CLOG_DEBUG "sending clipboard %d size=%d", transfer.m_id, size));
+            MsgDClipboard::write(m_stream, transfer.m_id, transfer.m_sequence,
+                            kDataStart, barrier::string::sizeTypeToString(size));
+            transfer.m_started = true;
+        }
+
+        // each chunk goes straight from the data to the stream
+        while (transfer.m_sent < size && written < g_windowSize) {
+            const size_t n = std::min(g_chunkSize, size - transfer.m_sent);
+            MsgDClipboard::writeSpan(m_stream,
+                            transfer.m_data->data() + transfer.m_sent,
+                            static_cast<UInt32>(n),
+                            transfer.m_id, transfer.m_sequence, kDataChunk);
+            transfer.m_sent += n;
+            written         += n;
+        }
+
+        if (transfer.m_sent == size) {
+            MsgDClipboard::write(m_stream, transfer.m_id, transfer.m_sequence,
+                            kDataEnd, String());
+            LOG((CLOG_DEBUG "sent clipboard size=%d", size));
+            m_queue.pop_front();
+        }
+    }
+}
+
+void
+ClipboardSender::handleOutputFlushed(const Event&, void*)
+{
+    if (!m_queue.empty()) {
+        sendWindow();
+    }
+}
@@ -0,0 +1,91 @@
+/*
+ * barrier -- mouse and keyboard sharing utility
+ * Copyright (C) 2018 Debauchee Open Source Group
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file LICENSE that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "barrier/clipboard_types.h"
+#include "base/String.h"
+
+#include <deque>
+#include <memory>
+
+class Event;
+class IEventQueue;
+namespace barrier { class IStream; }
+
+//! Clipboard data sender
+/*!
+Sends marshalled clipboard data to a stream as clipboard chunk messages.
+Chunks are written straight from the caller's buffer, which is kept
+until the last chunk is written.  Only a window of chunks is written at
+a time; the rest follow as the stream's output is flushed, so the
+stream never buffers more than a window of a large clipboard.
+*/
+class ClipboardSender {
+public:
+    typedef std::shared_ptr<const String> Data;
+
+    ClipboardSender(barrier::IStream* stream, IEventQueue* events);
+    ~ClipboardSender();
+
+    //! @name manipulators
+    //@{
+
+    //! Send clipboard data
+    /*!
+    Queues \p data, marshalled clipboard \p id, to be sent with sequence
+    number \p sequence.  Data not yet sent for the same clipboard is
+    dropped, including the rest of a transfer in progress, since the
+    receiver only needs the latest.  Small clipboards are sent before
+    this returns.
+    */
+    void                send(ClipboardID id, UInt32 sequence, const Data& data);
+
+    //@}
+    //! @name accessors
+    //@{
+
+    //! Test if sending
+    /*!
+    Returns true iff there's clipboard data that hasn't been written to
+    the stream yet.
+    */
+    bool                isSending() const;
+
+    //@}
+
+private:
+    class Transfer {
+    public:
+        ClipboardID        m_id;
+        UInt32            m_sequence;
+        Data            m_data;
+        size_t            m_sent;
+        bool            m_started;
+    };
+
+    // write the head transfer's chunks until the window is full
+    void                sendWindow();
+
+    void                handleOutputFlushed(const Event&, void*);
+
+private:
+    barrier::IStream*    m_stream;
+    IEventQueue*        m_events;
+    void*                m_target;
+    std::deque<Transfer> m_queue;
+};
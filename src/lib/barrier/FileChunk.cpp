@@ -17,20 +17,28 @@
 
 #include "barrier/FileChunk.h"
 
-#include "barrier/ProtocolUtil.h"
+#include "barrier/ProtocolMessage.h"
+#include "barrier/StreamChunker.h"
 #include "barrier/protocol_types.h"
 #include "io/IStream.h"
-#include "base/Stopwatch.h"
 #include "base/Log.h"
 
-static const UInt16 kIntervalThreshold = 1;
+#include <istream>
 
 FileChunk::FileChunk(size_t size) :
-    Chunk(size)
+    Chunk(size),
+    m_inWindow(false)
 {
         m_dataSize = size - FILE_CHUNK_META_SIZE;
 }
 
+FileChunk::~FileChunk()
+{
+    if (m_inWindow) {
+        StreamChunker::chunkDone();
+    }
+}
+
 FileChunk*
 FileChunk::start(const String& size)
 {
@@ -56,6 +64,21 @@ FileChunk::data(UInt8* data, size_t dataSize)
     return chunk;
 }
 
+FileChunk*
+FileChunk::data(std::istream& source, size_t dataSize)
+{
+    FileChunk* chunk = new FileChunk(dataSize + FILE_CHUNK_META_SIZE);
+    char* chunkData = chunk->m_chunk;
+    chunkData[0] = kDataChunk;
+    if (!source.read(&chunkData[1], dataSize)) {
+        delete chunk;
+        return NULL;
+    }
+    chunkData[dataSize + 1] = '\0';
+
+    return chunk;
+}
+
 FileChunk*
 FileChunk::end()
 {
@@ -67,84 +90,16 @@ FileChunk::end()
     return end;
 }
 
-int
-FileChunk::assemble(barrier::IStream* stream, String& dataReceived, size_t& expectedSize)
-{
-    // parse
-    UInt8 mark = 0;
-    String content;
-    static size_t receivedDataSize;
-    static double elapsedTime;
-    static Stopwatch stopwatch;
-
-    if (!ProtocolUtil::readf(stream, kMsgDFileTransfer + 4, &mark, &content)) {
-        return kError;
-    }
-
-    switch (mark) {
-    case kDataStart:
-        dataReceived.clear();
-        expectedSize = barrier::string::stringToSizeType(content);
-        receivedDataSize = 0;
-        elapsedTime = 0;
-        stopwatch.reset();
-
-        if (CLOG->getFilter() >= kDEBUG2) {
-            LOG((CLOG_DEBUG2 "recv file size=%s", content.c_str()));
-            stopwatch.start();
-        }
-        return kStart;
-
-    case kDataChunk:
-        dataReceived.append(content);
-        if (CLOG->getFilter() >= kDEBUG2) {
-                LOG((CLOG_DEBUG2 "recv file chunck size=%i", content.size()));
-                double interval = stopwatch.getTime();
-                receivedDataSize += content.size();
-                LOG((CLOG_DEBUG2 "recv file interval=%f s", interval));
-                if (interval >= kIntervalThreshold) {
-                    double averageSpeed = receivedDataSize / interval / 1000;
-                    LOG((CLOG_DEBUG2 "recv file average speed=%f kb/s", averageSpeed));
-
-                    receivedDataSize = 0;
-                    elapsedTime += interval;
-                    stopwatch.reset();
-                }
-            }
-        return kNotFinish;
-
-    case kDataEnd:
-        if (expectedSize != dataReceived.size()) {
-            LOG((CLOG_ERR "corrupted clipboard data, expected size=%d actual size=%d", expectedSize, dataReceived.size()));
-            return kError;
-        }
-
-        if (CLOG->getFilter() >= kDEBUG2) {
-            LOG((CLOG_DEBUG2 "file transfer finished"));
-            elapsedTime += stopwatch.getTime();
-            double averageSpeed = expectedSize / elapsedTime / 1000;
-            LOG((CLOG_DEBUG2 "file transfer finished: total time consumed=%f s", elapsedTime));
-            LOG((CLOG_DEBUG2 "file transfer finished: total data received=%i kb", expectedSize / 1000));
-            LOG((CLOG_DEBUG2 "file transfer finished: total average speed=%f kb/s", averageSpeed));
-        }
-        return kFinish;
-    }
-
-    return kError;
-}
-
 void
 FileChunk::send(barrier::IStream* stream, UInt8 mark, char* data, size_t dataSize)
 {
-    String chunk(data, dataSize);
-
     switch (mark) {
     case kDataStart:
         LOG((CLOG_DEBUG2 "sending file chunk start: size=%s", data));
         break;
 
     case kDataChunk:
-        LOG((CLOG_DEBUG2 "sending file chunk: size=%i", chunk.size()));
+        LOG((CLOG_DEBUG2 "sending file chunk: size=%i", dataSize));
         break;
 
     case kDataEnd:
@@ -152,5 +107,6 @@ FileChunk::send(barrier::IStream* stream, UInt8 mark, char* data, size_t dataSiz
         break;
     }
 
-    ProtocolUtil::writef(stream, kMsgDFileTransfer, mark, &chunk);
+    MsgDFileTransfer::writeSpan(stream, data,
+                            static_cast<UInt32>(dataSize), mark);
 }
@@ -18,29 +18,43 @@
 #pragma once
 
 #include "barrier/Chunk.h"
+#include "base/Event.h"
 #include "base/String.h"
 #include "common/basic_types.h"
 
+#include <iosfwd>
+
 #define FILE_CHUNK_META_SIZE 2
 
 namespace barrier {
 class IStream;
 };
 
-class FileChunk : public Chunk {
+//! File transfer chunk
+/*!
+The data of a \c fileChunkSending event, set with \c setDataObject() so
+the chunk is deleted with the event.
+*/
+class FileChunk : public Chunk, public EventData {
 public:
     FileChunk(size_t size);
+    virtual ~FileChunk();
 
     static FileChunk*    start(const String& size);
     static FileChunk*    data(UInt8* data, size_t dataSize);
+    //! Read the next \p dataSize bytes of \p source into a new chunk
+    /*!
+    Returns NULL if \p source ends first.
+    */
+    static FileChunk*    data(std::istream& source, size_t dataSize);
     static FileChunk*    end();
-    static int            assemble(
-                            barrier::IStream* stream,
-                            String& dataCached,
-                            size_t& expectedSize);
     static void            send(
                             barrier::IStream* stream,
                             UInt8 mark,
                             char* data,
                             size_t dataSize);
+
+public:
+    //! True if the chunk is counted in StreamChunker's send window
+    bool                m_inWindow;
 };
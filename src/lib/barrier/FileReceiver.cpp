@@ -0,0 +1,274 @@
+/*
+ * barrier -- mouse and keyboard sharing utility
+ * Copyright (C) 2018 Debauchee Open Source Group
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file LICENSE that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "barrier/FileReceiver.h"
+
+#include "barrier/ProtocolMessage.h"
+#include "barrier/protocol_types.h"
+#include "base/Log.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+
+#if SYSAPI_WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const double        kIntervalThreshold = 1.0; // seconds
+
+// create a new file in the temporary directory and open it for writing.
+// the file must not exist already:  anybody can create files there, and
+// a link or file put there under a name we'd pick could redirect or
+// read what we write.  returns NULL if the file can't be created.
+static FILE*
+openTemporaryFile(String& path)
+{
+#if SYSAPI_WIN32
+    static std::atomic<UInt32> s_count(0);
+
+    char dir[MAX_PATH + 1];
+    DWORD n = GetTempPathA(sizeof(dir), dir);
+    String dirPath = (n != 0 && n < sizeof(dir)) ? String(dir, n) : String(".\\");
+    unsigned long pid = GetCurrentProcessId();
+
+    for (int tries = 0; tries < 100; ++tries) {
+        path = dirPath + barrier::string::sprintf("barrier-%lu-%u.part",
+                            pid, static_cast<UInt32>(++s_count));
+        HANDLE handle = CreateFileA(path.c_str(), GENERIC_WRITE, 0, NULL,
+                            CREATE_NEW, FILE_ATTRIBUTE_TEMPORARY, NULL);
+        if (handle == INVALID_HANDLE_VALUE) {
+            if (GetLastError() == ERROR_FILE_EXISTS) {
+                continue;
+            }
+            return NULL;
+        }
+
+        int fd = _open_osfhandle(reinterpret_cast<intptr_t>(handle), _O_BINARY);
+        if (fd == -1) {
+            CloseHandle(handle);
+            remove(path.c_str());
+            return NULL;
+        }
+        FILE* file = _fdopen(fd, "wb");
+        if (file == NULL) {
+            _close(fd);
+            remove(path.c_str());
+        }
+        return file;
+    }
+    return NULL;
+#else
+    const char* dir = getenv("TMPDIR");
+    path = (dir != NULL && dir[0] != '\0') ? dir : "/tmp";
+    path.append("/barrier-XXXXXX");
+
+    // mkstemp() creates the file, readable only by us, or fails
+    std::vector<char> name(path.begin(), path.end());
+    name.push_back('\0');
+    int fd = mkstemp(&name[0]);
+    if (fd == -1) {
+        return NULL;
+    }
+    path = &name[0];
+
+    FILE* file = fdopen(fd, "wb");
+    if (file == NULL) {
+        close(fd);
+        remove(path.c_str());
+    }
+    return file;
+#endif
+}
+
+//
+// FileReceiver
+//
+
+FileReceiver::FileReceiver() :
+    m_file(NULL),
+    m_expectedSize(0),
+    m_size(0),
+    m_finished(false),
+    m_failed(false),
+    m_intervalSize(0),
+    m_elapsedTime(0.0)
+{
+    // do nothing
+}
+
+FileReceiver::~FileReceiver()
+{
+    discard();
+}
+
+int
+FileReceiver::read(barrier::IStream* stream)
+{
+    UInt8 mark = 0;
+    if (!MsgDFileTransfer::read(stream, &mark, &m_chunk)) {
+        return kError;
+    }
+
+    switch (mark) {
+    case kDataStart:
+        discard();
+        m_expectedSize = barrier::string::stringToSizeType(m_chunk);
+        m_file = openTemporaryFile(m_path);
+        if (m_file == NULL) {
+            LOG((CLOG_ERR "can't receive file: can not create %s", m_path.c_str()));
+            m_path.clear();
+            m_failed = true;
+        }
+
+        m_intervalSize = 0;
+        m_elapsedTime  = 0.0;
+        m_stopwatch.reset();
+        LOG((CLOG_DEBUG2 "recv file size=%s", m_chunk.c_str()));
+        return kStart;
+
+    case kDataChunk:
+        if (m_failed || m_file == NULL) {
+            return kError;
+        }
+        m_size += m_chunk.size();
+        if (m_size > m_expectedSize) {
+            LOG((CLOG_ERR "corrupted file data, expected size=%d actual size=%d", m_expectedSize, m_size));
+            m_failed = true;
+            return kError;
+        }
+        if (fwrite(m_chunk.data(), 1, m_chunk.size(), m_file) !=
+                            m_chunk.size()) {
+            LOG((CLOG_ERR "can't receive file: write to %s failed", m_path.c_str()));
+            m_failed = true;
+            return kError;
+        }
+        if (Log::isEnabled(kDEBUG2)) {
+            logProgress(m_chunk.size());
+        }
+        return kNotFinish;
+
+    case kDataEnd: {
+        if (m_failed || m_file == NULL) {
+            return kError;
+        }
+#if !SYSAPI_WIN32
+        // mkstemp() left the file readable only by us.  give it the
+        // permissions any other new file would get before it's moved.
+        mode_t mask = umask(0);
+        umask(mask);
+        fchmod(fileno(m_file), 0666 & ~mask);
+#endif
+        int closed = fclose(m_file);
+        m_file = NULL;
+        if (closed != 0) {
+            LOG((CLOG_ERR "can't receive file: write to %s failed", m_path.c_str()));
+            m_failed = true;
+            return kError;
+        }
+        if (m_expectedSize != m_size) {
+            LOG((CLOG_ERR "corrupted file data, expected size=%d actual size=%d", m_expectedSize, m_size));
+            m_failed = true;
+            return kError;
+        }
+        m_finished = true;
+
+        if (Log::isEnabled(kDEBUG2)) {
+            m_elapsedTime += m_stopwatch.getTime();
+            double averageSpeed = m_expectedSize / m_elapsedTime / 1000;
+            LOG((CLOG_DEBUG2 "file transfer finished: total time consumed=%f s", m_elapsedTime));
+            LOG((CLOG_DEBUG2 "file transfer finished: total data received=%i kb", m_expectedSize / 1000));
+            LOG((CLOG_DEBUG2 "file transfer finished: total average speed=%f kb/s", averageSpeed));
+        }
+        return kFinish;
+    }
+    }
+
+    return kError;
+}
+
+bool
+FileReceiver::save(const String& path)
+{
+    if (!isComplete()) {
+        return false;
+    }
+
+    // the temporary directory may be on another file system, in which
+    // case the file is copied
+    remove(path.c_str());
+    if (rename(m_path.c_str(), path.c_str()) != 0) {
+        std::ifstream src(m_path.c_str(), std::ios::in | std::ios::binary);
+        std::ofstream dst(path.c_str(), std::ios::out | std::ios::binary |
+                            std::ios::trunc);
+        if (!src.is_open() || !dst.is_open() || !(dst << src.rdbuf())) {
+            LOG((CLOG_ERR "drop file failed: can not write %s", path.c_str()));
+            return false;
+        }
+        src.close();
+        remove(m_path.c_str());
+    }
+
+    m_path.clear();
+    m_finished = false;
+    return true;
+}
+
+bool
+FileReceiver::isComplete() const
+{
+    return (m_finished && !m_failed && m_size == m_expectedSize);
+}
+
+void
+FileReceiver::discard()
+{
+    if (m_file != NULL) {
+        fclose(m_file);
+        m_file = NULL;
+    }
+    if (!m_path.empty()) {
+        remove(m_path.c_str());
+        m_path.clear();
+    }
+    m_expectedSize = 0;
+    m_size         = 0;
+    m_finished     = false;
+    m_failed       = false;
+}
+
+void
+FileReceiver::logProgress(size_t n)
+{
+    LOG((CLOG_DEBUG2 "recv file chunk size=%i", n));
+    m_intervalSize += n;
+    double interval = m_stopwatch.getTime();
+    if (interval >= kIntervalThreshold) {
+        double averageSpeed = m_intervalSize / interval / 1000;
+        LOG((CLOG_DEBUG2 "recv file average speed=%f kb/s", averageSpeed));
+        m_intervalSize = 0;
+        m_elapsedTime += interval;
+        m_stopwatch.reset();
+    }
+}
@@ -0,0 +1,104 @@
+/*
+ * barrier -- mouse and keyboard sharing utility
+ * Copyright (C) 2018 Debauchee Open Source Group
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file LICENSE that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "base/Stopwatch.h"
+#include "base/String.h"
+#include "common/basic_types.h"
+
+#include <cstdio>
+
+namespace barrier { class IStream; }
+
+//! File transfer receiver
+/*!
+Reads the file chunk messages of a file transfer and writes each chunk
+to a temporary file as it arrives, so the file is never held in memory.
+The temporary file gets a new name that only this process can open.
+The file is moved to where it belongs with save().  Keep one receiver
+per stream.
+*/
+class FileReceiver {
+public:
+    FileReceiver();
+    ~FileReceiver();
+
+    //! @name manipulators
+    //@{
+
+    //! Read a file chunk
+    /*!
+    Reads a file chunk message, whose code the caller has already read,
+    from \p stream.  Returns \c kStart for the first chunk of a file,
+    \c kNotFinish for the data, \c kFinish at the end of the file and
+    \c kError if the chunk can't be read or written to the temporary
+    file.  A start discards any file partly received.
+    */
+    int                    read(barrier::IStream* stream);
+
+    //! Save the received file
+    /*!
+    Moves the file received when read() last returned \c kFinish to
+    \p path, replacing any file there.  Returns false if the file isn't
+    complete or can't be moved.
+    */
+    bool                save(const String& path);
+
+    //@}
+    //! @name accessors
+    //@{
+
+    //! Get the size of the file being received
+    size_t                getExpectedSize() const { return m_expectedSize; }
+
+    //! Get the number of bytes received so far
+    size_t                getSize() const { return m_size; }
+
+    //! Test if a file has been received
+    /*!
+    Returns true iff the transfer has finished with every byte of the
+    file received.
+    */
+    bool                isComplete() const;
+
+    //@}
+
+private:
+    // close and delete the temporary file of any file received or partly
+    // received
+    void                discard();
+
+    // update the transfer rate in the log every second
+    void                logProgress(size_t n);
+
+private:
+    String                m_path;
+    FILE*                m_file;
+    size_t                m_expectedSize;
+    size_t                m_size;
+    bool                m_finished;
+    bool                m_failed;
+
+    // the chunk being read
+    String                m_chunk;
+
+    // for logging the transfer rate
+    Stopwatch            m_stopwatch;
+    size_t                m_intervalSize;
+    double                m_elapsedTime;
+};
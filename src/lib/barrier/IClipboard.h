@@ -163,7 +163,7 @@ public:
 
     //@}
 
-private:
+protected:
     static UInt32        readUInt32(const char*);
     static void            writeUInt32(String*, UInt32);
 };
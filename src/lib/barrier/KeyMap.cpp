@@ -20,6 +20,7 @@
 #include "barrier/key_types.h"
 #include "base/Log.h"
 
+#include <algorithm>
 #include <assert.h>
 #include <cctype>
 #include <cstdlib>
@@ -55,6 +56,8 @@ void
 KeyMap::swap(KeyMap& x)
 {
     m_keyIDMap.swap(x.m_keyIDMap);
+    m_keyIDs.swap(x.m_keyIDs);
+    m_keyGroupTables.swap(x.m_keyGroupTables);
     m_modifierKeys.swap(x.m_modifierKeys);
     m_halfDuplex.swap(x.m_halfDuplex);
     m_halfDuplexMods.swap(x.m_halfDuplexMods);
@@ -79,7 +82,7 @@ KeyMap::addKeyEntry(const KeyItem& item)
     if (getNumGroups() > numGroups) {
         numGroups = getNumGroups();
     }
-    KeyGroupTable& groupTable = m_keyIDMap[item.m_id];
+    KeyGroupTable& groupTable = getKeyGroupTable(item.m_id);
     if (groupTable.size() < static_cast<size_t>(numGroups)) {
         groupTable.resize(numGroups);
     }
@@ -151,7 +154,7 @@ KeyMap::addKeyCombinationEntry(KeyID id, SInt32 group,
     if (getNumGroups() > numGroups) {
         numGroups = getNumGroups();
     }
-    KeyGroupTable& groupTable = m_keyIDMap[id];
+    KeyGroupTable& groupTable = getKeyGroupTable(id);
     if (groupTable.size() < static_cast<size_t>(numGroups)) {
         groupTable.resize(numGroups);
     }
@@ -163,11 +166,11 @@ KeyMap::addKeyCombinationEntry(KeyID id, SInt32 group,
     // convert to buttons
     KeyItemList items;
     for (UInt32 i = 0; i < numKeys; ++i) {
-        KeyIDMap::const_iterator gtIndex = m_keyIDMap.find(keys[i]);
-        if (gtIndex == m_keyIDMap.end()) {
+        const KeyGroupTable* keyGroupTable = findKeyGroupTable(keys[i]);
+        if (keyGroupTable == NULL) {
             return false;
         }
-        const KeyGroupTable& groupTable = gtIndex->second;
+        const KeyGroupTable& groupTable = *keyGroupTable;
 
         // if we allow group switching during composition then search all
         // groups for keys, otherwise search just the given group.
@@ -349,12 +352,12 @@ KeyMap::findCompatibleKey(KeyID id, SInt32 group,
 {
     assert(group >= 0 && group < getNumGroups());
 
-    KeyIDMap::const_iterator i = m_keyIDMap.find(id);
-    if (i == m_keyIDMap.end()) {
+    const KeyGroupTable* keyGroupTable = findKeyGroupTable(id);
+    if (keyGroupTable == NULL) {
         return NULL;
     }
 
-    const KeyEntryList& entries = i->second[group];
+    const KeyEntryList& entries = (*keyGroupTable)[group];
     for (size_t j = 0; j < entries.size(); ++j) {
         if ((entries[j].back().m_sensitive & sensitive) == 0 ||
             (entries[j].back().m_required & sensitive) ==
@@ -401,6 +404,22 @@ KeyMap::collectButtons(const ModifierToKeys& mods, ButtonToKeyMap& keys)
     }
 }
 
+bool
+KeyMap::hasSameButtons(const ModifierToKeys& a, const ModifierToKeys& b)
+{
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (ModifierToKeys::const_iterator i = a.begin(), j = b.begin();
+                                i != a.end(); ++i, ++j) {
+        if (i->first != j->first ||
+            i->second.m_button != j->second.m_button) {
+            return false;
+        }
+    }
+    return true;
+}
+
 void
 KeyMap::initModifierKey(KeyItem& item)
 {
@@ -470,6 +489,34 @@ KeyMap::findNumGroups() const
     return static_cast<SInt32>(max);
 }
 
+KeyMap::KeyGroupTable&
+KeyMap::getKeyGroupTable(KeyID id)
+{
+    std::vector<KeyID>::iterator index =
+        std::lower_bound(m_keyIDs.begin(), m_keyIDs.end(), id);
+    size_t n = index - m_keyIDs.begin();
+    if (index != m_keyIDs.end() && *index == id) {
+        return *m_keyGroupTables[n];
+    }
+
+    // new key.  map entries don't move so the index can point at them.
+    KeyGroupTable& groupTable = m_keyIDMap[id];
+    m_keyIDs.insert(index, id);
+    m_keyGroupTables.insert(m_keyGroupTables.begin() + n, &groupTable);
+    return groupTable;
+}
+
+const KeyMap::KeyGroupTable*
+KeyMap::findKeyGroupTable(KeyID id) const
+{
+    std::vector<KeyID>::const_iterator index =
+        std::lower_bound(m_keyIDs.begin(), m_keyIDs.end(), id);
+    if (index == m_keyIDs.end() || *index != id) {
+        return NULL;
+    }
+    return m_keyGroupTables[index - m_keyIDs.begin()];
+}
+
 void
 KeyMap::setModifierKeys()
 {
@@ -515,13 +562,13 @@ KeyMap::mapCommandKey(Keystrokes& keys, KeyID id, SInt32 group,
     static const KeyModifierMask s_overrideModifiers = 0xffffu;
 
     // find KeySym in table
-    KeyIDMap::const_iterator i = m_keyIDMap.find(id);
-    if (i == m_keyIDMap.end()) {
+    const KeyGroupTable* keyGroupTableIndex = findKeyGroupTable(id);
+    if (keyGroupTableIndex == NULL) {
         // unknown key
         LOG((CLOG_DEBUG1 "key %04x is not on keyboard", id));
         return NULL;
     }
-    const KeyGroupTable& keyGroupTable = i->second;
+    const KeyGroupTable& keyGroupTable = *keyGroupTableIndex;
 
     // find the first key that generates this KeyID
     const KeyItem* keyItem = NULL;
@@ -545,7 +592,7 @@ KeyMap::mapCommandKey(Keystrokes& keys, KeyID id, SInt32 group,
             KeyModifierMask requiredIgnoreShiftMask = item.m_required & ~KeyModifierShift;
             if ((item.m_required & desiredShiftMask) == (item.m_sensitive & desiredShiftMask) &&
                 ((requiredIgnoreShiftMask & desiredMask) == requiredIgnoreShiftMask)) {
-                LOG((CLOG_INFO "found key in group %d", effectiveGroup));
+                LOG((CLOG_DEBUG1 "found key in group %d", effectiveGroup));
                 keyItem = &item;
                 break;
             }
@@ -606,13 +653,13 @@ KeyMap::mapCharacterKey(Keystrokes& keys, KeyID id, SInt32 group,
                 bool isAutoRepeat) const
 {
     // find KeySym in table
-    KeyIDMap::const_iterator i = m_keyIDMap.find(id);
-    if (i == m_keyIDMap.end()) {
+    const KeyGroupTable* keyGroupTableIndex = findKeyGroupTable(id);
+    if (keyGroupTableIndex == NULL) {
         // unknown key
         LOG((CLOG_DEBUG1 "key %04x is not on keyboard", id));
         return NULL;
     }
-    const KeyGroupTable& keyGroupTable = i->second;
+    const KeyGroupTable& keyGroupTable = *keyGroupTableIndex;
 
     // find best key in any group, starting with the active group
     SInt32 keyIndex  = -1;
@@ -831,6 +878,12 @@ KeyMap::keysToRestoreModifiers(const KeyItem& keyItem, SInt32,
 {
     // XXX -- we're not considering modified modifiers here
 
+    // nothing to do if the same modifier keys are down.  this is the
+    // usual case so skip building the button maps.
+    if (hasSameButtons(activeModifiers, desiredModifiers)) {
+        return true;
+    }
+
     ModifierToKeys oldModifiers = activeModifiers;
 
     // get the pressed modifier buttons before and after
@@ -283,6 +283,15 @@ public:
     static void            collectButtons(const ModifierToKeys& modifiers,
                             ButtonToKeyMap& keys);
 
+    //! Compare modifier keys
+    /*!
+    Returns \c true iff \p a and \p b have the same buttons down for
+    the same modifiers.  It may return \c false for equal maps if the
+    keys were added in a different order.
+    */
+    static bool            hasSameButtons(const ModifierToKeys& a,
+                            const ModifierToKeys& b);
+
     //! Set modifier key state
     /*!
     Sets the modifier key state (\c m_generates and \c m_lock) in \p item
@@ -359,9 +368,20 @@ private:
     // A list of ways to synthesize a KeyID
     typedef std::vector<KeyItemList> KeyEntryList;
 
+    // Ways to synthesize a KeyID over multiple keyboard groups
+    typedef std::vector<KeyEntryList> KeyGroupTable;
+
     // computes the number of groups
     SInt32                findNumGroups() const;
 
+    // returns the ways to synthesize \p id, adding it to the table and
+    // the index if it's not already there
+    KeyGroupTable&        getKeyGroupTable(KeyID id);
+
+    // returns the ways to synthesize \p id or NULL if it's not in the
+    // table
+    const KeyGroupTable*    findKeyGroupTable(KeyID id) const;
+
     // computes the map of modifiers to the keys that generate the modifiers
     void                setModifierKeys();
 
@@ -465,9 +485,6 @@ private:
     KeyMap&            operator=(const KeyMap&);
 
 private:
-    // Ways to synthesize a KeyID over multiple keyboard groups
-    typedef std::vector<KeyEntryList> KeyGroupTable;
-
     // Table of KeyID to ways to synthesize that KeyID
     typedef std::map<KeyID, KeyGroupTable> KeyIDMap;
 
@@ -493,6 +510,11 @@ private:
 
     // KeyID info
     KeyIDMap            m_keyIDMap;
+
+    // sorted index of m_keyIDMap for lookups when mapping keys.  the
+    // group table for m_keyIDs[i] is *m_keyGroupTables[i].
+    std::vector<KeyID>    m_keyIDs;
+    std::vector<KeyGroupTable*> m_keyGroupTables;
     SInt32                m_numGroups;
     ModifierToKeyTable    m_modifierKeys;
 
@@ -565,7 +565,8 @@ KeyState::fakeKeyDown(KeyID id, KeyModifierMask mask, KeyButton serverID)
     }
 
     // get keys for key press
-    Keystrokes keys;
+    Keystrokes& keys = m_keystrokes;
+    keys.clear();
     ModifierToKeys oldActiveModifiers = m_activeModifiers;
     const barrier::KeyMap::KeyItem* keyItem =
         m_keyMap.mapKey(keys, id, pollActiveGroup(), m_activeModifiers,
@@ -613,7 +614,8 @@ KeyState::fakeKeyRepeat(
     }
 
     // get keys for key repeat
-    Keystrokes keys;
+    Keystrokes& keys = m_keystrokes;
+    keys.clear();
     ModifierToKeys oldActiveModifiers = m_activeModifiers;
     const barrier::KeyMap::KeyItem* keyItem =
         m_keyMap.mapKey(keys, id, pollActiveGroup(), m_activeModifiers,
@@ -671,7 +673,8 @@ KeyState::fakeKeyUp(KeyButton serverID)
     }
 
     // get the sequence of keys to simulate key release
-    Keystrokes keys;
+    Keystrokes& keys = m_keystrokes;
+    keys.clear();
     keys.push_back(Keystroke(localID, false, false, m_keyClientData[localID]));
 
     // note keys down
@@ -881,6 +884,11 @@ KeyState::updateModifierKeyState(KeyButton button,
                 const ModifierToKeys& oldModifiers,
                 const ModifierToKeys& newModifiers)
 {
+    // nothing changed if the same modifier keys are down
+    if (barrier::KeyMap::hasSameButtons(oldModifiers, newModifiers)) {
+        return;
+    }
+
     // get the pressed modifier buttons before and after
     barrier::KeyMap::ButtonToKeyMap oldKeys, newKeys;
     for (ModifierToKeys::const_iterator i = oldModifiers.begin();
@@ -210,6 +210,10 @@ private:
     // the active modifiers and the buttons activating them
     ModifierToKeys        m_activeModifiers;
 
+    // keystrokes for the key being synthesized.  kept between calls so
+    // faking a key doesn't allocate.
+    Keystrokes            m_keystrokes;
+
     // current keyboard state (> 0 if pressed, 0 otherwise).  this is
     // initialized to the keyboard state according to the system then
     // it tracks synthesized events.
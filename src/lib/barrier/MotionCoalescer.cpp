@@ -0,0 +1,100 @@
+/*
+ * barrier -- mouse and keyboard sharing utility
+ * Copyright (C) 2018 Debauchee Open Source Group
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file LICENSE that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "barrier/MotionCoalescer.h"
+
+//
+// MotionCoalescer
+//
+
+MotionCoalescer::MotionCoalescer() :
+    m_hasPosition(false),
+    m_x(0),
+    m_y(0),
+    m_dx(0.0),
+    m_dy(0.0),
+    m_eventsIn(0),
+    m_eventsOut(0)
+{
+    // do nothing
+}
+
+void
+MotionCoalescer::addPosition(SInt32 x, SInt32 y)
+{
+    m_hasPosition = true;
+    m_x           = x;
+    m_y           = y;
+    ++m_eventsIn;
+}
+
+void
+MotionCoalescer::addDelta(double dx, double dy)
+{
+    m_dx += dx;
+    m_dy += dy;
+    ++m_eventsIn;
+}
+
+bool
+MotionCoalescer::takePosition(SInt32& x, SInt32& y)
+{
+    if (!m_hasPosition) {
+        return false;
+    }
+    m_hasPosition = false;
+    x             = m_x;
+    y             = m_y;
+    ++m_eventsOut;
+    return true;
+}
+
+bool
+MotionCoalescer::takeDelta(SInt32& dx, SInt32& dy)
+{
+    // truncate toward zero so the fraction left has the same sign as
+    // the motion and can't add up to a pixel the other way
+    dx = static_cast<SInt32>(m_dx);
+    dy = static_cast<SInt32>(m_dy);
+    if (dx == 0 && dy == 0) {
+        return false;
+    }
+    m_dx -= dx;
+    m_dy -= dy;
+    ++m_eventsOut;
+    return true;
+}
+
+void
+MotionCoalescer::reset()
+{
+    m_hasPosition = false;
+    m_dx          = 0.0;
+    m_dy          = 0.0;
+}
+
+UInt32
+MotionCoalescer::getEventsIn() const
+{
+    return m_eventsIn;
+}
+
+UInt32
+MotionCoalescer::getEventsOut() const
+{
+    return m_eventsOut;
+}
@@ -0,0 +1,82 @@
+/*
+ * barrier -- mouse and keyboard sharing utility
+ * Copyright (C) 2018 Debauchee Open Source Group
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file LICENSE that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common/basic_types.h"
+
+//! Pointer motion coalescer
+/*!
+Collects the pointer motion in a burst of input events so that a screen
+can report it as a single motion event.  Only the latest absolute
+position is kept.  Relative motion is summed, and fractions of a pixel
+carry over to later bursts so slow motion isn't lost.
+*/
+class MotionCoalescer {
+public:
+    MotionCoalescer();
+
+    //! @name manipulators
+    //@{
+
+    //! Add motion to an absolute position
+    void                addPosition(SInt32 x, SInt32 y);
+
+    //! Add relative motion
+    void                addDelta(double dx, double dy);
+
+    //! Take the position
+    /*!
+    Sets \p x,y to the latest position and returns true, or returns
+    false if there's been no position since the last call.
+    */
+    bool                takePosition(SInt32& x, SInt32& y);
+
+    //! Take the relative motion
+    /*!
+    Sets \p dx,dy to the whole pixels of relative motion added since the
+    last call and returns true, or returns false if that's less than a
+    pixel.  Any fraction is kept for next time.
+    */
+    bool                takeDelta(SInt32& dx, SInt32& dy);
+
+    //! Discard motion
+    /*!
+    Forgets pending motion, including fractions of a pixel.  Use this
+    when the pointer jumps, e.g. on entering or leaving the screen.
+    */
+    void                reset();
+
+    //@}
+    //! @name accessors
+    //@{
+
+    //! Get the number of motion events added
+    UInt32                getEventsIn() const;
+
+    //! Get the number of positions and deltas taken
+    UInt32                getEventsOut() const;
+
+    //@}
+
+private:
+    bool                m_hasPosition;
+    SInt32                m_x, m_y;
+    double                m_dx, m_dy;
+    UInt32                m_eventsIn;
+    UInt32                m_eventsOut;
+};
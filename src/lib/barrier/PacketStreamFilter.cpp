@@ -23,6 +23,7 @@
 
 #include <cstring>
 #include <memory>
+#include <vector>
 
 //
 // PacketStreamFilter
@@ -71,37 +72,68 @@ PacketStreamFilter::read(void* buffer, UInt32 n)
     }
 
     // read it
-    if (buffer != NULL) {
-        memcpy(buffer, m_buffer.peek(n), n);
-    }
-    m_buffer.pop(n);
+    m_buffer.read(buffer, n);
     m_size -= n;
+    finishRead();
 
-    // get next packet's size if we've finished with this packet and
-    // there's enough data to do so.
-    readPacketSize();
+    return n;
+}
 
-    if (m_inputShutdown && m_size == 0) {
-        m_events->addEvent(Event(m_events->forIStream().inputShutdown(),
-                        getEventTarget(), NULL));
+UInt32
+PacketStreamFilter::readAll(StreamBuffer& buffer)
+{
+    Lock lock(&m_mutex);
+
+    // if not enough data yet then give up
+    if (!isReadyNoLock()) {
+        return 0;
     }
 
+    // move what's left of the buffered packet
+    UInt32 n = m_size;
+    buffer.append(m_buffer, n);
+    m_size = 0;
+    finishRead();
+
     return n;
 }
 
 void
 PacketStreamFilter::write(const void* buffer, UInt32 count)
 {
-    // write the length of the payload
+    StreamBuffer::Span payload = { buffer, count };
+    writev(&payload, 1);
+}
+
+void
+PacketStreamFilter::writev(const StreamBuffer::Span* buffers, UInt32 count)
+{
+    // the length of the payload goes in front of it.  hand both to the
+    // stream in one call so they're sent together.
+    const UInt32 kLocalSpans = 8;
+    StreamBuffer::Span localSpans[kLocalSpans];
+    std::vector<StreamBuffer::Span> heapSpans;
+    StreamBuffer::Span* spans = localSpans;
+    if (count + 1 > kLocalSpans) {
+        heapSpans.resize(count + 1);
+        spans = &heapSpans[0];
+    }
+
+    UInt32 size = 0;
+    for (UInt32 i = 0; i < count; ++i) {
+        spans[i + 1] = buffers[i];
+        size        += (UInt32)buffers[i].m_size;
+    }
+
     UInt8 length[4];
-    length[0] = (UInt8)((count >> 24) & 0xff);
-    length[1] = (UInt8)((count >> 16) & 0xff);
-    length[2] = (UInt8)((count >>  8) & 0xff);
-    length[3] = (UInt8)( count        & 0xff);
-    getStream()->write(length, sizeof(length));
-
-    // write the payload
-    getStream()->write(buffer, count);
+    length[0] = (UInt8)((size >> 24) & 0xff);
+    length[1] = (UInt8)((size >> 16) & 0xff);
+    length[2] = (UInt8)((size >>  8) & 0xff);
+    length[3] = (UInt8)( size        & 0xff);
+    spans[0].m_data = length;
+    spans[0].m_size = sizeof(length);
+
+    getStream()->writev(spans, count + 1);
 }
 
 void
@@ -140,8 +172,7 @@ PacketStreamFilter::readPacketSize()
 
     if (m_size == 0 && m_buffer.getSize() >= 4) {
         UInt8 buffer[4];
-        memcpy(buffer, m_buffer.peek(sizeof(buffer)), sizeof(buffer));
-        m_buffer.pop(sizeof(buffer));
+        m_buffer.read(buffer, sizeof(buffer));
         m_size = ((UInt32)buffer[0] << 24) |
                  ((UInt32)buffer[1] << 16) |
                  ((UInt32)buffer[2] <<  8) |
@@ -149,19 +180,30 @@ PacketStreamFilter::readPacketSize()
     }
 }
 
+void
+PacketStreamFilter::finishRead()
+{
+    // note -- m_mutex must be locked on entry
+
+    // get next packet's size if we've finished with this packet and
+    // there's enough data to do so.
+    readPacketSize();
+
+    if (m_inputShutdown && m_size == 0) {
+        m_events->addEvent(Event(m_events->forIStream().inputShutdown(),
+                        getEventTarget(), NULL));
+    }
+}
+
 bool
 PacketStreamFilter::readMore()
 {
     // note if we have whole packet
     bool wasReady = isReadyNoLock();
 
-    // read more data
-    char buffer[4096];
-    UInt32 n = getStream()->read(buffer, sizeof(buffer));
-    while (n > 0) {
-        m_buffer.write(buffer, n);
-        n = getStream()->read(buffer, sizeof(buffer));
-    }
+    // take everything the stream has buffered.  we usually have no
+    // partial packet left over so this just swaps buffers.
+    getStream()->readAll(m_buffer);
 
     // if we don't yet have the next packet size then get it,
     // if possible.
@@ -36,7 +36,10 @@ public:
     // IStream overrides
     virtual void        close();
     virtual UInt32        read(void* buffer, UInt32 n);
+    virtual UInt32        readAll(StreamBuffer& buffer);
     virtual void        write(const void* buffer, UInt32 n);
+    virtual void        writev(const StreamBuffer::Span* buffers,
+                            UInt32 count);
     virtual void        shutdownInput();
     virtual bool        isReady() const;
     virtual UInt32        getSize() const;
@@ -48,6 +51,7 @@ protected:
 private:
     bool                isReadyNoLock() const;
     void                readPacketSize();
+    void                finishRead();
     bool                readMore();
 
 private:
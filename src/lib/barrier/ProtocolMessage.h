@@ -0,0 +1,403 @@
+/*
+ * barrier -- mouse and keyboard sharing utility
+ * Copyright (C) 2018 Debauchee Open Source Group
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file LICENSE that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "barrier/ProtocolUtil.h"
+#include "barrier/protocol_types.h"
+#include "io/IStream.h"
+#include "io/XIO.h"
+#include "base/String.h"
+
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+//
+// typed protocol messages.  each message is described at compile time by
+// its code and the types of its fields, so writing one is a single stream
+// write from a buffer sized by the compiler (for messages without strings
+// or lists) and reading one takes a single stream read.  the bytes on the
+// wire are the same as ProtocolUtil::writef() produces for the message's
+// format string.
+//
+
+//! Unsigned integer type of \c N bytes
+template <UInt32 N> class ProtocolUInt;
+template <> class ProtocolUInt<1> { public: typedef UInt8 type; };
+template <> class ProtocolUInt<2> { public: typedef UInt16 type; };
+template <> class ProtocolUInt<4> { public: typedef UInt32 type; };
+
+//! \c N byte integer field in network byte order (\c \%Ni)
+/*!
+Writes any integer or enum value, truncated to \c N bytes.  Reads into a
+signed or unsigned integer of exactly \c N bytes.
+*/
+template <UInt32 N>
+class FieldInt {
+public:
+    static const bool    kFixed = true;
+    static const UInt32    kSize  = N;
+
+    template <class T>
+    static UInt32        size(const T&)
+    {
+        return N;
+    }
+
+    template <class T>
+    static UInt8*        encode(UInt8* dst, const T& value)
+    {
+        static_assert(std::is_integral<T>::value || std::is_enum<T>::value,
+                            "integer field written from a non-integer");
+        const UInt32 v = static_cast<UInt32>(value);
+        for (UInt32 i = 0; i < N; ++i) {
+            dst[i] = static_cast<UInt8>((v >> (8 * (N - 1 - i))) & 0xff);
+        }
+        return dst + N;
+    }
+
+    template <class T>
+    static const UInt8*    decode(const UInt8* src, T* value)
+    {
+        static_assert(std::is_integral<T>::value && sizeof(T) == N,
+                            "integer field read into a different size");
+        UInt32 v = 0;
+        for (UInt32 i = 0; i < N; ++i) {
+            v = (v << 8) | src[i];
+        }
+        *value = static_cast<T>(static_cast<typename ProtocolUInt<N>::type>(v));
+        return src + N;
+    }
+
+    template <class T>
+    static void            read(barrier::IStream* stream, T* value)
+    {
+        UInt8 buffer[N];
+        ProtocolUtil::read(stream, buffer, N);
+        decode(buffer, value);
+    }
+};
+
+//! Counted list of \c N byte integers in network byte order (\c \%NI)
+/*!
+Read values are appended to the list.
+*/
+template <UInt32 N>
+class FieldIntList {
+public:
+    typedef typename ProtocolUInt<N>::type Element;
+    typedef std::vector<Element> List;
+
+    static const bool    kFixed = false;
+    static const UInt32    kSize  = 0;
+
+    static UInt32        size(const List& list)
+    {
+        return 4 + N * static_cast<UInt32>(list.size());
+    }
+
+    static UInt8*        encode(UInt8* dst, const List& list)
+    {
+        dst = FieldInt<4>::encode(dst, static_cast<UInt32>(list.size()));
+        for (typename List::const_iterator i = list.begin();
+                            i != list.end(); ++i) {
+            dst = FieldInt<N>::encode(dst, *i);
+        }
+        return dst;
+    }
+
+    static void            read(barrier::IStream* stream, List* list)
+    {
+        UInt32 n;
+        FieldInt<4>::read(stream, &n);
+        for (UInt32 i = 0; i < n; ++i) {
+            Element value;
+            FieldInt<N>::read(stream, &value);
+            list->push_back(value);
+        }
+    }
+};
+
+//! Counted string of bytes (\c \%s)
+class FieldString {
+public:
+    static const bool    kFixed = false;
+    static const UInt32    kSize  = 0;
+
+    static UInt32        size(const String& value)
+    {
+        return 4 + static_cast<UInt32>(value.size());
+    }
+
+    static UInt8*        encode(UInt8* dst, const String& value)
+    {
+        const UInt32 n = static_cast<UInt32>(value.size());
+        dst = FieldInt<4>::encode(dst, n);
+        if (n != 0) {
+            memcpy(dst, value.data(), n);
+        }
+        return dst + n;
+    }
+
+    static void            read(barrier::IStream* stream, String* value)
+    {
+        UInt32 n;
+        FieldInt<4>::read(stream, &n);
+        value->resize(n);
+        if (n != 0) {
+            ProtocolUtil::read(stream, &(*value)[0], n);
+        }
+    }
+};
+
+//! Sequence of message fields
+template <class... Fields>
+class ProtocolFields;
+
+template <>
+class ProtocolFields<> {
+public:
+    static const bool    kFixed = true;
+    static const UInt32    kSize  = 0;
+
+    static UInt32        size() { return 0; }
+    static UInt8*        encode(UInt8* dst) { return dst; }
+    static const UInt8*    decode(const UInt8* src) { return src; }
+    static void            read(barrier::IStream*) { }
+};
+
+template <class Field, class... Rest>
+class ProtocolFields<Field, Rest...> {
+public:
+    typedef ProtocolFields<Rest...> Next;
+
+    static const bool    kFixed = Field::kFixed && Next::kFixed;
+    static const UInt32    kSize  = Field::kSize + Next::kSize;
+
+    template <class Arg, class... Args>
+    static UInt32        size(const Arg& arg, const Args&... args)
+    {
+        return Field::size(arg) + Next::size(args...);
+    }
+
+    template <class Arg, class... Args>
+    static UInt8*        encode(UInt8* dst, const Arg& arg, const Args&... args)
+    {
+        return Next::encode(Field::encode(dst, arg), args...);
+    }
+
+    template <class Arg, class... Args>
+    static const UInt8*    decode(const UInt8* src, Arg* arg, Args*... args)
+    {
+        return Next::decode(Field::decode(src, arg), args...);
+    }
+
+    template <class Arg, class... Args>
+    static void            read(barrier::IStream* stream,
+                            Arg* arg, Args*... args)
+    {
+        Field::read(stream, arg);
+        Next::read(stream, args...);
+    }
+};
+
+//! Protocol message
+/*!
+A message with the 4 byte code \c Code (see EMessageCode) followed by
+\c Fields.  For example, \c kMsgDMouseMove ("DMMV%2i%2i") is
+\c ProtocolMessage<kMsgCodeDMouseMove, FieldInt<2>, FieldInt<2>>.
+*/
+template <UInt32 Code, class... Fields>
+class ProtocolMessage {
+public:
+    typedef ProtocolFields<Fields...> Body;
+
+    //! True if the message has no strings or lists
+    static const bool    kFixed = Body::kFixed;
+
+    //! Size of the message including its code, if \c kFixed
+    static const UInt32    kSize  = 4 + Body::kSize;
+
+    //! Write message
+    /*!
+    Writes the code and \c args, one per field, to \c stream with a
+    single write.
+    */
+    template <class... Args>
+    static void            write(barrier::IStream* stream, const Args&... args)
+    {
+        static_assert(sizeof...(Args) == sizeof...(Fields),
+                            "wrong number of message fields");
+        writeBody(stream, std::integral_constant<bool, kFixed>(), args...);
+    }
+
+    //! Write message without copying its string
+    /*!
+    Like \c write() for a message whose last field is a \c FieldString,
+    but the string is the \p n bytes at \p data and is handed to the
+    stream as the second buffer of a single \c writev() rather than
+    copied into the message.  \c args are the fields before it.
+    */
+    template <class... Args>
+    static void            writeSpan(barrier::IStream* stream,
+                            const void* data, UInt32 n, const Args&... args)
+    {
+        static_assert(sizeof...(Args) + 1 == sizeof...(Fields),
+                            "wrong number of message fields");
+
+        // encode the message with an empty string then patch in the
+        // string's length
+        const String empty;
+        const UInt32 size = 4 + Body::size(args..., empty);
+        UInt8 fixedBuffer[256];
+        std::vector<UInt8> buffer;
+        UInt8* header = fixedBuffer;
+        if (size > sizeof(fixedBuffer)) {
+            buffer.resize(size);
+            header = &buffer[0];
+        }
+        UInt8* end = Body::encode(FieldInt<4>::encode(header, Code),
+                            args..., empty);
+        FieldInt<4>::encode(end - 4, n);
+
+        StreamBuffer::Span spans[2] = { { header, size }, { data, n } };
+        stream->writev(spans, 2);
+    }
+
+    //! Read message
+    /*!
+    Reads the fields following the message's code, which the caller has
+    already read, from \c stream into \c args.  Returns false if the
+    stream ends first.
+    */
+    template <class... Args>
+    static bool            read(barrier::IStream* stream, Args*... args)
+    {
+        static_assert(sizeof...(Args) == sizeof...(Fields),
+                            "wrong number of message fields");
+        try {
+            readBody(stream, std::integral_constant<bool, kFixed>(), args...);
+            return true;
+        }
+        catch (XIO&) {
+            return false;
+        }
+    }
+
+private:
+    template <class... Args>
+    static void            writeBody(barrier::IStream* stream,
+                            std::true_type, const Args&... args)
+    {
+        UInt8 buffer[kSize];
+        Body::encode(FieldInt<4>::encode(buffer, Code), args...);
+        stream->write(buffer, kSize);
+    }
+
+    template <class... Args>
+    static void            writeBody(barrier::IStream* stream,
+                            std::false_type, const Args&... args)
+    {
+        const UInt32 size = 4 + Body::size(args...);
+        UInt8 fixedBuffer[256];
+        std::vector<UInt8> buffer;
+        UInt8* data = fixedBuffer;
+        if (size > sizeof(fixedBuffer)) {
+            buffer.resize(size);
+            data = &buffer[0];
+        }
+        Body::encode(FieldInt<4>::encode(data, Code), args...);
+        stream->write(data, size);
+    }
+
+    template <class... Args>
+    static void            readBody(barrier::IStream* stream,
+                            std::true_type, Args*... args)
+    {
+        // one byte more than needed so a message without fields still
+        // has a buffer
+        UInt8 buffer[kSize - 4 + 1];
+        ProtocolUtil::read(stream, buffer, kSize - 4);
+        Body::decode(buffer, args...);
+    }
+
+    template <class... Args>
+    static void            readBody(barrier::IStream* stream,
+                            std::false_type, Args*... args)
+    {
+        Body::read(stream, args...);
+    }
+};
+
+template <UInt32 Code, class... Fields>
+const bool ProtocolMessage<Code, Fields...>::kFixed;
+template <UInt32 Code, class... Fields>
+const UInt32 ProtocolMessage<Code, Fields...>::kSize;
+
+//
+// barrier protocol messages.  see protocol_types.h for their fields.
+//
+
+typedef ProtocolMessage<kMsgCodeCNoop> MsgCNoop;
+typedef ProtocolMessage<kMsgCodeCClose> MsgCClose;
+typedef ProtocolMessage<kMsgCodeCEnter,
+            FieldInt<2>, FieldInt<2>, FieldInt<4>, FieldInt<2> > MsgCEnter;
+typedef ProtocolMessage<kMsgCodeCLeave> MsgCLeave;
+typedef ProtocolMessage<kMsgCodeCClipboard,
+            FieldInt<1>, FieldInt<4> > MsgCClipboard;
+typedef ProtocolMessage<kMsgCodeCScreenSaver, FieldInt<1> > MsgCScreenSaver;
+typedef ProtocolMessage<kMsgCodeCResetOptions> MsgCResetOptions;
+typedef ProtocolMessage<kMsgCodeCInfoAck> MsgCInfoAck;
+typedef ProtocolMessage<kMsgCodeCKeepAlive> MsgCKeepAlive;
+typedef ProtocolMessage<kMsgCodeDKeyDown,
+            FieldInt<2>, FieldInt<2>, FieldInt<2> > MsgDKeyDown;
+typedef ProtocolMessage<kMsgCodeDKeyDown,
+            FieldInt<2>, FieldInt<2> > MsgDKeyDown1_0;
+typedef ProtocolMessage<kMsgCodeDKeyRepeat,
+            FieldInt<2>, FieldInt<2>, FieldInt<2>, FieldInt<2> > MsgDKeyRepeat;
+typedef ProtocolMessage<kMsgCodeDKeyRepeat,
+            FieldInt<2>, FieldInt<2>, FieldInt<2> > MsgDKeyRepeat1_0;
+typedef ProtocolMessage<kMsgCodeDKeyUp,
+            FieldInt<2>, FieldInt<2>, FieldInt<2> > MsgDKeyUp;
+typedef ProtocolMessage<kMsgCodeDKeyUp,
+            FieldInt<2>, FieldInt<2> > MsgDKeyUp1_0;
+typedef ProtocolMessage<kMsgCodeDMouseDown, FieldInt<1> > MsgDMouseDown;
+typedef ProtocolMessage<kMsgCodeDMouseUp, FieldInt<1> > MsgDMouseUp;
+typedef ProtocolMessage<kMsgCodeDMouseMove,
+            FieldInt<2>, FieldInt<2> > MsgDMouseMove;
+typedef ProtocolMessage<kMsgCodeDMouseRelMove,
+            FieldInt<2>, FieldInt<2> > MsgDMouseRelMove;
+typedef ProtocolMessage<kMsgCodeDMouseWheel,
+            FieldInt<2>, FieldInt<2> > MsgDMouseWheel;
+typedef ProtocolMessage<kMsgCodeDMouseWheel, FieldInt<2> > MsgDMouseWheel1_0;
+typedef ProtocolMessage<kMsgCodeDClipboard,
+            FieldInt<1>, FieldInt<4>, FieldInt<1>, FieldString> MsgDClipboard;
+typedef ProtocolMessage<kMsgCodeDInfo,
+            FieldInt<2>, FieldInt<2>, FieldInt<2>, FieldInt<2>,
+            FieldInt<2>, FieldInt<2>, FieldInt<2> > MsgDInfo;
+typedef ProtocolMessage<kMsgCodeDSetOptions, FieldIntList<4> > MsgDSetOptions;
+typedef ProtocolMessage<kMsgCodeDFileTransfer,
+            FieldInt<1>, FieldString> MsgDFileTransfer;
+typedef ProtocolMessage<kMsgCodeDDragInfo,
+            FieldInt<2>, FieldString> MsgDDragInfo;
+typedef ProtocolMessage<kMsgCodeQInfo> MsgQInfo;
+typedef ProtocolMessage<kMsgCodeEIncompatible,
+            FieldInt<2>, FieldInt<2> > MsgEIncompatible;
+typedef ProtocolMessage<kMsgCodeEBusy> MsgEBusy;
+typedef ProtocolMessage<kMsgCodeEUnknown> MsgEUnknown;
+typedef ProtocolMessage<kMsgCodeEBad> MsgEBad;
@@ -72,6 +72,13 @@ public:
     static bool            readf(barrier::IStream*,
                             const char* fmt, ...);
 
+    //! Read exactly
+    /*!
+    Reads exactly \c count bytes from the stream into the buffer.  Throws
+    XIOEndOfStream if the stream ends first.
+    */
+    static void            read(barrier::IStream*, void*, UInt32 count);
+
 private:
     static void            vwritef(barrier::IStream*,
                             const char* fmt, UInt32 size, va_list);
@@ -81,7 +88,6 @@ private:
     static UInt32        getLength(const char* fmt, va_list);
     static void            writef(void*, const char* fmt, va_list);
     static UInt32        eatLength(const char** fmt);
-    static void            read(barrier::IStream*, void*, UInt32);
 };
 
 //! Mismatched read exception
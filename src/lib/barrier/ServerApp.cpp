@@ -716,7 +716,7 @@ ServerApp::mainLoop()
 {
     // create socket multiplexer.  this must happen after daemonization
     // on unix because threads evaporate across a fork().
-    setSocketMultiplexer(std::make_unique<SocketMultiplexer>());
+    setSocketMultiplexer(std::make_unique<SocketMultiplexer>(!argsBase().m_disableEpoll));
 
     // if configuration has no screens then add this system
     // as the default
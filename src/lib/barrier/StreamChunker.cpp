@@ -20,7 +20,6 @@
 #include "mt/Lock.h"
 #include "mt/Mutex.h"
 #include "barrier/FileChunk.h"
-#include "barrier/ClipboardChunk.h"
 #include "barrier/protocol_types.h"
 #include "base/EventTypes.h"
 #include "base/Event.h"
@@ -30,16 +29,34 @@
 #include "base/Stopwatch.h"
 #include "base/String.h"
 
+#include <chrono>
 #include <fstream>
 #include <stdexcept>
+#include <vector>
 
 using namespace std;
 
 static const size_t g_chunkSize = 32 * 1024; //32kb
+static const size_t g_readBufferSize = 1024 * 1024; //1mb
+
+// chunks that may be waiting to be sent at once, so sending a file
+// takes about this many chunks of memory however large it is
+static const size_t g_chunkWindow = 32;
 
 bool StreamChunker::s_isChunkingFile = false;
 bool StreamChunker::s_interruptFile = false;
 Mutex* StreamChunker::s_interruptMutex = NULL;
+std::mutex StreamChunker::s_windowMutex;
+std::condition_variable StreamChunker::s_windowCondition;
+size_t StreamChunker::s_chunksInWindow = 0;
+
+static void
+addChunk(IEventQueue* events, void* eventTarget, FileChunk* chunk)
+{
+    Event event(events->forFile().fileChunkSending(), eventTarget);
+    event.setDataObject(chunk);
+    events->addEvent(event);
+}
 
 void
 StreamChunker::sendFile(
@@ -49,29 +66,35 @@ StreamChunker::sendFile(
 {
     s_isChunkingFile = true;
     
-    std::fstream file(static_cast<char*>(filename), std::ios::in | std::ios::binary);
+    // read the file front to back through a large buffer, so each chunk
+    // is copied from memory rather than read from the disk on its own
+    std::vector<char> buffer(g_readBufferSize);
+    std::ifstream file;
+    file.rdbuf()->pubsetbuf(&buffer[0], buffer.size());
+    file.open(static_cast<char*>(filename), std::ios::in | std::ios::binary);
 
     if (!file.is_open()) {
+        s_isChunkingFile = false;
         throw runtime_error("failed to open file");
     }
 
     // check file size
     file.seekg (0, std::ios::end);
     size_t size = (size_t)file.tellg();
+    file.seekg (0, std::ios::beg);
 
     // send first message (file size)
     String fileSize = barrier::string::sizeTypeToString(size);
     FileChunk* sizeMessage = FileChunk::start(fileSize);
 
-    events->addEvent(Event(events->forFile().fileChunkSending(), eventTarget, sizeMessage));
+    addChunk(events, eventTarget, sizeMessage);
 
     // send chunk messages with a fixed chunk size
     size_t sentLength = 0;
     size_t chunkSize = g_chunkSize;
-    file.seekg (0, std::ios::beg);
 
-    while (true) {
-        if (s_interruptFile) {
+    while (sentLength < size) {
+        if (!waitForWindow()) {
             s_interruptFile = false;
             LOG((CLOG_DEBUG "file transmission interrupted"));
             break;
@@ -79,31 +102,33 @@ StreamChunker::sendFile(
         
         events->addEvent(Event(events->forFile().keepAlive(), eventTarget));
         
-        // make sure we don't read too much from the mock data.
+        // make sure we don't read past the end of the file
         if (sentLength + chunkSize > size) {
             chunkSize = size - sentLength;
         }
 
-        char* chunkData = new char[chunkSize];
-        file.read(chunkData, chunkSize);
-        UInt8* data = reinterpret_cast<UInt8*>(chunkData);
-        FileChunk* fileChunk = FileChunk::data(data, chunkSize);
-        delete[] chunkData;
+        FileChunk* fileChunk = FileChunk::data(file, chunkSize);
+        if (fileChunk == NULL) {
+            LOG((CLOG_ERR "failed to read file at %s of %s bytes",
+                barrier::string::sizeTypeToString(sentLength).c_str(),
+                fileSize.c_str()));
+            break;
+        }
 
-        events->addEvent(Event(events->forFile().fileChunkSending(), eventTarget, fileChunk));
+        {
+            std::lock_guard<std::mutex> lock(s_windowMutex);
+            ++s_chunksInWindow;
+        }
+        fileChunk->m_inWindow = true;
+        addChunk(events, eventTarget, fileChunk);
 
         sentLength += chunkSize;
-        file.seekg (sentLength, std::ios::beg);
-
-        if (sentLength == size) {
-            break;
-        }
     }
 
     // send last message
     FileChunk* end = FileChunk::end();
 
-    events->addEvent(Event(events->forFile().fileChunkSending(), eventTarget, end));
+    addChunk(events, eventTarget, end);
 
     file.close();
     
@@ -111,49 +136,21 @@ StreamChunker::sendFile(
 }
 
 void
-StreamChunker::sendClipboard(
-                String& data,
-                size_t size,
-                ClipboardID id,
-                UInt32 sequence,
-                IEventQueue* events,
-                void* eventTarget)
+StreamChunker::chunkDone()
 {
-    // send first message (data size)
-    String dataSize = barrier::string::sizeTypeToString(size);
-    ClipboardChunk* sizeMessage = ClipboardChunk::start(id, sequence, dataSize);
-    
-    events->addEvent(Event(events->forClipboard().clipboardSending(), eventTarget, sizeMessage));
-
-    // send clipboard chunk with a fixed size
-    size_t sentLength = 0;
-    size_t chunkSize = g_chunkSize;
-    
-    while (true) {
-        events->addEvent(Event(events->forFile().keepAlive(), eventTarget));
-        
-        // make sure we don't read too much from the mock data.
-        if (sentLength + chunkSize > size) {
-            chunkSize = size - sentLength;
-        }
-
-        String chunk(data.substr(sentLength, chunkSize).c_str(), chunkSize);
-        ClipboardChunk* dataChunk = ClipboardChunk::data(id, sequence, chunk);
-        
-        events->addEvent(Event(events->forClipboard().clipboardSending(), eventTarget, dataChunk));
+    std::lock_guard<std::mutex> lock(s_windowMutex);
+    --s_chunksInWindow;
+    s_windowCondition.notify_all();
+}
 
-        sentLength += chunkSize;
-        if (sentLength == size) {
-            break;
-        }
+bool
+StreamChunker::waitForWindow()
+{
+    std::unique_lock<std::mutex> lock(s_windowMutex);
+    while (s_chunksInWindow >= g_chunkWindow && !s_interruptFile) {
+        s_windowCondition.wait_for(lock, std::chrono::milliseconds(100));
     }
-
-    // send last message
-    ClipboardChunk* end = ClipboardChunk::end(id, sequence);
-
-    events->addEvent(Event(events->forClipboard().clipboardSending(), eventTarget, end));
-    
-    LOG((CLOG_DEBUG "sent clipboard size=%d", sentLength));
+    return !s_interruptFile;
 }
 
 void
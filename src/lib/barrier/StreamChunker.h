@@ -20,6 +20,9 @@
 #include "barrier/clipboard_types.h"
 #include "base/String.h"
 
+#include <condition_variable>
+#include <mutex>
+
 class IEventQueue;
 class Mutex;
 
@@ -29,17 +32,25 @@ public:
                             char* filename,
                             IEventQueue* events,
                             void* eventTarget);
-    static void            sendClipboard(
-                            String& data,
-                            size_t size,
-                            ClipboardID id,
-                            UInt32 sequence,
-                            IEventQueue* events,
-                            void* eventTarget);
     static void            interruptFile();
+
+    //! Release a chunk's place in the send window
+    /*!
+    Called when a chunk queued by \c sendFile() has been sent and
+    deleted, letting \c sendFile() read another.
+    */
+    static void            chunkDone();
     
+private:
+    // wait until another chunk fits in the send window.  returns false
+    // if the file was interrupted.
+    static bool            waitForWindow();
+
 private:
     static bool            s_isChunkingFile;
     static bool            s_interruptFile;
     static Mutex*        s_interruptMutex;
+    static std::mutex    s_windowMutex;
+    static std::condition_variable s_windowCondition;
+    static size_t        s_chunksInWindow;
 };
@@ -302,6 +302,63 @@ extern const char*        kMsgEUnknown;
 // primary should disconnect after sending this message.
 extern const char*        kMsgEBad;
 
+//
+// message codes as integers.  each is the 4 character code of the kMsg
+// string with the same name read as a big endian 32 bit integer.
+// parsers switch on these instead of comparing the received code against
+// each message in turn.
+//
+
+//! Make an integer message code
+inline constexpr UInt32
+makeMessageCode(char a, char b, char c, char d)
+{
+    return (static_cast<UInt32>(static_cast<UInt8>(a)) << 24) |
+           (static_cast<UInt32>(static_cast<UInt8>(b)) << 16) |
+           (static_cast<UInt32>(static_cast<UInt8>(c)) <<  8) |
+            static_cast<UInt32>(static_cast<UInt8>(d));
+}
+
+//! Get the integer message code of a received 4 byte code
+inline UInt32
+toMessageCode(const UInt8* code)
+{
+    return (static_cast<UInt32>(code[0]) << 24) |
+           (static_cast<UInt32>(code[1]) << 16) |
+           (static_cast<UInt32>(code[2]) <<  8) |
+            static_cast<UInt32>(code[3]);
+}
+
+enum EMessageCode : UInt32 {
+    kMsgCodeCNoop           = makeMessageCode('C', 'N', 'O', 'P'),
+    kMsgCodeCClose          = makeMessageCode('C', 'B', 'Y', 'E'),
+    kMsgCodeCEnter          = makeMessageCode('C', 'I', 'N', 'N'),
+    kMsgCodeCLeave          = makeMessageCode('C', 'O', 'U', 'T'),
+    kMsgCodeCClipboard      = makeMessageCode('C', 'C', 'L', 'P'),
+    kMsgCodeCScreenSaver    = makeMessageCode('C', 'S', 'E', 'C'),
+    kMsgCodeCResetOptions   = makeMessageCode('C', 'R', 'O', 'P'),
+    kMsgCodeCInfoAck        = makeMessageCode('C', 'I', 'A', 'K'),
+    kMsgCodeCKeepAlive      = makeMessageCode('C', 'A', 'L', 'V'),
+    kMsgCodeDKeyDown        = makeMessageCode('D', 'K', 'D', 'N'),
+    kMsgCodeDKeyRepeat      = makeMessageCode('D', 'K', 'R', 'P'),
+    kMsgCodeDKeyUp          = makeMessageCode('D', 'K', 'U', 'P'),
+    kMsgCodeDMouseDown      = makeMessageCode('D', 'M', 'D', 'N'),
+    kMsgCodeDMouseUp        = makeMessageCode('D', 'M', 'U', 'P'),
+    kMsgCodeDMouseMove      = makeMessageCode('D', 'M', 'M', 'V'),
+    kMsgCodeDMouseRelMove   = makeMessageCode('D', 'M', 'R', 'M'),
+    kMsgCodeDMouseWheel     = makeMessageCode('D', 'M', 'W', 'M'),
+    kMsgCodeDClipboard      = makeMessageCode('D', 'C', 'L', 'P'),
+    kMsgCodeDInfo           = makeMessageCode('D', 'I', 'N', 'F'),
+    kMsgCodeDSetOptions     = makeMessageCode('D', 'S', 'O', 'P'),
+    kMsgCodeDFileTransfer   = makeMessageCode('D', 'F', 'T', 'R'),
+    kMsgCodeDDragInfo       = makeMessageCode('D', 'D', 'R', 'G'),
+    kMsgCodeQInfo           = makeMessageCode('Q', 'I', 'N', 'F'),
+    kMsgCodeEIncompatible   = makeMessageCode('E', 'I', 'C', 'V'),
+    kMsgCodeEBusy           = makeMessageCode('E', 'B', 'S', 'Y'),
+    kMsgCodeEUnknown        = makeMessageCode('E', 'U', 'N', 'K'),
+    kMsgCodeEBad            = makeMessageCode('E', 'B', 'A', 'D')
+};
+
 
 //
 // structures
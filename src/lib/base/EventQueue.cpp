@@ -29,6 +29,211 @@
 #include "base/XBase.h"
 #include "../gui/src/ShutdownCh.h"
 
+#include <algorithm>
+
+//
+// EventQueue::HandlerTable
+//
+
+// an open addressing hash table of handlers keyed on the target and type.
+// it's kept at most half full so lookups rarely probe past the first slot.
+//
+// lookups don't lock so the table is only changed in ways a concurrent
+// lookup can't trip over.  a handler is added to an empty slot, filling
+// in the target and type before publishing the handler, and a removed
+// handler's slot is marked as removed rather than emptied so later
+// entries can still be found.  replacing a handler just swaps the
+// pointer.  none of that allocates.  when the removed slots leave no room
+// for another handler the caller copies the live entries to a new table
+// and publishes that, which allocates and costs time in the number of
+// slots, but only once per so many changes.
+class EventQueue::HandlerTable {
+public:
+    class Entry {
+    public:
+        void*            m_target;
+        Event::Type        m_type;
+
+        // NULL if the slot is empty, s_removed if its handler was removed
+        std::atomic<IEventJob*> m_handler;
+    };
+
+    // make an empty table with room for count handlers
+    explicit HandlerTable(size_t count);
+
+    // get the handler for type and target or NULL if there isn't one
+    IEventJob*            find(Event::Type type, void* target) const;
+
+    // replace the handler for type and target, if there is one, and
+    // return the old one.  returns NULL if there isn't one.
+    IEventJob*            replace(Event::Type type, void* target,
+                            IEventJob* handler);
+
+    // true if insert() can add another handler
+    bool                hasRoom() const;
+
+    // add a handler that isn't already in the table
+    void                insert(Event::Type type, void* target,
+                            IEventJob* handler);
+
+    // remove the entries for which matches(entry) is true, appending
+    // their handlers to removed
+    template <class Matches>
+    void                removeIf(Matches matches,
+                            std::vector<IEventJob*>& removed);
+
+    // make a copy of the live entries with room for extra more handlers
+    HandlerTable*        copy(size_t extra) const;
+
+private:
+    size_t                slot(Event::Type type, void* target) const;
+    Entry*                lookup(Event::Type type, void* target);
+
+private:
+    static IEventJob*    s_removed;
+
+    std::vector<Entry>    m_entries;
+    size_t                m_mask;
+
+    // live handlers and slots that aren't empty, including removed ones
+    size_t                m_count;
+    size_t                m_used;
+};
+
+// the address is all that matters
+static char                s_removedHandler;
+IEventJob*                EventQueue::HandlerTable::s_removed =
+                            reinterpret_cast<IEventJob*>(&s_removedHandler);
+
+EventQueue::HandlerTable::HandlerTable(size_t count) :
+    m_count(0),
+    m_used(0)
+{
+    size_t capacity = 16;
+    while (capacity < 2 * count) {
+        capacity <<= 1;
+    }
+    m_entries = std::vector<Entry>(capacity);
+    for (std::vector<Entry>::iterator index = m_entries.begin();
+                            index != m_entries.end(); ++index) {
+        index->m_target = NULL;
+        index->m_type   = Event::kUnknown;
+        index->m_handler.store(NULL, std::memory_order_relaxed);
+    }
+    m_mask = capacity - 1;
+}
+
+size_t
+EventQueue::HandlerTable::slot(Event::Type type, void* target) const
+{
+    // targets are mostly heap objects so the low bits carry little
+    size_t hash = (reinterpret_cast<size_t>(target) >> 4) * 31 + type;
+    hash *= 2654435761u;
+    return (hash ^ (hash >> 15)) & m_mask;
+}
+
+IEventJob*
+EventQueue::HandlerTable::find(Event::Type type, void* target) const
+{
+    // the target and type of a slot are only valid once its handler is
+    // seen, and never change after that
+    for (size_t i = slot(type, target); ; i = (i + 1) & m_mask) {
+        const Entry& entry = m_entries[i];
+        IEventJob* handler = entry.m_handler.load(std::memory_order_acquire);
+        if (handler == NULL) {
+            return NULL;
+        }
+        if (handler != s_removed &&
+            entry.m_target == target && entry.m_type == type) {
+            return handler;
+        }
+    }
+}
+
+EventQueue::HandlerTable::Entry*
+EventQueue::HandlerTable::lookup(Event::Type type, void* target)
+{
+    for (size_t i = slot(type, target); ; i = (i + 1) & m_mask) {
+        Entry& entry       = m_entries[i];
+        IEventJob* handler = entry.m_handler.load(std::memory_order_relaxed);
+        if (handler == NULL) {
+            return NULL;
+        }
+        if (handler != s_removed &&
+            entry.m_target == target && entry.m_type == type) {
+            return &entry;
+        }
+    }
+}
+
+IEventJob*
+EventQueue::HandlerTable::replace(Event::Type type, void* target,
+                IEventJob* handler)
+{
+    assert(handler != NULL);
+
+    Entry* entry = lookup(type, target);
+    if (entry == NULL) {
+        return NULL;
+    }
+    return entry->m_handler.exchange(handler, std::memory_order_acq_rel);
+}
+
+bool
+EventQueue::HandlerTable::hasRoom() const
+{
+    return (2 * (m_used + 1) <= m_entries.size());
+}
+
+void
+EventQueue::HandlerTable::insert(Event::Type type, void* target,
+                IEventJob* handler)
+{
+    assert(handler != NULL);
+    assert(hasRoom());
+
+    size_t i = slot(type, target);
+    while (m_entries[i].m_handler.load(std::memory_order_relaxed) != NULL) {
+        i = (i + 1) & m_mask;
+    }
+    Entry& entry   = m_entries[i];
+    entry.m_target = target;
+    entry.m_type   = type;
+    entry.m_handler.store(handler, std::memory_order_release);
+    ++m_count;
+    ++m_used;
+}
+
+template <class Matches>
+void
+EventQueue::HandlerTable::removeIf(Matches matches,
+                std::vector<IEventJob*>& removed)
+{
+    for (std::vector<Entry>::iterator index = m_entries.begin();
+                            index != m_entries.end(); ++index) {
+        IEventJob* handler = index->m_handler.load(std::memory_order_relaxed);
+        if (handler != NULL && handler != s_removed && matches(*index)) {
+            removed.push_back(handler);
+            index->m_handler.store(s_removed, std::memory_order_release);
+            --m_count;
+        }
+    }
+}
+
+EventQueue::HandlerTable*
+EventQueue::HandlerTable::copy(size_t extra) const
+{
+    HandlerTable* table = new HandlerTable(m_count + extra);
+    for (std::vector<Entry>::const_iterator index = m_entries.begin();
+                            index != m_entries.end(); ++index) {
+        IEventJob* handler = index->m_handler.load(std::memory_order_relaxed);
+        if (handler != NULL && handler != s_removed) {
+            table->insert(index->m_type, index->m_target, handler);
+        }
+    }
+    return table;
+}
+
 EVENT_TYPE_ACCESSOR(Client)
 EVENT_TYPE_ACCESSOR(IStream)
 EVENT_TYPE_ACCESSOR(IpcClient)
@@ -38,6 +243,7 @@ EVENT_TYPE_ACCESSOR(IpcServerProxy)
 EVENT_TYPE_ACCESSOR(IDataSocket)
 EVENT_TYPE_ACCESSOR(IListenSocket)
 EVENT_TYPE_ACCESSOR(ISocket)
+EVENT_TYPE_ACCESSOR(AddressResolver)
 EVENT_TYPE_ACCESSOR(OSXScreen)
 EVENT_TYPE_ACCESSOR(ClientListener)
 EVENT_TYPE_ACCESSOR(ClientProxy)
@@ -64,9 +270,16 @@ interrupt(Arch::ESignal, void* data)
 // EventQueue
 //
 
+static const size_t        kInitialEventSlots = 256;
+
 EventQueue::EventQueue() :
     m_systemTarget(0),
     m_nextType(Event::kLast),
+    m_storageAllocations(0),
+    m_nextTimerID(1),
+    m_deletedTimers(0),
+    m_handlers(new HandlerTable(0)),
+    m_handlerReaders(0),
     m_typesForClient(NULL),
     m_typesForIStream(NULL),
     m_typesForIpcClient(NULL),
@@ -76,6 +289,7 @@ EventQueue::EventQueue() :
     m_typesForIDataSocket(NULL),
     m_typesForIListenSocket(NULL),
     m_typesForISocket(NULL),
+    m_typesForAddressResolver(NULL),
     m_typesForOSXScreen(NULL),
     m_typesForClientListener(NULL),
     m_typesForClientProxy(NULL),
@@ -90,9 +304,15 @@ EventQueue::EventQueue() :
     m_readyMutex(new Mutex),
     m_readyCondVar(new CondVar<bool>(m_readyMutex, false))
 {
+    for (UInt32 i = 0; i < kHandlerStatsTypes; ++i) {
+        m_handlerLookups[i] = 0;
+        m_handlerMisses[i]  = 0;
+    }
     ARCH->setSignalHandler(Arch::kINTERRUPT, &interrupt, this);
     ARCH->setSignalHandler(Arch::kTERMINATE, &interrupt, this);
     m_buffer = new SimpleEventQueueBuffer;
+    m_events.reserve(kInitialEventSlots);
+    m_oldEventIDs.reserve(kInitialEventSlots);
 }
 
 EventQueue::~EventQueue()
@@ -100,6 +320,13 @@ EventQueue::~EventQueue()
     delete m_buffer;
     delete m_readyCondVar;
     delete m_readyMutex;
+
+    logHandlerStats();
+    delete m_handlers.load();
+    for (HandlerTableList::iterator index = m_retiredHandlers.begin();
+                            index != m_retiredHandlers.end(); ++index) {
+        delete *index;
+    }
     
     ARCH->setSignalHandler(Arch::kINTERRUPT, NULL, NULL);
     ARCH->setSignalHandler(Arch::kTERMINATE, NULL, NULL);
@@ -178,16 +405,19 @@ EventQueue::adoptBuffer(IEventQueueBuffer* buffer)
 
     LOG((CLOG_DEBUG "adopting new buffer"));
 
-    if (m_events.size() != 0) {
+    size_t saved = m_events.size() - m_oldEventIDs.size();
+    if (saved != 0) {
         // this can come as a nasty surprise to programmers expecting
         // their events to be raised, only to have them deleted.
-        LOG((CLOG_DEBUG "discarding %d event(s)", m_events.size()));
+        LOG((CLOG_DEBUG "discarding %d event(s)", (int)saved));
     }
 
     // discard old buffer and old events
     delete m_buffer;
     for (EventTable::iterator i = m_events.begin(); i != m_events.end(); ++i) {
-        Event::deleteData(i->second);
+        if (i->getType() != Event::kUnknown) {
+            Event::deleteData(*i);
+        }
     }
     m_events.clear();
     m_oldEventIDs.clear();
@@ -273,11 +503,25 @@ retry:
 bool
 EventQueue::dispatchEvent(const Event& event)
 {
-    void* target   = event.getTarget();
-    IEventJob* job = getHandler(event.getType(), target);
-    if (job == NULL) {
-        job = getHandler(Event::kUnknown, target);
+    Event::Type type = event.getType();
+    void* target     = event.getTarget();
+
+    // fall back to the target's handler for any type
+    m_handlerReaders.fetch_add(1);
+    const HandlerTable* handlers = m_handlers.load();
+    IEventJob* job = handlers->find(type, target);
+    bool miss      = (job == NULL);
+    if (miss) {
+        job = handlers->find(Event::kUnknown, target);
     }
+    m_handlerReaders.fetch_sub(1, std::memory_order_release);
+
+    UInt32 stats = std::min(type, kHandlerStatsTypes - 1);
+    m_handlerLookups[stats].fetch_add(1, std::memory_order_relaxed);
+    if (miss) {
+        m_handlerMisses[stats].fetch_add(1, std::memory_order_relaxed);
+    }
+
     if (job != NULL) {
         job->run(event);
         return true;
@@ -330,85 +574,152 @@ EventQueue::addEventToBuffer(const Event& event)
 EventQueueTimer*
 EventQueue::newTimer(double duration, void* target)
 {
-    assert(duration > 0.0);
-
-    EventQueueTimer* timer = m_buffer->newTimer(duration, false);
-    if (target == NULL) {
-        target = timer;
-    }
-    std::lock_guard<std::mutex> lock(m_mutex);
-    m_timers.insert(timer);
-    // initial duration is requested duration plus whatever's on
-    // the clock currently because the latter will be subtracted
-    // the next time we check for timers.
-    m_timerQueue.push(Timer(timer, duration,
-                            duration + m_time.getTime(), target, false));
-    return timer;
+    return addTimer(duration, target, false);
 }
 
 EventQueueTimer*
 EventQueue::newOneShotTimer(double duration, void* target)
+{
+    return addTimer(duration, target, true);
+}
+
+EventQueueTimer*
+EventQueue::addTimer(double duration, void* target, bool oneShot)
 {
     assert(duration > 0.0);
 
-    EventQueueTimer* timer = m_buffer->newTimer(duration, true);
+    EventQueueTimer* timer = m_buffer->newTimer(duration, oneShot);
     if (target == NULL) {
         target = timer;
     }
     std::lock_guard<std::mutex> lock(m_mutex);
-    m_timers.insert(timer);
-    // initial duration is requested duration plus whatever's on
-    // the clock currently because the latter will be subtracted
-    // the next time we check for timers.
-    m_timerQueue.push(Timer(timer, duration,
-                            duration + m_time.getTime(), target, true));
+    ++m_storageAllocations;
+    TimerInfo& info = m_timers[timer];
+    info.m_id       = newTimerID();
+    info.m_deadline = m_time.getTime() + duration;
+    info.m_timeout  = duration;
+    info.m_target   = target;
+    info.m_oneShot  = oneShot;
+    pushTimer(Timer(timer, duration, info.m_deadline,
+                            target, oneShot, info.m_id));
     return timer;
 }
 
+UInt32
+EventQueue::newTimerID()
+{
+    UInt32 id = m_nextTimerID++;
+    if (m_nextTimerID == 0) {
+        m_nextTimerID = 1;
+    }
+    return id;
+}
+
 void
 EventQueue::deleteTimer(EventQueueTimer* timer)
 {
     std::lock_guard<std::mutex> lock(m_mutex);
-    for (TimerQueue::iterator index = m_timerQueue.begin();
-                            index != m_timerQueue.end(); ++index) {
-        if (index->getTimer() == timer) {
-            m_timerQueue.erase(index);
-            break;
-        }
-    }
     Timers::iterator index = m_timers.find(timer);
     if (index != m_timers.end()) {
+        if (index->second.m_id != 0) {
+            ++m_deletedTimers;
+        }
         m_timers.erase(index);
     }
+
+    // purge deleted timers once they're most of the queue
+    if (m_deletedTimers > 16 && 2 * m_deletedTimers > m_timerQueue.size()) {
+        std::vector<Timer> timers;
+        timers.reserve(m_timerQueue.size() - m_deletedTimers);
+        for (TimerQueue::iterator index = m_timerQueue.begin();
+                            index != m_timerQueue.end(); ++index) {
+            if (!isTimerDeleted(*index)) {
+                timers.push_back(*index);
+            }
+        }
+        m_timerQueue.swap(timers);
+        m_deletedTimers = 0;
+    }
     m_buffer->deleteTimer(timer);
 }
 
 void
-EventQueue::adoptHandler(Event::Type type, void* target, IEventJob* handler)
+EventQueue::touchTimer(EventQueueTimer* timer)
 {
     std::lock_guard<std::mutex> lock(m_mutex);
-    IEventJob*& job = m_handlers[target][type];
-    delete job;
-    job = handler;
+    Timers::iterator index = m_timers.find(timer);
+    if (index == m_timers.end()) {
+        return;
+    }
+
+    // just note the new deadline.  the timer's entry stays where it is
+    // in the queue until it reaches the front.
+    TimerInfo& info = index->second;
+    info.m_deadline = m_time.getTime() + info.m_timeout;
+    if (info.m_id == 0) {
+        // an expired one-shot timer has no entry so give it a new one
+        info.m_id = newTimerID();
+        pushTimer(Timer(timer, info.m_timeout, info.m_deadline,
+                            info.m_target, info.m_oneShot, info.m_id));
+    }
+}
+
+bool
+EventQueue::isTimerDeleted(const Timer& timer) const
+{
+    Timers::const_iterator index = m_timers.find(timer.getTimer());
+    return (index == m_timers.end() || index->second.m_id != timer.getID());
 }
 
 void
-EventQueue::removeHandler(Event::Type type, void* target)
+EventQueue::pushTimer(const Timer& timer)
+{
+    if (m_timerQueue.size() == m_timerQueue.capacity()) {
+        ++m_storageAllocations;
+    }
+    m_timerQueue.push(timer);
+}
+
+void
+EventQueue::adoptHandler(Event::Type type, void* target, IEventJob* handler)
 {
-    IEventJob* handler = NULL;
+    IEventJob* replaced;
     {
         std::lock_guard<std::mutex> lock(m_mutex);
-        HandlerTable::iterator index = m_handlers.find(target);
-        if (index != m_handlers.end()) {
-            TypeHandlerTable& typeHandlers = index->second;
-            TypeHandlerTable::iterator index2 = typeHandlers.find(type);
-            if (index2 != typeHandlers.end()) {
-                handler = index2->second;
-                typeHandlers.erase(index2);
+        HandlerTable* table = m_handlers.load();
+        replaced = table->replace(type, target, handler);
+        if (replaced == NULL) {
+            // once removed slots and handlers fill the table copy the
+            // handlers to a new one, which grows if they need the room
+            if (!table->hasRoom()) {
+                table = table->copy(1);
+                publishHandlers(table);
             }
+            table->insert(type, target, handler);
         }
     }
-    delete handler;
+
+    // delete the replaced handler
+    delete replaced;
+}
+
+void
+EventQueue::removeHandler(Event::Type type, void* target)
+{
+    std::vector<IEventJob*> handlers;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_handlers.load()->removeIf(
+            [=](const HandlerTable::Entry& entry) {
+                return entry.m_target == target && entry.m_type == type;
+            }, handlers);
+    }
+
+    // delete handler
+    for (std::vector<IEventJob*>::iterator index = handlers.begin();
+                            index != handlers.end(); ++index) {
+        delete *index;
+    }
 }
 
 void
@@ -417,16 +728,10 @@ EventQueue::removeHandlers(void* target)
     std::vector<IEventJob*> handlers;
     {
         std::lock_guard<std::mutex> lock(m_mutex);
-        HandlerTable::iterator index = m_handlers.find(target);
-        if (index != m_handlers.end()) {
-            // copy to handlers array and clear table for target
-            TypeHandlerTable& typeHandlers = index->second;
-            for (TypeHandlerTable::iterator index2 = typeHandlers.begin();
-                            index2 != typeHandlers.end(); ++index2) {
-                handlers.push_back(index2->second);
-            }
-            typeHandlers.clear();
-        }
+        m_handlers.load()->removeIf(
+            [=](const HandlerTable::Entry& entry) {
+                return entry.m_target == target;
+            }, handlers);
     }
 
     // delete handlers
@@ -438,36 +743,77 @@ EventQueue::removeHandlers(void* target)
 
 IEventJob*
 EventQueue::getHandler(Event::Type type, void* target) const
+{
+    m_handlerReaders.fetch_add(1);
+    IEventJob* job = m_handlers.load()->find(type, target);
+    m_handlerReaders.fetch_sub(1, std::memory_order_release);
+    return job;
+}
+
+UInt32
+EventQueue::getStorageAllocations() const
 {
     std::lock_guard<std::mutex> lock(m_mutex);
-    HandlerTable::const_iterator index = m_handlers.find(target);
-    if (index != m_handlers.end()) {
-        const TypeHandlerTable& typeHandlers = index->second;
-        TypeHandlerTable::const_iterator index2 = typeHandlers.find(type);
-        if (index2 != typeHandlers.end()) {
-            return index2->second;
+    return m_storageAllocations;
+}
+
+void
+EventQueue::getHandlerStats(Event::Type type,
+                UInt32& lookups, UInt32& misses) const
+{
+    UInt32 stats = std::min(type, kHandlerStatsTypes - 1);
+    lookups = m_handlerLookups[stats].load(std::memory_order_relaxed);
+    misses  = m_handlerMisses[stats].load(std::memory_order_relaxed);
+}
+
+void
+EventQueue::publishHandlers(HandlerTable* table)
+{
+    // lookups announce themselves before loading the table so if there
+    // are none now then none can still be using a table replaced earlier
+    m_retiredHandlers.push_back(m_handlers.exchange(table));
+    if (m_handlerReaders.load() == 0) {
+        for (HandlerTableList::iterator index = m_retiredHandlers.begin();
+                            index != m_retiredHandlers.end(); ++index) {
+            delete *index;
+        }
+        m_retiredHandlers.clear();
+    }
+}
+
+void
+EventQueue::logHandlerStats()
+{
+    for (UInt32 type = 0; type < kHandlerStatsTypes; ++type) {
+        UInt32 lookups, misses;
+        getHandlerStats(type, lookups, misses);
+        if (lookups != 0) {
+            LOG((CLOG_DEBUG2 "handler lookups for %s: %u, %u missed",
+                getTypeName(type), lookups, misses));
         }
     }
-    return NULL;
 }
 
 UInt32
 EventQueue::saveEvent(const Event& event)
 {
-    // choose id
+    assert(event.getType() != Event::kUnknown);
+
+    // reuse the most recently freed slot, since it's likely still in the
+    // cache, or add a slot
     UInt32 id;
     if (!m_oldEventIDs.empty()) {
-        // reuse an id
         id = m_oldEventIDs.back();
         m_oldEventIDs.pop_back();
+        m_events[id] = event;
     }
     else {
-        // make a new id
         id = static_cast<UInt32>(m_events.size());
+        if (m_events.size() == m_events.capacity()) {
+            ++m_storageAllocations;
+        }
+        m_events.push_back(event);
     }
-
-    // save data
-    m_events[id] = event;
     return id;
 }
 
@@ -475,16 +821,19 @@ Event
 EventQueue::removeEvent(UInt32 eventID)
 {
     // look up id
-    EventTable::iterator index = m_events.find(eventID);
-    if (index == m_events.end()) {
+    if (eventID >= m_events.size() ||
+        m_events[eventID].getType() == Event::kUnknown) {
         return Event();
     }
 
-    // get data
-    Event event = index->second;
-    m_events.erase(index);
+    // get data and free the slot
+    Event event = m_events[eventID];
+    m_events[eventID] = Event();
 
     // save old id for reuse
+    if (m_oldEventIDs.size() == m_oldEventIDs.capacity()) {
+        ++m_storageAllocations;
+    }
     m_oldEventIDs.push_back(eventID);
 
     return event;
@@ -495,41 +844,45 @@ EventQueue::hasTimerExpired(Event& event)
 {
     // return true if there's a timer in the timer priority queue that
     // has expired.  if returning true then fill in event appropriately
-    // and reset and reinsert the timer.
+    // and reschedule and reinsert the timer.
     if (m_timerQueue.empty()) {
         return false;
     }
+    const double now = m_time.getTime();
+    while (!m_timerQueue.empty() && m_timerQueue.top() <= now) {
+        // remove timer from queue
+        Timer timer = m_timerQueue.top();
+        m_timerQueue.pop();
+        if (isTimerDeleted(timer)) {
+            --m_deletedTimers;
+            continue;
+        }
 
-    // get time elapsed since last check
-    const double time = m_time.getTime();
-    m_time.reset();
-
-    // countdown elapsed time
-    for (TimerQueue::iterator index = m_timerQueue.begin();
-                            index != m_timerQueue.end(); ++index) {
-        (*index) -= time;
-    }
-
-    // done if no timers are expired
-    if (m_timerQueue.top() > 0.0) {
-        return false;
-    }
-
-    // remove timer from queue
-    Timer timer = m_timerQueue.top();
-    m_timerQueue.pop();
+        // if the timer was touched then it isn't due yet.  put it back
+        // where it belongs now.
+        TimerInfo& info = m_timers[timer.getTimer()];
+        if (info.m_deadline > timer) {
+            timer.setDeadline(info.m_deadline);
+            pushTimer(timer);
+            continue;
+        }
 
-    // prepare event and reset the timer's clock
-    timer.fillEvent(m_timerEvent);
-    event = Event(Event::kTimer, timer.getTarget(), &m_timerEvent);
-    timer.reset();
+        // prepare event
+        timer.fillEvent(m_timerEvent, now);
+        event = Event(Event::kTimer, timer.getTarget(), &m_timerEvent);
 
-    // reinsert timer into queue if it's not a one-shot
-    if (!timer.isOneShot()) {
-        m_timerQueue.push(timer);
+        // reinsert timer into queue if it's not a one-shot
+        if (timer.isOneShot()) {
+            info.m_id = 0;
+        }
+        else {
+            timer.reschedule(now);
+            info.m_deadline = timer;
+            pushTimer(timer);
+        }
+        return true;
     }
-
-    return true;
+    return false;
 }
 
 double
@@ -537,14 +890,16 @@ EventQueue::getNextTimerTimeout() const
 {
     // return -1 if no timers, 0 if the top timer has expired, otherwise
     // the time until the top timer in the timer priority queue will
-    // expire.
+    // expire.  the top timer may have been deleted, in which case we
+    // just wake up early.
     if (m_timerQueue.empty()) {
         return -1.0;
     }
-    if (m_timerQueue.top() <= 0.0) {
+    double timeout = m_timerQueue.top() - m_time.getTime();
+    if (timeout <= 0.0) {
         return 0.0;
     }
-    return m_timerQueue.top();
+    return timeout;
 }
 
 Event::Type EventQueue::getRegisteredType(const std::string& name) const
@@ -581,12 +936,13 @@ EventQueue::waitForReady() const
 //
 
 EventQueue::Timer::Timer(EventQueueTimer* timer, double timeout,
-                double initialTime, void* target, bool oneShot) :
+                double deadline, void* target, bool oneShot, UInt32 id) :
     m_timer(timer),
     m_timeout(timeout),
     m_target(target),
     m_oneShot(oneShot),
-    m_time(initialTime)
+    m_deadline(deadline),
+    m_id(id)
 {
     assert(m_timeout > 0.0);
 }
@@ -597,21 +953,23 @@ EventQueue::Timer::~Timer()
 }
 
 void
-EventQueue::Timer::reset()
+EventQueue::Timer::reschedule(double now)
 {
-    m_time = m_timeout;
+    // stay in step with the original deadline rather than drifting by
+    // however late each check is.  periods that were missed entirely are
+    // reported by the event's count instead.
+    m_deadline += m_timeout * getExpirations(now);
 }
 
-EventQueue::Timer&
-EventQueue::Timer::operator-=(double dt)
+void
+EventQueue::Timer::setDeadline(double deadline)
 {
-    m_time -= dt;
-    return *this;
+    m_deadline = deadline;
 }
 
 EventQueue::Timer::operator double() const
 {
-    return m_time;
+    return m_deadline;
 }
 
 bool
@@ -632,18 +990,30 @@ EventQueue::Timer::getTarget() const
     return m_target;
 }
 
+UInt32
+EventQueue::Timer::getID() const
+{
+    return m_id;
+}
+
 void
-EventQueue::Timer::fillEvent(TimerEvent& event) const
+EventQueue::Timer::fillEvent(TimerEvent& event, double now) const
 {
     event.m_timer = m_timer;
-    event.m_count = 0;
-    if (m_time <= 0.0) {
-        event.m_count = static_cast<UInt32>((m_timeout - m_time) / m_timeout);
+    event.m_count = getExpirations(now);
+}
+
+UInt32
+EventQueue::Timer::getExpirations(double now) const
+{
+    if (now < m_deadline) {
+        return 0;
     }
+    return static_cast<UInt32>((now - m_deadline) / m_timeout) + 1;
 }
 
 bool
 EventQueue::Timer::operator<(const Timer& t) const
 {
-    return m_time < t.m_time;
+    return m_deadline < t.m_deadline;
 }
@@ -28,8 +28,10 @@
 #include "common/stdset.h"
 #include "base/NonBlockingStream.h"
 
+#include <atomic>
 #include <mutex>
 #include <queue>
+#include <unordered_map>
 
 //! Event queue
 /*!
@@ -52,6 +54,7 @@ public:
     virtual EventQueueTimer*
                         newOneShotTimer(double duration, void* target);
     virtual void        deleteTimer(EventQueueTimer*);
+    virtual void        touchTimer(EventQueueTimer*);
     virtual void        adoptHandler(Event::Type type,
                             void* target, IEventJob* handler);
     virtual void        removeHandler(Event::Type type, void* target);
@@ -64,24 +67,53 @@ public:
     void*                getSystemTarget();
     virtual void        waitForReady() const;
 
+    //! Get handler lookup counts
+    /*!
+    Returns in \p lookups the number of events of type \p type that
+    dispatchEvent() has looked up a handler for and in \p misses how many
+    of those had no handler for the type itself, so they went to the
+    target's Event::kUnknown handler or weren't handled at all.
+    */
+    void                getHandlerStats(Event::Type type,
+                            UInt32& lookups, UInt32& misses) const;
+
+    //! Get storage allocation count
+    /*!
+    Returns how many times saving an event or adding, touching or
+    rescheduling a timer has had to allocate storage.  Once the queue has
+    grown to its peak number of events and timers this stops changing.
+    */
+    UInt32                getStorageAllocations() const;
+
 private:
+    class HandlerTable;
+    class Timer;
+
+    void                publishHandlers(HandlerTable*);
+    void                logHandlerStats();
     UInt32                saveEvent(const Event& event);
     Event                removeEvent(UInt32 eventID);
     bool                hasTimerExpired(Event& event);
     double                getNextTimerTimeout() const;
+    EventQueueTimer*    addTimer(double duration, void* target, bool oneShot);
+    UInt32                newTimerID();
+    bool                isTimerDeleted(const Timer&) const;
+    void                pushTimer(const Timer&);
     void                addEventToBuffer(const Event& event);
     bool                parent_requests_shutdown() const;
     
 private:
     class Timer {
     public:
-        Timer(EventQueueTimer*, double timeout, double initialTime,
-                            void* target, bool oneShot);
+        Timer(EventQueueTimer*, double timeout, double deadline,
+                            void* target, bool oneShot, UInt32 id);
         ~Timer();
 
-        void            reset();
+        //! Move the deadline to the first period ending after \c now
+        void            reschedule(double now);
 
-        Timer&            operator-=(double);
+        //! Move the deadline to \c deadline
+        void            setDeadline(double deadline);
 
                         operator double() const;
 
@@ -89,26 +121,52 @@ private:
         EventQueueTimer*
                         getTimer() const;
         void*            getTarget() const;
-        void            fillEvent(TimerEvent&) const;
+        UInt32            getID() const;
+        void            fillEvent(TimerEvent&, double now) const;
 
         bool            operator<(const Timer&) const;
 
+    private:
+        // number of periods that have ended by now
+        UInt32            getExpirations(double now) const;
+
     private:
         EventQueueTimer*    m_timer;
         double                m_timeout;
         void*                m_target;
         bool                m_oneShot;
-        double                m_time;
+        double                m_deadline;
+        UInt32                m_id;
     };
 
-    typedef std::set<EventQueueTimer*> Timers;
+    // what's known about each timer outside the timer queue
+    class TimerInfo {
+    public:
+        // the id of the timer's entry in the timer queue, or 0 if it has
+        // none (a one-shot timer that has expired)
+        UInt32            m_id;
+
+        // when the timer is next due.  touchTimer() moves this past the
+        // deadline of the queue entry, which gets moved to match when it
+        // reaches the front.
+        double            m_deadline;
+
+        double            m_timeout;
+        void*            m_target;
+        bool            m_oneShot;
+    };
+
+    typedef std::unordered_map<EventQueueTimer*, TimerInfo> Timers;
     typedef PriorityQueue<Timer> TimerQueue;
-    typedef std::map<UInt32, Event> EventTable;
+    typedef std::vector<Event> EventTable;
     typedef std::vector<UInt32> EventIDList;
     typedef std::map<Event::Type, const char*> TypeMap;
     typedef std::map<std::string, Event::Type> NameMap;
-    typedef std::map<Event::Type, IEventJob*> TypeHandlerTable;
-    typedef std::map<void*, TypeHandlerTable> HandlerTable;
+    typedef std::vector<HandlerTable*> HandlerTableList;
+
+    // number of event types with their own lookup counters.  types
+    // registered after these share the last counter.
+    static const UInt32 kHandlerStatsTypes = 256;
 
     int                    m_systemTarget;
     mutable std::mutex m_mutex;
@@ -121,18 +179,38 @@ private:
     // buffer of events
     IEventQueueBuffer*    m_buffer;
 
-    // saved events
+    // saved events, indexed by event id.  free slots hold an event of
+    // type kUnknown, which is never saved, and their ids are listed in
+    // m_oldEventIDs.  neither table shrinks so once they've grown to the
+    // peak number of queued events saving an event doesn't allocate.
     EventTable            m_events;
     EventIDList        m_oldEventIDs;
 
-    // timers
+    // times m_events, m_oldEventIDs, m_timers or m_timerQueue allocated
+    UInt32                m_storageAllocations;
+
+    // timers.  the queue is ordered by absolute deadline on m_time so
+    // checking for an expired timer only looks at the first one.  deleted
+    // timers are left in the queue, skipped when they reach the front and
+    // purged when they outnumber the rest.
     Stopwatch            m_time;
     Timers                m_timers;
     TimerQueue            m_timerQueue;
     TimerEvent            m_timerEvent;
+    UInt32                m_nextTimerID;
+    size_t                m_deletedTimers;
+
+    // event handlers.  the table is never changed once it's published;
+    // adding or removing a handler (with m_mutex held) publishes a copy so
+    // dispatch can look up handlers without locking.  replaced tables are
+    // deleted by the first change made while no lookup is in progress.
+    std::atomic<HandlerTable*> m_handlers;
+    mutable std::atomic<int> m_handlerReaders;
+    HandlerTableList    m_retiredHandlers;
 
-    // event handlers
-    HandlerTable        m_handlers;
+    // handler lookups and misses by event type
+    mutable std::atomic<UInt32> m_handlerLookups[kHandlerStatsTypes];
+    mutable std::atomic<UInt32> m_handlerMisses[kHandlerStatsTypes];
 
 public:
     //
@@ -147,6 +225,7 @@ public:
     IDataSocketEvents&            forIDataSocket();
     IListenSocketEvents&        forIListenSocket();
     ISocketEvents&                forISocket();
+    AddressResolverEvents&        forAddressResolver();
     OSXScreenEvents&            forOSXScreen();
     ClientListenerEvents&        forClientListener();
     ClientProxyEvents&            forClientProxy();
@@ -169,6 +248,7 @@ private:
     IDataSocketEvents*            m_typesForIDataSocket;
     IListenSocketEvents*        m_typesForIListenSocket;
     ISocketEvents*                m_typesForISocket;
+    AddressResolverEvents*        m_typesForAddressResolver;
     OSXScreenEvents*            m_typesForOSXScreen;
     ClientListenerEvents*        m_typesForClientListener;
     ClientProxyEvents*            m_typesForClientProxy;
@@ -98,6 +98,12 @@ REGISTER_EVENT(IListenSocket, connecting)
 REGISTER_EVENT(ISocket, disconnected)
 REGISTER_EVENT(ISocket, stopRetry)
 
+//
+// AddressResolver
+//
+
+REGISTER_EVENT(AddressResolver, resolved)
+
 //
 // OSXScreen
 //
@@ -193,7 +199,6 @@ REGISTER_EVENT(IpcServer, messageReceived)
 
 REGISTER_EVENT(Clipboard, clipboardGrabbed)
 REGISTER_EVENT(Clipboard, clipboardChanged)
-REGISTER_EVENT(Clipboard, clipboardSending)
 
 //
 // File
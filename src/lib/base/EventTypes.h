@@ -318,6 +318,28 @@ private:
     Event::Type        m_stopRetry;
 };
 
+class AddressResolverEvents : public EventTypes {
+public:
+    AddressResolverEvents() :
+        m_resolved(Event::kUnknown) { }
+
+    //! @name accessors
+    //@{
+
+    //! Get resolved event type
+    /*!
+    Returns the resolved event type.  An address resolver sends this
+    event when a lookup has finished, successfully or not.  The data
+    is an \c AddressResolver::Result set with \c setDataObject().
+    */
+    Event::Type        resolved();
+
+    //@}
+
+private:
+    Event::Type        m_resolved;
+};
+
 class OSXScreenEvents : public EventTypes {
 public:
     OSXScreenEvents() :
@@ -698,8 +720,7 @@ class ClipboardEvents : public EventTypes {
 public:
     ClipboardEvents() :
         m_clipboardGrabbed(Event::kUnknown),
-        m_clipboardChanged(Event::kUnknown),
-        m_clipboardSending(Event::kUnknown) { }
+        m_clipboardChanged(Event::kUnknown) { }
 
     //! @name accessors
     //@{
@@ -720,19 +741,11 @@ public:
     */
     Event::Type        clipboardChanged();
 
-    //! Clipboard sending event type
-    /*!
-    Returns the clipboard sending event type. This is used to send 
-    clipboard chunks.
-    */
-    Event::Type        clipboardSending();
-
     //@}
 
 private:
     Event::Type        m_clipboardGrabbed;
     Event::Type        m_clipboardChanged;
-    Event::Type        m_clipboardSending;
 };
 
 class FileEvents : public EventTypes {
@@ -39,6 +39,7 @@ class IpcServerProxyEvents;
 class IDataSocketEvents;
 class IListenSocketEvents;
 class ISocketEvents;
+class AddressResolverEvents;
 class OSXScreenEvents;
 class ClientListenerEvents;
 class ClientProxyEvents;
@@ -144,6 +145,16 @@ public:
     */
     virtual void        deleteTimer(EventQueueTimer*) = 0;
 
+    //! Push back a timer's expiry
+    /*!
+    Restarts the countdown of \p timer so that it next expires its
+    duration from now, as if it had just been created.  A one-shot timer
+    that has already expired is armed again.  Unlike deleting the timer
+    and creating a new one this doesn't allocate, so it's cheap enough
+    to call for every message when tracking whether a peer is alive.
+    */
+    virtual void        touchTimer(EventQueueTimer*) = 0;
+
     //! Register an event handler for an event type
     /*!
     Registers an event handler for \p type and \p target.  The \p handler
@@ -230,6 +241,7 @@ public:
     virtual IDataSocketEvents&            forIDataSocket() = 0;
     virtual IListenSocketEvents&        forIListenSocket() = 0;
     virtual ISocketEvents&                forISocket() = 0;
+    virtual AddressResolverEvents&        forAddressResolver() = 0;
     virtual OSXScreenEvents&            forOSXScreen() = 0;
     virtual ClientListenerEvents&        forClientListener() = 0;
     virtual ClientProxyEvents&            forClientProxy() = 0;
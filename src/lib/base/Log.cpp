@@ -127,7 +127,7 @@ Log::print(const char* file, int line, const char* fmt, ...)
     }
 
     // done if below priority threshold
-    if (priority > getFilter()) {
+    if (priority > LOG_MAX_LEVEL || priority > getFilter()) {
         return;
     }
 
@@ -184,7 +184,11 @@ Log::print(const char* file, int line, const char* fmt, ...)
         // assume there is no file contains over 100k lines of code
         size += 6;
 #endif
-        char* message = new char[size];
+        char messageStack[1024];
+        char* message = messageStack;
+        if (size > sizeof(messageStack)) {
+            message = new char[size];
+        }
 
 #ifndef NDEBUG
         sprintf(message, "[%s] %s: %s\n\t%s,%d", timestamp, g_priority[priority], buffer, file, line);
@@ -193,7 +197,9 @@ Log::print(const char* file, int line, const char* fmt, ...)
 #endif
 
         output(priority, message);
-        delete[] message;
+        if (message != messageStack) {
+            delete[] message;
+        }
     } else {
         output(priority, buffer);
     }
@@ -266,14 +272,12 @@ Log::setFilter(const char* maxPriority)
 void
 Log::setFilter(int maxPriority)
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
     m_maxPriority = maxPriority;
 }
 
 int
 Log::getFilter() const
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
     return m_maxPriority;
 }
 
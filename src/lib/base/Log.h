@@ -24,9 +24,16 @@
 #include "common/stdlist.h"
 
 #include <stdarg.h>
+#include <atomic>
 #include <mutex>
 
 #define CLOG (Log::getInstance())
+
+// the least important level that's compiled in.  log sites for less
+// important levels are compiled out.
+#if !defined(LOG_MAX_LEVEL)
+#define LOG_MAX_LEVEL kDEBUG5
+#endif
 #define BYE "\nTry `%s --help' for more information."
 
 class ILogOutputter;
@@ -111,6 +118,29 @@ public:
     //! Get the minimum priority level.
     int                    getFilter() const;
 
+    //! Check if a priority would be logged
+    /*!
+    Returns true if messages with priority \c level are compiled in and
+    pass the filter.  This doesn't lock so LOG() can call it before
+    evaluating its arguments.
+    */
+    static bool            isEnabled(int level)
+    {
+        return level <= LOG_MAX_LEVEL &&
+            level <= s_log->m_maxPriority.load(std::memory_order_relaxed);
+    }
+
+    //! Get the priority of a format
+    /*!
+    Returns the priority a \c CLOG_XXX prefix puts at the start of
+    \c format, or \c kINFO if it has none.
+    */
+    static constexpr int getPriority(const char* format)
+    {
+        return (format[0] == '%' && format[1] == 'z') ?
+            format[2] - '\060' : kINFO;
+    }
+
     //! Get the filter name of the current filter level.
     const char*            getFilterName() const;
 
@@ -137,7 +167,7 @@ private:
     OutputterList        m_outputters;
     OutputterList        m_alwaysOutputters;
     int                    m_maxNewlineLength;
-    int                    m_maxPriority;
+    std::atomic<int>    m_maxPriority;
 };
 
 /*!
@@ -153,6 +183,10 @@ replaced by one of enumerants in \c Log::ELevel without the leading
 \c k.  For example, \c CLOG_INFO.  The special \c CLOG_PRINT level will
 not be filtered and is never prefixed by the filename and line number.
 
+The priority is checked against the filter before the arguments are
+evaluated so a filtered message costs a comparison.  Priorities less
+important than \c LOG_MAX_LEVEL aren't compiled in at all.
+
 If \c NOLOGGING is defined during the build then this macro expands to
 nothing.  If \c NDEBUG is defined during the build then it expands to a
 call to Log::print.  Otherwise it expands to a call to Log::printt,
@@ -184,15 +218,19 @@ otherwise it expands to a call that doesn't.
 #define LOGC(_a1, _a2)
 #define CLOG_TRACE
 #elif defined(NDEBUG)
-#define LOG(_a1)        CLOG->print _a1
-#define LOGC(_a1, _a2)    if (_a1) CLOG->print _a2
+#define LOG(_a1)        (LOG_ENABLED _a1 ? CLOG->print _a1 : (void)0)
+#define LOGC(_a1, _a2)    ((_a1) && LOG_ENABLED _a2 ? CLOG->print _a2 : (void)0)
 #define CLOG_TRACE        NULL, 0,
 #else
-#define LOG(_a1)        CLOG->print _a1
-#define LOGC(_a1, _a2)    if (_a1) CLOG->print _a2
+#define LOG(_a1)        (LOG_ENABLED _a1 ? CLOG->print _a1 : (void)0)
+#define LOGC(_a1, _a2)    ((_a1) && LOG_ENABLED _a2 ? CLOG->print _a2 : (void)0)
 #define CLOG_TRACE        __FILE__, __LINE__,
 #endif
 
+// picks the format out of the arguments to LOG() without evaluating the rest
+#define LOG_ENABLED(_file, _line, _format, ...) \
+                        Log::isEnabled(Log::getPriority(_format))
+
 // the CLOG_* defines are line and file plus %z and an octal number (060=0, 
 // 071=9), but the limitation is that once we run out of numbers at either 
 // end, then we resort to using non-numerical chars. this still works (since 
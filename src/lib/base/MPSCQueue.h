@@ -0,0 +1,153 @@
+/*
+ * barrier -- mouse and keyboard sharing utility
+ * Copyright (C) 2018 Debauchee Open Source Group
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file LICENSE that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common/basic_types.h"
+
+#include <assert.h>
+#include <atomic>
+#include <memory>
+#include <utility>
+
+//! Bounded multiple producer, single consumer queue
+/*!
+A fixed size FIFO that any number of threads may push() to while one
+thread pop()s, without locking.  push() fails instead of blocking when the
+queue is full.  Each slot carries a sequence number that tells producers
+and the consumer whose turn it is to use the slot.
+*/
+template <class T>
+class MPSCQueue {
+public:
+    //! Create a queue holding up to \c capacity elements
+    /*!
+    \c capacity must be a power of two.
+    */
+    explicit MPSCQueue(UInt32 capacity) :
+        m_slots(new Slot[capacity]),
+        m_mask(capacity - 1),
+        m_pushPos(0),
+        m_popPos(0)
+    {
+        assert(capacity > 0 && (capacity & m_mask) == 0);
+        for (UInt32 i = 0; i < capacity; ++i) {
+            m_slots[i].m_sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MPSCQueue(const MPSCQueue&) = delete;
+    MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+    //! @name manipulators
+    //@{
+
+    //! Add element
+    /*!
+    Appends \c value and returns true, or returns false if the queue is
+    full.  Can be called from any thread.
+    */
+    bool                push(const T& value)
+    {
+        T copy(value);
+        return push(std::move(copy));
+    }
+
+    //! Add element without copying
+    /*!
+    Like push(const T&) but moves \c value into the queue.  \c value is
+    left unchanged if the queue is full.
+    */
+    bool                push(T&& value)
+    {
+        UInt32 pos = m_pushPos.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot   = m_slots[pos & m_mask];
+            UInt32 seq   = slot.m_sequence.load(std::memory_order_acquire);
+            SInt32 delta = static_cast<SInt32>(seq - pos);
+            if (delta == 0) {
+                // the slot is free for this position.  claim it.
+                if (m_pushPos.compare_exchange_weak(pos, pos + 1,
+                                std::memory_order_relaxed)) {
+                    slot.m_value = std::move(value);
+                    slot.m_sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (delta < 0) {
+                // the consumer hasn't emptied the slot yet
+                return false;
+            }
+            else {
+                // another producer took this position
+                pos = m_pushPos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    //! Remove head element
+    /*!
+    Moves the oldest element to \c value and returns true, or returns
+    false if the queue is empty.  Must only be called from the consumer
+    thread.
+    */
+    bool                pop(T& value)
+    {
+        Slot& slot = m_slots[m_popPos & m_mask];
+        if (slot.m_sequence.load(std::memory_order_acquire) != m_popPos + 1) {
+            return false;
+        }
+        value = std::move(slot.m_value);
+        slot.m_sequence.store(m_popPos + m_mask + 1, std::memory_order_release);
+        ++m_popPos;
+        return true;
+    }
+
+    //@}
+    //! @name accessors
+    //@{
+
+    //! Test if queue is empty
+    /*!
+    Returns true if pop() would fail.  Must only be called from the
+    consumer thread.  A push() in progress on another thread is not
+    seen until it returns.
+    */
+    bool                empty() const
+    {
+        const Slot& slot = m_slots[m_popPos & m_mask];
+        return (slot.m_sequence.load(std::memory_order_acquire) != m_popPos + 1);
+    }
+
+    //@}
+
+private:
+    class Slot {
+    public:
+        std::atomic<UInt32>    m_sequence;
+        T                    m_value;
+    };
+
+    std::unique_ptr<Slot[]>    m_slots;
+    const UInt32        m_mask;
+
+    // producers and the consumer work at opposite ends;  keep them off
+    // each other's cache line
+    std::atomic<UInt32>    m_pushPos;
+    char                m_padding[64];
+    UInt32                m_popPos;
+};
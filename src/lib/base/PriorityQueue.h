@@ -112,6 +112,12 @@ public:
         return c.size();
     }
 
+    //! Returns the number of elements there's room for
+    size_type            capacity() const
+    {
+        return c.capacity();
+    }
+
     //! Returns the head element
     const value_type&    top() const
     {
@@ -26,11 +26,15 @@ class EventQueueTimer { };
 // SimpleEventQueueBuffer
 //
 
-SimpleEventQueueBuffer::SimpleEventQueueBuffer()
+const UInt32            SimpleEventQueueBuffer::kQueueSize = 4096;
+
+SimpleEventQueueBuffer::SimpleEventQueueBuffer() :
+    m_queue(kQueueSize),
+    m_overflowing(false),
+    m_waiting(false)
 {
     m_queueMutex     = ARCH->newMutex();
     m_queueReadyCond = ARCH->newCondVar();
-    m_queueReady     = false;
 }
 
 SimpleEventQueueBuffer::~SimpleEventQueueBuffer()
@@ -42,50 +46,75 @@ SimpleEventQueueBuffer::~SimpleEventQueueBuffer()
 void
 SimpleEventQueueBuffer::waitForEvent(double timeout)
 {
+    if (!isEmpty()) {
+        return;
+    }
+
     ArchMutexLock lock(m_queueMutex);
+
+    // producers check m_waiting after adding an event.  either they see
+    // it set or we see their event.
+    m_waiting = true;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
     Stopwatch timer(true);
-    while (!m_queueReady) {
+    while (isEmpty()) {
         double timeLeft = timeout;
         if (timeLeft >= 0.0) {
             timeLeft -= timer.getTime();
             if (timeLeft < 0.0) {
-                return;
+                break;
             }
         }
         ARCH->waitCondVar(m_queueReadyCond, m_queueMutex, timeLeft);
     }
+    m_waiting = false;
 }
 
 IEventQueueBuffer::Type
 SimpleEventQueueBuffer::getEvent(Event&, UInt32& dataID)
 {
-    ArchMutexLock lock(m_queueMutex);
-    if (!m_queueReady) {
-        return kNone;
+    if (m_queue.pop(dataID)) {
+        return kUser;
     }
-    dataID = m_queue.back();
-    m_queue.pop_back();
-    m_queueReady = !m_queue.empty();
-    return kUser;
+
+    if (m_overflowing) {
+        ArchMutexLock lock(m_queueMutex);
+        if (!m_overflow.empty()) {
+            dataID = m_overflow.front();
+            m_overflow.pop_front();
+            m_overflowing = !m_overflow.empty();
+            return kUser;
+        }
+    }
+
+    return kNone;
 }
 
 bool
 SimpleEventQueueBuffer::addEvent(UInt32 dataID)
 {
-    ArchMutexLock lock(m_queueMutex);
-    m_queue.push_front(dataID);
-    if (!m_queueReady) {
-        m_queueReady = true;
-        ARCH->broadcastCondVar(m_queueReadyCond);
+    if (!m_overflowing && m_queue.push(dataID)) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_waiting) {
+            ArchMutexLock lock(m_queueMutex);
+            ARCH->broadcastCondVar(m_queueReadyCond);
+        }
+        return true;
     }
+
+    // the queue is full.  hold the event until the queue drains.
+    ArchMutexLock lock(m_queueMutex);
+    m_overflow.push_back(dataID);
+    m_overflowing = true;
+    ARCH->broadcastCondVar(m_queueReadyCond);
     return true;
 }
 
 bool
 SimpleEventQueueBuffer::isEmpty() const
 {
-    ArchMutexLock lock(m_queueMutex);
-    return !m_queueReady;
+    return (m_queue.empty() && !m_overflowing);
 }
 
 EventQueueTimer*
@@ -19,12 +19,17 @@
 #pragma once
 
 #include "base/IEventQueueBuffer.h"
+#include "base/MPSCQueue.h"
 #include "arch/IArchMultithread.h"
 #include "common/stddeque.h"
 
+#include <atomic>
+
 //! In-memory event queue buffer
 /*!
 An event queue buffer provides a queue of events for an IEventQueue.
+Events are added through a lock free queue so adding one from another
+thread costs no lock unless the event thread is asleep waiting for it.
 */
 class SimpleEventQueueBuffer : public IEventQueueBuffer {
 public:
@@ -44,9 +49,19 @@ public:
 private:
     typedef std::deque<UInt32> EventDeque;
 
+    static const UInt32    kQueueSize;
+
+    MPSCQueue<UInt32>    m_queue;
+
+    // events added while m_queue was full.  these come after everything
+    // in m_queue and m_overflowing stays set until they're all gone, so
+    // later events keep their order.  guarded by m_queueMutex.
+    EventDeque            m_overflow;
+    std::atomic<bool>    m_overflowing;
+
+    // set while the event thread waits on m_queueReadyCond
+    std::atomic<bool>    m_waiting;
+
     ArchMutex            m_queueMutex;
     ArchCond            m_queueReadyCond;
-    bool                m_queueReady;
-    EventDeque            m_queue;
 };
-
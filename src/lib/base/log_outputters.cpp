@@ -21,12 +21,25 @@
 #include "arch/Arch.h"
 #include "base/String.h"
 
+#include <algorithm>
+#include <chrono>
 #include <fstream>
+#include <vector>
+
+#if SYSAPI_UNIX
+#include <pthread.h>
+#endif
 
 enum EFileLogOutputter {
-    kFileSizeLimit = 1024 // kb
+    kFileSizeLimit = 1024, // kb
+    kQueueSize = 4096, // messages
+    kWriterIdleTime = 100 // ms
 };
 
+// the threaded file outputters, for the fork() handlers
+static std::mutex s_forkMutex;
+static std::vector<FileLogOutputter*> s_forkOutputters;
+
 //
 // StopLogOutputter
 //
@@ -238,47 +251,221 @@ BufferedLogOutputter::write(ELevel, const char* message)
 // FileLogOutputter
 //
 
-FileLogOutputter::FileLogOutputter(const char* logFile)
+FileLogOutputter::FileLogOutputter(const char* logFile, bool useThread) :
+    m_size(0),
+    m_started(false),
+    m_running(false),
+    m_waiting(false),
+    m_dropped(0)
 {
     setLogFilename(logFile);
+
+    if (useThread) {
+        m_queue.reset(new Queue(kQueueSize));
+#if SYSAPI_UNIX
+        static std::once_flag s_atfork;
+        std::call_once(s_atfork, [] {
+            pthread_atfork(&FileLogOutputter::prepareFork,
+                            &FileLogOutputter::parentFork,
+                            &FileLogOutputter::childFork);
+        });
+#endif
+        std::lock_guard<std::mutex> lock(s_forkMutex);
+        s_forkOutputters.push_back(this);
+    }
 }
 
 FileLogOutputter::~FileLogOutputter()
 {
+    if (m_queue) {
+        std::lock_guard<std::mutex> lock(s_forkMutex);
+        s_forkOutputters.erase(std::find(s_forkOutputters.begin(),
+                            s_forkOutputters.end(), this));
+    }
+    if (m_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_wakeMutex);
+            m_running = false;
+            m_wake.notify_one();
+        }
+        m_thread.join();
+    }
 }
 
 void
 FileLogOutputter::setLogFilename(const char* logFile)
 {
     assert(logFile != NULL);
+    std::lock_guard<std::mutex> lock(m_fileMutex);
     m_fileName = logFile;
+    if (m_handle.is_open()) {
+        m_handle.close();
+    }
 }
 
 bool
 FileLogOutputter::write(ELevel level, const char *message)
 {
-    bool moveFile = false;
+    if (!m_queue) {
+        std::lock_guard<std::mutex> lock(m_fileMutex);
+        writeToFile(message);
+        m_handle.flush();
+        return true;
+    }
 
-    std::ofstream m_handle;
-    m_handle.open(m_fileName.c_str(), std::fstream::app);
-    if (m_handle.is_open() && m_handle.fail() != true) {
-        m_handle << message << std::endl;
+    if (!m_started) {
+        startThread();
+    }
+    if (!m_queue->push(std::string(message))) {
+        ++m_dropped;
+        return true;
+    }
 
-        // when file size exceeds limits, move to 'old log' filename.
-        size_t p = m_handle.tellp();
-        if (p > (kFileSizeLimit * 1024)) {
-            moveFile = true;
+    // wake the writer if it's waiting.  the fence pairs with the one in
+    // writerThread() so either it sees the message or we see it waiting.
+    // nothing waits for the message to be written, not even an error:
+    // this is called with the log locked and would hold up every thread
+    // that logs.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_waiting.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_wake.notify_one();
+    }
+    return true;
+}
+
+void
+FileLogOutputter::startThread()
+{
+    // the thread can't be a Thread since those log as they start and
+    // stop, and an outputter mustn't log
+    std::lock_guard<std::mutex> lock(m_wakeMutex);
+    if (!m_started) {
+        m_running = true;
+        m_thread  = std::thread(&FileLogOutputter::writerThread, this);
+        m_started = true;
+    }
+}
+
+void
+FileLogOutputter::writerThread()
+{
+    for (;;) {
+        bool running = m_running;
+        {
+            std::lock_guard<std::mutex> lock(m_fileMutex);
+            writeQueue();
+        }
+        if (!running) {
+            break;
+        }
+
+        // wait for more
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        m_waiting = true;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_running && m_queue->empty()) {
+            m_wake.wait_for(lock, std::chrono::milliseconds(kWriterIdleTime));
         }
+        m_waiting = false;
     }
-    m_handle.close();
+}
 
-    if (moveFile) {
+void
+FileLogOutputter::writeQueue()
+{
+    // write everything queued with one flush
+    std::string message;
+    while (m_queue->pop(message)) {
+        writeToFile(message);
+    }
+    UInt32 dropped = m_dropped.exchange(0);
+    if (dropped != 0) {
+        writeToFile(barrier::string::sprintf(
+            "log queue full, %u messages dropped", dropped));
+    }
+    m_handle.flush();
+}
+
+void
+FileLogOutputter::prepareFork()
+{
+    // write what's queued so the parent and child don't both write it.
+    // the writer only pops with the file locked so we can pop here.
+    s_forkMutex.lock();
+    for (size_t i = 0; i < s_forkOutputters.size(); ++i) {
+        FileLogOutputter* outputter = s_forkOutputters[i];
+        outputter->m_fileMutex.lock();
+        outputter->writeQueue();
+        outputter->m_wakeMutex.lock();
+    }
+}
+
+void
+FileLogOutputter::parentFork()
+{
+    for (size_t i = 0; i < s_forkOutputters.size(); ++i) {
+        s_forkOutputters[i]->m_wakeMutex.unlock();
+        s_forkOutputters[i]->m_fileMutex.unlock();
+    }
+    s_forkMutex.unlock();
+}
+
+void
+FileLogOutputter::childFork()
+{
+    for (size_t i = 0; i < s_forkOutputters.size(); ++i) {
+        FileLogOutputter* outputter = s_forkOutputters[i];
+        outputter->m_wakeMutex.unlock();
+        outputter->m_fileMutex.unlock();
+
+        // only the forking thread exists in the child.  the writer's
+        // handle can't be joined or destroyed while it looks joinable,
+        // so leak it, and the next write() starts a writer of our own.
+        if (outputter->m_thread.joinable()) {
+            new std::thread(std::move(outputter->m_thread));
+        }
+        outputter->m_started = false;
+        outputter->m_running = false;
+        outputter->m_waiting = false;
+    }
+    s_forkMutex.unlock();
+}
+
+void
+FileLogOutputter::writeToFile(const std::string& message)
+{
+    if (!m_handle.is_open()) {
+        openFile();
+        if (!m_handle.is_open()) {
+            return;
+        }
+    }
+
+    m_handle << message << '\n';
+    m_size += message.size() + 1;
+
+    // when file size exceeds limits, move to 'old log' filename.
+    if (m_size > kFileSizeLimit * 1024) {
+        m_handle.close();
         std::string oldLogFilename = barrier::string::sprintf("%s.1", m_fileName.c_str());
         remove(oldLogFilename.c_str());
         rename(m_fileName.c_str(), oldLogFilename.c_str());
     }
+}
 
-    return true;
+void
+FileLogOutputter::openFile()
+{
+    m_handle.clear();
+    m_handle.open(m_fileName.c_str(), std::fstream::app);
+    if (m_handle.is_open() && !m_handle.fail()) {
+        m_handle.seekp(0, std::ios::end);
+        m_size = (size_t)m_handle.tellp();
+    }
+    else {
+        m_handle.close();
+    }
 }
 
 void
@@ -20,12 +20,18 @@
 
 #include "mt/Thread.h"
 #include "base/ILogOutputter.h"
+#include "base/MPSCQueue.h"
 #include "common/basic_types.h"
 #include "common/stddeque.h"
 
+#include <atomic>
+#include <condition_variable>
 #include <list>
 #include <fstream>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 
 //! Stop traversing log chain outputter
 /*!
@@ -66,12 +72,21 @@ public:
 //! Write log to file
 /*!
 This outputter writes output to the file.  The level for each
-message is ignored.
+message is ignored.  The file is kept open between messages and is
+moved to \c <file>.1 when it grows past the size limit.
 */
 
 class FileLogOutputter : public ILogOutputter {
 public:
-    FileLogOutputter(const char* logFile);
+    /*!
+    If \p useThread is \c true then write() just queues the message and
+    a thread writes the queue to the file in batches, so logging doesn't
+    wait on the disk.  The thread is started by the first write(), and
+    again by the first write() in a child after a fork(), so a process
+    that daemonizes keeps it.  Messages that don't fit in the queue are
+    dropped and a count of them is written in their place.
+    */
+    FileLogOutputter(const char* logFile, bool useThread = false);
     virtual ~FileLogOutputter();
 
     // ILogOutputter overrides
@@ -83,7 +98,39 @@ public:
     void                setLogFilename(const char* title);
 
 private:
+    void                startThread();
+    void                writerThread();
+
+    // write the queue to the file.  call with m_fileMutex locked.
+    void                writeQueue();
+    void                writeToFile(const std::string& message);
+    void                openFile();
+
+    // fork() handlers.  the queue of every threaded outputter is written
+    // and its mutexes held across the fork so the child gets them
+    // unlocked, and the child forgets the writer thread it didn't get.
+    static void            prepareFork();
+    static void            parentFork();
+    static void            childFork();
+
+private:
+    typedef MPSCQueue<std::string> Queue;
+
+    // the file.  m_fileMutex guards it from the writer thread.
+    std::mutex            m_fileMutex;
     std::string            m_fileName;
+    std::ofstream        m_handle;
+    size_t                m_size;
+
+    // the queue and the thread that writes it
+    std::unique_ptr<Queue> m_queue;
+    std::thread            m_thread;
+    std::mutex            m_wakeMutex;
+    std::condition_variable m_wake;
+    std::atomic<bool>    m_started;
+    std::atomic<bool>    m_running;
+    std::atomic<bool>    m_waiting;
+    std::atomic<UInt32>    m_dropped;
 };
 
 //! Write log to system log
@@ -29,6 +29,7 @@
 #include "barrier/StreamChunker.h"
 #include "barrier/IPlatformScreen.h"
 #include "mt/Thread.h"
+#include "net/AddressResolver.h"
 #include "net/TCPSocket.h"
 #include "net/IDataSocket.h"
 #include "net/ISocketFactory.h"
@@ -45,6 +46,42 @@
 #include <stdexcept>
 #include <fstream>
 
+// how long a connection to one of the server's addresses gets before
+// the next address is tried alongside it (the connection attempt delay
+// of RFC 8305, "happy eyeballs")
+static const double        kConnectAttemptDelay = 0.25;
+
+// order the server's addresses to alternate between address families,
+// starting with the family the system prefers, so an unreachable family
+// costs one attempt delay rather than a connect timeout per address
+static std::vector<NetworkAddress>
+interleaveFamilies(const std::vector<NetworkAddress>& addresses)
+{
+    std::vector<NetworkAddress> preferred;
+    std::vector<NetworkAddress> other;
+    IArchNetwork::EAddressFamily family =
+        ARCH->getAddrFamily(addresses[0].getAddress());
+    for (size_t i = 0; i < addresses.size(); ++i) {
+        if (ARCH->getAddrFamily(addresses[i].getAddress()) == family) {
+            preferred.push_back(addresses[i]);
+        }
+        else {
+            other.push_back(addresses[i]);
+        }
+    }
+
+    std::vector<NetworkAddress> result;
+    for (size_t i = 0; i < preferred.size() || i < other.size(); ++i) {
+        if (i < preferred.size()) {
+            result.push_back(preferred[i]);
+        }
+        if (i < other.size()) {
+            result.push_back(other[i]);
+        }
+    }
+    return result;
+}
+
 //
 // Client
 //
@@ -52,7 +89,8 @@
 Client::Client(IEventQueue* events, const std::string& name, const NetworkAddress& address,
                ISocketFactory* socketFactory,
                barrier::Screen* screen,
-               ClientArgs const& args) :
+               ClientArgs const& args,
+               AddressResolver* resolver) :
     m_mock(false),
     m_name(name),
     m_serverAddress(address),
@@ -60,6 +98,9 @@ Client::Client(IEventQueue* events, const std::string& name, const NetworkAddres
     m_screen(screen),
     m_stream(NULL),
     m_timer(NULL),
+    m_resolver(resolver != NULL ? resolver : new AddressResolver(events)),
+    m_nextServerAddress(0),
+    m_attemptTimer(NULL),
     m_server(NULL),
     m_ready(false),
     m_active(false),
@@ -76,6 +117,11 @@ Client::Client(IEventQueue* events, const std::string& name, const NetworkAddres
     assert(m_socketFactory != NULL);
     assert(m_screen        != NULL);
 
+    m_events->adoptHandler(m_events->forAddressResolver().resolved(),
+                            m_resolver->getEventTarget(),
+                            new TMethodEventJob<Client>(this,
+                                &Client::handleResolved));
+
     // register suspend/resume event handlers
     m_events->adoptHandler(m_events->forIScreen().suspend(),
                             getEventTarget(),
@@ -113,13 +159,16 @@ Client::~Client()
     cleanupScreen();
     cleanupConnecting();
     cleanupConnection();
+    m_events->removeHandler(m_events->forAddressResolver().resolved(),
+                              m_resolver->getEventTarget());
+    delete m_resolver;
     delete m_socketFactory;
 }
 
 void
 Client::connect()
 {
-    if (m_stream != NULL) {
+    if (m_stream != NULL || isConnecting()) {
         return;
     }
     if (m_suspended) {
@@ -127,47 +176,17 @@ Client::connect()
         return;
     }
 
-    try {
-        // resolve the server hostname.  do this every time we connect
-        // in case we couldn't resolve the address earlier or the address
-        // has changed (which can happen frequently if this is a laptop
-        // being shuttled between various networks).  patch by Brent
-        // Priddy.
-        m_serverAddress.resolve();
-        
-        // m_serverAddress will be null if the hostname address is not reolved
-        if (m_serverAddress.getAddress() != NULL) {
-          // to help users troubleshoot, show server host name (issue: 60)
-          LOG((CLOG_NOTE "connecting to '%s': %s:%i", 
-          m_serverAddress.getHostname().c_str(),
-          ARCH->addrToString(m_serverAddress.getAddress()).c_str(),
-          m_serverAddress.getPort()));
-        }
-
-        // create the socket
-        IDataSocket* socket = m_socketFactory->create(
-                ARCH->getAddrFamily(m_serverAddress.getAddress()),
-                m_useSecureNetwork);
-        m_socket = dynamic_cast<TCPSocket*>(socket);
-
-        // filter socket messages, including a packetizing filter
-        m_stream = socket;
-        m_stream = new PacketStreamFilter(m_events, m_stream, true);
-
-        // connect
-        LOG((CLOG_DEBUG1 "connecting to server"));
-        setupConnecting();
-        setupTimer();
-        socket->connect(m_serverAddress);
-    }
-    catch (XBase& e) {
-        cleanupTimer();
-        cleanupConnecting();
-        cleanupStream();
-        LOG((CLOG_DEBUG1 "connection failed"));
-        sendConnectionFailedEvent(e.what());
-        return;
-    }
+    // resolve the server hostname.  do this every time we connect
+    // in case we couldn't resolve the address earlier or the address
+    // has changed (which can happen frequently if this is a laptop
+    // being shuttled between various networks).  patch by Brent
+    // Priddy.  the name is looked up on another thread, so a slow
+    // name server doesn't stall the client, and handleResolved()
+    // carries on.  the connect timeout covers the lookup.  results are
+    // cached briefly but dropped when none of them can be connected to.
+    LOG((CLOG_DEBUG1 "connecting to server"));
+    setupTimer();
+    m_resolver->resolve(m_serverAddress);
 }
 
 void
@@ -400,13 +419,12 @@ Client::sendClipboard(ClipboardID id)
         // save new time
         m_timeClipboard[id] = clipboard.getTime();
 
-        // marshall the data
-        std::string data = clipboard.marshall();
-
-        // save and send data if different or not yet sent
-        if (!m_sentClipboard[id] || data != m_dataClipboard[id]) {
+        // save and send data if different or not yet sent.  the saved
+        // copy shares the data, and the marshalled data sent with it.
+        if (!m_sentClipboard[id] ||
+            !clipboard.hasSameData(m_dataClipboard[id])) {
             m_sentClipboard[id] = true;
-            m_dataClipboard[id] = data;
+            Clipboard::copy(&m_dataClipboard[id], &clipboard);
             m_server->onClipboardChanged(id, &clipboard);
         }
     }
@@ -428,9 +446,9 @@ Client::sendConnectionFailedEvent(const char* msg)
 }
 
 void
-Client::sendFileChunk(const void* data)
+Client::sendFileChunk(EventData* data)
 {
-    FileChunk* chunk = static_cast<FileChunk*>(const_cast<void*>(data));
+    FileChunk* chunk = static_cast<FileChunk*>(data);
     LOG((CLOG_DEBUG1 "send file chunk"));
     assert(m_server != NULL);
 
@@ -439,27 +457,27 @@ Client::sendFileChunk(const void* data)
 }
 
 void
-Client::setupConnecting()
+Client::setupConnecting(barrier::IStream* stream)
 {
-    assert(m_stream != NULL);
+    assert(stream != NULL);
 
     if (m_args.m_enableCrypto) {
         m_events->adoptHandler(m_events->forIDataSocket().secureConnected(),
-                    m_stream->getEventTarget(),
+                    stream->getEventTarget(),
                         new TMethodEventJob<Client>(this,
-                                &Client::handleConnected));
+                                &Client::handleConnected, stream));
     }
     else {
         m_events->adoptHandler(m_events->forIDataSocket().connected(),
-                    m_stream->getEventTarget(),
+                    stream->getEventTarget(),
                         new TMethodEventJob<Client>(this,
-                                &Client::handleConnected));
+                                &Client::handleConnected, stream));
     }
 
     m_events->adoptHandler(m_events->forIDataSocket().connectionFailed(),
-                            m_stream->getEventTarget(),
+                            stream->getEventTarget(),
                             new TMethodEventJob<Client>(this,
-                                &Client::handleConnectionFailed));
+                                &Client::handleConnectionFailed, stream));
 }
 
 void
@@ -524,14 +542,109 @@ Client::setupTimer()
 void
 Client::cleanupConnecting()
 {
+    m_resolver->cancel();
+    cleanupAttemptTimer();
+    while (!m_attempts.empty()) {
+        cleanupConnectAttempt(m_attempts.back().m_stream);
+    }
+    m_serverAddresses.clear();
+    m_nextServerAddress = 0;
+
     if (m_stream != NULL) {
         m_events->removeHandler(m_events->forIDataSocket().connected(),
                             m_stream->getEventTarget());
+        m_events->removeHandler(m_events->forIDataSocket().secureConnected(),
+                            m_stream->getEventTarget());
         m_events->removeHandler(m_events->forIDataSocket().connectionFailed(),
                             m_stream->getEventTarget());
     }
 }
 
+void
+Client::cleanupConnectAttempt(barrier::IStream* stream)
+{
+    for (ConnectAttempts::iterator i = m_attempts.begin();
+                            i != m_attempts.end(); ++i) {
+        if (i->m_stream == stream) {
+            m_events->removeHandler(m_events->forIDataSocket().connected(),
+                                stream->getEventTarget());
+            m_events->removeHandler(m_events->forIDataSocket().secureConnected(),
+                                stream->getEventTarget());
+            m_events->removeHandler(m_events->forIDataSocket().connectionFailed(),
+                                stream->getEventTarget());
+            m_attempts.erase(i);
+            delete stream;
+            return;
+        }
+    }
+}
+
+void
+Client::cleanupAttemptTimer()
+{
+    if (m_attemptTimer != NULL) {
+        m_events->removeHandler(Event::kTimer, m_attemptTimer);
+        m_events->deleteTimer(m_attemptTimer);
+        m_attemptTimer = NULL;
+    }
+}
+
+bool
+Client::startConnectAttempt()
+{
+    while (m_nextServerAddress < m_serverAddresses.size()) {
+        const NetworkAddress& address = m_serverAddresses[m_nextServerAddress++];
+
+        // to help users troubleshoot, show server host name (issue: 60)
+        LOG((CLOG_NOTE "connecting to '%s': %s:%i",
+            address.getHostname().c_str(),
+            ARCH->addrToString(address.getAddress()).c_str(),
+            address.getPort()));
+
+        ConnectAttempt attempt;
+        attempt.m_socket = NULL;
+        attempt.m_stream = NULL;
+        try {
+            // create the socket
+            attempt.m_socket = m_socketFactory->create(
+                    ARCH->getAddrFamily(address.getAddress()),
+                    m_useSecureNetwork);
+
+            // filter socket messages, including a packetizing filter
+            attempt.m_stream = new PacketStreamFilter(m_events,
+                                attempt.m_socket, true);
+            setupConnecting(attempt.m_stream);
+            m_attempts.push_back(attempt);
+
+            // connect
+            attempt.m_socket->connect(address);
+        }
+        catch (XBase& e) {
+            LOG((CLOG_DEBUG1 "connection to %s failed: %s",
+                ARCH->addrToString(address.getAddress()).c_str(), e.what()));
+            m_connectError = e.what();
+            if (attempt.m_stream != NULL) {
+                cleanupConnectAttempt(attempt.m_stream);
+            }
+            else {
+                delete attempt.m_socket;
+            }
+            continue;
+        }
+
+        // if this address is slow to answer, race it with the next
+        cleanupAttemptTimer();
+        if (m_nextServerAddress < m_serverAddresses.size()) {
+            m_attemptTimer = m_events->newOneShotTimer(kConnectAttemptDelay, NULL);
+            m_events->adoptHandler(Event::kTimer, m_attemptTimer,
+                                new TMethodEventJob<Client>(this,
+                                    &Client::handleAttemptTimeout));
+        }
+        return true;
+    }
+    return false;
+}
+
 void
 Client::cleanupConnection()
 {
@@ -587,9 +700,23 @@ Client::cleanupStream()
 }
 
 void
-Client::handleConnected(const Event&, void*)
+Client::handleConnected(const Event&, void* vstream)
 {
     LOG((CLOG_DEBUG1 "connected;  wait for hello"));
+
+    // the first connection wins and the others are closed
+    barrier::IStream* stream = static_cast<barrier::IStream*>(vstream);
+    for (ConnectAttempts::iterator i = m_attempts.begin();
+                            i != m_attempts.end(); ++i) {
+        if (i->m_stream == stream) {
+            m_socket = dynamic_cast<TCPSocket*>(i->m_socket);
+            m_stream = stream;
+            m_attempts.erase(i);
+            break;
+        }
+    }
+    assert(m_stream == stream);
+
     cleanupConnecting();
     setupConnection();
 
@@ -602,22 +729,33 @@ Client::handleConnected(const Event&, void*)
 }
 
 void
-Client::handleConnectionFailed(const Event& event, void*)
+Client::handleConnectionFailed(const Event& event, void* vstream)
 {
     IDataSocket::ConnectionFailedInfo* info =
         static_cast<IDataSocket::ConnectionFailedInfo*>(event.getData());
+    m_connectError = info->m_what;
+    delete info;
 
+    // try the next address now rather than after the attempt delay
+    LOG((CLOG_DEBUG1 "connection attempt failed: %s", m_connectError.c_str()));
+    cleanupConnectAttempt(static_cast<barrier::IStream*>(vstream));
+    if (startConnectAttempt() || !m_attempts.empty()) {
+        return;
+    }
+
+    // every address failed so look the server up again next time
+    m_resolver->invalidate(m_serverAddress);
     cleanupTimer();
     cleanupConnecting();
     cleanupStream();
     LOG((CLOG_DEBUG1 "connection failed"));
-    sendConnectionFailedEvent(info->m_what.c_str());
-    delete info;
+    sendConnectionFailedEvent(m_connectError.c_str());
 }
 
 void
 Client::handleConnectTimeout(const Event&, void*)
 {
+    m_resolver->invalidate(m_serverAddress);
     cleanupTimer();
     cleanupConnecting();
     cleanupConnection();
@@ -626,6 +764,43 @@ Client::handleConnectTimeout(const Event&, void*)
     sendConnectionFailedEvent("Timed out");
 }
 
+void
+Client::handleResolved(const Event& event, void*)
+{
+    AddressResolver::Result* result =
+        static_cast<AddressResolver::Result*>(event.getDataObject());
+
+    // ignore the result of a lookup that was cancelled after it was sent
+    if (!isConnecting() || m_stream != NULL || !m_serverAddresses.empty()) {
+        return;
+    }
+
+    if (result->m_addresses.empty()) {
+        cleanupTimer();
+        LOG((CLOG_DEBUG1 "connection failed"));
+        sendConnectionFailedEvent(result->m_error.c_str());
+        return;
+    }
+
+    m_serverAddresses   = interleaveFamilies(result->m_addresses);
+    m_nextServerAddress = 0;
+    m_connectError.clear();
+    if (!startConnectAttempt()) {
+        m_resolver->invalidate(m_serverAddress);
+        cleanupTimer();
+        cleanupConnecting();
+        LOG((CLOG_DEBUG1 "connection failed"));
+        sendConnectionFailedEvent(m_connectError.c_str());
+    }
+}
+
+void
+Client::handleAttemptTimeout(const Event&, void*)
+{
+    cleanupAttemptTimer();
+    startConnectAttempt();
+}
+
 void
 Client::handleOutputError(const Event&, void*)
 {
@@ -742,7 +917,7 @@ Client::handleResume(const Event&, void*)
 void
 Client::handleFileChunkSending(const Event& event, void*)
 {
-    sendFileChunk(event.getData());
+    sendFileChunk(event.getDataObject());
 }
 
 void
@@ -777,7 +952,7 @@ Client::writeToDropDirThread(void*)
     }
     
     DropHelper::writeToDir(m_screen->getDropTarget(), m_dragFileList,
-                    m_receivedFileData);
+                    m_fileReceiver);
 }
 
 void
@@ -797,7 +972,7 @@ Client::dragInfoReceived(UInt32 fileNum, std::string data)
 bool
 Client::isReceivedFileSizeValid()
 {
-    return m_expectedFileSize == m_receivedFileData.size();
+    return m_fileReceiver.isComplete();
 }
 
 void
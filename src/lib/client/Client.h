@@ -22,12 +22,16 @@
 
 #include "barrier/Clipboard.h"
 #include "barrier/DragInformation.h"
+#include "barrier/FileReceiver.h"
 #include "barrier/INode.h"
 #include "barrier/ClientArgs.h"
 #include "net/NetworkAddress.h"
 #include "base/EventTypes.h"
 #include "mt/CondVar.h"
+#include "common/stdvector.h"
 
+class AddressResolver;
+class EventData;
 class EventQueueTimer;
 namespace barrier { class Screen; }
 class ServerProxy;
@@ -55,11 +59,15 @@ public:
     /*!
     This client will attempt to connect to the server using \p name
     as its name and \p address as the server's address and \p factory
-    to create the socket.  \p screen is    the local screen.
+    to create the socket.  \p screen is    the local screen.  \p resolver
+    looks up the server's addresses;  a resolver using the system's
+    name service is used if it's NULL.  The client adopts \p factory
+    and \p resolver.
     */
     Client(IEventQueue* events, const std::string& name,
            const NetworkAddress& address, ISocketFactory* socketFactory,
-           barrier::Screen* screen, ClientArgs const& args);
+           barrier::Screen* screen, ClientArgs const& args,
+           AddressResolver* resolver = NULL);
 
     ~Client();
 
@@ -69,7 +77,10 @@ public:
     //! Connect to server
     /*!
     Starts an attempt to connect to the server.  This is ignored if
-    the client is trying to connect or is already connected.
+    the client is trying to connect or is already connected.  The
+    server's addresses are looked up without blocking and connections
+    to them are raced, starting one more each 250ms until one succeeds,
+    alternating between IPv6 and IPv4.
     */
     void                connect();
 
@@ -122,11 +133,8 @@ public:
     //! Return true if recieved file size is valid
     bool                isReceivedFileSizeValid();
 
-    //! Return expected file size
-    size_t&                getExpectedFileSize() { return m_expectedFileSize; }
-
-    //! Return received file data
-    std::string& getReceivedFileData() { return m_receivedFileData; }
+    //! Return the receiver of dropped files
+    FileReceiver&        getFileReceiver() { return m_fileReceiver; }
 
     //! Return drag file list
     DragFileList        getDragFileList() { return m_dragFileList; }
@@ -166,14 +174,17 @@ private:
     void                sendClipboard(ClipboardID);
     void                sendEvent(Event::Type, void*);
     void                sendConnectionFailedEvent(const char* msg);
-    void                sendFileChunk(const void* data);
+    void                sendFileChunk(EventData* data);
     void                sendFileThread(void*);
     void                writeToDropDirThread(void*);
-    void                setupConnecting();
+    void                setupConnecting(barrier::IStream* stream);
     void                setupConnection();
     void                setupScreen();
     void                setupTimer();
     void                cleanupConnecting();
+    void                cleanupConnectAttempt(barrier::IStream* stream);
+    void                cleanupAttemptTimer();
+    bool                startConnectAttempt();
     void                cleanupConnection();
     void                cleanupScreen();
     void                cleanupTimer();
@@ -181,6 +192,8 @@ private:
     void                handleConnected(const Event&, void*);
     void                handleConnectionFailed(const Event&, void*);
     void                handleConnectTimeout(const Event&, void*);
+    void                handleResolved(const Event&, void*);
+    void                handleAttemptTimeout(const Event&, void*);
     void                handleOutputError(const Event&, void*);
     void                handleDisconnected(const Event&, void*);
     void                handleShapeChanged(const Event&, void*);
@@ -194,6 +207,16 @@ private:
     void                onFileRecieveCompleted();
     void                sendClipboardThread(void*);
 
+private:
+    // a connection to one of the server's addresses, raced against
+    // the others
+    class ConnectAttempt {
+    public:
+        IDataSocket*        m_socket;
+        barrier::IStream*    m_stream;
+    };
+    typedef std::vector<ConnectAttempt> ConnectAttempts;
+
 public:
     bool                m_mock;
 
@@ -204,6 +227,12 @@ private:
     barrier::Screen*    m_screen;
     barrier::IStream*    m_stream;
     EventQueueTimer*    m_timer;
+    AddressResolver*    m_resolver;
+    std::vector<NetworkAddress> m_serverAddresses;
+    size_t                m_nextServerAddress;
+    ConnectAttempts        m_attempts;
+    EventQueueTimer*    m_attemptTimer;
+    std::string            m_connectError;
     ServerProxy*        m_server;
     bool                m_ready;
     bool                m_active;
@@ -212,10 +241,9 @@ private:
     bool                m_ownClipboard[kClipboardEnd];
     bool                m_sentClipboard[kClipboardEnd];
     IClipboard::Time    m_timeClipboard[kClipboardEnd];
-    std::string m_dataClipboard[kClipboardEnd];
+    Clipboard            m_dataClipboard[kClipboardEnd];
     IEventQueue*        m_events;
-    std::size_t            m_expectedFileSize;
-    std::string m_receivedFileData;
+    FileReceiver        m_fileReceiver;
     DragFileList        m_dragFileList;
     std::string m_dragFileExt;
     Thread*                m_sendFileThread;
@@ -20,10 +20,8 @@
 
 #include "client/Client.h"
 #include "barrier/FileChunk.h"
-#include "barrier/ClipboardChunk.h"
-#include "barrier/StreamChunker.h"
 #include "barrier/Clipboard.h"
-#include "barrier/ProtocolUtil.h"
+#include "barrier/ProtocolMessage.h"
 #include "barrier/option_types.h"
 #include "barrier/protocol_types.h"
 #include "io/IStream.h"
@@ -52,7 +50,8 @@ ServerProxy::ServerProxy(Client* client, barrier::IStream* stream, IEventQueue*
     m_keepAliveAlarm(0.0),
     m_keepAliveAlarmTimer(NULL),
     m_parser(&ServerProxy::parseHandshakeMessage),
-    m_events(events)
+    m_events(events),
+    m_clipboardSender(stream, events)
 {
     assert(m_client != NULL);
     assert(m_stream != NULL);
@@ -67,11 +66,6 @@ ServerProxy::ServerProxy(Client* client, barrier::IStream* stream, IEventQueue*
                             new TMethodEventJob<ServerProxy>(this,
                                 &ServerProxy::handleData));
 
-    m_events->adoptHandler(m_events->forClipboard().clipboardSending(),
-                            this,
-                            new TMethodEventJob<ServerProxy>(this,
-                                &ServerProxy::handleClipboardSendingEvent));
-
     // send heartbeat
     setKeepAliveRate(kKeepAliveRate);
 }
@@ -81,12 +75,22 @@ ServerProxy::~ServerProxy()
     setKeepAliveRate(-1.0);
     m_events->removeHandler(m_events->forIStream().inputReady(),
                             m_stream->getEventTarget());
-    m_events->removeHandler(m_events->forClipboard().clipboardSending(), this);
 }
 
 void
 ServerProxy::resetKeepAliveAlarm()
 {
+    // push back the alarm.  the timer is only replaced when the rate
+    // changes.
+    if (m_keepAliveAlarmTimer != NULL) {
+        m_events->touchTimer(m_keepAliveAlarmTimer);
+    }
+}
+
+void
+ServerProxy::setKeepAliveRate(double rate)
+{
+    m_keepAliveAlarm = rate * kKeepAlivesUntilDeath;
     if (m_keepAliveAlarmTimer != NULL) {
         m_events->removeHandler(Event::kTimer, m_keepAliveAlarmTimer);
         m_events->deleteTimer(m_keepAliveAlarmTimer);
@@ -101,13 +105,6 @@ ServerProxy::resetKeepAliveAlarm()
     }
 }
 
-void
-ServerProxy::setKeepAliveRate(double rate)
-{
-    m_keepAliveAlarm = rate * kKeepAlivesUntilDeath;
-    resetKeepAliveAlarm();
-}
-
 void
 ServerProxy::handleData(const Event&, void*)
 {
@@ -124,7 +121,7 @@ ServerProxy::handleData(const Event&, void*)
 
         // parse message
         LOG((CLOG_DEBUG2 "msg from server: %c%c%c%c", code[0], code[1], code[2], code[3]));
-        switch ((this->*m_parser)(code)) {
+        switch ((this->*m_parser)(toMessageCode(code))) {
         case kOkay:
             break;
 
@@ -145,72 +142,69 @@ ServerProxy::handleData(const Event&, void*)
 }
 
 ServerProxy::EResult
-ServerProxy::parseHandshakeMessage(const UInt8* code)
+ServerProxy::parseHandshakeMessage(UInt32 code)
 {
-    if (memcmp(code, kMsgQInfo, 4) == 0) {
+    switch (code) {
+    case kMsgCodeQInfo:
         queryInfo();
-    }
+        break;
 
-    else if (memcmp(code, kMsgCInfoAck, 4) == 0) {
+    case kMsgCodeCInfoAck:
         infoAcknowledgment();
-    }
+        break;
 
-    else if (memcmp(code, kMsgDSetOptions, 4) == 0) {
+    case kMsgCodeDSetOptions:
         setOptions();
 
         // handshake is complete
         m_parser = &ServerProxy::parseMessage;
         m_client->handshakeComplete();
-    }
+        break;
 
-    else if (memcmp(code, kMsgCResetOptions, 4) == 0) {
+    case kMsgCodeCResetOptions:
         resetOptions();
-    }
+        break;
 
-    else if (memcmp(code, kMsgCKeepAlive, 4) == 0) {
+    case kMsgCodeCKeepAlive:
         // echo keep alives and reset alarm
-        ProtocolUtil::writef(m_stream, kMsgCKeepAlive);
+        MsgCKeepAlive::write(m_stream);
         resetKeepAliveAlarm();
-    }
+        break;
 
-    else if (memcmp(code, kMsgCNoop, 4) == 0) {
+    case kMsgCodeCNoop:
         // accept and discard no-op
-    }
+        break;
 
-    else if (memcmp(code, kMsgCClose, 4) == 0) {
+    case kMsgCodeCClose:
         // server wants us to hangup
         LOG((CLOG_DEBUG1 "recv close"));
         m_client->disconnect(NULL);
         return kDisconnect;
-    }
 
-    else if (memcmp(code, kMsgEIncompatible, 4) == 0) {
-        SInt32 major, minor;
-        ProtocolUtil::readf(m_stream,
-                        kMsgEIncompatible + 4, &major, &minor);
+    case kMsgCodeEIncompatible: {
+        SInt16 major, minor;
+        MsgEIncompatible::read(m_stream, &major, &minor);
         LOG((CLOG_ERR "server has incompatible version %d.%d", major, minor));
         m_client->disconnect("server has incompatible version");
         return kDisconnect;
     }
 
-    else if (memcmp(code, kMsgEBusy, 4) == 0) {
+    case kMsgCodeEBusy:
         LOG((CLOG_ERR "server already has a connected client with name \"%s\"", m_client->getName().c_str()));
         m_client->disconnect("server already has a connected client with our name");
         return kDisconnect;
-    }
 
-    else if (memcmp(code, kMsgEUnknown, 4) == 0) {
+    case kMsgCodeEUnknown:
         LOG((CLOG_ERR "server refused client with name \"%s\"", m_client->getName().c_str()));
         m_client->disconnect("server refused client with our name");
         return kDisconnect;
-    }
 
-    else if (memcmp(code, kMsgEBad, 4) == 0) {
+    case kMsgCodeEBad:
         LOG((CLOG_ERR "server disconnected due to a protocol error"));
         m_client->disconnect("server reported a protocol error");
         return kDisconnect;
-    }
-    else {
+
+    default:
         return kUnknown;
     }
 
@@ -218,105 +212,107 @@ ServerProxy::parseHandshakeMessage(const UInt8* code)
 }
 
 ServerProxy::EResult
-ServerProxy::parseMessage(const UInt8* code)
+ServerProxy::parseMessage(UInt32 code)
 {
-    if (memcmp(code, kMsgDMouseMove, 4) == 0) {
+    switch (code) {
+    case kMsgCodeDMouseMove:
         mouseMove();
-    }
+        break;
 
-    else if (memcmp(code, kMsgDMouseRelMove, 4) == 0) {
+    case kMsgCodeDMouseRelMove:
         mouseRelativeMove();
-    }
+        break;
 
-    else if (memcmp(code, kMsgDMouseWheel, 4) == 0) {
+    case kMsgCodeDMouseWheel:
         mouseWheel();
-    }
+        break;
 
-    else if (memcmp(code, kMsgDKeyDown, 4) == 0) {
+    case kMsgCodeDKeyDown:
         keyDown();
-    }
+        break;
 
-    else if (memcmp(code, kMsgDKeyUp, 4) == 0) {
+    case kMsgCodeDKeyUp:
         keyUp();
-    }
+        break;
 
-    else if (memcmp(code, kMsgDMouseDown, 4) == 0) {
+    case kMsgCodeDMouseDown:
         mouseDown();
-    }
+        break;
 
-    else if (memcmp(code, kMsgDMouseUp, 4) == 0) {
+    case kMsgCodeDMouseUp:
         mouseUp();
-    }
+        break;
 
-    else if (memcmp(code, kMsgDKeyRepeat, 4) == 0) {
+    case kMsgCodeDKeyRepeat:
         keyRepeat();
-    }
+        break;
 
-    else if (memcmp(code, kMsgCKeepAlive, 4) == 0) {
+    case kMsgCodeCKeepAlive:
         // echo keep alives and reset alarm
-        ProtocolUtil::writef(m_stream, kMsgCKeepAlive);
+        MsgCKeepAlive::write(m_stream);
         resetKeepAliveAlarm();
-    }
+        break;
 
-    else if (memcmp(code, kMsgCNoop, 4) == 0) {
+    case kMsgCodeCNoop:
         // accept and discard no-op
-    }
+        break;
 
-    else if (memcmp(code, kMsgCEnter, 4) == 0) {
+    case kMsgCodeCEnter:
         enter();
-    }
+        break;
 
-    else if (memcmp(code, kMsgCLeave, 4) == 0) {
+    case kMsgCodeCLeave:
         leave();
-    }
+        break;
 
-    else if (memcmp(code, kMsgCClipboard, 4) == 0) {
+    case kMsgCodeCClipboard:
         grabClipboard();
-    }
+        break;
 
-    else if (memcmp(code, kMsgCScreenSaver, 4) == 0) {
+    case kMsgCodeCScreenSaver:
         screensaver();
-    }
+        break;
 
-    else if (memcmp(code, kMsgQInfo, 4) == 0) {
+    case kMsgCodeQInfo:
         queryInfo();
-    }
+        break;
 
-    else if (memcmp(code, kMsgCInfoAck, 4) == 0) {
+    case kMsgCodeCInfoAck:
         infoAcknowledgment();
-    }
+        break;
 
-    else if (memcmp(code, kMsgDClipboard, 4) == 0) {
+    case kMsgCodeDClipboard:
         setClipboard();
-    }
+        break;
 
-    else if (memcmp(code, kMsgCResetOptions, 4) == 0) {
+    case kMsgCodeCResetOptions:
         resetOptions();
-    }
+        break;
 
-    else if (memcmp(code, kMsgDSetOptions, 4) == 0) {
+    case kMsgCodeDSetOptions:
         setOptions();
-    }
+        break;
 
-    else if (memcmp(code, kMsgDFileTransfer, 4) == 0) {
+    case kMsgCodeDFileTransfer:
         fileChunkReceived();
-    }
-    else if (memcmp(code, kMsgDDragInfo, 4) == 0) {
+        break;
+
+    case kMsgCodeDDragInfo:
         dragInfoReceived();
-    }
+        break;
 
-    else if (memcmp(code, kMsgCClose, 4) == 0) {
+    case kMsgCodeCClose:
         // server wants us to hangup
         LOG((CLOG_DEBUG1 "recv close"));
         m_client->disconnect(NULL);
         return kDisconnect;
-    }
-    else if (memcmp(code, kMsgEBad, 4) == 0) {
+
+    case kMsgCodeEBad:
         LOG((CLOG_ERR "server disconnected due to a protocol error"));
         m_client->disconnect("server reported a protocol error");
         return kDisconnect;
-    }
-    else {
+
+    default:
         return kUnknown;
     }
 
@@ -327,7 +323,7 @@ ServerProxy::parseMessage(const UInt8* code)
     // on a data packet.  we provide that packet here.  i don't
     // know why a delayed ACK should cause the server to wait since
     // TCP_NODELAY is enabled.
-    ProtocolUtil::writef(m_stream, kMsgCNoop);
+    MsgCNoop::write(m_stream);
 
     return kOkay;
 }
@@ -354,17 +350,25 @@ bool
 ServerProxy::onGrabClipboard(ClipboardID id)
 {
     LOG((CLOG_DEBUG1 "sending clipboard %d changed", id));
-    ProtocolUtil::writef(m_stream, kMsgCClipboard, id, m_seqNum);
+    MsgCClipboard::write(m_stream, id, m_seqNum);
     return true;
 }
 
 void
 ServerProxy::onClipboardChanged(ClipboardID id, const IClipboard* clipboard)
 {
-    std::string data = IClipboard::marshall(clipboard);
+    // a Clipboard has its marshalled data already
+    ClipboardSender::Data data;
+    const Clipboard* memClipboard = dynamic_cast<const Clipboard*>(clipboard);
+    if (memClipboard != NULL) {
+        data = memClipboard->marshallShared();
+    }
+    else {
+        data = std::make_shared<const String>(IClipboard::marshall(clipboard));
+    }
     LOG((CLOG_DEBUG "sending clipboard %d seqnum=%d", id, m_seqNum));
 
-    StreamChunker::sendClipboard(data, data.size(), id, m_seqNum, m_events, this);
+    m_clipboardSender.send(id, m_seqNum, data);
 }
 
 void
@@ -386,8 +390,7 @@ void
 ServerProxy::sendInfo(const ClientInfo& info)
 {
     LOG((CLOG_DEBUG1 "sending info shape=%d,%d %dx%d", info.m_x, info.m_y, info.m_w, info.m_h));
-    ProtocolUtil::writef(m_stream, kMsgDInfo,
-                                info.m_x, info.m_y,
+    MsgDInfo::write(m_stream, info.m_x, info.m_y,
                                 info.m_w, info.m_h, 0,
                                 info.m_mx, info.m_my);
 }
@@ -519,7 +522,7 @@ ServerProxy::enter()
     SInt16 x, y;
     UInt16 mask;
     UInt32 seqNum;
-    ProtocolUtil::readf(m_stream, kMsgCEnter + 4, &x, &y, &seqNum, &mask);
+    MsgCEnter::read(m_stream, &x, &y, &seqNum, &mask);
     LOG((CLOG_DEBUG1 "recv enter, %d,%d %d %04x", x, y, seqNum, mask));
 
     // discard old compressed mouse motion, if any
@@ -550,22 +553,19 @@ void
 ServerProxy::setClipboard()
 {
     // parse
-    static std::string dataCached;
-    ClipboardID id;
-    UInt32 seq;
-    
-    int r = ClipboardChunk::assemble(m_stream, dataCached, id, seq);
+    int r = m_clipboardReceiver.read(m_stream);
+    ClipboardID id = m_clipboardReceiver.getID();
 
     if (r == kStart) {
-        size_t size = ClipboardChunk::getExpectedSize();
+        size_t size = m_clipboardReceiver.getExpectedSize();
         LOG((CLOG_DEBUG "receiving clipboard %d size=%d", id, size));
     }
     else if (r == kFinish) {
-        LOG((CLOG_DEBUG "received clipboard %d size=%d", id, dataCached.size()));
-        
+        LOG((CLOG_DEBUG "received clipboard %d size=%d", id, m_clipboardReceiver.getSize()));
+
         // forward
         Clipboard clipboard;
-        clipboard.unmarshall(dataCached, 0);
+        m_clipboardReceiver.takeClipboard(&clipboard, 0);
         m_client->setClipboard(id, &clipboard);
 
         LOG((CLOG_INFO "clipboard was updated"));
@@ -578,7 +578,7 @@ ServerProxy::grabClipboard()
     // parse
     ClipboardID id;
     UInt32 seqNum;
-    ProtocolUtil::readf(m_stream, kMsgCClipboard + 4, &id, &seqNum);
+    MsgCClipboard::read(m_stream, &id, &seqNum);
     LOG((CLOG_DEBUG "recv grab clipboard %d", id));
 
     // validate
@@ -598,7 +598,7 @@ ServerProxy::keyDown()
 
     // parse
     UInt16 id, mask, button;
-    ProtocolUtil::readf(m_stream, kMsgDKeyDown + 4, &id, &mask, &button);
+    MsgDKeyDown::read(m_stream, &id, &mask, &button);
     LOG((CLOG_DEBUG1 "recv key down id=0x%08x, mask=0x%04x, button=0x%04x", id, mask, button));
 
     // translate
@@ -621,8 +621,7 @@ ServerProxy::keyRepeat()
 
     // parse
     UInt16 id, mask, count, button;
-    ProtocolUtil::readf(m_stream, kMsgDKeyRepeat + 4,
-                                &id, &mask, &count, &button);
+    MsgDKeyRepeat::read(m_stream, &id, &mask, &count, &button);
     LOG((CLOG_DEBUG1 "recv key repeat id=0x%08x, mask=0x%04x, count=%d, button=0x%04x", id, mask, count, button));
 
     // translate
@@ -645,7 +644,7 @@ ServerProxy::keyUp()
 
     // parse
     UInt16 id, mask, button;
-    ProtocolUtil::readf(m_stream, kMsgDKeyUp + 4, &id, &mask, &button);
+    MsgDKeyUp::read(m_stream, &id, &mask, &button);
     LOG((CLOG_DEBUG1 "recv key up id=0x%08x, mask=0x%04x, button=0x%04x", id, mask, button));
 
     // translate
@@ -668,7 +667,7 @@ ServerProxy::mouseDown()
 
     // parse
     SInt8 id;
-    ProtocolUtil::readf(m_stream, kMsgDMouseDown + 4, &id);
+    MsgDMouseDown::read(m_stream, &id);
     LOG((CLOG_DEBUG1 "recv mouse down id=%d", id));
 
     // forward
@@ -683,7 +682,7 @@ ServerProxy::mouseUp()
 
     // parse
     SInt8 id;
-    ProtocolUtil::readf(m_stream, kMsgDMouseUp + 4, &id);
+    MsgDMouseUp::read(m_stream, &id);
     LOG((CLOG_DEBUG1 "recv mouse up id=%d", id));
 
     // forward
@@ -696,7 +695,7 @@ ServerProxy::mouseMove()
     // parse
     bool ignore;
     SInt16 x, y;
-    ProtocolUtil::readf(m_stream, kMsgDMouseMove + 4, &x, &y);
+    MsgDMouseMove::read(m_stream, &x, &y);
 
     // note if we should ignore the move
     ignore = m_ignoreMouse;
@@ -729,7 +728,7 @@ ServerProxy::mouseRelativeMove()
     // parse
     bool ignore;
     SInt16 dx, dy;
-    ProtocolUtil::readf(m_stream, kMsgDMouseRelMove + 4, &dx, &dy);
+    MsgDMouseRelMove::read(m_stream, &dx, &dy);
 
     // note if we should ignore the move
     ignore = m_ignoreMouse;
@@ -761,7 +760,7 @@ ServerProxy::mouseWheel()
 
     // parse
     SInt16 xDelta, yDelta;
-    ProtocolUtil::readf(m_stream, kMsgDMouseWheel + 4, &xDelta, &yDelta);
+    MsgDMouseWheel::read(m_stream, &xDelta, &yDelta);
     LOG((CLOG_DEBUG2 "recv mouse wheel %+d,%+d", xDelta, yDelta));
 
     // forward
@@ -773,7 +772,7 @@ ServerProxy::screensaver()
 {
     // parse
     SInt8 on;
-    ProtocolUtil::readf(m_stream, kMsgCScreenSaver + 4, &on);
+    MsgCScreenSaver::read(m_stream, &on);
     LOG((CLOG_DEBUG1 "recv screen saver on=%d", on));
 
     // forward
@@ -803,7 +802,7 @@ ServerProxy::setOptions()
 {
     // parse
     OptionsList options;
-    ProtocolUtil::readf(m_stream, kMsgDSetOptions + 4, &options);
+    MsgDSetOptions::read(m_stream, &options);
     LOG((CLOG_DEBUG1 "recv set options size=%d", options.size()));
 
     // forward
@@ -862,10 +861,7 @@ ServerProxy::infoAcknowledgment()
 void
 ServerProxy::fileChunkReceived()
 {
-    int result = FileChunk::assemble(
-                    m_stream,
-                    m_client->getReceivedFileData(),
-                    m_client->getExpectedFileSize());
+    int result = m_client->getFileReceiver().read(m_stream);
 
     if (result == kFinish) {
         m_events->addEvent(Event(m_events->forFile().fileRecieveCompleted(), m_client));
@@ -882,19 +878,13 @@ void
 ServerProxy::dragInfoReceived()
 {
     // parse
-    UInt32 fileNum = 0;
+    UInt16 fileNum = 0;
     std::string content;
-    ProtocolUtil::readf(m_stream, kMsgDDragInfo + 4, &fileNum, &content);
+    MsgDDragInfo::read(m_stream, &fileNum, &content);
 
     m_client->dragInfoReceived(fileNum, content);
 }
 
-void
-ServerProxy::handleClipboardSendingEvent(const Event& event, void*)
-{
-    ClipboardChunk::send(m_stream, event.getData());
-}
-
 void
 ServerProxy::fileChunkSending(UInt8 mark, char* data, size_t dataSize)
 {
@@ -905,5 +895,5 @@ void
 ServerProxy::sendDragInfo(UInt32 fileCount, const char* info, size_t size)
 {
     std::string data(info, size);
-    ProtocolUtil::writef(m_stream, kMsgDDragInfo, fileCount, &data);
+    MsgDDragInfo::write(m_stream, fileCount, data);
 }
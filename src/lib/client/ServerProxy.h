@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include "barrier/ClipboardReceiver.h"
+#include "barrier/ClipboardSender.h"
 #include "barrier/clipboard_types.h"
 #include "barrier/key_types.h"
 #include "base/Event.h"
@@ -65,8 +67,8 @@ public:
 
 protected:
     enum EResult { kOkay, kUnknown, kDisconnect };
-    EResult                parseHandshakeMessage(const UInt8* code);
-    EResult                parseMessage(const UInt8* code);
+    EResult                parseHandshakeMessage(UInt32 code);
+    EResult                parseMessage(UInt32 code);
 
 private:
     // if compressing mouse motion then send the last motion now
@@ -105,10 +107,9 @@ private:
     void                infoAcknowledgment();
     void                fileChunkReceived();
     void                dragInfoReceived();
-    void                handleClipboardSendingEvent(const Event&, void*);
 
 private:
-    typedef EResult (ServerProxy::*MessageParser)(const UInt8*);
+    typedef EResult (ServerProxy::*MessageParser)(UInt32);
 
     Client*            m_client;
     barrier::IStream*    m_stream;
@@ -129,4 +130,7 @@ private:
 
     MessageParser        m_parser;
     IEventQueue*        m_events;
+
+    ClipboardSender        m_clipboardSender;
+    ClipboardReceiver    m_clipboardReceiver;
 };
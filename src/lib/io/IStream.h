@@ -22,6 +22,7 @@
 #include "base/Event.h"
 #include "base/IEventQueue.h"
 #include "base/EventTypes.h"
+#include "io/StreamBuffer.h"
 
 class IEventQueue;
 
@@ -56,6 +57,14 @@ public:
     */
     virtual UInt32        read(void* buffer, UInt32 n) = 0;
 
+    //! Read all available data into a buffer
+    /*!
+    Appends everything an immediate \c read() could return to \p buffer
+    and returns the number of bytes appended.  Streams that keep their
+    input in a StreamBuffer can hand it over without copying.
+    */
+    virtual UInt32        readAll(StreamBuffer& buffer) = 0;
+
     //! Write to stream
     /*!
     Write \c n bytes from \c buffer to the stream.  If this can't
@@ -65,6 +74,16 @@ public:
     */
     virtual void        write(const void* buffer, UInt32 n) = 0;
 
+    //! Write several buffers to stream
+    /*!
+    Write the \c count buffers in \c buffers to the stream in order.
+    This behaves like a \c write() of the buffers joined together, so
+    no other write can come between them, but the caller needn't join
+    them first.
+    */
+    virtual void        writev(const StreamBuffer::Span* buffers,
+                            UInt32 count) = 0;
+
     //! Flush the stream
     /*!
     Waits until all buffered data has been written to the stream.
@@ -18,15 +18,20 @@
 
 #include "io/StreamBuffer.h"
 
+#include <algorithm>
+#include <cstring>
+
 //
 // StreamBuffer
 //
 
-const UInt32            StreamBuffer::kChunkSize = 4096;
+const UInt32            StreamBuffer::kMinCapacity = 4096;
+const UInt32            StreamBuffer::kMaxIdleCapacity = 65536;
 
 StreamBuffer::StreamBuffer() :
+    m_head(0),
     m_size(0),
-    m_headUsed(0)
+    m_reserved(0)
 {
     // do nothing
 }
@@ -42,54 +47,58 @@ StreamBuffer::peek(UInt32 n)
     assert(n <= m_size);
 
     // if requesting no data then return NULL so we don't try to access
-    // an empty list.
+    // an empty ring.
     if (n == 0) {
         return NULL;
     }
 
-    // reserve space in first chunk
-    ChunkList::iterator head = m_chunks.begin();
-    head->reserve(n + m_headUsed);
-
-    // consolidate chunks into the first chunk until it has n bytes
-    ChunkList::iterator scan = head;
-    ++scan;
-    while (head->size() - m_headUsed < n && scan != m_chunks.end()) {
-        head->insert(head->end(), scan->begin(), scan->end());
-        scan = m_chunks.erase(scan);
+    // make the data contiguous if it wraps
+    if (m_head + n > (UInt32)m_ring.size()) {
+        linearize();
     }
 
-    return static_cast<const void*>(&(head->begin()[m_headUsed]));
+    return static_cast<const void*>(&m_ring[m_head]);
 }
 
 void
 StreamBuffer::pop(UInt32 n)
 {
-    // discard all chunks if n is greater than or equal to m_size
+    m_reserved = 0;
+
+    // discard everything if n is greater than or equal to m_size.  don't
+    // hang on to a ring that grew for an unusually large write.
     if (n >= m_size) {
-        m_size     = 0;
-        m_headUsed = 0;
-        m_chunks.clear();
+        m_size = 0;
+        m_head = 0;
+        if (m_ring.size() > kMaxIdleCapacity) {
+            std::vector<UInt8>().swap(m_ring);
+        }
         return;
     }
 
-    // update size
+    m_head  = (m_head + n) & ((UInt32)m_ring.size() - 1);
     m_size -= n;
+}
 
-    // discard chunks until more than n bytes would've been discarded
-    ChunkList::iterator scan = m_chunks.begin();
-    assert(scan != m_chunks.end());
-    while (scan->size() - m_headUsed <= n) {
-        n         -= (UInt32)scan->size() - m_headUsed;
-        m_headUsed = 0;
-        scan       = m_chunks.erase(scan);
-        assert(scan != m_chunks.end());
+UInt32
+StreamBuffer::read(void* vdata, UInt32 n)
+{
+    if (n > m_size) {
+        n = m_size;
     }
 
-    // remove left over bytes from the head chunk
-    if (n > 0) {
-        m_headUsed += n;
+    if (vdata != NULL) {
+        UInt8* data = static_cast<UInt8*>(vdata);
+        Span spans[2];
+        UInt32 count = peekSpans(spans, n);
+        for (UInt32 i = 0; i < count; ++i) {
+            memcpy(data, spans[i].m_data, spans[i].m_size);
+            data += spans[i].m_size;
+        }
     }
+
+    pop(n);
+    return n;
 }
 
 void
@@ -97,46 +106,106 @@ StreamBuffer::write(const void* vdata, UInt32 n)
 {
     assert(vdata != NULL);
 
-    // ignore if no data, otherwise update size
+    m_reserved = 0;
+
+    // ignore if no data
     if (n == 0) {
         return;
     }
-    m_size += n;
 
-    // cast data to bytes
+    if ((UInt32)m_ring.size() - m_size < n) {
+        grow(n);
+    }
+
+    // copy up to the end of the ring then wrap around to the start
     const UInt8* data = static_cast<const UInt8*>(vdata);
+    UInt32 capacity   = (UInt32)m_ring.size();
+    UInt32 tail       = (m_head + m_size) & (capacity - 1);
+    UInt32 count      = std::min(n, capacity - tail);
+    memcpy(&m_ring[tail], data, count);
+    if (count < n) {
+        memcpy(&m_ring[0], data + count, n - count);
+    }
+    m_size += n;
+}
 
-    // point to last chunk if it has space, otherwise append an empty chunk
-    ChunkList::iterator scan = m_chunks.end();
-    if (scan != m_chunks.begin()) {
-        --scan;
-        if (scan->size() >= kChunkSize) {
-            ++scan;
-        }
+void
+StreamBuffer::append(StreamBuffer& source, UInt32 n)
+{
+    assert(&source != this);
+    assert(n <= source.m_size);
+
+    m_reserved        = 0;
+    source.m_reserved = 0;
+
+    // take over the source's ring if we'd copy all of it into nothing
+    if (m_size == 0 && n == source.m_size) {
+        m_ring.swap(source.m_ring);
+        std::swap(m_head, source.m_head);
+        std::swap(m_size, source.m_size);
+        return;
+    }
+
+    Span spans[2];
+    UInt32 count = source.peekSpans(spans, n);
+    for (UInt32 i = 0; i < count; ++i) {
+        write(spans[i].m_data, (UInt32)spans[i].m_size);
+    }
+    source.pop(n);
+}
+
+void*
+StreamBuffer::reserve(UInt32 n)
+{
+    if (m_ring.empty() || (UInt32)m_ring.size() - m_size < n) {
+        grow(n);
     }
-    if (scan == m_chunks.end()) {
-        scan = m_chunks.insert(scan, Chunk());
+    else {
+        // if the data doesn't wrap then the free space is split between
+        // the end and the start of the ring.  slide the data down if the
+        // end doesn't have enough room.
+        UInt32 capacity = (UInt32)m_ring.size();
+        UInt32 tail     = m_head + m_size;
+        if (tail < capacity && capacity - tail < n) {
+            if (m_size > 0) {
+                memmove(&m_ring[0], &m_ring[m_head], m_size);
+            }
+            m_head = 0;
+        }
     }
 
-    // append data in chunks
-    while (n > 0) {
-        // choose number of bytes for next chunk
-        assert(scan->size() <= kChunkSize);
-        UInt32 count = kChunkSize - (UInt32)scan->size();
-        if (count > n)
-            count = n;
+    m_reserved = n;
+    return &m_ring[(m_head + m_size) & ((UInt32)m_ring.size() - 1)];
+}
 
-        // transfer data
-        scan->insert(scan->end(), data, data + count);
-        n    -= count;
-        data += count;
+void
+StreamBuffer::commit(UInt32 n)
+{
+    assert(n <= m_reserved);
 
-        // append another empty chunk if we're not done yet
-        if (n > 0) {
-            ++scan;
-            scan = m_chunks.insert(scan, Chunk());
-        }
+    m_size    += n;
+    m_reserved = 0;
+}
+
+UInt32
+StreamBuffer::peekSpans(Span spans[2], UInt32 n) const
+{
+    assert(n <= m_size);
+
+    if (n == 0) {
+        return 0;
+    }
+
+    UInt32 count = std::min(n, (UInt32)m_ring.size() - m_head);
+    spans[0].m_data = &m_ring[m_head];
+    spans[0].m_size = count;
+    if (count == n) {
+        return 1;
     }
+
+    spans[1].m_data = &m_ring[0];
+    spans[1].m_size = n - count;
+    return 2;
 }
 
 UInt32
@@ -144,3 +213,35 @@ StreamBuffer::getSize() const
 {
     return m_size;
 }
+
+void
+StreamBuffer::grow(UInt32 n)
+{
+    assert(n <= 0x80000000u - m_size);
+
+    // double until the ring fits the data.  doubling keeps the cost of
+    // copying on growth constant per byte written.
+    UInt32 capacity = std::max(kMinCapacity, (UInt32)m_ring.size());
+    while (capacity - m_size < n) {
+        capacity <<= 1;
+    }
+
+    std::vector<UInt8> ring(capacity);
+    Span spans[2];
+    UInt32 count = peekSpans(spans, m_size);
+    UInt32 offset = 0;
+    for (UInt32 i = 0; i < count; ++i) {
+        memcpy(&ring[offset], spans[i].m_data, spans[i].m_size);
+        offset += (UInt32)spans[i].m_size;
+    }
+
+    m_ring.swap(ring);
+    m_head = 0;
+}
+
+void
+StreamBuffer::linearize()
+{
+    std::rotate(m_ring.begin(), m_ring.begin() + m_head, m_ring.end());
+    m_head = 0;
+}
@@ -18,16 +18,25 @@
 
 #pragma once
 
+#include "arch/IArchNetwork.h"
 #include "base/EventTypes.h"
-#include "common/stdlist.h"
 #include "common/stdvector.h"
 
 //! FIFO of bytes
 /*!
-This class maintains a FIFO (first-in, last-out) buffer of bytes.
+This class maintains a FIFO (first-in, last-out) buffer of bytes.  The
+bytes are kept in a single power-of-two sized ring that grows by doubling,
+so data is only copied when it's written, when the ring grows, and when
+a peek() straddles the end of the ring.
 */
 class StreamBuffer {
 public:
+    //! Contiguous run of bytes in the buffer
+    /*!
+    Spans can be passed directly to \c IArchNetwork::writevSocket().
+    */
+    typedef IArchNetwork::IoVector Span;
+
     StreamBuffer();
     ~StreamBuffer();
 
@@ -38,7 +47,8 @@ public:
     /*!
     Return a pointer to memory with the next \c n bytes in the buffer
     (which must be <= getSize()).  The caller must not modify the returned
-    memory nor delete it.
+    memory nor delete it.  If the bytes wrap around the end of the ring
+    they're first moved to the start of it.  Use peekSpans() to avoid that.
     */
     const void*            peek(UInt32 n);
 
@@ -49,16 +59,57 @@ public:
     */
     void                pop(UInt32 n);
 
+    //! Remove data from buffer
+    /*!
+    Copies up to \c n bytes to \c data and discards them, returning the
+    number of bytes removed.  If \c data is NULL then the bytes are only
+    discarded.  Unlike peek(), this never moves the data in the ring.
+    */
+    UInt32                read(void* data, UInt32 n);
+
     //! Write data to buffer
     /*!
     Appends \c n bytes from \c data to the buffer.
     */
     void                write(const void* data, UInt32 n);
 
+    //! Move data from another buffer
+    /*!
+    Removes the next \c n bytes (which must be <= source.getSize()) from
+    \c source and appends them to this buffer.  If this buffer is empty
+    and \c n is all of \c source then the storage is exchanged instead
+    of copied.
+    */
+    void                append(StreamBuffer& source, UInt32 n);
+
+    //! Reserve space for writing
+    /*!
+    Returns a pointer to at least \c n contiguous bytes of writable memory
+    just past the end of the buffer.  The bytes aren't part of the buffer
+    until commit() is called.  The pointer is invalidated by any other
+    manipulator.
+    */
+    void*                reserve(UInt32 n);
+
+    //! Append reserved data
+    /*!
+    Appends the first \c n bytes of the memory returned by the last call to
+    reserve() to the buffer.  \c n must not exceed the reserved size.
+    */
+    void                commit(UInt32 n);
+
     //@}
     //! @name accessors
     //@{
 
+    //! Get data without copying
+    /*!
+    Fills \c spans with the next \c n bytes in the buffer (which must be
+    <= getSize()) and returns the number of spans used, which is 0, 1 or
+    2.  The spans are invalidated by any manipulator.
+    */
+    UInt32                peekSpans(Span spans[2], UInt32 n) const;
+
     //! Get size of buffer
     /*!
     Returns the number of bytes in the buffer.
@@ -68,12 +119,19 @@ public:
     //@}
 
 private:
-    static const UInt32    kChunkSize;
+    // make room for at least n more bytes, keeping the data in order
+    void                grow(UInt32 n);
 
-    typedef std::vector<UInt8> Chunk;
-    typedef std::list<Chunk> ChunkList;
+    // move the data to the start of the ring
+    void                linearize();
+
+private:
+    static const UInt32    kMinCapacity;
+    static const UInt32    kMaxIdleCapacity;
 
-    ChunkList            m_chunks;
+    // the ring.  its size is zero or a power of two.
+    std::vector<UInt8>    m_ring;
+    UInt32                m_head;
     UInt32                m_size;
-    UInt32                m_headUsed;
+    UInt32                m_reserved;
 };
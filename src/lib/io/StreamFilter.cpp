@@ -56,12 +56,24 @@ StreamFilter::read(void* buffer, UInt32 n)
     return getStream()->read(buffer, n);
 }
 
+UInt32
+StreamFilter::readAll(StreamBuffer& buffer)
+{
+    return getStream()->readAll(buffer);
+}
+
 void
 StreamFilter::write(const void* buffer, UInt32 n)
 {
     getStream()->write(buffer, n);
 }
 
+void
+StreamFilter::writev(const StreamBuffer::Span* buffers, UInt32 count)
+{
+    getStream()->writev(buffers, count);
+}
+
 void
 StreamFilter::flush()
 {
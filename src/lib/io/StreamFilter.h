@@ -41,7 +41,10 @@ public:
     // Override as necessary.  getEventTarget returns a pointer to this.
     virtual void        close();
     virtual UInt32        read(void* buffer, UInt32 n);
+    virtual UInt32        readAll(StreamBuffer& buffer);
     virtual void        write(const void* buffer, UInt32 n);
+    virtual void        writev(const StreamBuffer::Span* buffers,
+                            UInt32 count);
     virtual void        flush();
     virtual void        shutdownInput();
     virtual void        shutdownOutput();
@@ -20,6 +20,7 @@
 
 #include "ipc/Ipc.h"
 #include "ipc/IpcMessage.h"
+#include "barrier/ProtocolMessage.h"
 #include "barrier/ProtocolUtil.h"
 #include "io/IStream.h"
 #include "arch/Arch.h"
@@ -128,34 +129,42 @@ IpcClientProxy::handleData(const Event&, void*)
     LOG((CLOG_DEBUG "finished ipc handle data"));
 }
 
-void
-IpcClientProxy::send(const IpcMessage& message)
+bool
+IpcClientProxy::encode(const IpcMessage& message, std::vector<UInt8>& data)
 {
-    // don't allow other threads to write until we've finished the entire
-    // message. stream write is locked, but only for that single write.
-    // also, don't allow the dtor to destroy the stream while we're using it.
-    std::lock_guard<std::mutex> lock(m_writeMutex);
-
-    LOG((CLOG_DEBUG4 "ipc write: %d", message.type()));
-
     switch (message.type()) {
     case kIpcLogLine: {
         const IpcLogLineMessage& llm = static_cast<const IpcLogLineMessage&>(message);
         const std::string logLine = llm.logLine();
-        ProtocolUtil::writef(&m_stream, kIpcMsgLogLine, &logLine);
-        break;
+        data.resize(4 + FieldString::size(logLine));
+        memcpy(&data[0], kIpcMsgLogLine, 4);
+        FieldString::encode(&data[4], logLine);
+        return true;
     }
-            
+
     case kIpcShutdown:
-        ProtocolUtil::writef(&m_stream, kIpcMsgShutdown);
-        break;
+        data.resize(4);
+        memcpy(&data[0], kIpcMsgShutdown, 4);
+        return true;
 
     default:
         LOG((CLOG_ERR "ipc message not supported: %d", message.type()));
-        break;
+        return false;
     }
 }
 
+void
+IpcClientProxy::write(const std::vector<UInt8>& data)
+{
+    // don't allow other threads to write until we've finished the entire
+    // message. stream write is locked, but only for that single write.
+    // also, don't allow the dtor to destroy the stream while we're using it.
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+
+    LOG((CLOG_DEBUG4 "ipc write: %c%c%c%c", data[0], data[1], data[2], data[3]));
+    m_stream.write(&data[0], static_cast<UInt32>(data.size()));
+}
+
 IpcHelloMessage*
 IpcClientProxy::parseHello()
 {
@@ -24,6 +24,7 @@
 #include "base/Event.h"
 
 #include <mutex>
+#include <vector>
 
 namespace barrier { class IStream; }
 class IpcMessage;
@@ -39,7 +40,17 @@ public:
     virtual ~IpcClientProxy();
 
 private:
-    void                send(const IpcMessage& message);
+    //! Encode a message
+    /*!
+    Replaces \p data with \p message as it's sent to a client.  Returns
+    false if the message can't be sent to clients.
+    */
+    static bool            encode(const IpcMessage& message,
+                            std::vector<UInt8>& data);
+
+    //! Write an encoded message
+    void                write(const std::vector<UInt8>& data);
+
     void                handleData(const Event&, void*);
     void                handleDisconnect(const Event&, void*);
     void                handleWriteError(const Event&, void*);
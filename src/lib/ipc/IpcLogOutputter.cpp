@@ -30,23 +30,33 @@
 #include "base/TMethodEventJob.h"
 #include "base/TMethodJob.h"
 
+#include <algorithm>
+
 enum EIpcLogOutputter {
     kBufferMaxSize = 1000,
     kMaxSendLines = 100,
+    kMaxSendSize = 64 * 1024, // bytes
     kBufferRateWriteLimit = 1000, // writes per kBufferRateTime
     kBufferRateTimeLimit = 1 // seconds
 };
 
+// the least time between sends by the buffer thread, and how often it
+// looks for a client while it has lines but nobody to send them to
+static const double        kSendInterval = 0.05; // seconds
+static const double        kNoClientsWait = 1.0; // seconds
+
 IpcLogOutputter::IpcLogOutputter(IpcServer& ipcServer, EIpcClientType clientType, bool useThread) :
     m_ipcServer(ipcServer),
+    m_buffer(kBufferMaxSize),
+    m_bufferHead(0),
+    m_bufferCount(0),
+    m_lastSend(0.0),
     m_sending(false),
     m_bufferThread(nullptr),
     m_running(false),
     m_notifyCond(ARCH->newCondVar()),
     m_notifyMutex(ARCH->newMutex()),
-    m_bufferWaiting(false),
     m_bufferThreadId(0),
-    m_bufferMaxSize(kBufferMaxSize),
     m_bufferRateWriteLimit(kBufferRateWriteLimit),
     m_bufferRateTimeLimit(kBufferRateTimeLimit),
     m_bufferWriteCount(0),
@@ -54,6 +64,7 @@ IpcLogOutputter::IpcLogOutputter(IpcServer& ipcServer, EIpcClientType clientType
     m_clientType(clientType)
 {
     if (useThread) {
+        m_running = true;
         m_bufferThread = new Thread(new TMethodJob<IpcLogOutputter>(
             this, &IpcLogOutputter::bufferThread));
     }
@@ -82,8 +93,10 @@ void
 IpcLogOutputter::close()
 {
     if (m_bufferThread != nullptr) {
-        std::lock_guard<std::mutex> lock(m_runningMutex);
-        m_running = false;
+        {
+            std::lock_guard<std::mutex> lock(m_runningMutex);
+            m_running = false;
+        }
         notifyBuffer();
         m_bufferThread->wait(5);
     }
@@ -103,13 +116,16 @@ IpcLogOutputter::write(ELevel, const char* text)
         return true;
     }
 
-    appendBuffer(text);
-    notifyBuffer();
+    // the buffer thread only waits when the buffer is empty
+    if (appendBuffer(text)) {
+        notifyBuffer();
+    }
 
     return true;
 }
 
-void IpcLogOutputter::appendBuffer(const std::string& text)
+bool
+IpcLogOutputter::appendBuffer(const char* text)
 {
     std::lock_guard<std::mutex> lock(m_bufferMutex);
 
@@ -117,7 +133,7 @@ void IpcLogOutputter::appendBuffer(const std::string& text)
     if (elapsed < m_bufferRateTimeLimit) {
         if (m_bufferWriteCount >= m_bufferRateWriteLimit) {
             // discard the log line if we've logged too much.
-            return;
+            return false;
         }
     }
     else {
@@ -125,14 +141,29 @@ void IpcLogOutputter::appendBuffer(const std::string& text)
         m_bufferRateStart = ARCH->time();
     }
 
-    if (m_buffer.size() >= m_bufferMaxSize) {
+    if (m_buffer.empty()) {
+        return false;
+    }
+
+    if (m_bufferCount == m_buffer.size()) {
         // if the queue is exceeds size limit,
         // throw away the oldest item
-        m_buffer.pop_front();
+        m_bufferHead = (m_bufferHead + 1) % m_buffer.size();
+        --m_bufferCount;
     }
 
-    m_buffer.push_back(text);
+    const bool wasEmpty = (m_bufferCount == 0);
+    m_buffer[(m_bufferHead + m_bufferCount) % m_buffer.size()].assign(text);
+    ++m_bufferCount;
     m_bufferWriteCount++;
+    return wasEmpty;
+}
+
+bool
+IpcLogOutputter::isBufferEmpty()
+{
+    std::lock_guard<std::mutex> lock(m_bufferMutex);
+    return (m_bufferCount == 0);
 }
 
 bool
@@ -146,16 +177,36 @@ void
 IpcLogOutputter::bufferThread(void*)
 {
     m_bufferThreadId = m_bufferThread->getID();
-    m_running = true;
 
     try {
         while (isRunning()) {
-            if (m_buffer.empty() || !m_ipcServer.hasClients(m_clientType)) {
+            {
+                // wait for lines, or for a client to send them to
                 ArchMutexLock lock(m_notifyMutex);
-                ARCH->waitCondVar(m_notifyCond, m_notifyMutex, -1);
+                if (!isRunning()) {
+                    break;
+                }
+                if (isBufferEmpty()) {
+                    ARCH->waitCondVar(m_notifyCond, m_notifyMutex, -1);
+                }
+                else if (!m_ipcServer.hasClients(m_clientType)) {
+                    ARCH->waitCondVar(m_notifyCond, m_notifyMutex, kNoClientsWait);
+                }
+            }
+
+            // let lines gather if we sent recently
+            double wait = m_lastSend + kSendInterval - ARCH->time();
+            if (wait > 0.0) {
+                ARCH->sleep(wait);
             }
 
-            sendBuffer();
+            bool sent = false;
+            while (isRunning() && sendChunk()) {
+                sent = true;
+            }
+            if (sent) {
+                m_lastSend = ARCH->time();
+            }
         }
     }
     catch (XArch& e) {
@@ -172,46 +223,70 @@ IpcLogOutputter::notifyBuffer()
     ARCH->broadcastCondVar(m_notifyCond);
 }
 
-std::string IpcLogOutputter::getChunk(size_t count)
+void
+IpcLogOutputter::getChunk(std::string& chunk, size_t count)
 {
     std::lock_guard<std::mutex> lock(m_bufferMutex);
 
-    if (m_buffer.size() < count) {
-        count = m_buffer.size();
+    if (m_bufferCount < count) {
+        count = m_bufferCount;
     }
 
-    std::string chunk;
+    chunk.clear();
     for (size_t i = 0; i < count; i++) {
-        chunk.append(m_buffer.front());
+        const std::string& line = m_buffer[m_bufferHead];
+        if (!chunk.empty() && chunk.size() + line.size() + 1 > static_cast<size_t>(kMaxSendSize)) {
+            break;
+        }
+        chunk.append(line);
         chunk.append("\n");
-        m_buffer.pop_front();
+        m_bufferHead = (m_bufferHead + 1) % m_buffer.size();
+        --m_bufferCount;
     }
-    return chunk;
 }
 
-void
-IpcLogOutputter::sendBuffer()
+bool
+IpcLogOutputter::sendChunk()
 {
-    if (m_buffer.empty() || !m_ipcServer.hasClients(m_clientType)) {
-        return;
+    if (isBufferEmpty() || !m_ipcServer.hasClients(m_clientType)) {
+        return false;
     }
 
-    IpcLogLineMessage message(getChunk(kMaxSendLines));
+    getChunk(m_chunk, kMaxSendLines);
+    IpcLogLineMessage message(m_chunk);
     m_sending = true;
     m_ipcServer.send(message, kIpcClientGui);
     m_sending = false;
+    return true;
+}
+
+void
+IpcLogOutputter::sendBuffer()
+{
+    sendChunk();
 }
 
 void
 IpcLogOutputter::bufferMaxSize(UInt16 bufferMaxSize)
 {
-    m_bufferMaxSize = bufferMaxSize;
+    std::lock_guard<std::mutex> lock(m_bufferMutex);
+
+    // keep the newest lines
+    Buffer buffer(bufferMaxSize);
+    size_t count = std::min<size_t>(m_bufferCount, bufferMaxSize);
+    size_t skip  = m_bufferCount - count;
+    for (size_t i = 0; i < count; ++i) {
+        buffer[i].swap(m_buffer[(m_bufferHead + skip + i) % m_buffer.size()]);
+    }
+    m_buffer.swap(buffer);
+    m_bufferHead  = 0;
+    m_bufferCount = count;
 }
 
 UInt16
 IpcLogOutputter::bufferMaxSize() const
 {
-    return m_bufferMaxSize;
+    return static_cast<UInt16>(m_buffer.size());
 }
 
 void
@@ -24,8 +24,9 @@
 #include "base/String.h"
 #include "ipc/Ipc.h"
 
-#include <deque>
 #include <mutex>
+#include <string>
+#include <vector>
 
 class IpcServer;
 class Event;
@@ -33,12 +34,15 @@ class IpcClientProxy;
 
 //! Write log to GUI over IPC
 /*!
-This outputter writes output to the GUI via IPC.
+This outputter writes output to the GUI via IPC.  Lines are kept in a
+ring of preallocated lines and sent in chunks of many lines.
 */
 class IpcLogOutputter : public ILogOutputter {
 public:
     /*!
     If \p useThread is \c true, the buffer will be sent using a thread.
+    The thread is woken when the buffer stops being empty and sends at
+    most once per interval, so lines logged in between go together.
     If \p useThread is \c false, then the buffer needs to be sent manually
     using the \c sendBuffer() function.
     */
@@ -59,8 +63,8 @@ public:
 
     //! Set the buffer size
     /*!
-    Set the maximum size of the buffer to protect memory
-    from runaway logging.
+    Set the maximum number of lines in the buffer to protect memory
+    from runaway logging.  The oldest lines are discarded first.
     */
     void                bufferMaxSize(UInt16 bufferMaxSize);
 
@@ -93,25 +97,32 @@ public:
 private:
     void                init();
     void                bufferThread(void*);
-    std::string getChunk(size_t count);
-    void appendBuffer(const std::string& text);
+    void                getChunk(std::string& chunk, size_t count);
+    bool                appendBuffer(const char* text);
+    bool                isBufferEmpty();
+    bool                sendChunk();
     bool                isRunning();
 
 private:
-    typedef std::deque<std::string> Buffer;
+    typedef std::vector<std::string> Buffer;
 
     IpcServer&            m_ipcServer;
+
+    // the lines are m_bufferCount lines starting at m_bufferHead and
+    // wrapping around.  the strings keep their capacity when reused.
     Buffer                m_buffer;
+    size_t                m_bufferHead;
+    size_t                m_bufferCount;
+    std::string            m_chunk;
+    double                m_lastSend;
     std::mutex m_bufferMutex;
     bool                m_sending;
     Thread*                m_bufferThread;
     bool                m_running;
     ArchCond            m_notifyCond;
     ArchMutex            m_notifyMutex;
-    bool                m_bufferWaiting;
     IArchMultithread::ThreadID
                         m_bufferThreadId;
-    UInt16                m_bufferMaxSize;
     UInt16                m_bufferRateWriteLimit;
     double                m_bufferRateTimeLimit;
     UInt16                m_bufferWriteCount;
@@ -176,13 +176,19 @@ IpcServer::hasClients(EIpcClientType clientType) const
 void
 IpcServer::send(const IpcMessage& message, EIpcClientType filterType)
 {
+    // encode once for every client
+    std::vector<UInt8> data;
+    if (!IpcClientProxy::encode(message, data)) {
+        return;
+    }
+
     std::lock_guard<std::mutex> lock(m_clientsMutex);
 
     ClientList::iterator it;
     for (it = m_clients.begin(); it != m_clients.end(); it++) {
         IpcClientProxy* proxy = *it;
         if (proxy->m_clientType == filterType) {
-            proxy->send(message);
+            proxy->write(data);
         }
     }
 }
@@ -0,0 +1,213 @@
+/*
+ * barrier -- mouse and keyboard sharing utility
+ * Copyright (C) 2018 Debauchee Open Source Group
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file LICENSE that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "net/AddressResolver.h"
+
+#include "mt/Thread.h"
+#include "arch/Arch.h"
+#include "base/IEventQueue.h"
+#include "base/EventTypes.h"
+#include "base/Log.h"
+#include "base/TMethodJob.h"
+#include "base/XBase.h"
+
+const double AddressResolver::kDefaultTTL = 60.0;
+
+static std::string
+cacheKey(const NetworkAddress& address)
+{
+    return address.getHostname() + ":" + std::to_string(address.getPort());
+}
+
+//
+// AddressResolver
+//
+
+AddressResolver::AddressResolver(IEventQueue* events, double ttl) :
+    m_events(events),
+    m_lookup([](const NetworkAddress& address) { return address.resolveAll(); }),
+    m_ttl(ttl),
+    m_thread(NULL),
+    m_stopping(false),
+    m_request(0),
+    m_nextRequest(0),
+    m_pendingRequest(0)
+{
+    // do nothing
+}
+
+AddressResolver::AddressResolver(IEventQueue* events, const Lookup& lookup,
+                double ttl) :
+    m_events(events),
+    m_lookup(lookup),
+    m_ttl(ttl),
+    m_thread(NULL),
+    m_stopping(false),
+    m_request(0),
+    m_nextRequest(0),
+    m_pendingRequest(0)
+{
+    // do nothing
+}
+
+AddressResolver::~AddressResolver()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping       = true;
+        m_request        = 0;
+        m_pendingRequest = 0;
+    }
+    m_wake.notify_one();
+
+    // a lookup in progress can't be interrupted so this waits for it
+    if (m_thread != NULL) {
+        m_thread->wait();
+        delete m_thread;
+    }
+}
+
+void
+AddressResolver::resolve(const NetworkAddress& address)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    UInt32 id = ++m_nextRequest;
+    if (id == 0) {
+        id = ++m_nextRequest;
+    }
+    m_request = id;
+
+    Cache::const_iterator i = m_cache.find(cacheKey(address));
+    if (i != m_cache.end() && !i->second.m_invalid &&
+            ARCH->time() - i->second.m_time < m_ttl) {
+        LOG((CLOG_DEBUG1 "using cached addresses of %s", address.getHostname().c_str()));
+        Result* result      = new Result;
+        result->m_addresses = i->second.m_addresses;
+        send(id, result);
+        return;
+    }
+
+    LOG((CLOG_DEBUG1 "resolving %s", address.getHostname().c_str()));
+    m_pending        = address;
+    m_pendingRequest = id;
+    if (m_thread == NULL) {
+        m_thread = new Thread(new TMethodJob<AddressResolver>(
+                                this, &AddressResolver::lookupThread));
+    }
+    lock.unlock();
+    m_wake.notify_one();
+}
+
+void
+AddressResolver::cancel()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_request = 0;
+}
+
+void
+AddressResolver::invalidate(const NetworkAddress& address)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Cache::iterator i = m_cache.find(cacheKey(address));
+    if (i != m_cache.end()) {
+        i->second.m_invalid = true;
+    }
+}
+
+void
+AddressResolver::flush()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_cache.clear();
+}
+
+void*
+AddressResolver::getEventTarget() const
+{
+    return const_cast<void*>(static_cast<const void*>(this));
+}
+
+bool
+AddressResolver::isResolving() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return (m_request != 0);
+}
+
+void
+AddressResolver::send(UInt32 id, Result* result)
+{
+    if (id != m_request) {
+        delete result;
+        return;
+    }
+
+    m_request = 0;
+    Event event(m_events->forAddressResolver().resolved(), getEventTarget());
+    event.setDataObject(result);
+    m_events->addEvent(event);
+}
+
+void
+AddressResolver::lookupThread(void*)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_wake.wait(lock, [this] { return m_stopping || m_pendingRequest != 0; });
+        if (m_stopping) {
+            return;
+        }
+        NetworkAddress address = m_pending;
+        UInt32 id              = m_pendingRequest;
+        m_pendingRequest       = 0;
+        lock.unlock();
+
+        Result* result = new Result;
+        try {
+            result->m_addresses = m_lookup(address);
+            if (result->m_addresses.empty()) {
+                result->m_error = "no addresses";
+            }
+        }
+        catch (XBase& e) {
+            result->m_error = e.what();
+        }
+
+        lock.lock();
+        const std::string key = cacheKey(address);
+        if (!result->m_addresses.empty()) {
+            Entry& entry      = m_cache[key];
+            entry.m_addresses = result->m_addresses;
+            entry.m_time      = ARCH->time();
+            entry.m_invalid   = false;
+        }
+        else {
+            // a stale address is more use than none when the name server
+            // is having a bad day
+            Cache::const_iterator i = m_cache.find(key);
+            if (i != m_cache.end()) {
+                LOG((CLOG_WARN "can't resolve %s: %s, using the address from %.0fs ago",
+                    address.getHostname().c_str(), result->m_error.c_str(),
+                    ARCH->time() - i->second.m_time));
+                result->m_addresses = i->second.m_addresses;
+                result->m_error.clear();
+            }
+        }
+        send(id, result);
+    }
+}
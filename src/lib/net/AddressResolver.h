@@ -0,0 +1,158 @@
+/*
+ * barrier -- mouse and keyboard sharing utility
+ * Copyright (C) 2018 Debauchee Open Source Group
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file LICENSE that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "net/NetworkAddress.h"
+#include "base/Event.h"
+#include "common/stdmap.h"
+#include "common/stdvector.h"
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+
+class IEventQueue;
+class Thread;
+
+//! Asynchronous host name resolver
+/*!
+Looks up the addresses of a host on a thread of its own, so a slow name
+server doesn't stall the event loop, and sends a \c resolved event (see
+\c AddressResolverEvents) with the result.  Results are cached for a
+time to live;  if a later lookup of the host fails, the expired result
+is used instead.  The lookup thread is started by the first lookup and
+stopped when the resolver is destroyed.
+*/
+class AddressResolver {
+public:
+    //! Blocking lookup of every address of a host
+    typedef std::function<std::vector<NetworkAddress>(const NetworkAddress&)> Lookup;
+
+    //! Result of a lookup
+    /*!
+    The data of a \c resolved event.
+    */
+    class Result : public EventData {
+    public:
+        //! The addresses, with the port set, or empty if the lookup failed
+        std::vector<NetworkAddress> m_addresses;
+
+        //! Why the lookup failed
+        std::string        m_error;
+    };
+
+    //! Seconds a result is cached by default
+    static const double    kDefaultTTL;
+
+    /*!
+    Looks up names with \c NetworkAddress::resolveAll().
+    */
+    AddressResolver(IEventQueue* events, double ttl = kDefaultTTL);
+
+    /*!
+    Looks up names with \p lookup, which may throw XSocketAddress.
+    */
+    AddressResolver(IEventQueue* events, const Lookup& lookup,
+                            double ttl = kDefaultTTL);
+
+    ~AddressResolver();
+
+    //! @name manipulators
+    //@{
+
+    //! Resolve address
+    /*!
+    Starts looking up the hostname of \p address.  A lookup already in
+    progress is cancelled.  The \c resolved event is sent even if the
+    result comes from the cache.
+    */
+    void                resolve(const NetworkAddress& address);
+
+    //! Cancel lookup
+    /*!
+    No \c resolved event is sent for the lookup in progress, if any.
+    Its result is still cached.
+    */
+    void                cancel();
+
+    //! Look up address again
+    /*!
+    The next resolve() of the hostname and port of \p address looks them
+    up again even if the cached result hasn't expired, say because none
+    of its addresses could be connected to.  The cached result is kept
+    in case that lookup fails.
+    */
+    void                invalidate(const NetworkAddress& address);
+
+    //! Forget cached results
+    void                flush();
+
+    //@}
+    //! @name accessors
+    //@{
+
+    //! Get event target
+    /*!
+    Returns the target of \c resolved events.
+    */
+    void*                getEventTarget() const;
+
+    //! Test if resolving
+    /*!
+    Returns true iff a \c resolved event is still to be sent.
+    */
+    bool                isResolving() const;
+
+    //@}
+
+private:
+    // send result for request id if it's still wanted.  call with
+    // m_mutex locked.
+    void                send(UInt32 id, Result* result);
+
+    void                lookupThread(void*);
+
+private:
+    class Entry {
+    public:
+        std::vector<NetworkAddress> m_addresses;
+        double            m_time;
+        bool            m_invalid;
+    };
+    typedef std::map<std::string, Entry> Cache;
+
+    IEventQueue*        m_events;
+    Lookup                m_lookup;
+    double                m_ttl;
+    Thread*                m_thread;
+
+    mutable std::mutex    m_mutex;
+    std::condition_variable    m_wake;
+    bool                m_stopping;
+    Cache                m_cache;
+
+    // the request whose result is wanted, 0 if none
+    UInt32                m_request;
+    UInt32                m_nextRequest;
+
+    // the address for the lookup thread to look up next and the request
+    // it's for, 0 if none
+    NetworkAddress        m_pending;
+    UInt32                m_pendingRequest;
+};
@@ -63,7 +63,10 @@ public:
 
     // IStream overrides
     virtual UInt32        read(void* buffer, UInt32 n) = 0;
+    virtual UInt32        readAll(StreamBuffer& buffer) = 0;
     virtual void        write(const void* buffer, UInt32 n) = 0;
+    virtual void        writev(const StreamBuffer::Span* buffers,
+                            UInt32 count) = 0;
     virtual void        flush() = 0;
     virtual void        shutdownInput() = 0;
     virtual void        shutdownOutput() = 0;
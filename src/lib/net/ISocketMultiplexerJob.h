@@ -84,6 +84,5 @@ public:
     */
     virtual bool        isWritable() const = 0;
 
-    virtual bool isCursor() const { return false; }
     //@}
 };
@@ -149,23 +149,41 @@ NetworkAddress::resolve()
             m_address = ARCH->nameToAddr(m_hostname);
         }
     }
-    catch (XArchNetworkNameUnknown&) {
-        throw XSocketAddress(XSocketAddress::kNotFound, m_hostname, m_port);
-    }
-    catch (XArchNetworkNameNoAddress&) {
-        throw XSocketAddress(XSocketAddress::kNoAddress, m_hostname, m_port);
-    }
-    catch (XArchNetworkNameUnsupported&) {
-        throw XSocketAddress(XSocketAddress::kUnsupported, m_hostname, m_port);
-    }
     catch (XArchNetworkName&) {
-        throw XSocketAddress(XSocketAddress::kUnknown, m_hostname, m_port);
+        throwAddressError();
     }
 
     // set port in address
     ARCH->setAddrPort(m_address, m_port);
 }
 
+std::vector<NetworkAddress>
+NetworkAddress::resolveAll() const
+{
+    std::vector<ArchNetAddress> addrs;
+    try {
+        if (m_hostname.empty()) {
+            addrs.push_back(ARCH->newAnyAddr(IArchNetwork::kINET6));
+        }
+        else {
+            addrs = ARCH->nameToAddrs(m_hostname);
+        }
+    }
+    catch (XArchNetworkName&) {
+        throwAddressError();
+    }
+
+    // the copies take ownership of the addresses
+    std::vector<NetworkAddress> result(addrs.size());
+    for (size_t i = 0; i < addrs.size(); ++i) {
+        ARCH->setAddrPort(addrs[i], m_port);
+        result[i].m_address  = addrs[i];
+        result[i].m_hostname = m_hostname;
+        result[i].m_port     = m_port;
+    }
+    return result;
+}
+
 bool
 NetworkAddress::operator==(const NetworkAddress& addr) const
 {
@@ -201,6 +219,26 @@ std::string NetworkAddress::getHostname() const
     return m_hostname;
 }
 
+void
+NetworkAddress::throwAddressError() const
+{
+    try {
+        throw;
+    }
+    catch (XArchNetworkNameUnknown&) {
+        throw XSocketAddress(XSocketAddress::kNotFound, m_hostname, m_port);
+    }
+    catch (XArchNetworkNameNoAddress&) {
+        throw XSocketAddress(XSocketAddress::kNoAddress, m_hostname, m_port);
+    }
+    catch (XArchNetworkNameUnsupported&) {
+        throw XSocketAddress(XSocketAddress::kUnsupported, m_hostname, m_port);
+    }
+    catch (XArchNetworkName&) {
+        throw XSocketAddress(XSocketAddress::kUnknown, m_hostname, m_port);
+    }
+}
+
 void
 NetworkAddress::checkPort()
 {
@@ -20,6 +20,7 @@
 
 #include "base/EventTypes.h"
 #include "arch/IArchNetwork.h"
+#include "common/stdvector.h"
 
 //! Network address type
 /*!
@@ -72,6 +73,20 @@ public:
     //! @name accessors
     //@{
 
+    //! Resolve all addresses
+    /*!
+    Looks up every address of the hostname and returns a copy of this
+    address for each, with the port set, in the order the system
+    prefers them.  This address is unchanged.  Throws XSocketAddress
+    like \c resolve().  The lookup can block for seconds, so call this
+    off the event thread (see \c AddressResolver).
+    */
+    std::vector<NetworkAddress> resolveAll() const;
+
+    //@}
+    //! @name accessors
+    //@{
+
     //! Check address equality
     /*!
     Returns true if this address is equal to \p address.
@@ -115,6 +130,9 @@ public:
 private:
     void                checkPort();
 
+    // rethrow the XArchNetworkName being handled as an XSocketAddress
+    void                throwAddressError() const;
+
 private:
     ArchNetAddress        m_address;
     std::string m_hostname;
@@ -36,7 +36,11 @@ SecureListenSocket::SecureListenSocket(
         IEventQueue* events,
         SocketMultiplexer* socketMultiplexer,
         IArchNetwork::EAddressFamily family) :
-    TCPListenSocket(events, socketMultiplexer, family)
+    TCPListenSocket(events, socketMultiplexer, family),
+    m_certificateFilename(barrier::string::sprintf("%s/%s/%s",
+                                        DataDirectories::profile().c_str(),
+                                        s_certificateDir,
+                                        s_certificateFilename))
 {
 }
 
@@ -55,12 +59,7 @@ SecureListenSocket::accept()
             setListeningJob();
         }
 
-        std::string certificateFilename = barrier::string::sprintf("%s/%s/%s",
-                                        DataDirectories::profile().c_str(),
-                                        s_certificateDir,
-                                        s_certificateFilename);
-
-        bool loaded = socket->loadCertificates(certificateFilename);
+        bool loaded = socket->loadCertificates(m_certificateFilename);
         if (!loaded) {
             delete socket;
             return NULL;
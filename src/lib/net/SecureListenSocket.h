@@ -33,4 +33,7 @@ public:
     // IListenSocket overrides
     virtual IDataSocket*
                         accept();
+
+private:
+    std::string            m_certificateFilename;
 };
@@ -20,6 +20,7 @@
 #include "net/TSocketMultiplexerMethodJob.h"
 #include "base/TMethodEventJob.h"
 #include "net/TCPSocket.h"
+#include "net/NetworkAddress.h"
 #include "mt/Lock.h"
 #include "arch/XArch.h"
 #include "base/Log.h"
@@ -31,8 +32,14 @@
 #include <cstring>
 #include <cstdlib>
 #include <memory>
+#include <deque>
 #include <fstream>
-#include <memory>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <ctime>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 //
 // SecureSocket
@@ -40,10 +47,14 @@
 
 #define MAX_ERROR_SIZE 65535
 
-static const float s_retryDelay = 0.01f;
-
 enum {
-    kMsgSize = 128
+    kMsgSize = 128,
+
+    // sessions kept for resuming per server.  each is only used once.
+    kMaxSessions = 64,
+
+    // the largest TLS record payload
+    kRecordSize = 16384
 };
 
 static const char kFingerprintDirName[] = "SSL/Fingerprints";
@@ -52,10 +63,50 @@ static const char kFingerprintTrustedServersFilename[] = "TrustedServers.txt";
 //static const char kFingerprintTrustedClientsFilename[] = "TrustedClients.txt";
 
 struct Ssl {
-    SSL_CTX*    m_context;
+    SSL_CTX*    m_context;    // shared, not owned
     SSL*        m_ssl;
 };
 
+// guards the shared contexts and the certificate loaded into the server's
+static std::mutex s_contextMutex;
+
+// the certificate file last loaded into the server context, a digest
+// of its contents, what stat() said about it when it was last digested
+// and when that was
+static std::string s_certificateFilename;
+static std::string s_certificateDigest;
+static struct stat s_certificateStat;
+static time_t s_certificateChecked = 0;
+
+// client sessions to resume, by server address
+typedef std::deque<SSL_SESSION*> SessionList;
+static std::mutex s_sessionMutex;
+static std::map<std::string, SessionList> s_sessions;
+
+// handshake statistics for the client and the server side
+static std::mutex s_statsMutex;
+static SecureSocket::HandshakeStats s_handshakeStats[2];
+
+static
+int
+saveSession(SSL* ssl, SSL_SESSION* session)
+{
+    const std::string* key = static_cast<const std::string*>(SSL_get_app_data(ssl));
+    if (key == NULL || key->empty()) {
+        return 0;
+    }
+
+    // keep the newest sessions from each server
+    std::lock_guard<std::mutex> lock(s_sessionMutex);
+    SessionList& sessions = s_sessions[*key];
+    sessions.push_back(session);
+    if (sessions.size() > kMaxSessions) {
+        SSL_SESSION_free(sessions.front());
+        sessions.pop_front();
+    }
+    return 1;
+}
+
 SecureSocket::SecureSocket(
         IEventQueue* events,
         SocketMultiplexer* socketMultiplexer,
@@ -63,7 +114,11 @@ SecureSocket::SecureSocket(
     TCPSocket(events, socketMultiplexer, family),
     m_ssl(nullptr),
     m_secureReady(false),
-    m_fatal(false)
+    m_fatal(false),
+    m_wantWrite(false),
+    m_handshakeRetries(0),
+    m_handshakeStart(0.0),
+    m_writeRetrySize(0)
 {
 }
 
@@ -74,7 +129,11 @@ SecureSocket::SecureSocket(
     TCPSocket(events, socketMultiplexer, socket),
     m_ssl(nullptr),
     m_secureReady(false),
-    m_fatal(false)
+    m_fatal(false),
+    m_wantWrite(false),
+    m_handshakeRetries(0),
+    m_handshakeStart(0.0),
+    m_writeRetrySize(0)
 {
 }
 
@@ -108,16 +167,14 @@ void SecureSocket::freeSSLResources()
         SSL_free(m_ssl->m_ssl);
         m_ssl->m_ssl = NULL;
     }
-
-    if (m_ssl->m_context != NULL) {
-        SSL_CTX_free(m_ssl->m_context);
-        m_ssl->m_context = NULL;
-    }
 }
 
 void
 SecureSocket::connect(const NetworkAddress& addr)
 {
+    m_sessionKey = barrier::string::sprintf("%s:%d",
+                            addr.getHostname().c_str(), addr.getPort());
+
     m_events->adoptHandler(m_events->forIDataSocket().connected(),
                 getEventTarget(),
                 new TMethodEventJob<SecureSocket>(this,
@@ -140,6 +197,22 @@ std::unique_ptr<ISocketMultiplexerJob> SecureSocket::newJob()
 void
 SecureSocket::secureConnect()
 {
+    createSSL();
+
+    // offer the newest session with this server for resumption, and
+    // have any new ones saved under its address
+    SSL_set_app_data(m_ssl->m_ssl, &m_sessionKey);
+    {
+        std::lock_guard<std::mutex> lock(s_sessionMutex);
+        SessionList& sessions = s_sessions[m_sessionKey];
+        if (!sessions.empty()) {
+            SSL_set_session(m_ssl->m_ssl, sessions.back());
+            SSL_SESSION_free(sessions.back());
+            sessions.pop_back();
+        }
+    }
+
+    m_handshakeStart = ARCH->time();
     setJob(std::make_unique<TSocketMultiplexerMethodJob<SecureSocket>>(
                     this, &SecureSocket::serviceConnect,
                     getSocket(), isReadable(), isWritable()));
@@ -148,6 +221,8 @@ SecureSocket::secureConnect()
 void
 SecureSocket::secureAccept()
 {
+    createSSL();
+    m_handshakeStart = ARCH->time();
     setJob(std::make_unique<TSocketMultiplexerMethodJob<SecureSocket>>(
                     this, &SecureSocket::serviceAccept,
                     getSocket(), isReadable(), isWritable()));
@@ -156,13 +231,13 @@ SecureSocket::secureAccept()
 TCPSocket::EJobResult
 SecureSocket::doRead()
 {
-    static UInt8 buffer[4096];
-    memset(buffer, 0, sizeof(buffer));
     int bytesRead = 0;
     int status = 0;
 
+    // decrypt straight into the input buffer
     if (isSecureReady()) {
-        status = secureRead(buffer, sizeof(buffer), bytesRead);
+        status = secureRead(m_inputBuffer.reserve(kRecordSize),
+                            kRecordSize, bytesRead);
         if (status < 0) {
             return kBreak;
         }
@@ -179,9 +254,10 @@ SecureSocket::doRead()
         
         // slurp up as much as possible
         do {
-            m_inputBuffer.write(buffer, bytesRead);
+            m_inputBuffer.commit((UInt32)bytesRead);
             
-            status = secureRead(buffer, sizeof(buffer), bytesRead);
+            status = secureRead(m_inputBuffer.reserve(kRecordSize),
+                            kRecordSize, bytesRead);
             if (status < 0) {
                 return kBreak;
             }
@@ -211,12 +287,8 @@ SecureSocket::doRead()
 TCPSocket::EJobResult
 SecureSocket::doWrite()
 {
-    static bool s_retry = false;
-    static int s_retrySize = 0;
-    static std::unique_ptr<char[]> s_staticBuffer;
-    static std::size_t s_staticBufferSize = 0;
-
     // write data
+    const void* buffer = NULL;
     int bufferSize = 0;
     int bytesWrote = 0;
     int status = 0;
@@ -224,16 +296,19 @@ SecureSocket::doWrite()
     if (!isSecureReady())
         return kRetry;
 
-    if (s_retry) {
-        bufferSize = s_retrySize;
-    } else {
-        bufferSize = m_outputBuffer.getSize();
-        if (bufferSize > s_staticBufferSize) {
-            s_staticBuffer.reset(new char[bufferSize]);
-            s_staticBufferSize = bufferSize;
-        }
-        if (bufferSize > 0) {
-            memcpy(s_staticBuffer.get(), m_outputBuffer.peek(bufferSize), bufferSize);
+    if (m_writeRetrySize > 0) {
+        // openssl wants the failed write repeated with the same length.
+        // those bytes are still at the front of the output buffer, though
+        // the buffer may have moved them since.
+        bufferSize = m_writeRetrySize;
+        buffer = m_outputBuffer.peek(bufferSize);
+    }
+    else {
+        // encrypt straight from the output buffer, one span at a time
+        StreamBuffer::Span spans[2];
+        if (m_outputBuffer.peekSpans(spans, m_outputBuffer.getSize()) > 0) {
+            buffer = spans[0].m_data;
+            bufferSize = (int)spans[0].m_size;
         }
     }
     
@@ -241,14 +316,13 @@ SecureSocket::doWrite()
         return kRetry;
     }
 
-    status = secureWrite(s_staticBuffer.get(), bufferSize, bytesWrote);
+    status = secureWrite(buffer, bufferSize, bytesWrote);
     if (status > 0) {
-        s_retry = false;
+        m_writeRetrySize = 0;
     } else if (status < 0) {
         return kBreak;
     } else if (status == 0) {
-        s_retry = true;
-        s_retrySize = bufferSize;
+        m_writeRetrySize = bufferSize;
         return kNew;
     }
     
@@ -267,7 +341,7 @@ SecureSocket::secureRead(void* buffer, int size, int& read)
         LOG((CLOG_DEBUG2 "reading secure socket"));
         read = SSL_read(m_ssl->m_ssl, buffer, size);
         
-        static int retry;
+        int retry = 0;
 
         // Check result will cleanup the connection in the case of a fatal
         checkResult(read, retry);
@@ -294,7 +368,7 @@ SecureSocket::secureWrite(const void* buffer, int size, int& wrote)
 
         wrote = SSL_write(m_ssl->m_ssl, buffer, size);
         
-        static int retry;
+        int retry = 0;
 
         // Check result will cleanup the connection in the case of a fatal
         checkResult(wrote, retry);
@@ -335,17 +409,55 @@ bool SecureSocket::loadCertificates(const std::string& filename)
         showError("ssl certificate is not specified");
         return false;
     }
-    else {
-        std::ifstream file(filename.c_str());
-        bool exist = file.good();
-        file.close();
 
-        if (!exist) {
-            showError("ssl certificate doesn't exist: " + filename);
-            return false;
-        }
+    time_t now = time(NULL);
+    struct stat info;
+    if (stat(filename.c_str(), &info) != 0) {
+        showError("ssl certificate doesn't exist: " + filename);
+        return false;
+    }
+
+    // the context keeps the certificate, so only parse the file again
+    // when its contents change.  if stat() says nothing changed there's
+    // no need to read the file, unless it was changed in the second it
+    // was last digested:  a certificate renewed in place within that
+    // second often has the same size and times.  otherwise a digest of
+    // the contents tells.
+    std::lock_guard<std::mutex> lock(s_contextMutex);
+    if (filename == s_certificateFilename &&
+        info.st_ino   == s_certificateStat.st_ino &&
+        info.st_size  == s_certificateStat.st_size &&
+        info.st_mtime == s_certificateStat.st_mtime &&
+        info.st_ctime == s_certificateStat.st_ctime &&
+        info.st_mtime < s_certificateChecked &&
+        info.st_ctime < s_certificateChecked) {
+        return true;
     }
 
+    std::ifstream file(filename.c_str(), std::ios::binary);
+    if (!file.good()) {
+        showError("ssl certificate doesn't exist: " + filename);
+        return false;
+    }
+    std::string contents((std::istreambuf_iterator<char>(file)),
+                            std::istreambuf_iterator<char>());
+    unsigned char fileDigest[EVP_MAX_MD_SIZE];
+    unsigned int fileDigestLength = 0;
+    if (EVP_Digest(contents.data(), contents.size(), fileDigest,
+                            &fileDigestLength, EVP_sha256(), NULL) <= 0) {
+        showError("could not digest ssl certificate: " + filename);
+        return false;
+    }
+    std::string contentsDigest((const char*)fileDigest, fileDigestLength);
+
+    if (filename == s_certificateFilename &&
+        contentsDigest == s_certificateDigest) {
+        s_certificateStat    = info;
+        s_certificateChecked = now;
+        return true;
+    }
+    s_certificateFilename.clear();
+
     int r = 0;
     r = SSL_CTX_use_certificate_file(m_ssl->m_context, filename.c_str(), SSL_FILETYPE_PEM);
     if (r <= 0) {
@@ -365,44 +477,85 @@ bool SecureSocket::loadCertificates(const std::string& filename)
         return false;
     }
 
+    // tie sessions to the certificate so that clients can't resume a
+    // session made with a different one
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digestLength = 0;
+    X509* cert = SSL_CTX_get0_certificate(m_ssl->m_context);
+    if (X509_digest(cert, EVP_sha256(), digest, &digestLength) <= 0 ||
+        SSL_CTX_set_session_id_context(m_ssl->m_context, digest,
+                            digestLength) <= 0) {
+        showError("could not set ssl session context: " + filename);
+        return false;
+    }
+
+    s_certificateFilename = filename;
+    s_certificateDigest   = contentsDigest;
+    s_certificateStat     = info;
+    s_certificateChecked  = now;
     return true;
 }
 
 void
 SecureSocket::initContext(bool server)
 {
-    SSL_library_init();
+    // every socket shares one context per role.  the first socket to
+    // get here sets it up and it lives for the rest of the process.
+    static SSL_CTX* s_contexts[2] = { NULL, NULL };
+
+    std::lock_guard<std::mutex> lock(s_contextMutex);
+    SSL_CTX*& context = s_contexts[server ? 1 : 0];
+    if (context == NULL) {
+        SSL_library_init();
 
-    const SSL_METHOD* method;
+        const SSL_METHOD* method;
  
-    // load & register all cryptos, etc.
-    OpenSSL_add_all_algorithms();
+        // load & register all cryptos, etc.
+        OpenSSL_add_all_algorithms();
 
-    // load all error messages
-    SSL_load_error_strings();
+        // load all error messages
+        SSL_load_error_strings();
 
-    if (CLOG->getFilter() >= kINFO) {
-        showSecureLibInfo();
-    }
+        if (Log::isEnabled(kINFO)) {
+            showSecureLibInfo();
+        }
 
-    // SSLv23_method uses TLSv1, with the ability to fall back to SSLv3
-    if (server) {
-        method = SSLv23_server_method();
-    }
-    else {
-        method = SSLv23_client_method();
-    }
+        // SSLv23_method uses TLSv1, with the ability to fall back to SSLv3
+        if (server) {
+            method = SSLv23_server_method();
+        }
+        else {
+            method = SSLv23_client_method();
+        }
     
-    // create new context from method
-    SSL_METHOD* m = const_cast<SSL_METHOD*>(method);
-    m_ssl->m_context = SSL_CTX_new(m);
-
-    // drop SSLv3 support
-    SSL_CTX_set_options(m_ssl->m_context, SSL_OP_NO_SSLv3);
+        // create new context from method
+        SSL_METHOD* m = const_cast<SSL_METHOD*>(method);
+        context = SSL_CTX_new(m);
 
-    if (m_ssl->m_context == NULL) {
-        showError("");
+        if (context == NULL) {
+            showError("");
+        }
+        else {
+            // drop SSLv3 support
+            SSL_CTX_set_options(context, SSL_OP_NO_SSLv3);
+
+            // doWrite() hands over the front of the output buffer, which
+            // may move before a retry, and discards whatever got sent
+            SSL_CTX_set_mode(context, SSL_MODE_ENABLE_PARTIAL_WRITE |
+                                SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+
+            // let reconnecting clients resume their session instead of
+            // doing a full handshake.  the server issues tickets and
+            // caches sessions by default;  clients keep their own.
+            if (!server) {
+                SSL_CTX_set_session_cache_mode(context, SSL_SESS_CACHE_CLIENT |
+                                SSL_SESS_CACHE_NO_INTERNAL_STORE);
+                SSL_CTX_sess_set_new_cb(context, &saveSession);
+            }
+        }
     }
+
+    m_ssl->m_context = context;
 }
 
 void
@@ -427,7 +580,7 @@ SecureSocket::secureAccept(int socket)
     LOG((CLOG_DEBUG2 "accepting secure socket"));
     int r = SSL_accept(m_ssl->m_ssl);
     
-    static int retry;
+    int& retry = m_handshakeRetries;
 
     checkResult(r, retry);
 
@@ -445,7 +598,8 @@ SecureSocket::secureAccept(int socket)
     if (retry == 0) {
         m_secureReady = true;
         LOG((CLOG_INFO "accepted secure socket"));
-        if (CLOG->getFilter() >= kDEBUG1) {
+        countHandshake(true);
+        if (Log::isEnabled(kDEBUG1)) {
             showSecureCipherInfo();
         }
         showSecureConnectInfo();
@@ -456,7 +610,6 @@ SecureSocket::secureAccept(int socket)
     if (retry > 0) {
         LOG((CLOG_DEBUG2 "retry accepting secure socket"));
         m_secureReady = false;
-        ARCH->sleep(s_retryDelay);
         return 0;
     }
 
@@ -476,7 +629,7 @@ SecureSocket::secureConnect(int socket)
     LOG((CLOG_DEBUG2 "connecting secure socket"));
     int r = SSL_connect(m_ssl->m_ssl);
     
-    static int retry;
+    int& retry = m_handshakeRetries;
 
     checkResult(r, retry);
 
@@ -490,7 +643,6 @@ SecureSocket::secureConnect(int socket)
     if (retry > 0) {
         LOG((CLOG_DEBUG2 "retry connect secure socket"));
         m_secureReady = false;
-        ARCH->sleep(s_retryDelay);
         return 0;
     }
 
@@ -510,13 +662,41 @@ SecureSocket::secureConnect(int socket)
         return -1; // Fingerprint failed, error
     }
     LOG((CLOG_DEBUG2 "connected secure socket"));
-    if (CLOG->getFilter() >= kDEBUG1) {
+    countHandshake(false);
+    if (Log::isEnabled(kDEBUG1)) {
         showSecureCipherInfo();
     }
     showSecureConnectInfo();
     return 1;
 }
 
+void
+SecureSocket::countHandshake(bool server)
+{
+    double time = ARCH->time() - m_handshakeStart;
+    bool resumed = (SSL_session_reused(m_ssl->m_ssl) != 0);
+    LOG((CLOG_DEBUG1 "%s handshake took %.1fms",
+        resumed ? "resumed" : "full", time * 1000.0));
+
+    std::lock_guard<std::mutex> lock(s_statsMutex);
+    HandshakeStats& stats = s_handshakeStats[server ? 1 : 0];
+    if (resumed) {
+        ++stats.m_resumed;
+        stats.m_resumedTime += time;
+    }
+    else {
+        ++stats.m_full;
+        stats.m_fullTime += time;
+    }
+}
+
+SecureSocket::HandshakeStats
+SecureSocket::getHandshakeStats(bool server)
+{
+    std::lock_guard<std::mutex> lock(s_statsMutex);
+    return s_handshakeStats[server ? 1 : 0];
+}
+
 bool
 SecureSocket::showCertificate()
 {
@@ -550,6 +730,7 @@ SecureSocket::checkResult(int status, int& retry)
     switch (errorCode) {
     case SSL_ERROR_NONE:
         retry = 0;
+        m_wantWrite = false;
         // operation completed
         break;
 
@@ -560,6 +741,7 @@ SecureSocket::checkResult(int status, int& retry)
         break;
 
     case SSL_ERROR_WANT_READ:
+        m_wantWrite = false;
         retry++;
         LOG((CLOG_DEBUG2 "want to read, error=%d, attempt=%d", errorCode, retry));
         break;
@@ -569,6 +751,7 @@ SecureSocket::checkResult(int status, int& retry)
         // select action actually triggers on a write. This isn't necessary for 
         // m_readable because the socket logic is always readable
         m_writable = true;
+        m_wantWrite = true;
         retry++;
         LOG((CLOG_DEBUG2 "want to write, error=%d, attempt=%d", errorCode, retry));
         break;
@@ -759,12 +942,13 @@ MultiplexerJobStatus SecureSocket::serviceConnect(ISocketMultiplexerJob* job,
         return newJobOrStopServicing();
     }
 
-    // Retry case
+    // Retry case.  wait for the socket to become ready for whatever
+    // openssl is waiting on rather than spinning.
     return {
         true,
         std::make_unique<TSocketMultiplexerMethodJob<SecureSocket>>(
             this, &SecureSocket::serviceConnect,
-            getSocket(), isReadable(), isWritable())
+            getSocket(), !m_wantWrite, m_wantWrite)
     };
 }
 
@@ -791,10 +975,11 @@ MultiplexerJobStatus SecureSocket::serviceAccept(ISocketMultiplexerJob* job,
         return newJobOrStopServicing();
     }
 
-    // Retry case
+    // Retry case.  wait for the socket to become ready for whatever
+    // openssl is waiting on rather than spinning.
     return {true, std::make_unique<TSocketMultiplexerMethodJob<SecureSocket>>(
             this, &SecureSocket::serviceAccept,
-            getSocket(), isReadable(), isWritable())};
+            getSocket(), !m_wantWrite, m_wantWrite)};
 }
 
 void
@@ -32,6 +32,24 @@ A secure socket using SSL.
 */
 class SecureSocket : public TCPSocket {
 public:
+    //! Handshake statistics
+    /*!
+    Counts of the handshakes completed by one side of every secure socket
+    in the process, and the total seconds they took.
+    */
+    class HandshakeStats {
+    public:
+        HandshakeStats() : m_full(0), m_resumed(0),
+                            m_fullTime(0.0), m_resumedTime(0.0) { }
+
+    public:
+        UInt32            m_full;
+        UInt32            m_resumed;
+        double            m_fullTime;
+        double            m_resumedTime;
+    };
+
+
     SecureSocket(IEventQueue* events, SocketMultiplexer* socketMultiplexer, IArchNetwork::EAddressFamily family);
     SecureSocket(IEventQueue* events,
         SocketMultiplexer* socketMultiplexer,
@@ -57,6 +75,13 @@ public:
     void                initSsl(bool server);
     bool loadCertificates(const std::string& filename);
 
+    //! Get handshake statistics
+    /*!
+    Returns the statistics for the accepting side if \c server is true,
+    otherwise for the connecting side.
+    */
+    static HandshakeStats getHandshakeStats(bool server);
+
 private:
     // SSL
     void                initContext(bool server);
@@ -77,6 +102,7 @@ private:
     void                showSecureConnectInfo();
     void                showSecureLibInfo();
     void                showSecureCipherInfo();
+    void                countHandshake(bool server);
     
     void                handleTCPConnected(const Event& event, void*);
 
@@ -86,4 +112,16 @@ private:
     Ssl*                m_ssl;
     bool                m_secureReady;
     bool                m_fatal;
+
+    // true if openssl last asked to wait for the socket to be writable
+    bool                m_wantWrite;
+
+    int                    m_handshakeRetries;
+    double                m_handshakeStart;
+
+    // the server's address, for looking up a session to resume
+    std::string            m_sessionKey;
+
+    // length of an SSL_write() that must be retried, or 0
+    int                    m_writeRetrySize;
 };
@@ -27,36 +27,42 @@
 #include "arch/XArch.h"
 #include "base/Log.h"
 #include "base/TMethodJob.h"
-#include "common/stdvector.h"
 
 //
 // SocketMultiplexer
 //
 
-class CursorMultiplexerJob : public ISocketMultiplexerJob {
-public:
-    MultiplexerJobStatus run(bool readable, bool writable, bool error) override
-    {
-        return {false, {}};
+static
+unsigned short
+getPollEvents(const ISocketMultiplexerJob* job)
+{
+    unsigned short events = 0;
+    if (job->isReadable()) {
+        events |= IArchNetwork::kPOLLIN;
     }
+    if (job->isWritable()) {
+        events |= IArchNetwork::kPOLLOUT;
+    }
+    return events;
+}
 
-    ArchSocket getSocket() const override { return {}; }
-    bool isReadable() const override { return false; }
-    bool isWritable() const override { return false; }
-    bool isCursor() const override { return true; }
-};
-
-
-SocketMultiplexer::SocketMultiplexer() :
+SocketMultiplexer::SocketMultiplexer(bool usePollSet) :
     m_mutex(new Mutex),
     m_thread(NULL),
+    m_pollSet(NULL),
+    m_removedEntries(false),
     m_update(false),
-    m_jobsReady(new CondVar<bool>(m_mutex, false)),
-    m_jobListLock(new CondVar<bool>(m_mutex, false)),
-    m_jobListLockLocked(new CondVar<bool>(m_mutex, false)),
-    m_jobListLocker(NULL),
-    m_jobListLockLocker(NULL)
+    m_hasRequests(false),
+    m_queued(0),
+    m_requestsReady(new CondVar<bool>(m_mutex, false)),
+    m_applied(new CondVar<UInt32>(m_mutex, 0))
 {
+    if (usePollSet) {
+        m_pollSet = ARCH->newPollSet();
+    }
+    LOG((CLOG_DEBUG1 "socket multiplexer using %s",
+        m_pollSet != NULL ? "poll set" : "poll"));
+
     // start thread
     m_thread = new Thread(new TMethodJob<SocketMultiplexer>(
                                 this, &SocketMultiplexer::serviceThread));
@@ -65,48 +71,39 @@ SocketMultiplexer::SocketMultiplexer() :
 SocketMultiplexer::~SocketMultiplexer()
 {
     m_thread->cancel();
-    m_thread->unblockPollSocket();
+    if (m_pollSet != NULL) {
+        ARCH->unblockPollSet(m_pollSet);
+    }
+    else {
+        m_thread->unblockPollSocket();
+    }
     m_thread->wait();
     delete m_thread;
-    delete m_jobsReady;
-    delete m_jobListLock;
-    delete m_jobListLockLocked;
-    delete m_jobListLocker;
-    delete m_jobListLockLocker;
+
+    m_entries.clear();
+    m_requests.clear();
+    if (m_pollSet != NULL) {
+        ARCH->closePollSet(m_pollSet);
+    }
+
+    delete m_requestsReady;
+    delete m_applied;
     delete m_mutex;
 }
 
-void SocketMultiplexer::addSocket(ISocket* socket, std::unique_ptr<ISocketMultiplexerJob>&& job)
+void
+SocketMultiplexer::addSocket(ISocket* socket, std::unique_ptr<ISocketMultiplexerJob>&& job)
 {
     assert(socket != NULL);
     assert(job    != NULL);
 
-    // prevent other threads from locking the job list
-    lockJobListLock();
-
-    // break thread out of poll
-    m_thread->unblockPollSocket();
-
-    // lock the job list
-    lockJobList();
-
-    // insert/replace job
-    SocketJobMap::iterator i = m_socketJobMap.find(socket);
-    if (i == m_socketJobMap.end()) {
-        // we *must* put the job at the end so the order of jobs in
-        // the list continue to match the order of jobs in pfds in
-        // serviceThread().
-        JobCursor j = m_socketJobs.insert(m_socketJobs.end(), std::move(job));
-        m_update     = true;
-        m_socketJobMap.insert(std::make_pair(socket, j));
-    }
-    else {
-        *(i->second) = std::move(job);
-        m_update = true;
+    // a job may change other sockets' jobs directly
+    if (isServiceThread()) {
+        applyRequest(socket, std::move(job));
+        return;
     }
 
-    // unlock the job list
-    unlockJobList();
+    queueRequest(socket, std::move(job));
 }
 
 void
@@ -114,235 +111,303 @@ SocketMultiplexer::removeSocket(ISocket* socket)
 {
     assert(socket != NULL);
 
-    // prevent other threads from locking the job list
-    lockJobListLock();
-
-    // break thread out of poll
-    m_thread->unblockPollSocket();
-
-    // lock the job list
-    lockJobList();
-
-    // remove job.  rather than removing it from the map we put NULL
-    // in the list instead so the order of jobs in the list continues
-    // to match the order of jobs in pfds in serviceThread().
-    SocketJobMap::iterator i = m_socketJobMap.find(socket);
-    if (i != m_socketJobMap.end()) {
-        if (*(i->second)) {
-            i->second->reset();
-            m_update = true;
-        }
+    // a job may remove other sockets directly.  it can't remove its
+    // own socket so the removed job isn't running.
+    if (isServiceThread()) {
+        applyRequest(socket, {});
+        return;
     }
 
-    // unlock the job list
-    unlockJobList();
+    // wait until the service thread has applied the removal.  it only
+    // applies requests between dispatches so the job isn't running and
+    // has been destroyed.
+    UInt32 request = queueRequest(socket, {});
+    Lock lock(m_mutex);
+    while (static_cast<SInt32>(*m_applied - request) < 0) {
+        m_applied->wait();
+    }
 }
 
 void
 SocketMultiplexer::serviceThread(void*)
 {
     std::vector<IArchNetwork::PollEntry> pfds;
-    IArchNetwork::PollEntry pfd;
+    std::vector<JobEntry*> pollEntries;
 
     // service the connections
     for (;;) {
         Thread::testCancel();
 
+        applyRequests();
+
         // wait until there are jobs to handle
-        {
+        if (m_entries.empty()) {
             Lock lock(m_mutex);
-            while (!(bool)*m_jobsReady) {
-                m_jobsReady->wait();
+            while (!(bool)*m_requestsReady) {
+                m_requestsReady->wait();
             }
+            continue;
         }
 
-        // lock the job list
-        lockJobListLock();
-        lockJobList();
-
-        // collect poll entries
-        if (m_update) {
-            m_update = false;
-            pfds.clear();
-            pfds.reserve(m_socketJobMap.size());
-
-            JobCursor cursor    = newCursor();
-            JobCursor jobCursor = nextCursor(cursor);
-            while (jobCursor != m_socketJobs.end()) {
-                if (*jobCursor) {
-                    pfd.m_socket = (*jobCursor)->getSocket();
-                    pfd.m_events = 0;
-                    if ((*jobCursor)->isReadable()) {
-                        pfd.m_events |= IArchNetwork::kPOLLIN;
-                    }
-                    if ((*jobCursor)->isWritable()) {
-                        pfd.m_events |= IArchNetwork::kPOLLOUT;
-                    }
-                    pfds.push_back(pfd);
-                }                
-                jobCursor = nextCursor(cursor);
-            }
-            deleteCursor(cursor);
+        if (m_pollSet != NULL) {
+            servicePollSet();
+        }
+        else {
+            servicePoll(pfds, pollEntries);
         }
 
-        int status;
-        try {
-            // check for status
-            if (!pfds.empty()) {
-                status = ARCH->pollSocket(&pfds[0], (int)pfds.size(), -1);
-            }
-            else {
-                status = 0;
+        // free entries removed during dispatch
+        deleteRemovedEntries();
+    }
+}
+
+void
+SocketMultiplexer::servicePoll(std::vector<IArchNetwork::PollEntry>& pfds,
+                std::vector<JobEntry*>& pollEntries)
+{
+    // collect poll entries
+    if (m_update) {
+        m_update = false;
+        pfds.clear();
+        pollEntries.clear();
+        pfds.reserve(m_entries.size());
+        pollEntries.reserve(m_entries.size());
+
+        IArchNetwork::PollEntry pfd;
+        for (JobEntries::iterator i = m_entries.begin(); i != m_entries.end(); ++i) {
+            JobEntry* entry = i->second.get();
+            if (entry->m_job) {
+                pfd.m_socket  = entry->m_job->getSocket();
+                pfd.m_events  = getPollEvents(entry->m_job.get());
+                pfd.m_revents = 0;
+                pfds.push_back(pfd);
+                pollEntries.push_back(entry);
             }
         }
-        catch (XArchNetwork& e) {
-            LOG((CLOG_WARN "error in socket multiplexer: %s", e.what()));
+    }
+
+    int status;
+    try {
+        // check for status
+        if (!pfds.empty()) {
+            status = ARCH->pollSocket(&pfds[0], (int)pfds.size(), -1);
+        }
+        else {
             status = 0;
         }
+    }
+    catch (XArchNetwork& e) {
+        LOG((CLOG_WARN "error in socket multiplexer: %s", e.what()));
+        status = 0;
+    }
 
-        if (status != 0) {
-            // iterate over socket jobs, invoking each and saving the
-            // new job.
-            UInt32 i             = 0;
-            JobCursor cursor    = newCursor();
-            JobCursor jobCursor = nextCursor(cursor);
-            while (i < pfds.size() && jobCursor != m_socketJobs.end()) {
-                if (*jobCursor != NULL) {
-                    // get poll state
-                    unsigned short revents = pfds[i].m_revents;
-                    bool read  = ((revents & IArchNetwork::kPOLLIN) != 0);
-                    bool write = ((revents & IArchNetwork::kPOLLOUT) != 0);
-                    bool error = ((revents & (IArchNetwork::kPOLLERR |
-                                              IArchNetwork::kPOLLNVAL)) != 0);
-
-                    // run job
-                    MultiplexerJobStatus status = (*jobCursor)->run(read, write, error);
-
-                    if (!status.continue_servicing) {
-                        Lock lock(m_mutex);
-                        jobCursor->reset();
-                        m_update = true;
-                    } else if (status.new_job) {
-                        Lock lock(m_mutex);
-                        *jobCursor = std::move(status.new_job);
-                        m_update = true;
-                    }
-                    ++i;
-                }
-
-                // next job
-                jobCursor = nextCursor(cursor);
-            }
-            deleteCursor(cursor);
-        }
+    // requests that arrived while polling may have replaced or removed
+    // entries.  removed entries are kept until the dispatch is over.
+    applyRequests();
 
-        // delete any removed socket jobs
-        for (SocketJobMap::iterator i = m_socketJobMap.begin();
-                            i != m_socketJobMap.end();) {
-            if (*(i->second) == NULL) {
-                m_socketJobs.erase(i->second);
-                m_socketJobMap.erase(i++);
-                m_update = true;
-            }
-            else {
-                ++i;
+    if (status != 0) {
+        for (size_t i = 0; i < pfds.size(); ++i) {
+            if (pfds[i].m_revents != 0) {
+                runJob(pollEntries[i], pfds[i].m_revents);
             }
         }
-
-        // unlock the job list
-        unlockJobList();
     }
 }
 
-SocketMultiplexer::JobCursor
-SocketMultiplexer::newCursor()
+void
+SocketMultiplexer::servicePollSet()
 {
-    Lock lock(m_mutex);
-    return m_socketJobs.insert(m_socketJobs.begin(), std::make_unique<CursorMultiplexerJob>());
-}
+    static const int s_maxEvents = 64;
+    IArchNetwork::PollSetEvent events[s_maxEvents];
 
-SocketMultiplexer::JobCursor
-SocketMultiplexer::nextCursor(JobCursor cursor)
-{
-    Lock lock(m_mutex);
-    JobCursor j = m_socketJobs.end();
-    JobCursor i = cursor;
-    while (++i != m_socketJobs.end()) {
-        if (*i && !(*i)->isCursor()) {
-            // found a real job (as opposed to a cursor)
-            j = i;
-
-            // move our cursor just past the job
-            m_socketJobs.splice(++i, m_socketJobs, cursor);
-            break;
-        }
+    int n;
+    try {
+        n = ARCH->waitPollSet(m_pollSet, events, s_maxEvents, -1);
+    }
+    catch (XArchNetwork& e) {
+        LOG((CLOG_WARN "error in socket multiplexer: %s", e.what()));
+        n = 0;
+    }
+
+    // requests that arrived while waiting may have replaced or removed
+    // entries.  removed entries are kept until the dispatch is over so
+    // the poll set's results stay valid.
+    applyRequests();
+
+    for (int i = 0; i < n; ++i) {
+        runJob(reinterpret_cast<JobEntry*>(events[i].m_data),
+                            events[i].m_revents);
     }
-    return j;
 }
 
 void
-SocketMultiplexer::deleteCursor(JobCursor cursor)
+SocketMultiplexer::runJob(JobEntry* entry, unsigned short revents)
 {
-    Lock lock(m_mutex);
-    m_socketJobs.erase(cursor);
+    if (!entry->m_job) {
+        // removed since the poll
+        return;
+    }
+
+    // get poll state
+    bool read  = ((revents & IArchNetwork::kPOLLIN) != 0);
+    bool write = ((revents & IArchNetwork::kPOLLOUT) != 0);
+    bool error = ((revents & (IArchNetwork::kPOLLERR |
+                              IArchNetwork::kPOLLNVAL)) != 0);
+
+    // run job
+    MultiplexerJobStatus status = entry->m_job->run(read, write, error);
+
+    if (!status.continue_servicing) {
+        setJob(entry, {});
+    }
+    else if (status.new_job) {
+        setJob(entry, std::move(status.new_job));
+    }
 }
 
-void
-SocketMultiplexer::lockJobListLock()
+bool
+SocketMultiplexer::applyRequests()
 {
-    Lock lock(m_mutex);
+    if (!m_hasRequests.load(std::memory_order_acquire)) {
+        return false;
+    }
 
-    // wait for the lock on the lock
-    while (*m_jobListLockLocked) {
-        m_jobListLockLocked->wait();
+    std::vector<JobRequest> requests;
+    UInt32 applied;
+    {
+        Lock lock(m_mutex);
+        requests.swap(m_requests);
+        m_hasRequests.store(false, std::memory_order_relaxed);
+        *m_requestsReady = false;
+        applied = m_queued;
     }
 
-    // take ownership of the lock on the lock
-    *m_jobListLockLocked = true;
-    m_jobListLockLocker  = new Thread(Thread::getCurrentThread());
+    for (size_t i = 0; i < requests.size(); ++i) {
+        applyRequest(requests[i].m_socket, std::move(requests[i].m_job));
+    }
+
+    // jobs replaced by the requests were destroyed above
+    {
+        Lock lock(m_mutex);
+        *m_applied = applied;
+        m_applied->broadcast();
+    }
+    return true;
 }
 
 void
-SocketMultiplexer::lockJobList()
+SocketMultiplexer::applyRequest(ISocket* socket,
+                std::unique_ptr<ISocketMultiplexerJob>&& job)
 {
-    Lock lock(m_mutex);
+    JobEntries::iterator i = m_entries.find(socket);
+    if (i != m_entries.end()) {
+        setJob(i->second.get(), std::move(job));
+    }
+    else if (job) {
+        JobEntry* entry = new JobEntry;
+        entry->m_socket = socket;
+        m_entries.insert(std::make_pair(socket, std::unique_ptr<JobEntry>(entry)));
+        setJob(entry, std::move(job));
+    }
+}
 
-    // make sure we're the one that called lockJobListLock()
-    assert(*m_jobListLockLocker == Thread::getCurrentThread());
+void
+SocketMultiplexer::setJob(JobEntry* entry,
+                std::unique_ptr<ISocketMultiplexerJob>&& job)
+{
+    ISocketMultiplexerJob* oldJob = entry->m_job.get();
+    ISocketMultiplexerJob* newJob = job.get();
 
-    // wait for the job list lock
-    while (*m_jobListLock) {
-        m_jobListLock->wait();
+    if (oldJob == NULL && newJob == NULL) {
+        return;
     }
 
-    // take ownership of the lock
-    *m_jobListLock      = true;
-    m_jobListLocker     = m_jobListLockLocker;
-    m_jobListLockLocker = NULL;
+    // most job changes don't change interest, e.g. a socket that's
+    // still got more to write
+    bool sameSocket = (oldJob != NULL && newJob != NULL &&
+                        oldJob->getSocket() == newJob->getSocket());
+    if (sameSocket && getPollEvents(oldJob) == getPollEvents(newJob)) {
+        entry->m_job = std::move(job);
+        return;
+    }
 
-    // release the lock on the lock
-    *m_jobListLockLocked = false;
-    m_jobListLockLocked->broadcast();
+    if (m_pollSet != NULL) {
+        try {
+            if (sameSocket) {
+                ARCH->modifyPollSet(m_pollSet, newJob->getSocket(),
+                            getPollEvents(newJob), entry);
+            }
+            else {
+                if (oldJob != NULL) {
+                    ARCH->removeFromPollSet(m_pollSet, oldJob->getSocket());
+                }
+                if (newJob != NULL) {
+                    ARCH->addToPollSet(m_pollSet, newJob->getSocket(),
+                            getPollEvents(newJob), entry);
+                }
+            }
+        }
+        catch (XArchNetwork& e) {
+            LOG((CLOG_WARN "error in socket multiplexer: %s", e.what()));
+        }
+    }
+    else {
+        m_update = true;
+    }
+
+    if (newJob == NULL) {
+        m_removedEntries = true;
+    }
+    entry->m_job = std::move(job);
 }
 
 void
-SocketMultiplexer::unlockJobList()
+SocketMultiplexer::deleteRemovedEntries()
 {
-    Lock lock(m_mutex);
+    if (!m_removedEntries) {
+        return;
+    }
+    m_removedEntries = false;
 
-    // make sure we're the one that called lockJobList()
-    assert(*m_jobListLocker == Thread::getCurrentThread());
+    for (JobEntries::iterator i = m_entries.begin(); i != m_entries.end();) {
+        if (!i->second->m_job) {
+            i = m_entries.erase(i);
+        }
+        else {
+            ++i;
+        }
+    }
+}
 
-    // release the lock
-    delete m_jobListLocker;
-    m_jobListLocker = NULL;
-    *m_jobListLock  = false;
-    m_jobListLock->signal();
+UInt32
+SocketMultiplexer::queueRequest(ISocket* socket,
+                std::unique_ptr<ISocketMultiplexerJob>&& job)
+{
+    UInt32 request;
+    {
+        Lock lock(m_mutex);
+        JobRequest r;
+        r.m_socket = socket;
+        r.m_job    = std::move(job);
+        m_requests.push_back(std::move(r));
+        request = ++m_queued;
+        m_hasRequests.store(true, std::memory_order_release);
+        *m_requestsReady = true;
+        m_requestsReady->signal();
+    }
 
-    // set new jobs ready state
-    bool isReady = !m_socketJobMap.empty();
-    if (*m_jobsReady != isReady) {
-        *m_jobsReady = isReady;
-        m_jobsReady->signal();
+    // break thread out of poll
+    if (m_pollSet != NULL) {
+        ARCH->unblockPollSet(m_pollSet);
+    }
+    else {
+        m_thread->unblockPollSocket();
     }
+    return request;
+}
+
+bool
+SocketMultiplexer::isServiceThread() const
+{
+    return Thread::getCurrentThread() == *m_thread;
 }
@@ -19,9 +19,11 @@
 #pragma once
 
 #include "arch/IArchNetwork.h"
-#include "common/stdlist.h"
-#include "common/stdmap.h"
+#include "common/basic_types.h"
+#include "common/stdvector.h"
+#include <atomic>
 #include <memory>
+#include <unordered_map>
 
 template <class T>
 class CondVar;
@@ -36,20 +38,45 @@ A socket multiplexer services multiple sockets simultaneously.
 */
 class SocketMultiplexer {
 public:
-    SocketMultiplexer();
+    //! Create a multiplexer
+    /*!
+    If \c usePollSet is true and the platform supports it (epoll on
+    Linux) then sockets are registered with the kernel once and only
+    changes in interest are passed down, otherwise every socket is
+    passed to \c pollSocket() on each wakeup.
+    */
+    explicit SocketMultiplexer(bool usePollSet = true);
     ~SocketMultiplexer();
 
     //! @name manipulators
     //@{
 
+    //! Add or replace the job for a socket
+    /*!
+    The job is handed to the service thread, which installs it before
+    it next dispatches.  This does not wait for the service thread.
+    */
     void                addSocket(ISocket*, std::unique_ptr<ISocketMultiplexerJob>&& job);
 
+    //! Remove the job for a socket
+    /*!
+    When this returns the socket's job has been destroyed and will not
+    be run again, so the socket may be deleted.  Unless called from a
+    job this waits for the service thread to finish dispatching.
+    */
     void                removeSocket(ISocket*);
 
     //@}
     //! @name accessors
     //@{
 
+    //! Check for poll set
+    /*!
+    Returns true if sockets are serviced through a poll set rather than
+    \c pollSocket().
+    */
+    bool                isUsingPollSet() const { return m_pollSet != NULL; }
+
     // maybe belongs on ISocketMultiplexer
     static SocketMultiplexer*
                         getInstance();
@@ -57,54 +84,73 @@ public:
     //@}
 
 private:
-    // list of jobs.  we use a list so we can safely iterate over it
-    // while other threads modify it.
-    using SocketJobs = std::list<std::unique_ptr<ISocketMultiplexerJob>>;
-    typedef SocketJobs::iterator JobCursor;
-    typedef std::map<ISocket*, JobCursor> SocketJobMap;
-
-    // service sockets.  the service thread will only access m_sockets
-    // and m_update while m_pollable and m_polling are true.  all other
-    // threads must only modify these when m_pollable and m_polling are
-    // false.  only the service thread sets m_polling.
+    // a registered socket.  the entry is what the poll set reports
+    // back so it outlives its job until the end of the dispatch in
+    // which the job was removed.
+    class JobEntry {
+    public:
+        ISocket*        m_socket;
+        std::unique_ptr<ISocketMultiplexerJob> m_job;
+    };
+
+    // a pending change from addSocket() or removeSocket().  a NULL job
+    // removes the socket.
+    class JobRequest {
+    public:
+        ISocket*        m_socket;
+        std::unique_ptr<ISocketMultiplexerJob> m_job;
+    };
+
+    using JobEntries = std::unordered_map<ISocket*, std::unique_ptr<JobEntry>>;
+
+    // service sockets.  the job entries are owned by the service thread
+    // and are never locked;  other threads queue requests which the
+    // service thread applies between dispatches.
     void                serviceThread(void*);
 
-    // create, iterate, and destroy a cursor.  a cursor is used to
-    // safely iterate through the job list while other threads modify
-    // the list.  it works by inserting a dummy item in the list and
-    // moving that item through the list.  the dummy item will never
-    // be removed by other edits so an iterator pointing at the item
-    // remains valid until we remove the dummy item in deleteCursor().
-    // nextCursor() finds the next non-dummy item, moves our dummy
-    // item just past it, and returns an iterator for the non-dummy
-    // item.  all cursor calls lock the mutex for their duration.
-    JobCursor            newCursor();
-    JobCursor            nextCursor(JobCursor);
-    void                deleteCursor(JobCursor);
-
-    // lock out locking the job list.  this blocks if another thread
-    // has already locked out locking.  once it returns, only the
-    // calling thread will be able to lock the job list after any
-    // current lock is released.
-    void                lockJobListLock();
-
-    // lock the job list.  this blocks if the job list is already
-    // locked.  the calling thread must have called requestJobLock.
-    void                lockJobList();
-
-    // unlock the job list and the lock out on locking.
-    void                unlockJobList();
+    // wait for sockets to become ready and run their jobs
+    void                servicePoll(std::vector<IArchNetwork::PollEntry>&,
+                            std::vector<JobEntry*>&);
+    void                servicePollSet();
+
+    // run an entry's job and apply the result
+    void                runJob(JobEntry*, unsigned short revents);
+
+    // apply queued requests.  returns false if there were none.  this
+    // must only be called by the service thread between dispatches.
+    bool                applyRequests();
+
+    // install or remove a job.  removed entries keep their memory until
+    // deleteRemovedEntries().  service thread only.
+    void                applyRequest(ISocket*, std::unique_ptr<ISocketMultiplexerJob>&&);
+    void                setJob(JobEntry*, std::unique_ptr<ISocketMultiplexerJob>&&);
+    void                deleteRemovedEntries();
+
+    // queue a request for the service thread and wake it.  returns the
+    // request's sequence number.
+    UInt32                queueRequest(ISocket*, std::unique_ptr<ISocketMultiplexerJob>&&);
+
+    // true if the caller is the service thread, i.e. a job
+    bool                isServiceThread() const;
 
 private:
     Mutex*                m_mutex;
     Thread*                m_thread;
+
+    // NULL if sockets are passed to pollSocket()
+    ArchPollSet            m_pollSet;
+
+    // owned by the service thread.  m_update is set when the sockets
+    // passed to pollSocket() must be collected again.
+    JobEntries            m_entries;
+    bool                m_removedEntries;
     bool                m_update;
-    CondVar<bool>*        m_jobsReady;
-    CondVar<bool>*        m_jobListLock;
-    CondVar<bool>*        m_jobListLockLocked;
-    Thread*                m_jobListLocker;
-    Thread*                m_jobListLockLocker;
-
-    SocketJobs            m_socketJobs;
-    SocketJobMap        m_socketJobMap;
+
+    // requests from other threads, guarded by m_mutex.  m_hasRequests
+    // lets the service thread check for requests without locking.
+    std::vector<JobRequest>    m_requests;
+    std::atomic<bool>    m_hasRequests;
+    UInt32                m_queued;
+    CondVar<bool>*        m_requestsReady;
+    CondVar<UInt32>*    m_applied;
 };
@@ -139,14 +139,7 @@ TCPSocket::read(void* buffer, UInt32 n)
 {
     // copy data directly from our input buffer
     Lock lock(&m_mutex);
-    UInt32 size = m_inputBuffer.getSize();
-    if (n > size) {
-        n = size;
-    }
-    if (buffer != NULL && n != 0) {
-        memcpy(buffer, m_inputBuffer.peek(n), n);
-    }
-    m_inputBuffer.pop(n);
+    n = m_inputBuffer.read(buffer, n);
 
     // if no more data and we cannot read or write then send disconnected
     if (n > 0 && m_inputBuffer.getSize() == 0 && !m_readable && !m_writable) {
@@ -157,8 +150,32 @@ TCPSocket::read(void* buffer, UInt32 n)
     return n;
 }
 
+UInt32
+TCPSocket::readAll(StreamBuffer& buffer)
+{
+    // hand over the whole input buffer
+    Lock lock(&m_mutex);
+    UInt32 n = m_inputBuffer.getSize();
+    buffer.append(m_inputBuffer, n);
+
+    // if no more data and we cannot read or write then send disconnected
+    if (n > 0 && !m_readable && !m_writable) {
+        sendEvent(m_events->forISocket().disconnected());
+        m_connected = false;
+    }
+
+    return n;
+}
+
 void
 TCPSocket::write(const void* buffer, UInt32 n)
+{
+    StreamBuffer::Span span = { buffer, n };
+    writev(&span, 1);
+}
+
+void
+TCPSocket::writev(const StreamBuffer::Span* buffers, UInt32 count)
 {
     bool wasEmpty;
     {
@@ -170,15 +187,18 @@ TCPSocket::write(const void* buffer, UInt32 n)
             return;
         }
 
-        // ignore empty writes
-        if (n == 0) {
+        // copy data to the output buffer, ignoring empty writes
+        wasEmpty = (m_outputBuffer.getSize() == 0);
+        for (UInt32 i = 0; i < count; ++i) {
+            if (buffers[i].m_size > 0) {
+                m_outputBuffer.write(buffers[i].m_data,
+                                (UInt32)buffers[i].m_size);
+            }
+        }
+        if (m_outputBuffer.getSize() == 0) {
             return;
         }
 
-        // copy data to the output buffer
-        wasEmpty = (m_outputBuffer.getSize() == 0);
-        m_outputBuffer.write(buffer, n);
-
         // there's data to write
         m_flushed = false;
     }
@@ -332,20 +352,23 @@ TCPSocket::init()
 TCPSocket::EJobResult
 TCPSocket::doRead()
 {
-    UInt8 buffer[4096];
-    memset(buffer, 0, sizeof(buffer));
+    // read straight into the input buffer.  reads are large enough that
+    // a 32 KB clipboard chunk takes only a couple of them.
+    const UInt32 kReadSize = 16384;
     size_t bytesRead = 0;
     
-    bytesRead = ARCH->readSocket(m_socket, buffer, sizeof(buffer));
+    bytesRead = ARCH->readSocket(m_socket,
+                                m_inputBuffer.reserve(kReadSize), kReadSize);
     
     if (bytesRead > 0) {
         bool wasEmpty = (m_inputBuffer.getSize() == 0);
         
         // slurp up as much as possible
         do {
-            m_inputBuffer.write(buffer, (UInt32)bytesRead);
+            m_inputBuffer.commit((UInt32)bytesRead);
 
-            bytesRead = ARCH->readSocket(m_socket, buffer, sizeof(buffer));
+            bytesRead = ARCH->readSocket(m_socket,
+                                m_inputBuffer.reserve(kReadSize), kReadSize);
         } while (bytesRead > 0);
         
         // send input ready if input buffer was empty
@@ -372,13 +395,15 @@ TCPSocket::doRead()
 TCPSocket::EJobResult
 TCPSocket::doWrite()
 {
-    // write data
-    UInt32 bufferSize = 0;
+    // write data straight from the output buffer, even if it wraps
+    StreamBuffer::Span spans[2];
     int bytesWrote = 0;
 
-    bufferSize = m_outputBuffer.getSize();
-    const void* buffer = m_outputBuffer.peek(bufferSize);
-    bytesWrote = (UInt32)ARCH->writeSocket(m_socket, buffer, bufferSize);
+    UInt32 count = m_outputBuffer.peekSpans(spans, m_outputBuffer.getSize());
+    if (count == 0) {
+        return kRetry;
+    }
+    bytesWrote = (UInt32)ARCH->writevSocket(m_socket, spans, count);
 
     if (bytesWrote > 0) {
         discardWrittenData(bytesWrote);
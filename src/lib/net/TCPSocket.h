@@ -48,7 +48,10 @@ public:
 
     // IStream overrides
     virtual UInt32        read(void* buffer, UInt32 n);
+    virtual UInt32        readAll(StreamBuffer& buffer);
     virtual void        write(const void* buffer, UInt32 n);
+    virtual void        writev(const StreamBuffer::Span* buffers,
+                            UInt32 count);
     virtual void        flush();
     virtual void        shutdownInput();
     virtual void        shutdownOutput();
@@ -181,11 +181,15 @@ public:
                              Window confine_to, Cursor cursor, Time time) = 0;
     virtual int XUngrabKeyboard(Display* display, Time time) = 0;
     virtual int XPending(Display* display) = 0;
+    virtual int XEventsQueued(Display* display, int mode) = 0;
     virtual int XPeekEvent(Display* display, XEvent* event_return) = 0;
     virtual Status XkbRefreshKeyboardMapping(XkbMapNotifyEvent* event) = 0;
     virtual int XRefreshKeyboardMapping(XMappingEvent* event_map) = 0;
     virtual int XISelectEvents(Display* display, Window w, XIEventMask* masks,
                                int num_masks) = 0;
+    virtual XIDeviceInfo* XIQueryDevice(Display* display, int deviceid,
+                                        int* ndevices_return) = 0;
+    virtual void XIFreeDeviceInfo(XIDeviceInfo* info) = 0;
     virtual Atom XInternAtom(Display* display, _Xconst char* atom_name,
                              Bool only_if_exists) = 0;
     virtual int XGetScreenSaver(Display* display, int* timeout_return,
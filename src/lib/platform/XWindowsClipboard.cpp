@@ -383,6 +383,10 @@ XWindowsClipboard::has(EFormat format) const
     assert(m_open);
 
     fillCache();
+    if (!m_added[format]) {
+        // the owner didn't offer it but may have it anyway
+        fillFormat(format);
+    }
     return m_added[format];
 }
 
@@ -391,6 +395,7 @@ std::string XWindowsClipboard::get(EFormat format) const
     assert(m_open);
 
     fillCache();
+    fillFormat(format);
     return m_data[format];
 }
 
@@ -471,8 +476,9 @@ XWindowsClipboard::doClearCache()
     m_checkCache = false;
     m_cached     = false;
     for (SInt32 index = 0; index < kNumFormats; ++index) {
-        m_data[index]  = "";
-        m_added[index] = false;
+        m_data[index]    = "";
+        m_added[index]   = false;
+        m_pending[index] = false;
     }
 }
 
@@ -500,15 +506,39 @@ XWindowsClipboard::doFillCache()
     m_cacheTime  = m_timeOwned;
 }
 
+void
+XWindowsClipboard::fillFormat(EFormat format) const
+{
+    // get the format's data if not already transferred
+    if (m_pending[format]) {
+        const_cast<XWindowsClipboard*>(this)->doFillFormat(format);
+    }
+}
+
+void
+XWindowsClipboard::doFillFormat(EFormat format)
+{
+    // only the ICCCM path leaves formats pending.  a format the owner
+    // offered but couldn't convert stays added, with no data, so has()
+    // doesn't change its answer under the caller.
+    m_pending[format] = false;
+    if (icccmFillFormat(format)) {
+        m_added[format] = true;
+    }
+    else if (m_added[format]) {
+        LOG((CLOG_DEBUG "format %d offered but not converted", format));
+    }
+}
+
 void
 XWindowsClipboard::icccmFillCache()
 {
     LOG((CLOG_DEBUG "ICCCM fill clipboard %d", m_id));
 
     // see if we can get the list of available formats from the selection.
-    // if not then use a default list of formats.  note that some clipboard
-    // owners are broken and report TARGETS as the type of the TARGETS data
-    // instead of the correct type ATOM;  allow either.
+    // note that some clipboard owners are broken and report TARGETS as
+    // the type of the TARGETS data instead of the correct type ATOM;
+    // allow either.
     const Atom atomTargets = m_atomTargets;
     Atom target;
     std::string data;
@@ -516,7 +546,6 @@ XWindowsClipboard::icccmFillCache()
         (target != m_atomAtom && target != m_atomTargets)) {
         LOG((CLOG_DEBUG1 "selection doesn't support TARGETS"));
         data = "";
-        XWindowsUtil::appendAtomData(data, XA_STRING);
     }
 
     XWindowsUtil::convertAtomProperty(data);
@@ -524,36 +553,39 @@ XWindowsClipboard::icccmFillCache()
     const UInt32 numTargets = data.size() / sizeof(Atom);
     LOG((CLOG_DEBUG "  available targets: %s", XWindowsUtil::atomsToString(m_display, targets, numTargets).c_str()));
 
-    // try each converter in order (because they're in order of
-    // preference).
+    // note which formats are offered but don't transfer any data until
+    // somebody asks for it.  a large image can take a long time to
+    // transfer and there's no point if it's never pasted.  formats that
+    // aren't offered are still pending:  i've seen clipboard owners that
+    // don't report all the targets they support, so has() asks for them.
     for (ConverterList::const_iterator index = m_converters.begin();
                                 index != m_converters.end(); ++index) {
         IXWindowsClipboardConverter* converter = *index;
-
-        // skip already handled targets
-        if (m_added[converter->getFormat()]) {
-            continue;
-        }
-
-        // see if atom is in target list
-        Atom target = None;
-        // XXX -- just ask for the converter's target to see if it's
-        // available rather than checking TARGETS.  i've seen clipboard
-        // owners that don't report all the targets they support.
-        target = converter->getAtom();
-        /*
+        m_pending[converter->getFormat()] = true;
         for (UInt32 i = 0; i < numTargets; ++i) {
             if (converter->getAtom() == targets[i]) {
-                target = targets[i];
+                m_added[converter->getFormat()] = true;
                 break;
             }
         }
-        */
-        if (target == None) {
+    }
+}
+
+bool
+XWindowsClipboard::icccmFillFormat(EFormat format)
+{
+    // try each converter for the format in order (because they're in
+    // order of preference).  ask for the converter's target whether or
+    // not the owner offered it.
+    for (ConverterList::const_iterator index = m_converters.begin();
+                                index != m_converters.end(); ++index) {
+        IXWindowsClipboardConverter* converter = *index;
+        if (converter->getFormat() != format) {
             continue;
         }
 
         // get the data
+        Atom target = converter->getAtom();
         Atom actualTarget;
         std::string targetData;
         if (!icccmGetSelection(target, &actualTarget, &targetData)) {
@@ -561,12 +593,12 @@ XWindowsClipboard::icccmFillCache()
             continue;
         }
 
-        // add to clipboard and note we've done it
-        IClipboard::EFormat format = converter->getFormat();
-        m_data[format]  = converter->toIClipboard(targetData);
-        m_added[format] = true;
+        // add to clipboard
+        m_data[format] = converter->toIClipboard(targetData);
         LOG((CLOG_DEBUG "added format %d for target %s (%u %s)", format, XWindowsUtil::atomToString(m_display, target).c_str(), targetData.size(), targetData.size() == 1 ? "byte" : "bytes"));
+        return true;
     }
+    return false;
 }
 
 bool
@@ -1014,10 +1046,11 @@ XWindowsClipboard::sendReply(Reply* reply)
 
         // send INCR reply if incremental and we haven't replied yet
         if (useINCR && !reply->m_replied) {
-            UInt32 size = reply->m_data.size();
+            // format 32 data is passed to Xlib as longs
+            long size = static_cast<long>(reply->m_data.size());
             if (!XWindowsUtil::setWindowProperty(m_display,
                                 reply->m_requestor, reply->m_property,
-                                &size, 4, m_atomINCR, 32)) {
+                                &size, sizeof(size), m_atomINCR, 32)) {
                 failed = true;
             }
         }
@@ -1091,7 +1124,7 @@ XWindowsClipboard::sendReply(Reply* reply)
         // log.  we've seen what appears to be a bug in lesstif and
         // knowing the properties may help design a workaround, if
         // it becomes necessary.
-        if (CLOG->getFilter() >= kDEBUG2) {
+        if (Log::isEnabled(kDEBUG2)) {
             XWindowsUtil::ErrorLock lock(m_display);
             int n;
             Atom* props = m_impl->XListProperties(m_display, reply->m_requestor,
@@ -1315,26 +1348,27 @@ XWindowsClipboard::CICCCMGetClipboard::readClipboard(Display* display,
     // synchronize with server before we start following timeout countdown
     XSync(display, False);
 
-    // Xlib inexplicably omits the ability to wait for an event with
-    // a timeout.  (it's inexplicable because there's no portable way
-    // to do it.)  we'll poll until we have what we're looking for or
-    // a timeout expires.  we use a timeout so we don't get locked up
-    // by badly behaved selection owners.
+    // Xlib omits the ability to wait for an event with a timeout so
+    // we wait on the connection ourselves until we have what we're
+    // looking for or a timeout expires.  we use a timeout so we don't
+    // get locked up by badly behaved selection owners.  the timer is
+    // reset whenever the owner makes progress so long incremental
+    // transfers aren't cut short.
     XEvent xevent;
     std::vector<XEvent> events;
     Stopwatch timeout(false);    // timer not stopped, not triggered
     static const double s_timeout = 0.25;    // FIXME -- is this too short?
-    bool noWait = false;
     while (!m_done && !m_failed) {
         // fail if timeout has expired
-        if (timeout.getTime() >= s_timeout) {
+        const double remaining = s_timeout - timeout.getTime();
+        if (remaining <= 0.0) {
             m_failed = true;
             break;
         }
 
-        // process events if any otherwise sleep
-        if (noWait || XPending(display) > 0) {
-            while (!m_done && !m_failed && (noWait || XPending(display) > 0)) {
+        // process events if any otherwise wait for some
+        if (XPending(display) > 0) {
+            while (!m_done && !m_failed && XPending(display) > 0) {
                 XNextEvent(display, &xevent);
                 if (!processEvent(display, &xevent)) {
                     // not processed so save it
@@ -1343,17 +1377,11 @@ XWindowsClipboard::CICCCMGetClipboard::readClipboard(Display* display,
                 else {
                     // reset timer since we've made some progress
                     timeout.reset();
-
-                    // don't sleep anymore, just block waiting for events.
-                    // we're assuming here that the clipboard owner will
-                    // complete the protocol correctly.  if we continue to
-                    // sleep we'll get very bad performance.
-                    noWait = true;
                 }
             }
         }
         else {
-            ARCH->sleep(0.01);
+            XWindowsUtil::waitForEvent(display, remaining);
         }
     }
 
@@ -129,10 +129,15 @@ private:
     void                clearCache() const;
     void                doClearCache();
 
-    // cache all formats of the selection
+    // cache the formats the selection offers.  the data for each
+    // format is only transferred when it's asked for.
     void                fillCache() const;
     void                doFillCache();
 
+    // transfer the data for a format if it hasn't been transferred yet
+    void                fillFormat(EFormat) const;
+    void                doFillFormat(EFormat);
+
     //
     // helper classes
     //
@@ -254,6 +259,7 @@ private:
 
     // ICCCM interoperability methods
     void                icccmFillCache();
+    bool                icccmFillFormat(EFormat);
     bool icccmGetSelection(Atom target, Atom* actualTarget, std::string* data) const;
     Time                icccmGetTime() const;
 
@@ -306,6 +312,9 @@ private:
     bool                m_added[kNumFormats];
     std::string m_data[kNumFormats];
 
+    // formats of the selection we haven't tried to transfer yet
+    bool                m_pending[kNumFormats];
+
     // conversion request replies
     ReplyMap            m_replies;
     ReplyEventMask        m_eventMasks;
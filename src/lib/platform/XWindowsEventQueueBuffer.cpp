@@ -18,27 +18,19 @@
 
 #include "platform/XWindowsEventQueueBuffer.h"
 
+#include "platform/XWindowsUtil.h"
 #include "mt/Lock.h"
 #include "mt/Thread.h"
 #include "base/Event.h"
 #include "base/IEventQueue.h"
+#include "base/Stopwatch.h"
 
 #include <fcntl.h>
 #if HAVE_UNISTD_H
 #    include <unistd.h>
 #endif
-#if HAVE_POLL
-#    include <poll.h>
-#else
-#    if HAVE_SYS_SELECT_H
-#        include <sys/select.h>
-#    endif
-#    if HAVE_SYS_TIME_H
-#        include <sys/time.h>
-#    endif
-#    if HAVE_SYS_TYPES_H
-#        include <sys/types.h>
-#    endif
+#if HAVE_SYS_EVENTFD_H
+#    include <sys/eventfd.h>
 #endif
 
 //
@@ -52,37 +44,47 @@ class EventQueueTimer { };
 // XWindowsEventQueueBuffer
 //
 
+const UInt32            XWindowsEventQueueBuffer::kQueueSize = 4096;
+
 XWindowsEventQueueBuffer::XWindowsEventQueueBuffer(IXWindowsImpl* impl,
         Display* display, Window window, IEventQueue* events) :
-    m_events(events),
+    m_impl(impl),
     m_display(display),
     m_window(window),
-    m_waiting(false)
+    m_queue(kQueueSize),
+    m_overflowing(false),
+    m_waiting(false),
+    m_events(events)
 {
-    m_impl = impl;
     assert(m_display != NULL);
     assert(m_window  != None);
 
-    m_userEvent = m_impl->XInternAtom(m_display, "BARRIER_USER_EVENT", False);
-    // set up for pipe hack
-    int result = pipe(m_pipefd);
+#if HAVE_SYS_EVENTFD_H
+    m_wakeFd[0] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    m_wakeFd[1] = m_wakeFd[0];
+    assert(m_wakeFd[0] != -1);
+#else
+    int result = pipe(m_wakeFd);
     assert(result == 0);
 
     int pipeflags;
-    pipeflags = fcntl(m_pipefd[0], F_GETFL);
-    fcntl(m_pipefd[0], F_SETFL, pipeflags | O_NONBLOCK);
-    pipeflags = fcntl(m_pipefd[1], F_GETFL);
-    fcntl(m_pipefd[1], F_SETFL, pipeflags | O_NONBLOCK);
+    pipeflags = fcntl(m_wakeFd[0], F_GETFL);
+    fcntl(m_wakeFd[0], F_SETFL, pipeflags | O_NONBLOCK);
+    pipeflags = fcntl(m_wakeFd[1], F_GETFL);
+    fcntl(m_wakeFd[1], F_SETFL, pipeflags | O_NONBLOCK);
+#endif
 }
 
 XWindowsEventQueueBuffer::~XWindowsEventQueueBuffer()
 {
-    // release pipe hack resources
-    close(m_pipefd[0]);
-    close(m_pipefd[1]);
+    close(m_wakeFd[0]);
+    if (m_wakeFd[1] != m_wakeFd[0]) {
+        close(m_wakeFd[1]);
+    }
 }
 
-int XWindowsEventQueueBuffer::getPendingCountLocked()
+int
+XWindowsEventQueueBuffer::getPendingCountLocked() const
 {
     Lock lock(&m_mutex);
     // work around a bug in old libx11 which causes the first XPending not to read events under
@@ -100,113 +102,30 @@ XWindowsEventQueueBuffer::waitForEvent(double dtimeout)
 {
     Thread::testCancel();
 
-    // clear out the pipe in preparation for waiting.
-
-    char buf[16];
-    ssize_t read_response = read(m_pipefd[0], buf, 15);
-    
-    // with linux automake, warnings are treated as errors by default
-    if (read_response < 0)
-    {
-        // todo: handle read response
-    }
-
-    {
-        Lock lock(&m_mutex);
-        // we're now waiting for events
-        m_waiting = true;
-
-        // push out pending events
-        flush();
-    }
-    // calling flush may have queued up a new event.
-    if (!XWindowsEventQueueBuffer::isEmpty()) {
-        Thread::testCancel();
-        return;
-    }
-
-    // use poll() to wait for a message from the X server or for timeout.
-    // this is a good deal more efficient than polling and sleeping.
-#if HAVE_POLL
-    struct pollfd pfds[2];
-    pfds[0].fd     = ConnectionNumber(m_display);
-    pfds[0].events = POLLIN;
-    pfds[1].fd     = m_pipefd[0];
-    pfds[1].events = POLLIN;
-    int timeout    = (dtimeout < 0.0) ? -1 :
-                        static_cast<int>(1000.0 * dtimeout);
-    int remaining  =  timeout;
-    int retval     =  0;
-#else
-    struct timeval timeout;
-    struct timeval* timeoutPtr;
-    if (dtimeout < 0.0) {
-        timeoutPtr = NULL;
-    }
-    else {
-        timeout.tv_sec  = static_cast<int>(dtimeout);
-        timeout.tv_usec = static_cast<int>(1.0e+6 *
-                                (dtimeout - timeout.tv_sec));
-        timeoutPtr      = &timeout;
-    }
-
-    // initialize file descriptor sets
-    fd_set rfds;
-    FD_ZERO(&rfds);
-    FD_SET(ConnectionNumber(m_display), &rfds);
-    FD_SET(m_pipefd[0], &rfds);
-     int nfds;
-     if (ConnectionNumber(m_display) > m_pipefd[0]) {
-         nfds = ConnectionNumber(m_display) + 1;
-     }
-     else {
-         nfds = m_pipefd[0] + 1;
-     }
-#endif
-    // It's possible that the X server has queued events locally
-    // in xlib's event buffer and not pushed on to the fd. Hence we
-    // can't simply monitor the fd as we may never be woken up.
-    // ie addEvent calls flush, XFlush may not send via the fd hence
-    // there is an event waiting to be sent but we must exit the poll
-    // before it can.
-    // Instead we poll for a brief period of time (so if events
-    // queued locally in the xlib buffer can be processed)
-    // and continue doing this until timeout is reached.
-    // The human eye can notice 60hz (ansi) which is 16ms, however
-    // we want to give the cpu a chance s owe up this to 25ms
-#define TIMEOUT_DELAY 25
-
-    while (((dtimeout < 0.0) || (remaining > 0)) && getPendingCountLocked() == 0 && retval == 0) {
-#if HAVE_POLL
-    retval = poll(pfds, 2, TIMEOUT_DELAY); //16ms = 60hz, but we make it > to play nicely with the cpu
-     if (pfds[1].revents & POLLIN) {
-         ssize_t read_response = read(m_pipefd[0], buf, 15);
-        
-        // with linux automake, warnings are treated as errors by default
-        if (read_response < 0)
-        {
-            // todo: handle read response
+    // addEvent() only writes to the wakeup fd while we're waiting.  set
+    // the flag before checking for events so that either it sees the
+    // flag or we see its event.
+    clearWakeup();
+    m_waiting = true;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    // isEmpty() flushes requests to the X server and reads whatever it
+    // has sent, so an X event can't be sitting in xlib's buffer while
+    // we wait on the connection.
+    Stopwatch timer(true);
+    while (isEmpty()) {
+        double timeLeft = dtimeout;
+        if (timeLeft >= 0.0) {
+            timeLeft -= timer.getTime();
+            if (timeLeft <= 0.0) {
+                break;
+            }
         }
-
-     }
-#else
-    retval = select(nfds,
-                        SELECT_TYPE_ARG234 &rfds,
-                        SELECT_TYPE_ARG234 NULL,
-                        SELECT_TYPE_ARG234 NULL,
-                        SELECT_TYPE_ARG5   TIMEOUT_DELAY);
-    if (FD_SET(m_pipefd[0], &rfds)) {
-        read(m_pipefd[0], buf, 15);
-    }
-#endif
-        remaining-=TIMEOUT_DELAY;
+        XWindowsUtil::pollDisplay(m_display, m_wakeFd[0], timeLeft);
+        clearWakeup();
     }
 
-    {
-        // we're no longer waiting for events
-        Lock lock(&m_mutex);
-        m_waiting = false;
-    }
+    m_waiting = false;
 
     Thread::testCancel();
 }
@@ -214,69 +133,48 @@ XWindowsEventQueueBuffer::waitForEvent(double dtimeout)
 IEventQueueBuffer::Type
 XWindowsEventQueueBuffer::getEvent(Event& event, UInt32& dataID)
 {
-    Lock lock(&m_mutex);
-
-    // push out pending events
-    flush();
+    {
+        Lock lock(&m_mutex);
 
-    // get next event
-    m_impl->XNextEvent(m_display, &m_event);
+        // X events that have already been read come first so that a
+        // flood of user events can't hold them up.  only ask the server
+        // for more when there are no user events.
+        if (m_impl->XEventsQueued(m_display, QueuedAlready) > 0 ||
+            (!hasUserEvent() && m_impl->XPending(m_display) > 0)) {
+            m_impl->XNextEvent(m_display, &m_event);
+            event = Event(Event::kSystem,
+                            m_events->getSystemTarget(), &m_event);
+            return kSystem;
+        }
+    }
 
-    // process event
-    if (m_event.xany.type == ClientMessage &&
-        m_event.xclient.message_type == m_userEvent) {
-        dataID = static_cast<UInt32>(m_event.xclient.data.l[0]);
+    if (popUserEvent(dataID)) {
         return kUser;
     }
-    else {
-        event = Event(Event::kSystem,
-                            m_events->getSystemTarget(), &m_event);
-        return kSystem;
-    }
+    return kNone;
 }
 
 bool
 XWindowsEventQueueBuffer::addEvent(UInt32 dataID)
 {
-    // prepare a message
-    XEvent xevent;
-    xevent.xclient.type         = ClientMessage;
-    xevent.xclient.window       = m_window;
-    xevent.xclient.message_type = m_userEvent;
-    xevent.xclient.format       = 32;
-    xevent.xclient.data.l[0]    = static_cast<long>(dataID);
-
-    // save the message
-    Lock lock(&m_mutex);
-    m_postedEvents.push_back(xevent);
+    if (m_overflowing || !m_queue.push(dataID)) {
+        // the queue is full.  hold the event until the queue drains.
+        Lock lock(&m_overflowMutex);
+        m_overflow.push_back(dataID);
+        m_overflowing = true;
+    }
 
-    // if we're currently waiting for an event then send saved events to
-    // the X server now.  if we're not waiting then some other thread
-    // might be using the display connection so we can't safely use it
-    // too.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
     if (m_waiting) {
-        flush();
-        // Send a character through the round-trip pipe to wake a thread
-        // that is waiting for a ConnectionNumber() socket to be readable.
-        // The flush call can read incoming data from the socket and put
-        // it in Xlib's input buffer.  That sneaks it past the other thread.
-        ssize_t write_response = write(m_pipefd[1], "!", 1);
-
-        // with linux automake, warnings are treated as errors by default
-        if (write_response < 0)
-        {
-            // todo: handle read response
-        }
+        wakeup();
     }
-
     return true;
 }
 
 bool
 XWindowsEventQueueBuffer::isEmpty() const
 {
-    Lock lock(&m_mutex);
-    return (m_impl->XPending(m_display) == 0 );
+    return (!hasUserEvent() && getPendingCountLocked() == 0);
 }
 
 EventQueueTimer*
@@ -291,15 +189,49 @@ XWindowsEventQueueBuffer::deleteTimer(EventQueueTimer* timer) const
     delete timer;
 }
 
+bool
+XWindowsEventQueueBuffer::hasUserEvent() const
+{
+    return (!m_queue.empty() || m_overflowing);
+}
+
+bool
+XWindowsEventQueueBuffer::popUserEvent(UInt32& dataID)
+{
+    if (m_queue.pop(dataID)) {
+        return true;
+    }
+
+    if (m_overflowing) {
+        Lock lock(&m_overflowMutex);
+        if (!m_overflow.empty()) {
+            dataID = m_overflow.front();
+            m_overflow.pop_front();
+            m_overflowing = !m_overflow.empty();
+            return true;
+        }
+    }
+
+    return false;
+}
+
 void
-XWindowsEventQueueBuffer::flush()
+XWindowsEventQueueBuffer::wakeup()
 {
-    // note -- m_mutex must be locked on entry
+#if HAVE_SYS_EVENTFD_H
+    eventfd_t one = 1;
+    ssize_t ignore = write(m_wakeFd[1], &one, sizeof(one));
+#else
+    ssize_t ignore = write(m_wakeFd[1], "!", 1);
+#endif
+    (void)ignore;
+}
 
-    // flush the posted event list to the X server
-    for (size_t i = 0; i < m_postedEvents.size(); ++i) {
-        m_impl->XSendEvent(m_display, m_window, False, 0, &m_postedEvents[i]);
+void
+XWindowsEventQueueBuffer::clearWakeup()
+{
+    char buf[64];
+    while (read(m_wakeFd[0], buf, sizeof(buf)) == sizeof(buf)) {
+        // keep reading until a pipe is empty
     }
-    m_impl->XFlush(m_display);
-    m_postedEvents.clear();
 }
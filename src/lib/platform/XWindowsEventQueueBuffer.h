@@ -20,7 +20,8 @@
 
 #include "mt/Mutex.h"
 #include "base/IEventQueueBuffer.h"
-#include "common/stdvector.h"
+#include "base/MPSCQueue.h"
+#include "common/stddeque.h"
 #include "XWindowsImpl.h"
 
 #if X_DISPLAY_MISSING
@@ -29,9 +30,16 @@
 #    include <X11/Xlib.h>
 #endif
 
+#include <atomic>
+
 class IEventQueue;
 
 //! Event queue buffer for X11
+/*!
+User events never go through the X server.  They're queued locally and
+the event thread is woken through an eventfd (a pipe where there's no
+eventfd) that it waits on along with the X connection.
+*/
 class XWindowsEventQueueBuffer : public IEventQueueBuffer {
 public:
     XWindowsEventQueueBuffer(IXWindowsImpl* impl, Display*, Window,
@@ -49,21 +57,38 @@ public:
     virtual void        deleteTimer(EventQueueTimer*) const;
 
 private:
-    void                flush();
+    int                 getPendingCountLocked() const;
+    bool                hasUserEvent() const;
+    bool                popUserEvent(UInt32& dataID);
 
-    int getPendingCountLocked();
+    void                wakeup();
+    void                clearWakeup();
 
 private:
-    typedef std::vector<XEvent> EventList;
-     IXWindowsImpl*       m_impl;
+    typedef std::deque<UInt32> EventDeque;
+
+    static const UInt32    kQueueSize;
+
+    IXWindowsImpl*        m_impl;
 
+    // guards the display
     Mutex                m_mutex;
     Display*            m_display;
     Window                m_window;
-    Atom                m_userEvent;
     XEvent                m_event;
-    EventList            m_postedEvents;
-    bool                m_waiting;
-    int                    m_pipefd[2];
+
+    // user events.  as in SimpleEventQueueBuffer, events added while
+    // m_queue is full wait in m_overflow, guarded by m_overflowMutex.
+    MPSCQueue<UInt32>    m_queue;
+    EventDeque            m_overflow;
+    std::atomic<bool>    m_overflowing;
+    Mutex                m_overflowMutex;
+
+    // set while the event thread is blocked in waitForEvent()
+    std::atomic<bool>    m_waiting;
+
+    // read and write ends of the wakeup fd.  these are the same fd when
+    // it's an eventfd.
+    int                    m_wakeFd[2];
     IEventQueue*        m_events;
 };
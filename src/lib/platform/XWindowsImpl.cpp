@@ -469,6 +469,11 @@ int XWindowsImpl::XPending(Display* display)
     return ::XPending(display);
 }
 
+int XWindowsImpl::XEventsQueued(Display* display, int mode)
+{
+    return ::XEventsQueued(display, mode);
+}
+
 int XWindowsImpl::XPeekEvent(Display* display, XEvent* event_return)
 {
     return ::XPeekEvent(display, event_return);
@@ -490,6 +495,17 @@ int XWindowsImpl::XISelectEvents(Display* display, Window w, XIEventMask* masks,
     return ::XISelectEvents(display, w, masks, num_masks);
 }
 
+XIDeviceInfo* XWindowsImpl::XIQueryDevice(Display* display, int deviceid,
+                                          int* ndevices_return)
+{
+    return ::XIQueryDevice(display, deviceid, ndevices_return);
+}
+
+void XWindowsImpl::XIFreeDeviceInfo(XIDeviceInfo* info)
+{
+    ::XIFreeDeviceInfo(info);
+}
+
 Atom XWindowsImpl::XInternAtom(Display* display, _Xconst char* atom_name,
                                Bool only_if_exists)
 {
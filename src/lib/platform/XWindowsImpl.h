@@ -142,11 +142,15 @@ public:
                              Window confine_to, Cursor cursor, Time time);
     virtual int XUngrabKeyboard(Display* display, Time time);
     virtual int XPending(Display* display);
+    virtual int XEventsQueued(Display* display, int mode);
     virtual int XPeekEvent(Display* display, XEvent* event_return);
     virtual Status XkbRefreshKeyboardMapping(XkbMapNotifyEvent* event);
     virtual int XRefreshKeyboardMapping(XMappingEvent* event_map);
     virtual int XISelectEvents(Display* display, Window w, XIEventMask* masks,
                                int num_masks);
+    virtual XIDeviceInfo* XIQueryDevice(Display* display, int deviceid,
+                                        int* ndevices_return);
+    virtual void XIFreeDeviceInfo(XIDeviceInfo* info);
     virtual Atom XInternAtom(Display* display, _Xconst char* atom_name,
                              Bool only_if_exists);
     virtual int XGetScreenSaver(Display* display, int* timeout_return,
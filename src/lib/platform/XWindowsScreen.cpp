@@ -88,6 +88,8 @@ XWindowsScreen::XWindowsScreen(
 	m_preserveFocus(false),
 	m_xkb(false),
 	m_xi2detected(false),
+	m_queryPointer(false),
+	m_xiRawMotion(false),
 	m_xrandr(false),
 	m_events(events),
 	PlatformScreen(events)
@@ -292,6 +294,12 @@ XWindowsScreen::enter()
 
 	// now on screen
 	m_isOnScreen = true;
+	m_xiRawMotion = false;
+	m_motion.reset();
+	if (m_isPrimary) {
+		LOG((CLOG_DEBUG1 "pointer motion so far: %u events sent as %u",
+			m_motion.getEventsIn(), m_motion.getEventsOut()));
+	}
 }
 
 bool
@@ -345,8 +353,12 @@ XWindowsScreen::leave()
 		m_filtered.clear();
 	}
 
-	// now off screen
+	// now off screen.  forget what we know about devices in case one
+	// has been replaced.
 	m_isOnScreen = false;
+	m_xiRawMotion = false;
+	m_xiRelativeDevices.clear();
+	m_motion.reset();
 
 	return true;
 }
@@ -1216,38 +1228,11 @@ XWindowsScreen::handleSystemEvent(const Event& event, void*)
 		return;
 	}
 
-#ifdef HAVE_XI2
-	if (m_xi2detected) {
-		// Process RawMotion
-		XGenericEventCookie *cookie = (XGenericEventCookie*)&xevent->xcookie;
-            if (m_impl->XGetEventData(m_display, cookie) &&
-				cookie->type == GenericEvent &&
-				cookie->extension == xi_opcode) {
-			if (cookie->evtype == XI_RawMotion) {
-				// Get current pointer's position
-				Window root, child;
-				XMotionEvent xmotion;
-				xmotion.type = MotionNotify;
-				xmotion.send_event = False; // Raw motion
-				xmotion.display = m_display;
-				xmotion.window = m_window;
-				/* xmotion's time, state and is_hint are not used */
-				unsigned int msk;
-                    xmotion.same_screen = m_impl->XQueryPointer(
-						m_display, m_root, &xmotion.root, &xmotion.subwindow,
-						&xmotion.x_root,
-						&xmotion.y_root,
-						&xmotion.x,
-						&xmotion.y,
-						&msk);
-					onMouseMove(xmotion);
-                    m_impl->XFreeEventData(m_display, cookie);
-					return;
-			}
-                m_impl->XFreeEventData(m_display, cookie);
-		}
+	// pointer motion, core or XI2 raw
+	if (isMotionEvent(*xevent)) {
+		onMotion(*xevent);
+		return;
 	}
-#endif
 
 	// handle the event ourself
 	switch (xevent->type) {
@@ -1555,35 +1540,48 @@ XWindowsScreen::onMouseRelease(const XButtonEvent& xbutton)
 void
 XWindowsScreen::onMouseMove(const XMotionEvent& xmotion)
 {
+	if (!xmotion.send_event) {
+		onMouseMove(xmotion.x_root, xmotion.y_root);
+		return;
+	}
+
 	LOG((CLOG_DEBUG2 "event: MotionNotify %d,%d", xmotion.x_root, xmotion.y_root));
 
+	// save position to compute delta of next motion
+	m_xCursor = xmotion.x_root;
+	m_yCursor = xmotion.y_root;
+
+	// we warped the mouse.  discard events until we
+	// find the matching sent event.  see
+	// warpCursorNoFlush() for where the events are
+	// sent.  we discard the matching sent event and
+	// can be sure we've skipped the warp event.
+	XEvent xevent;
+	char cntr = 0;
+	do {
+        m_impl->XMaskEvent(m_display, PointerMotionMask, &xevent);
+		if (cntr++ > 10) {
+			LOG((CLOG_WARN "too many discarded events! %d", cntr));
+			break;
+		}
+	} while (!xevent.xany.send_event);
+}
+
+void
+XWindowsScreen::onMouseMove(SInt32 xRoot, SInt32 yRoot)
+{
+	LOG((CLOG_DEBUG2 "event: MotionNotify %d,%d", xRoot, yRoot));
+
 	// compute motion delta (relative to the last known
 	// mouse position)
-	SInt32 x = xmotion.x_root - m_xCursor;
-	SInt32 y = xmotion.y_root - m_yCursor;
+	SInt32 x = xRoot - m_xCursor;
+	SInt32 y = yRoot - m_yCursor;
 
 	// save position to compute delta of next motion
-	m_xCursor = xmotion.x_root;
-	m_yCursor = xmotion.y_root;
+	m_xCursor = xRoot;
+	m_yCursor = yRoot;
 
-	if (xmotion.send_event) {
-		// we warped the mouse.  discard events until we
-		// find the matching sent event.  see
-		// warpCursorNoFlush() for where the events are
-		// sent.  we discard the matching sent event and
-		// can be sure we've skipped the warp event.
-		XEvent xevent;
-		char cntr = 0;
-		do {
-            m_impl->XMaskEvent(m_display, PointerMotionMask, &xevent);
-			if (cntr++ > 10) {
-				LOG((CLOG_WARN "too many discarded events! %d", cntr));
-				break;
-			}
-		} while (!xevent.xany.send_event);
-		cntr = 0;
-	}
-	else if (m_isOnScreen) {
+	if (m_isOnScreen) {
 		// motion on primary screen
 		sendEvent(m_events->forIPrimaryScreen().motionOnPrimary(),
 							MotionInfo::alloc(m_xCursor, m_yCursor));
@@ -1602,10 +1600,10 @@ XWindowsScreen::onMouseMove(const XMotionEvent& xmotion)
 		// it we only warp when the mouse has moved more
 		// than s_size pixels from the center.
 		static const SInt32 s_size = 32;
-		if (xmotion.x_root - m_xCenter < -s_size ||
-			xmotion.x_root - m_xCenter >  s_size ||
-			xmotion.y_root - m_yCenter < -s_size ||
-			xmotion.y_root - m_yCenter >  s_size) {
+		if (xRoot - m_xCenter < -s_size ||
+			xRoot - m_xCenter >  s_size ||
+			yRoot - m_yCenter < -s_size ||
+			yRoot - m_yCenter >  s_size) {
 			warpCursorNoFlush(m_xCenter, m_yCenter);
 		}
 
@@ -1621,6 +1619,161 @@ XWindowsScreen::onMouseMove(const XMotionEvent& xmotion)
 	}
 }
 
+bool
+XWindowsScreen::isMotionEvent(const XEvent& xevent) const
+{
+	if (!m_isPrimary) {
+		return false;
+	}
+	if (xevent.type == MotionNotify) {
+		// sent events mark warps and need handling on their own
+		return !xevent.xmotion.send_event;
+	}
+#ifdef HAVE_XI2
+	if (m_xi2detected && xevent.type == GenericEvent) {
+		return (xevent.xcookie.extension == xi_opcode &&
+				xevent.xcookie.evtype == XI_RawMotion);
+	}
+#endif
+	return false;
+}
+
+void
+XWindowsScreen::onMotion(XEvent& xevent)
+{
+	// a fast mouse can send a thousand motion events a second and
+	// more than one may have arrived since we last looked.  take all
+	// the motion that's waiting, stopping at any other event to keep
+	// motion in order with buttons and keys, and report it once.
+	addMotion(xevent);
+	XEvent next;
+    while (m_impl->XEventsQueued(m_display, QueuedAfterReading) > 0) {
+        m_impl->XPeekEvent(m_display, &next);
+		if (!isMotionEvent(next)) {
+			break;
+		}
+        m_impl->XNextEvent(m_display, &next);
+		addMotion(next);
+	}
+	flushMotion();
+}
+
+void
+XWindowsScreen::addMotion(XEvent& xevent)
+{
+#ifdef HAVE_XI2
+	if (xevent.type == GenericEvent) {
+		XGenericEventCookie* cookie = &xevent.xcookie;
+        if (m_impl->XGetEventData(m_display, cookie)) {
+			addRawMotion(static_cast<const XIRawEvent*>(cookie->data));
+            m_impl->XFreeEventData(m_display, cookie);
+		}
+		return;
+	}
+#endif
+
+	if (!m_isOnScreen && m_xiRawMotion) {
+		// raw motion is already moving the pointer on the other screen
+		m_xCursor = xevent.xmotion.x_root;
+		m_yCursor = xevent.xmotion.y_root;
+		return;
+	}
+	m_motion.addPosition(xevent.xmotion.x_root, xevent.xmotion.y_root);
+}
+
+void
+XWindowsScreen::flushMotion()
+{
+	SInt32 x, y;
+	if (m_motion.takePosition(x, y)) {
+		if (m_queryPointer) {
+			Window root, child;
+			int xRoot, yRoot, xWindow, yWindow;
+			unsigned int mask;
+            if (m_impl->XQueryPointer(m_display, m_root, &root, &child,
+								&xRoot, &yRoot, &xWindow, &yWindow, &mask)) {
+				x = xRoot;
+				y = yRoot;
+			}
+			m_queryPointer = false;
+		}
+		onMouseMove(x, y);
+	}
+
+	if (m_motion.takeDelta(x, y)) {
+		LOG((CLOG_DEBUG2 "event: RawMotion %+d,%+d", x, y));
+		sendEvent(m_events->forIPrimaryScreen().motionOnSecondary(), MotionInfo::alloc(x, y));
+	}
+}
+
+#ifdef HAVE_XI2
+void
+XWindowsScreen::addRawMotion(const XIRawEvent* raw)
+{
+	if (m_isOnScreen) {
+		// look up where the pointer is once the burst is over
+		m_motion.addPosition(m_xCursor, m_yCursor);
+		m_queryPointer = true;
+		return;
+	}
+
+	if (!isRelativeDevice(raw->sourceid)) {
+		// tablets and the like report positions, not motion.  leave
+		// them to core motion events.
+		m_xiRawMotion = false;
+		return;
+	}
+
+	// raw motion isn't stopped by the edge of the screen so there's
+	// no need to keep warping the pointer back to the center.  the
+	// values are packed:  one for each valuator set in the mask.
+	// valuators 0 and 1 are x and y.
+	double delta[2] = { 0.0, 0.0 };
+	const double* value = raw->valuators.values;
+	for (int i = 0; i < 2 && i < 8 * raw->valuators.mask_len; ++i) {
+		if (XIMaskIsSet(raw->valuators.mask, i)) {
+			delta[i] = *value++;
+		}
+	}
+	m_motion.addDelta(delta[0], delta[1]);
+	m_xiRawMotion = true;
+}
+
+bool
+XWindowsScreen::isRelativeDevice(int deviceid)
+{
+	std::map<int, bool>::const_iterator index =
+		m_xiRelativeDevices.find(deviceid);
+	if (index != m_xiRelativeDevices.end()) {
+		return index->second;
+	}
+
+	// relative if both x and y are
+	int relativeAxes = 0;
+	int count;
+    XIDeviceInfo* info = m_impl->XIQueryDevice(m_display, deviceid, &count);
+	if (info != NULL) {
+		for (int i = 0; i < info->num_classes; ++i) {
+			if (info->classes[i]->type != XIValuatorClass) {
+				continue;
+			}
+			const XIValuatorClassInfo* valuator =
+				reinterpret_cast<const XIValuatorClassInfo*>(info->classes[i]);
+			if ((valuator->number == 0 || valuator->number == 1) &&
+				valuator->mode == XIModeRelative) {
+				++relativeAxes;
+			}
+		}
+        m_impl->XIFreeDeviceInfo(info);
+	}
+
+	bool relative = (relativeAxes == 2);
+	LOG((CLOG_DEBUG1 "XI2 device %d reports %s motion", deviceid, relative ? "relative" : "absolute"));
+	m_xiRelativeDevices[deviceid] = relative;
+	return relative;
+}
+#endif
+
 int
 XWindowsScreen::x_accumulateMouseScroll(SInt32 xDelta) const
 {
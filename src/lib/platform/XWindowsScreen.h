@@ -20,6 +20,8 @@
 
 #include "barrier/PlatformScreen.h"
 #include "barrier/KeyMap.h"
+#include "barrier/MotionCoalescer.h"
+#include "common/stdmap.h"
 #include "common/stdset.h"
 #include "common/stdvector.h"
 #include "XWindowsImpl.h"
@@ -136,6 +138,18 @@ private:
     void                onMousePress(const XButtonEvent&);
     void                onMouseRelease(const XButtonEvent&);
     void                onMouseMove(const XMotionEvent&);
+    void                onMouseMove(SInt32 x, SInt32 y);
+
+    // pointer motion.  onMotion() handles a motion event along with any
+    // more that have already arrived, and reports them as one.
+    bool                isMotionEvent(const XEvent&) const;
+    void                onMotion(XEvent&);
+    void                addMotion(XEvent&);
+    void                flushMotion();
+#ifdef HAVE_XI2
+    void                addRawMotion(const XIRawEvent*);
+    bool                isRelativeDevice(int deviceid);
+#endif
 
     // Returns the number of scroll events needed after the current delta has
     // been taken into account
@@ -255,6 +269,21 @@ private:
 
     bool                m_xi2detected;
 
+    // pointer motion collected from a burst of motion events
+    MotionCoalescer        m_motion;
+
+    // true if the pointer position must be looked up for the motion
+    // collected.  XI2 raw events don't say where the pointer is.
+    bool                m_queryPointer;
+
+    // true while off screen if XI2 raw motion from a relative device
+    // is moving the pointer on the other screen.  core motion is then
+    // ignored and the pointer isn't warped back to the center.
+    bool                m_xiRawMotion;
+
+    // whether each XI2 device reports relative motion
+    std::map<int, bool>    m_xiRelativeDevices;
+
     // XRandR extension stuff
     bool                m_xrandr;
     int                 m_xrandrEventBase;
@@ -23,6 +23,21 @@
 #include "base/Log.h"
 #include "base/String.h"
 
+#include <algorithm>
+#include <cmath>
+#if HAVE_POLL
+#    include <poll.h>
+#else
+#    if HAVE_SYS_SELECT_H
+#        include <sys/select.h>
+#    endif
+#    if HAVE_SYS_TIME_H
+#        include <sys/time.h>
+#    endif
+#    if HAVE_SYS_TYPES_H
+#        include <sys/types.h>
+#    endif
+#endif
 #include <X11/Xatom.h>
 #define XK_APL
 #define XK_ARABIC
@@ -1465,6 +1480,62 @@ XWindowsUtil::getCurrentTime(Display* display, Window window)
     return xevent.xproperty.time;
 }
 
+bool
+XWindowsUtil::waitForEvent(Display* display, double dtimeout)
+{
+    // events Xlib has already read don't show up on the connection
+    if (XEventsQueued(display, QueuedAfterFlush) > 0) {
+        return true;
+    }
+
+    pollDisplay(display, -1, dtimeout);
+
+    // readable doesn't mean a whole event arrived
+    return (XEventsQueued(display, QueuedAfterReading) > 0);
+}
+
+void
+XWindowsUtil::pollDisplay(Display* display, int fd, double dtimeout)
+{
+    // round the timeout up so we don't spin just short of it
+#if HAVE_POLL
+    struct pollfd pfds[2];
+    pfds[0].fd     = ConnectionNumber(display);
+    pfds[0].events = POLLIN;
+    pfds[1].fd     = fd;
+    pfds[1].events = POLLIN;
+    int timeout    = (dtimeout < 0.0) ? -1 :
+                        static_cast<int>(std::ceil(1000.0 * dtimeout));
+    poll(pfds, (fd == -1) ? 1 : 2, timeout);
+#else
+    struct timeval timeout;
+    struct timeval* timeoutPtr;
+    if (dtimeout < 0.0) {
+        timeoutPtr = NULL;
+    }
+    else {
+        timeout.tv_sec  = static_cast<int>(dtimeout);
+        timeout.tv_usec = static_cast<int>(std::ceil(1.0e+6 *
+                                (dtimeout - timeout.tv_sec)));
+        timeoutPtr      = &timeout;
+    }
+
+    fd_set rfds;
+    FD_ZERO(&rfds);
+    FD_SET(ConnectionNumber(display), &rfds);
+    int nfds = ConnectionNumber(display) + 1;
+    if (fd != -1) {
+        FD_SET(fd, &rfds);
+        nfds = std::max(nfds, fd + 1);
+    }
+    select(nfds,
+                        SELECT_TYPE_ARG234 &rfds,
+                        SELECT_TYPE_ARG234 NULL,
+                        SELECT_TYPE_ARG234 NULL,
+                        SELECT_TYPE_ARG5   timeoutPtr);
+#endif
+}
+
 KeyID
 XWindowsUtil::mapKeySymToKeyID(KeySym k)
 {
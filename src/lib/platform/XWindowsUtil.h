@@ -63,6 +63,23 @@ public:
     */
     static Time            getCurrentTime(Display*, Window);
 
+    //! Wait for an event
+    /*!
+    Waits up to \c timeout seconds for the X server to send something
+    on \c display's connection without spinning or sleeping.  Returns
+    true if there's an event to read, false on timeout.
+    */
+    static bool            waitForEvent(Display*, double timeout);
+
+    //! Wait for the X server or a file descriptor
+    /*!
+    Waits up to \c timeout seconds for \c display's connection or \c fd
+    to become readable.  A negative \c timeout waits forever and an
+    \c fd of -1 is ignored.  Data on the connection may be less than a
+    whole event.
+    */
+    static void            pollDisplay(Display*, int fd, double timeout);
+
     //! Convert KeySym to KeyID
     /*!
     Converts a KeySym to the equivalent KeyID.  Returns kKeyNone if the
@@ -18,15 +18,13 @@
 
 #include "server/ClientProxy1_0.h"
 
-#include "barrier/ProtocolUtil.h"
+#include "barrier/ProtocolMessage.h"
 #include "barrier/XBarrier.h"
 #include "io/IStream.h"
 #include "base/Log.h"
 #include "base/IEventQueue.h"
 #include "base/TMethodEventJob.h"
 
-#include <cstring>
-
 //
 // ClientProxy1_0
 //
@@ -62,7 +60,7 @@ ClientProxy1_0::ClientProxy1_0(const std::string& name, barrier::IStream* stream
     setHeartbeatRate(kHeartRate, kHeartRate * kHeartBeatsUntilDeath);
 
     LOG((CLOG_DEBUG1 "querying client \"%s\" info", getName().c_str()));
-    ProtocolUtil::writef(getStream(), kMsgQInfo);
+    MsgQInfo::write(getStream());
 }
 
 ClientProxy1_0::~ClientProxy1_0()
@@ -116,9 +114,15 @@ ClientProxy1_0::removeHeartbeatTimer()
 void
 ClientProxy1_0::resetHeartbeatTimer()
 {
-    // reset the alarm
-    removeHeartbeatTimer();
-    addHeartbeatTimer();
+    // reset the alarm.  this happens for every batch of messages so
+    // push back the existing timer rather than replacing it.  only the
+    // alarm is (re)started here, not anything a subclass adds.
+    if (m_heartbeatTimer != NULL) {
+        m_events->touchTimer(m_heartbeatTimer);
+    }
+    else {
+        ClientProxy1_0::addHeartbeatTimer();
+    }
 }
 
 void
@@ -149,7 +153,7 @@ ClientProxy1_0::handleData(const Event&, void*)
 
         // parse message
         LOG((CLOG_DEBUG2 "msg from \"%s\": %c%c%c%c", getName().c_str(), code[0], code[1], code[2], code[3]));
-        if (!(this->*m_parser)(code)) {
+        if (!(this->*m_parser)(toMessageCode(code))) {
             LOG((CLOG_ERR "invalid message from client \"%s\": %c%c%c%c", getName().c_str(), code[0], code[1], code[2], code[3]));
             disconnect();
             return;
@@ -164,14 +168,15 @@ ClientProxy1_0::handleData(const Event&, void*)
 }
 
 bool
-ClientProxy1_0::parseHandshakeMessage(const UInt8* code)
+ClientProxy1_0::parseHandshakeMessage(UInt32 code)
 {
-    if (memcmp(code, kMsgCNoop, 4) == 0) {
+    switch (code) {
+    case kMsgCodeCNoop:
         // discard no-ops
         LOG((CLOG_DEBUG2 "no-op from", getName().c_str()));
         return true;
-    }
-    else if (memcmp(code, kMsgDInfo, 4) == 0) {
+
+    case kMsgCodeDInfo:
         // future messages get parsed by parseMessage
         m_parser = &ClientProxy1_0::parseMessage;
         if (recvInfo()) {
@@ -179,33 +184,39 @@ ClientProxy1_0::parseHandshakeMessage(const UInt8* code)
             addHeartbeatTimer();
             return true;
         }
+        return false;
+
+    default:
+        return false;
     }
-    return false;
 }
 
 bool
-ClientProxy1_0::parseMessage(const UInt8* code)
+ClientProxy1_0::parseMessage(UInt32 code)
 {
-    if (memcmp(code, kMsgDInfo, 4) == 0) {
+    switch (code) {
+    case kMsgCodeDInfo:
         if (recvInfo()) {
             m_events->addEvent(
                             Event(m_events->forIScreen().shapeChanged(), getEventTarget()));
             return true;
         }
         return false;
-    }
-    else if (memcmp(code, kMsgCNoop, 4) == 0) {
+
+    case kMsgCodeCNoop:
         // discard no-ops
         LOG((CLOG_DEBUG2 "no-op from", getName().c_str()));
         return true;
-    }
-    else if (memcmp(code, kMsgCClipboard, 4) == 0) {
+
+    case kMsgCodeCClipboard:
         return recvGrabClipboard();
-    }
-    else if (memcmp(code, kMsgDClipboard, 4) == 0) {
+
+    case kMsgCodeDClipboard:
         return recvClipboard();
+
+    default:
+        return false;
     }
-    return false;
 }
 
 void
@@ -259,7 +270,7 @@ ClientProxy1_0::enter(SInt32 xAbs, SInt32 yAbs,
                 UInt32 seqNum, KeyModifierMask mask, bool)
 {
     LOG((CLOG_DEBUG1 "send enter to \"%s\", %d,%d %d %04x", getName().c_str(), xAbs, yAbs, seqNum, mask));
-    ProtocolUtil::writef(getStream(), kMsgCEnter,
+    MsgCEnter::write(getStream(),
                                 xAbs, yAbs, seqNum, mask);
 }
 
@@ -267,7 +278,7 @@ bool
 ClientProxy1_0::leave()
 {
     LOG((CLOG_DEBUG1 "send leave to \"%s\"", getName().c_str()));
-    ProtocolUtil::writef(getStream(), kMsgCLeave);
+    MsgCLeave::write(getStream());
 
     // we can never prevent the user from leaving
     return true;
@@ -283,7 +294,7 @@ void
 ClientProxy1_0::grabClipboard(ClipboardID id)
 {
     LOG((CLOG_DEBUG "send grab clipboard %d to \"%s\"", id, getName().c_str()));
-    ProtocolUtil::writef(getStream(), kMsgCClipboard, id, 0);
+    MsgCClipboard::write(getStream(), id, 0);
 
     // this clipboard is now dirty
     m_clipboard[id].m_dirty = true;
@@ -299,7 +310,7 @@ void
 ClientProxy1_0::keyDown(KeyID key, KeyModifierMask mask, KeyButton)
 {
     LOG((CLOG_DEBUG1 "send key down to \"%s\" id=%d, mask=0x%04x", getName().c_str(), key, mask));
-    ProtocolUtil::writef(getStream(), kMsgDKeyDown1_0, key, mask);
+    MsgDKeyDown1_0::write(getStream(), key, mask);
 }
 
 void
@@ -307,35 +318,35 @@ ClientProxy1_0::keyRepeat(KeyID key, KeyModifierMask mask,
                 SInt32 count, KeyButton)
 {
     LOG((CLOG_DEBUG1 "send key repeat to \"%s\" id=%d, mask=0x%04x, count=%d", getName().c_str(), key, mask, count));
-    ProtocolUtil::writef(getStream(), kMsgDKeyRepeat1_0, key, mask, count);
+    MsgDKeyRepeat1_0::write(getStream(), key, mask, count);
 }
 
 void
 ClientProxy1_0::keyUp(KeyID key, KeyModifierMask mask, KeyButton)
 {
     LOG((CLOG_DEBUG1 "send key up to \"%s\" id=%d, mask=0x%04x", getName().c_str(), key, mask));
-    ProtocolUtil::writef(getStream(), kMsgDKeyUp1_0, key, mask);
+    MsgDKeyUp1_0::write(getStream(), key, mask);
 }
 
 void
 ClientProxy1_0::mouseDown(ButtonID button)
 {
     LOG((CLOG_DEBUG1 "send mouse down to \"%s\" id=%d", getName().c_str(), button));
-    ProtocolUtil::writef(getStream(), kMsgDMouseDown, button);
+    MsgDMouseDown::write(getStream(), button);
 }
 
 void
 ClientProxy1_0::mouseUp(ButtonID button)
 {
     LOG((CLOG_DEBUG1 "send mouse up to \"%s\" id=%d", getName().c_str(), button));
-    ProtocolUtil::writef(getStream(), kMsgDMouseUp, button);
+    MsgDMouseUp::write(getStream(), button);
 }
 
 void
 ClientProxy1_0::mouseMove(SInt32 xAbs, SInt32 yAbs)
 {
     LOG((CLOG_DEBUG2 "send mouse move to \"%s\" %d,%d", getName().c_str(), xAbs, yAbs));
-    ProtocolUtil::writef(getStream(), kMsgDMouseMove, xAbs, yAbs);
+    MsgDMouseMove::write(getStream(), xAbs, yAbs);
 }
 
 void
@@ -349,7 +360,7 @@ ClientProxy1_0::mouseWheel(SInt32, SInt32 yDelta)
 {
     // clients prior to 1.3 only support the y axis
     LOG((CLOG_DEBUG2 "send mouse wheel to \"%s\" %+d", getName().c_str(), yDelta));
-    ProtocolUtil::writef(getStream(), kMsgDMouseWheel1_0, yDelta);
+    MsgDMouseWheel1_0::write(getStream(), yDelta);
 }
 
 void
@@ -370,14 +381,14 @@ void
 ClientProxy1_0::screensaver(bool on)
 {
     LOG((CLOG_DEBUG1 "send screen saver to \"%s\" on=%d", getName().c_str(), on ? 1 : 0));
-    ProtocolUtil::writef(getStream(), kMsgCScreenSaver, on ? 1 : 0);
+    MsgCScreenSaver::write(getStream(), on ? 1 : 0);
 }
 
 void
 ClientProxy1_0::resetOptions()
 {
     LOG((CLOG_DEBUG1 "send reset options to \"%s\"", getName().c_str()));
-    ProtocolUtil::writef(getStream(), kMsgCResetOptions);
+    MsgCResetOptions::write(getStream());
 
     // reset heart rate and death
     resetHeartbeatRate();
@@ -389,7 +400,7 @@ void
 ClientProxy1_0::setOptions(const OptionsList& options)
 {
     LOG((CLOG_DEBUG1 "send set options to \"%s\" size=%d", getName().c_str(), options.size()));
-    ProtocolUtil::writef(getStream(), kMsgDSetOptions, &options);
+    MsgDSetOptions::write(getStream(), options);
 
     // check options
     for (UInt32 i = 0, n = (UInt32)options.size(); i < n; i += 2) {
@@ -410,7 +421,7 @@ ClientProxy1_0::recvInfo()
 {
     // parse the message
     SInt16 x, y, w, h, dummy1, mx, my;
-    if (!ProtocolUtil::readf(getStream(), kMsgDInfo + 4,
+    if (!MsgDInfo::read(getStream(),
                             &x, &y, &w, &h, &dummy1, &mx, &my)) {
         return false;
     }
@@ -435,7 +446,7 @@ ClientProxy1_0::recvInfo()
 
     // acknowledge receipt
     LOG((CLOG_DEBUG1 "send info ack to \"%s\"", getName().c_str()));
-    ProtocolUtil::writef(getStream(), kMsgCInfoAck);
+    MsgCInfoAck::write(getStream());
     return true;
 }
 
@@ -452,7 +463,7 @@ ClientProxy1_0::recvGrabClipboard()
     // parse message
     ClipboardID id;
     UInt32 seqNum;
-    if (!ProtocolUtil::readf(getStream(), kMsgCClipboard + 4, &id, &seqNum)) {
+    if (!MsgCClipboard::read(getStream(), &id, &seqNum)) {
         return false;
     }
     LOG((CLOG_DEBUG "received client \"%s\" grabbed clipboard %d seqnum=%d", getName().c_str(), id, seqNum));
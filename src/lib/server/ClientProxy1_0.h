@@ -62,8 +62,8 @@ public:
     virtual void        fileChunkSending(UInt8 mark, char* data, size_t dataSize);
 
 protected:
-    virtual bool        parseHandshakeMessage(const UInt8* code);
-    virtual bool        parseMessage(const UInt8* code);
+    virtual bool        parseHandshakeMessage(UInt32 code);
+    virtual bool        parseMessage(UInt32 code);
 
     virtual void        resetHeartbeatRate();
     virtual void        setHeartbeatRate(double rate, double alarm);
@@ -97,7 +97,7 @@ protected:
     ClientClipboard    m_clipboard[kClipboardEnd];
 
 private:
-    typedef bool (ClientProxy1_0::*MessageParser)(const UInt8*);
+    typedef bool (ClientProxy1_0::*MessageParser)(UInt32);
 
     ClientInfo            m_info;
     double                m_heartbeatAlarm;
@@ -18,7 +18,7 @@
 
 #include "server/ClientProxy1_2.h"
 
-#include "barrier/ProtocolUtil.h"
+#include "barrier/ProtocolMessage.h"
 #include "base/Log.h"
 
 //
@@ -41,5 +41,5 @@ void
 ClientProxy1_2::mouseRelativeMove(SInt32 xRel, SInt32 yRel)
 {
     LOG((CLOG_DEBUG2 "send mouse relative move to \"%s\" %d,%d", getName().c_str(), xRel, yRel));
-    ProtocolUtil::writef(getStream(), kMsgDMouseRelMove, xRel, yRel);
+    MsgDMouseRelMove::write(getStream(), xRel, yRel);
 }
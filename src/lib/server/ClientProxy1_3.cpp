@@ -18,12 +18,11 @@
 
 #include "server/ClientProxy1_3.h"
 
-#include "barrier/ProtocolUtil.h"
+#include "barrier/ProtocolMessage.h"
 #include "base/Log.h"
 #include "base/IEventQueue.h"
 #include "base/TMethodEventJob.h"
 
-#include <cstring>
 #include <memory>
 
 //
@@ -50,19 +49,20 @@ void
 ClientProxy1_3::mouseWheel(SInt32 xDelta, SInt32 yDelta)
 {
     LOG((CLOG_DEBUG2 "send mouse wheel to \"%s\" %+d,%+d", getName().c_str(), xDelta, yDelta));
-    ProtocolUtil::writef(getStream(), kMsgDMouseWheel, xDelta, yDelta);
+    MsgDMouseWheel::write(getStream(), xDelta, yDelta);
 }
 
 bool
-ClientProxy1_3::parseMessage(const UInt8* code)
+ClientProxy1_3::parseMessage(UInt32 code)
 {
     // process message
-    if (memcmp(code, kMsgCKeepAlive, 4) == 0) {
+    switch (code) {
+    case kMsgCodeCKeepAlive:
         // reset alarm
         resetHeartbeatTimer();
         return true;
-    }
-    else {
+
+    default:
         return ClientProxy1_2::parseMessage(code);
     }
 }
@@ -84,8 +84,7 @@ void
 ClientProxy1_3::resetHeartbeatTimer()
 {
     // reset the alarm but not the keep alive timer
-    ClientProxy1_2::removeHeartbeatTimer();
-    ClientProxy1_2::addHeartbeatTimer();
+    ClientProxy1_2::resetHeartbeatTimer();
 }
 
 void
@@ -126,5 +125,5 @@ ClientProxy1_3::handleKeepAlive(const Event&, void*)
 void
 ClientProxy1_3::keepAlive()
 {
-    ProtocolUtil::writef(getStream(), kMsgCKeepAlive);
+    MsgCKeepAlive::write(getStream());
 }
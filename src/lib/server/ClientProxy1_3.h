@@ -33,7 +33,7 @@ public:
 
 protected:
     // ClientProxy overrides
-    virtual bool        parseMessage(const UInt8* code);
+    virtual bool        parseMessage(UInt32 code);
     virtual void        resetHeartbeatRate();
     virtual void        setHeartbeatRate(double rate, double alarm);
     virtual void        resetHeartbeatTimer();
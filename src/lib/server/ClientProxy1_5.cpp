@@ -20,7 +20,7 @@
 #include "server/Server.h"
 #include "barrier/FileChunk.h"
 #include "barrier/StreamChunker.h"
-#include "barrier/ProtocolUtil.h"
+#include "barrier/ProtocolMessage.h"
 #include "io/IStream.h"
 #include "base/TMethodEventJob.h"
 #include "base/Log.h"
@@ -53,7 +53,7 @@ ClientProxy1_5::sendDragInfo(UInt32 fileCount, const char* info, size_t size)
 {
     std::string data(info, size);
 
-    ProtocolUtil::writef(getStream(), kMsgDDragInfo, fileCount, &data);
+    MsgDDragInfo::write(getStream(), fileCount, data);
 }
 
 void
@@ -63,15 +63,18 @@ ClientProxy1_5::fileChunkSending(UInt8 mark, char* data, size_t dataSize)
 }
 
 bool
-ClientProxy1_5::parseMessage(const UInt8* code)
+ClientProxy1_5::parseMessage(UInt32 code)
 {
-    if (memcmp(code, kMsgDFileTransfer, 4) == 0) {
+    switch (code) {
+    case kMsgCodeDFileTransfer:
         fileChunkReceived();
-    }
-    else if (memcmp(code, kMsgDDragInfo, 4) == 0) {
+        break;
+
+    case kMsgCodeDDragInfo:
         dragInfoReceived();
-    }
-    else {
+        break;
+
+    default:
         return ClientProxy1_4::parseMessage(code);
     }
 
@@ -82,11 +85,7 @@ void
 ClientProxy1_5::fileChunkReceived()
 {
     Server* server = getServer();
-    int result = FileChunk::assemble(
-                    getStream(),
-                    server->getReceivedFileData(),
-                    server->getExpectedFileSize());
-    
+    int result = server->getFileReceiver().read(getStream());
 
     if (result == kFinish) {
         m_events->addEvent(Event(m_events->forFile().fileRecieveCompleted(), server));
@@ -103,9 +102,9 @@ void
 ClientProxy1_5::dragInfoReceived()
 {
     // parse
-    UInt32 fileNum = 0;
+    UInt16 fileNum = 0;
     std::string content;
-    ProtocolUtil::readf(getStream(), kMsgDDragInfo + 4, &fileNum, &content);
+    MsgDDragInfo::read(getStream(), &fileNum, &content);
     
     m_server->dragInfoReceived(fileNum, content);
 }
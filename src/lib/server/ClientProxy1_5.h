@@ -33,7 +33,7 @@ public:
 
     virtual void        sendDragInfo(UInt32 fileCount, const char* info, size_t size);
     virtual void        fileChunkSending(UInt8 mark, char* data, size_t dataSize);
-    virtual bool        parseMessage(const UInt8* code);
+    virtual bool        parseMessage(UInt32 code);
     void                fileChunkReceived();
     void                dragInfoReceived();
 
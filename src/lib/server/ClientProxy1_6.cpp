@@ -19,10 +19,7 @@
 
 #include "server/Server.h"
 #include "barrier/ProtocolUtil.h"
-#include "barrier/StreamChunker.h"
-#include "barrier/ClipboardChunk.h"
 #include "io/IStream.h"
-#include "base/TMethodEventJob.h"
 #include "base/Log.h"
 
 //
@@ -32,12 +29,9 @@
 ClientProxy1_6::ClientProxy1_6(const std::string& name, barrier::IStream* stream, Server* server,
                                IEventQueue* events) :
     ClientProxy1_5(name, stream, server, events),
-    m_events(events)
+    m_events(events),
+    m_clipboardSender(stream, events)
 {
-    m_events->adoptHandler(m_events->forClipboard().clipboardSending(),
-                                this,
-                                new TMethodEventJob<ClientProxy1_6>(this,
-                                    &ClientProxy1_6::handleClipboardSendingEvent));
 }
 
 ClientProxy1_6::~ClientProxy1_6()
@@ -53,40 +47,33 @@ ClientProxy1_6::setClipboard(ClipboardID id, const IClipboard* clipboard)
         m_clipboard[id].m_dirty = false;
         Clipboard::copy(&m_clipboard[id].m_clipboard, clipboard);
 
-        std::string data = m_clipboard[id].m_clipboard.marshall();
+        // this is the same buffer every other client is sent
+        std::shared_ptr<const String> data =
+            m_clipboard[id].m_clipboard.marshallShared();
 
-        size_t size = data.size();
         LOG((CLOG_DEBUG "sending clipboard %d to \"%s\"", id, getName().c_str()));
 
-        StreamChunker::sendClipboard(data, size, id, 0, m_events, this);
+        m_clipboardSender.send(id, 0, data);
     }
 }
 
-void
-ClientProxy1_6::handleClipboardSendingEvent(const Event& event, void*)
-{
-    ClipboardChunk::send(getStream(), event.getData());
-}
-
 bool
 ClientProxy1_6::recvClipboard()
 {
     // parse message
-    static std::string dataCached;
-    ClipboardID id;
-    UInt32 seq;
-
-    int r = ClipboardChunk::assemble(getStream(), dataCached, id, seq);
+    int r = m_clipboardReceiver.read(getStream());
+    ClipboardID id = m_clipboardReceiver.getID();
+    UInt32 seq     = m_clipboardReceiver.getSequence();
 
     if (r == kStart) {
-        size_t size = ClipboardChunk::getExpectedSize();
+        size_t size = m_clipboardReceiver.getExpectedSize();
         LOG((CLOG_DEBUG "receiving clipboard %d size=%d", id, size));
     }
     else if (r == kFinish) {
         LOG((CLOG_DEBUG "received client \"%s\" clipboard %d seqnum=%d, size=%d",
-                getName().c_str(), id, seq, dataCached.size()));
+                getName().c_str(), id, seq, m_clipboardReceiver.getSize()));
         // save clipboard
-        m_clipboard[id].m_clipboard.unmarshall(dataCached, 0);
+        m_clipboardReceiver.takeClipboard(&m_clipboard[id].m_clipboard, 0);
         m_clipboard[id].m_sequenceNumber = seq;
         
         // notify
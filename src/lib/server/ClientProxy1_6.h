@@ -18,6 +18,8 @@
 #pragma once
 
 #include "server/ClientProxy1_5.h"
+#include "barrier/ClipboardReceiver.h"
+#include "barrier/ClipboardSender.h"
 
 class Server;
 class IEventQueue;
@@ -32,9 +34,8 @@ public:
     virtual void        setClipboard(ClipboardID id, const IClipboard* clipboard);
     virtual bool        recvClipboard();
 
-private:
-    void                handleClipboardSendingEvent(const Event&, void*);
-
 private:
     IEventQueue*        m_events;
+    ClipboardSender        m_clipboardSender;
+    ClipboardReceiver    m_clipboardReceiver;
 };
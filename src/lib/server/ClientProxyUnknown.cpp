@@ -27,6 +27,7 @@
 #include "server/ClientProxy1_5.h"
 #include "server/ClientProxy1_6.h"
 #include "barrier/protocol_types.h"
+#include "barrier/ProtocolMessage.h"
 #include "barrier/ProtocolUtil.h"
 #include "barrier/XBarrier.h"
 #include "io/IStream.h"
@@ -250,14 +251,13 @@ ClientProxyUnknown::handleData(const Event&, void*)
     catch (XIncompatibleClient& e) {
         // client is incompatible
         LOG((CLOG_WARN "client \"%s\" has incompatible version %d.%d)", name.c_str(), e.getMajor(), e.getMinor()));
-        ProtocolUtil::writef(m_stream,
-                            kMsgEIncompatible,
+        MsgEIncompatible::write(m_stream,
                             kProtocolMajorVersion, kProtocolMinorVersion);
     }
     catch (XBadClient&) {
         // client not behaving
         LOG((CLOG_WARN "protocol error from client \"%s\"", name.c_str()));
-        ProtocolUtil::writef(m_stream, kMsgEBad);
+        MsgEBad::write(m_stream);
     }
     catch (XBase& e) {
         // misc error
@@ -0,0 +1,136 @@
+/*
+ * barrier -- mouse and keyboard sharing utility
+ * Copyright (C) 2018 Debauchee Open Source Group
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file LICENSE that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "server/NeighborTable.h"
+
+#include "server/Config.h"
+
+#include <algorithm>
+
+//
+// NeighborTable
+//
+
+NeighborTable::NeighborTable() :
+    m_sides(1, 0)
+{
+    // do nothing
+}
+
+void
+NeighborTable::build(const Config& config)
+{
+    m_names.clear();
+    m_screens.clear();
+    m_links.clear();
+    m_sides.clear();
+
+    // number the screens
+    for (Config::const_iterator i = config.begin(); i != config.end(); ++i) {
+        m_screens[*i] = static_cast<SInt32>(m_names.size());
+        m_names.push_back(*i);
+    }
+    for (Config::all_const_iterator i = config.beginAll();
+                            i != config.endAll(); ++i) {
+        ScreenMap::const_iterator screen = m_screens.find(i->second);
+        if (screen != m_screens.end()) {
+            m_screens[i->first] = screen->second;
+        }
+    }
+
+    // copy the links side by side.  the config keeps each screen's links
+    // ordered by side then start.
+    for (size_t screen = 0; screen != m_names.size(); ++screen) {
+        const std::string& name = m_names[screen];
+        Config::link_const_iterator link = config.beginNeighbor(name);
+        Config::link_const_iterator end  = config.endNeighbor(name);
+        for (SInt32 side = kFirstDirection; side <= kLastDirection; ++side) {
+            m_sides.push_back(static_cast<UInt32>(m_links.size()));
+            for (; link != end && link->first.getSide() == side; ++link) {
+                const Config::Interval src = link->first.getInterval();
+                const Config::Interval dst = link->second.getInterval();
+                Link entry;
+                entry.m_srcStart = src.first;
+                entry.m_srcEnd   = src.second;
+                entry.m_dstStart = dst.first;
+                entry.m_dstEnd   = dst.second;
+                entry.m_dst      = getScreen(link->second.getName());
+                m_links.push_back(entry);
+            }
+        }
+    }
+    m_sides.push_back(static_cast<UInt32>(m_links.size()));
+}
+
+SInt32
+NeighborTable::getNumScreens() const
+{
+    return static_cast<SInt32>(m_names.size());
+}
+
+SInt32
+NeighborTable::getScreen(const std::string& name) const
+{
+    ScreenMap::const_iterator i = m_screens.find(name);
+    if (i == m_screens.end()) {
+        return kNoScreen;
+    }
+    return i->second;
+}
+
+const std::string&
+NeighborTable::getName(SInt32 screen) const
+{
+    assert(screen >= 0 && screen < getNumScreens());
+    return m_names[screen];
+}
+
+SInt32
+NeighborTable::getNeighbor(SInt32 screen, EDirection side,
+                            float position, float* positionOut) const
+{
+    assert(screen >= 0 && screen < getNumScreens());
+    assert(side >= kFirstDirection && side <= kLastDirection);
+
+    // find the last link starting at or before position
+    const size_t index = screen * kNumDirections + (side - kFirstDirection);
+    const Link* begin  = m_links.data() + m_sides[index];
+    const Link* end    = m_links.data() + m_sides[index + 1];
+    const Link* link   = std::upper_bound(begin, end, position, &startsAfter);
+    if (link == begin) {
+        return kNoScreen;
+    }
+    --link;
+    if (position >= link->m_srcEnd || link->m_dst == kNoScreen) {
+        return kNoScreen;
+    }
+
+    // compute position on neighbor the way Config::CellEdge does
+    if (positionOut != NULL) {
+        float t = (position - link->m_srcStart) /
+                            (link->m_srcEnd - link->m_srcStart);
+        *positionOut = t * (link->m_dstEnd - link->m_dstStart) +
+                            link->m_dstStart;
+    }
+    return link->m_dst;
+}
+
+bool
+NeighborTable::startsAfter(float position, const Link& link)
+{
+    return (position < link.m_srcStart);
+}
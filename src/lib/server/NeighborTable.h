@@ -0,0 +1,108 @@
+/*
+ * barrier -- mouse and keyboard sharing utility
+ * Copyright (C) 2018 Debauchee Open Source Group
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file LICENSE that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "barrier/protocol_types.h"
+#include "base/String.h"
+#include "common/basic_types.h"
+
+#include <map>
+#include <vector>
+
+class Config;
+
+//! Screen neighbor table
+/*!
+The links between screens in a Config compiled into a table indexed by
+screen number.  The links on each side of each screen are kept sorted by
+where they start so finding the neighbor at a position is a binary
+search, with no screen names involved.  Screens are numbered in the
+order the Config lists them.  The table doesn't track the Config so it
+must be rebuilt when the Config changes.
+*/
+class NeighborTable {
+public:
+    enum { kNoScreen = -1 };
+
+    NeighborTable();
+
+    //! @name manipulators
+    //@{
+
+    //! Build the table
+    /*!
+    Replaces the table with the screens and links in \p config.
+    */
+    void                build(const Config& config);
+
+    //@}
+    //! @name accessors
+    //@{
+
+    //! Get the number of screens
+    SInt32                getNumScreens() const;
+
+    //! Get screen number
+    /*!
+    Returns the number of the screen named \p name, which may be any of
+    its names, or \c kNoScreen if there's no such screen.
+    */
+    SInt32                getScreen(const std::string& name) const;
+
+    //! Get screen name
+    /*!
+    Returns the canonical name of screen \p screen.
+    */
+    const std::string&    getName(SInt32 screen) const;
+
+    //! Get neighbor
+    /*!
+    Returns the number of the screen linked to side \p side of screen
+    \p screen at \p position, a fraction of the side's length, or
+    \c kNoScreen if there's no link there.  Otherwise saves the position
+    on the neighbor in \p positionOut if it's not \c NULL.  This gives
+    the same answer as Config::getNeighbor().
+    */
+    SInt32                getNeighbor(SInt32 screen, EDirection side,
+                            float position, float* positionOut) const;
+
+    //@}
+
+private:
+    class Link {
+    public:
+        float            m_srcStart;
+        float            m_srcEnd;
+        float            m_dstStart;
+        float            m_dstEnd;
+        SInt32            m_dst;
+    };
+    typedef std::map<std::string, SInt32,
+                            barrier::string::CaselessCmp> ScreenMap;
+
+    static bool            startsAfter(float position, const Link& link);
+
+private:
+    std::vector<std::string> m_names;
+    ScreenMap            m_screens;
+
+    // the links on side s of screen n are m_links[m_sides[i]] up to
+    // m_links[m_sides[i + 1]] where i is n * kNumDirections + s.
+    std::vector<Link>    m_links;
+    std::vector<UInt32>    m_sides;
+};
@@ -111,7 +111,6 @@ Server::Server(
 			clipboard.m_clipboard.empty();
 			clipboard.m_clipboard.close();
 		}
-		clipboard.m_clipboardData   = clipboard.m_clipboard.marshall();
 	}
 
 	// install event handlers
@@ -281,6 +280,9 @@ Server::setConfig(const Config& config)
 	// configuration.
 	closeClients(config);
 
+	// compile the screen links
+	rebuildNeighbors();
+
 	// cut over
 	processOptions();
 
@@ -601,44 +603,46 @@ Server::getNeighbor(BaseClientProxy* src,
 
 	assert(src != NULL);
 
-	// get source screen name
-    std::string srcName = getName(src);
-	assert(!srcName.empty());
-	LOG((CLOG_DEBUG2 "find neighbor on %s of \"%s\"", Config::dirName(dir), srcName.c_str()));
+	// get source screen
+	ClientScreens::const_iterator index = m_clientScreens.find(src);
+	if (index == m_clientScreens.end()) {
+		return NULL;
+	}
+	SInt32 srcScreen = index->second;
+	LOG((CLOG_DEBUG2 "find neighbor on %s of \"%s\"", Config::dirName(dir), m_neighbors.getName(srcScreen).c_str()));
 
 	// convert position to fraction
 	float t = mapToFraction(src, dir, x, y);
 
-	// search for the closest neighbor that exists in direction dir
+	// search for the closest neighbor that exists in direction dir.
+	// each pass skips a screen so if we've been through them all then
+	// the unconnected screens link in a loop.
 	float tTmp;
-	for (;;) {
-        std::string dstName(m_config->getNeighbor(srcName, dir, t, &tTmp));
-
-		// if nothing in that direction then return NULL. if the
-		// destination is the source then we can make no more
-		// progress in this direction.  since we haven't found a
-		// connected neighbor we return NULL.
-		if (dstName.empty()) {
-			LOG((CLOG_DEBUG2 "no neighbor on %s of \"%s\"", Config::dirName(dir), srcName.c_str()));
+	for (SInt32 n = 0; n < m_neighbors.getNumScreens(); ++n) {
+		SInt32 dstScreen = m_neighbors.getNeighbor(srcScreen, dir, t, &tTmp);
+
+		// if nothing in that direction then return NULL
+		if (dstScreen == NeighborTable::kNoScreen) {
+			LOG((CLOG_DEBUG2 "no neighbor on %s of \"%s\"", Config::dirName(dir), m_neighbors.getName(srcScreen).c_str()));
 			return NULL;
 		}
 
-		// look up neighbor cell.  if the screen is connected and
-		// ready then we can stop.
-		ClientList::const_iterator index = m_clients.find(dstName);
-		if (index != m_clients.end()) {
-			LOG((CLOG_DEBUG2 "\"%s\" is on %s of \"%s\" at %f", dstName.c_str(), Config::dirName(dir), srcName.c_str(), t));
-			mapToPixel(index->second, dir, tTmp, x, y);
-			return index->second;
+		// if the screen is connected and ready then we can stop
+		BaseClientProxy* dst = m_screenClients[dstScreen];
+		if (dst != NULL) {
+			LOG((CLOG_DEBUG2 "\"%s\" is on %s of \"%s\" at %f", m_neighbors.getName(dstScreen).c_str(), Config::dirName(dir), m_neighbors.getName(srcScreen).c_str(), t));
+			mapToPixel(dst, dir, tTmp, x, y);
+			return dst;
 		}
 
 		// skip over unconnected screen
-		LOG((CLOG_DEBUG2 "ignored \"%s\" on %s of \"%s\"", dstName.c_str(), Config::dirName(dir), srcName.c_str()));
-		srcName = dstName;
+		LOG((CLOG_DEBUG2 "ignored \"%s\" on %s of \"%s\"", m_neighbors.getName(dstScreen).c_str(), Config::dirName(dir), m_neighbors.getName(srcScreen).c_str()));
+		srcScreen = dstScreen;
 
 		// use position on skipped screen
 		t = tTmp;
 	}
+	return NULL;
 }
 
 BaseClientProxy*
@@ -757,7 +761,11 @@ Server::avoidJumpZone(BaseClientProxy* dst,
 		return;
 	}
 
-    const std::string dstName(getName(dst));
+	ClientScreens::const_iterator index = m_clientScreens.find(dst);
+	if (index == m_clientScreens.end()) {
+		return;
+	}
+	const SInt32 dstScreen = index->second;
 	SInt32 dx, dy, dw, dh;
 	dst->getShape(dx, dy, dw, dh);
 	float t = mapToFraction(dst, dir, x, y);
@@ -768,25 +776,29 @@ Server::avoidJumpZone(BaseClientProxy* dst,
 	// don't need to move inwards because that side can't provoke a jump.
 	switch (dir) {
 	case kLeft:
-		if (!m_config->getNeighbor(dstName, kRight, t, NULL).empty() &&
+		if (m_neighbors.getNeighbor(dstScreen, kRight, t, NULL) !=
+				NeighborTable::kNoScreen &&
 			x > dx + dw - 1 - z)
 			x = dx + dw - 1 - z;
 		break;
 
 	case kRight:
-		if (!m_config->getNeighbor(dstName, kLeft, t, NULL).empty() &&
+		if (m_neighbors.getNeighbor(dstScreen, kLeft, t, NULL) !=
+				NeighborTable::kNoScreen &&
 			x < dx + z)
 			x = dx + z;
 		break;
 
 	case kTop:
-		if (!m_config->getNeighbor(dstName, kBottom, t, NULL).empty() &&
+		if (m_neighbors.getNeighbor(dstScreen, kBottom, t, NULL) !=
+				NeighborTable::kNoScreen &&
 			y > dy + dh - 1 - z)
 			y = dy + dh - 1 - z;
 		break;
 
 	case kBottom:
-		if (!m_config->getNeighbor(dstName, kTop, t, NULL).empty() &&
+		if (m_neighbors.getNeighbor(dstScreen, kTop, t, NULL) !=
+				NeighborTable::kNoScreen &&
 			y < dy + z)
 			y = dy + z;
 		break;
@@ -1252,7 +1264,6 @@ Server::handleClipboardGrabbed(const Event& event, void* vclient)
 		clipboard.m_clipboard.empty();
 		clipboard.m_clipboard.close();
 	}
-	clipboard.m_clipboardData = clipboard.m_clipboard.marshall();
 
 	// tell all other screens to take ownership of clipboard.  tell the
 	// grabber that it's clipboard isn't dirty.
@@ -1525,7 +1536,7 @@ Server::handleFakeInputEndEvent(const Event&, void*)
 void
 Server::handleFileChunkSendingEvent(const Event& event, void*)
 {
-	onFileChunkSending(event.getData());
+	onFileChunkSending(event.getDataObject());
 }
 
 void
@@ -1549,19 +1560,19 @@ Server::onClipboardChanged(BaseClientProxy* sender,
 	// should be the expected client
 	assert(sender == m_clients.find(clipboard.m_clipboardOwner)->second);
 
-	// get data
+	// get data.  copies of a Clipboard share its data so keeping the
+	// old one to compare against costs nothing.
+	Clipboard previous(clipboard.m_clipboard);
 	sender->getClipboard(id, &clipboard.m_clipboard);
 
 	// ignore if data hasn't changed
-    std::string data = clipboard.m_clipboard.marshall();
-	if (data == clipboard.m_clipboardData) {
+	if (clipboard.m_clipboard.hasSameData(previous)) {
 		LOG((CLOG_DEBUG "ignored screen \"%s\" update of clipboard %d (unchanged)", clipboard.m_clipboardOwner.c_str(), id));
 		return;
 	}
 
 	// got new data
 	LOG((CLOG_INFO "screen \"%s\" updated clipboard %d", clipboard.m_clipboardOwner.c_str(), id));
-	clipboard.m_clipboardData = data;
 
 	// tell all clients except the sender that the clipboard is dirty
 	for (ClientList::const_iterator index = m_clients.begin();
@@ -2072,9 +2083,9 @@ Server::onMouseWheel(SInt32 xDelta, SInt32 yDelta)
 }
 
 void
-Server::onFileChunkSending(const void* data)
+Server::onFileChunkSending(EventData* data)
 {
-	FileChunk* chunk = static_cast<FileChunk*>(const_cast<void*>(data));
+	FileChunk* chunk = static_cast<FileChunk*>(data);
 
 	LOG((CLOG_DEBUG1 "sending file chunk"));
 	assert(m_active != NULL);
@@ -2103,7 +2114,7 @@ Server::writeToDropDirThread(void*)
 	}
 
 	DropHelper::writeToDir(m_screen->getDropTarget(), m_fakeDragFileList,
-					m_receivedFileData);
+					m_fileReceiver);
 }
 
 bool
@@ -2131,6 +2142,7 @@ Server::addClient(BaseClientProxy* client)
 	// add to list
 	m_clientSet.insert(client);
 	m_clients.insert(std::make_pair(name, client));
+	updateNeighborClients();
 
 	// initialize client data
 	SInt32 x, y;
@@ -2163,10 +2175,33 @@ Server::removeClient(BaseClientProxy* client)
 	// remove from list
 	m_clients.erase(getName(client));
 	m_clientSet.erase(i);
+	updateNeighborClients();
 
 	return true;
 }
 
+void
+Server::rebuildNeighbors()
+{
+	m_neighbors.build(*m_config);
+	updateNeighborClients();
+}
+
+void
+Server::updateNeighborClients()
+{
+	m_screenClients.assign(m_neighbors.getNumScreens(), NULL);
+	m_clientScreens.clear();
+	for (ClientList::const_iterator index = m_clients.begin();
+								index != m_clients.end(); ++index) {
+		SInt32 screen = m_neighbors.getScreen(index->first);
+		if (screen != NeighborTable::kNoScreen) {
+			m_screenClients[screen] = index->second;
+			m_clientScreens[index->second] = screen;
+		}
+	}
+}
+
 void
 Server::closeClient(BaseClientProxy* client, const char* msg)
 {
@@ -2306,7 +2341,6 @@ Server::forceLeaveClient(BaseClientProxy* client)
 
 Server::ClipboardInfo::ClipboardInfo() :
 	m_clipboard(),
-	m_clipboardData(),
 	m_clipboardOwner(),
 	m_clipboardSeqNum(0)
 {
@@ -2384,7 +2418,7 @@ Server::KeyboardBroadcastInfo::alloc(State state, const std::string& screens)
 bool
 Server::isReceivedFileSizeValid()
 {
-	return m_expectedFileSize == m_receivedFileData.size();
+	return m_fileReceiver.isComplete();
 }
 
 void
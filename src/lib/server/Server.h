@@ -19,12 +19,14 @@
 #pragma once
 
 #include "server/Config.h"
+#include "server/NeighborTable.h"
 #include "barrier/clipboard_types.h"
 #include "barrier/Clipboard.h"
 #include "barrier/key_types.h"
 #include "barrier/mouse_types.h"
 #include "barrier/INode.h"
 #include "barrier/DragInformation.h"
+#include "barrier/FileReceiver.h"
 #include "barrier/ServerArgs.h"
 #include "base/Event.h"
 #include "base/Stopwatch.h"
@@ -170,11 +172,8 @@ public:
     //! Return true if recieved file size is valid
     bool                isReceivedFileSizeValid();
 
-    //! Return expected file data size
-    size_t&                getExpectedFileSize() { return m_expectedFileSize; }
-
-    //! Return received file data
-    std::string& getReceivedFileData() { return m_receivedFileData; }
+    //! Return the receiver of dropped files
+    FileReceiver&        getFileReceiver() { return m_fileReceiver; }
 
     //! Return fake drag file list
     DragFileList        getFakeDragFileList() { return m_fakeDragFileList; }
@@ -331,7 +330,7 @@ private:
     bool                onMouseMovePrimary(SInt32 x, SInt32 y);
     void                onMouseMoveSecondary(SInt32 dx, SInt32 dy);
     void                onMouseWheel(SInt32 xDelta, SInt32 yDelta);
-    void                onFileChunkSending(const void* data);
+    void                onFileChunkSending(EventData* data);
     void                onFileRecieveCompleted();
 
     // add client to list and attach event handlers for client
@@ -343,6 +342,12 @@ private:
     // close a client
     void                closeClient(BaseClientProxy*, const char* msg);
 
+    // rebuild the neighbor table from the configuration
+    void                rebuildNeighbors();
+
+    // match the screens in the neighbor table to the connected clients
+    void                updateNeighborClients();
+
     // close clients not in \p config
     void                closeClients(const Config& config);
 
@@ -379,7 +384,6 @@ private:
 
     public:
         Clipboard        m_clipboard;
-        std::string m_clipboardData;
         std::string m_clipboardOwner;
         UInt32            m_clipboardSeqNum;
     };
@@ -417,6 +421,14 @@ private:
     // current configuration
     Config*                m_config;
 
+    // the links between screens in m_config, with the connected client
+    // for each screen in the table (or NULL) and the screen for each
+    // connected client
+    typedef std::map<const BaseClientProxy*, SInt32> ClientScreens;
+    NeighborTable        m_neighbors;
+    std::vector<BaseClientProxy*> m_screenClients;
+    ClientScreens        m_clientScreens;
+
     // input filter (from m_config);
     InputFilter*        m_inputFilter;
 
@@ -466,8 +478,7 @@ private:
     IEventQueue*        m_events;
 
     // file transfer
-    size_t                m_expectedFileSize;
-    std::string m_receivedFileData;
+    FileReceiver        m_fileReceiver;
     DragFileList        m_dragFileList;
     DragFileList        m_fakeDragFileList;
     Thread*                m_sendFileThread;
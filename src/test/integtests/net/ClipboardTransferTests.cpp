@@ -0,0 +1,222 @@
+/*
+ * barrier -- mouse and keyboard sharing utility
+ * Copyright (C) 2018 Debauchee Open Source Group
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file LICENSE that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test/global/TestEventQueue.h"
+#include "barrier/ClipboardReceiver.h"
+#include "barrier/ClipboardSender.h"
+#include "barrier/Clipboard.h"
+#include "barrier/PacketStreamFilter.h"
+#include "barrier/ProtocolMessage.h"
+#include "net/SocketMultiplexer.h"
+#include "net/TCPSocket.h"
+#include "arch/Arch.h"
+#include "base/Log.h"
+#include "base/TMethodEventJob.h"
+
+#include "test/global/gtest.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+#define TEST_PORT 24806
+
+// sends a clipboard between two loopback sockets, the way the server and
+// client proxies do
+class ClipboardTransferTests : public ::testing::Test {
+public:
+    ClipboardTransferTests() :
+        m_result(kNotFinish) { }
+
+    // send a clipboard with size bytes of text, check it arrives as sent
+    // and log the time taken and the memory the transfer took
+    void                transfer(size_t size);
+
+private:
+    void                handleInputReady(const Event&, void* vstream);
+
+    // the process's resident set size and its peak in kB, or -1.  the
+    // peak is reset to the current size by resetPeakRss().
+    static long long    getRss(const char* field);
+    static void            resetPeakRss();
+
+private:
+    TestEventQueue        m_events;
+    ClipboardReceiver    m_receiver;
+    int                    m_result;
+    Clipboard            m_received;
+};
+
+void
+ClipboardTransferTests::transfer(size_t size)
+{
+    // connect two sockets
+    ArchNetAddress addr = ARCH->nameToAddr("127.0.0.1");
+    ARCH->setAddrPort(addr, TEST_PORT);
+    ArchSocket listener = ARCH->newSocket(IArchNetwork::kINET, IArchNetwork::kSTREAM);
+    ARCH->setReuseAddrOnSocket(listener, true);
+    ARCH->bindSocket(listener, addr);
+    ARCH->listenOnSocket(listener);
+    ArchSocket remote = ARCH->newSocket(IArchNetwork::kINET, IArchNetwork::kSTREAM);
+    ARCH->connectSocket(remote, addr);
+    ArchSocket local = NULL;
+    while (local == NULL) {
+        IArchNetwork::PollEntry pfd = { listener, IArchNetwork::kPOLLIN, 0 };
+        ARCH->pollSocket(&pfd, 1, 1.0);
+        local = ARCH->acceptSocket(listener, NULL);
+    }
+    ARCH->closeSocket(listener);
+    ARCH->closeAddr(addr);
+
+    SocketMultiplexer multiplexer;
+    PacketStreamFilter sendStream(&m_events,
+                            new TCPSocket(&m_events, &multiplexer, remote), true);
+    PacketStreamFilter recvStream(&m_events,
+                            new TCPSocket(&m_events, &multiplexer, local), true);
+    m_events.adoptHandler(m_events.forIStream().inputReady(),
+                            recvStream.getEventTarget(),
+                            new TMethodEventJob<ClipboardTransferTests>(this,
+                                &ClipboardTransferTests::handleInputReady,
+                                &recvStream));
+
+    // the clipboard as the screen hands it over.  the text depends on
+    // the position so misplaced or repeated chunks show up.
+    String expected(size, '\0');
+    for (size_t i = 0; i < size; ++i) {
+        expected[i] = (char)('a' + (i * 7 + i / 251) % 26);
+    }
+    ClipboardSender::Data data;
+    {
+        Clipboard clipboard;
+        clipboard.open(0);
+        clipboard.add(IClipboard::kText, expected);
+        clipboard.close();
+        data = clipboard.marshallShared();
+    }
+
+    // count only what the transfer takes on top of the clipboard
+    resetPeakRss();
+    long long rss = getRss("VmRSS:");
+
+    // measure from here so only the transfer's memory counts.  the
+    // received clipboard accounts for 1x.
+    m_result = kNotFinish;
+
+    int filter = CLOG->getFilter();
+    CLOG->setFilter(kINFO);
+    double start = ARCH->time();
+    {
+        ClipboardSender sender(&sendStream, &m_events);
+        sender.send(kClipboardClipboard, 1, data);
+        data.reset();
+        m_events.initQuitTimeout(60);
+        m_events.loop();
+        m_events.cleanupQuitTimeout();
+    }
+    double elapsed = ARCH->time() - start;
+    CLOG->setFilter(filter);
+
+    long long peak = getRss("VmHWM:");
+    m_events.removeHandler(m_events.forIStream().inputReady(),
+                            recvStream.getEventTarget());
+
+    ASSERT_EQ(kFinish, m_result);
+    m_received.open(0);
+    String text = m_received.get(IClipboard::kText);
+    m_received.close();
+    EXPECT_EQ(size, text.size());
+    EXPECT_TRUE(text == expected);
+
+    if (rss >= 0 && peak >= 0) {
+        LOG((CLOG_INFO "%.0f kB clipboard: %.0f ms, peak RSS +%.1f MB (%.2fx the clipboard)",
+            size / 1024.0, elapsed * 1.0e+3,
+            (peak - rss) / 1024.0, (peak - rss) * 1024.0 / size));
+    }
+    else {
+        LOG((CLOG_INFO "%.0f kB clipboard: %.0f ms",
+            size / 1024.0, elapsed * 1.0e+3));
+    }
+}
+
+void
+ClipboardTransferTests::handleInputReady(const Event&, void* vstream)
+{
+    PacketStreamFilter* stream = static_cast<PacketStreamFilter*>(vstream);
+    while (stream->isReady()) {
+        UInt32 code;
+        FieldInt<4>::read(stream, &code);
+        ASSERT_EQ(kMsgCodeDClipboard, code);
+        m_result = m_receiver.read(stream);
+        if (m_result == kFinish) {
+            m_receiver.takeClipboard(&m_received, 0);
+        }
+        if (m_result == kFinish || m_result == kError) {
+            m_events.raiseQuitEvent();
+            return;
+        }
+    }
+}
+
+long long
+ClipboardTransferTests::getRss(const char* field)
+{
+    long long kb = -1;
+#if SYSAPI_UNIX
+    FILE* file = fopen("/proc/self/status", "r");
+    if (file != NULL) {
+        char line[128];
+        size_t n = strlen(field);
+        while (fgets(line, sizeof(line), file) != NULL) {
+            if (strncmp(line, field, n) == 0) {
+                kb = atoll(line + n);
+            }
+        }
+        fclose(file);
+    }
+#endif
+    return kb;
+}
+
+void
+ClipboardTransferTests::resetPeakRss()
+{
+#if SYSAPI_UNIX
+    FILE* file = fopen("/proc/self/clear_refs", "w");
+    if (file != NULL) {
+        fputs("5", file);
+        fclose(file);
+    }
+#endif
+}
+
+TEST_F(ClipboardTransferTests, smallClipboard_receivedIntact)
+{
+    transfer(4096);
+}
+
+TEST_F(ClipboardTransferTests, largeClipboard_receivedIntact)
+{
+    transfer(8 << 20);
+}
+
+TEST_F(ClipboardTransferTests, DISABLED_benchmark_loopback)
+{
+    const size_t kSizes[] = { 1, 50, 200 };
+    for (size_t i = 0; i < sizeof(kSizes) / sizeof(kSizes[0]); ++i) {
+        transfer(kSizes[i] << 20);
+    }
+}
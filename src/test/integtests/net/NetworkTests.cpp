@@ -33,11 +33,13 @@
 #include "barrier/StreamChunker.h"
 #include "net/SocketMultiplexer.h"
 #include "net/NetworkAddress.h"
+#include "net/AddressResolver.h"
 #include "net/TCPSocketFactory.h"
 #include "mt/Thread.h"
 #include "base/TMethodEventJob.h"
 #include "base/TMethodJob.h"
 #include "base/Log.h"
+#include "arch/Arch.h"
 #include <stdexcept>
 
 #include "test/global/gtest.h"
@@ -46,6 +48,10 @@
 #include <iostream>
 #include <stdio.h>
 
+#if SYSAPI_UNIX
+#include <sys/resource.h>
+#endif
+
 using namespace std;
 using ::testing::_;
 using ::testing::NiceMock;
@@ -64,6 +70,7 @@ void getScreenShape(SInt32& x, SInt32& y, SInt32& w, SInt32& h);
 void getCursorPos(SInt32& x, SInt32& y);
 UInt8* newMockData(size_t size);
 void createFile(fstream& file, const char* filename, size_t size);
+long getPeakMemoryKB();
 
 class NetworkTests : public ::testing::Test
 {
@@ -71,7 +78,8 @@ public:
     NetworkTests() :
         m_mockData(NULL),
         m_mockDataSize(0),
-        m_mockFileSize(0)
+        m_mockFileSize(0),
+        m_receivedTime(0.0)
     {
         m_mockData = newMockData(kMockDataSize);
         createFile(m_mockFile, kMockFilename, kMockFileSize);
@@ -84,18 +92,22 @@ public:
     }
 
     void                sendMockData(void* eventTarget);
+    void                benchmarkSendToClient(size_t size);
     
     void                sendToClient_mockData_handleClientConnected(const Event&, void* vlistener);
     void                sendToClient_mockData_fileRecieveCompleted(const Event&, void*);
     
     void                sendToClient_mockFile_handleClientConnected(const Event&, void* vlistener);
     void                sendToClient_mockFile_fileRecieveCompleted(const Event& event, void*);
+    void                sendToClient_benchmark_fileRecieveCompleted(const Event& event, void*);
     
     void                sendToServer_mockData_handleClientConnected(const Event&, void* vlistener);
     void                sendToServer_mockData_fileRecieveCompleted(const Event& event, void*);
 
     void                sendToServer_mockFile_handleClientConnected(const Event&, void* vlistener);
     void                sendToServer_mockFile_fileRecieveCompleted(const Event& event, void*);
+
+    void                connect_handleClientConnected(const Event&, void* vlistener);
     
 public:
     TestEventQueue        m_events;
@@ -103,6 +115,7 @@ public:
     size_t                m_mockDataSize;
     fstream                m_mockFile;
     size_t                m_mockFileSize;
+    double                m_receivedTime;
 };
 
 TEST_F(NetworkTests, sendToClient_mockData)
@@ -221,6 +234,84 @@ TEST_F(NetworkTests, sendToClient_mockFile)
     m_events.cleanupQuitTimeout();
 }
 
+TEST_F(NetworkTests, DISABLED_benchmark_sendToClient_1MBFile)
+{
+    benchmarkSendToClient(1024 * 1024);
+}
+
+TEST_F(NetworkTests, DISABLED_benchmark_sendToClient_16MBFile)
+{
+    benchmarkSendToClient(16 * 1024 * 1024);
+}
+
+TEST_F(NetworkTests, DISABLED_benchmark_sendToClient_128MBFile)
+{
+    benchmarkSendToClient(128 * 1024 * 1024);
+}
+
+TEST_F(NetworkTests, connect_unreachableFirstAddress_connectsToNext)
+{
+    NetworkAddress serverAddress(TEST_HOST, TEST_PORT);
+    serverAddress.resolve();
+
+    // server
+    SocketMultiplexer serverSocketMultiplexer;
+    TCPSocketFactory* serverSocketFactory = new TCPSocketFactory(&m_events, &serverSocketMultiplexer);
+    ClientListener listener(serverAddress, serverSocketFactory, &m_events, false);
+    NiceMock<MockScreen> serverScreen;
+    NiceMock<MockPrimaryClient> primaryClient;
+    NiceMock<MockConfig> serverConfig;
+    NiceMock<MockInputFilter> serverInputFilter;
+
+    m_events.adoptHandler(
+        m_events.forClientListener().connected(), &listener,
+        new TMethodEventJob<NetworkTests>(
+            this, &NetworkTests::connect_handleClientConnected, &listener));
+
+    ON_CALL(serverConfig, isScreen(_)).WillByDefault(Return(true));
+    ON_CALL(serverConfig, getInputFilter()).WillByDefault(Return(&serverInputFilter));
+
+    ServerArgs serverArgs;
+    Server server(serverConfig, &primaryClient, &serverScreen, &m_events, serverArgs);
+    server.m_mock = true;
+    listener.setServer(&server);
+
+    // client, with a stub resolver that puts an address nothing answers
+    // (TEST-NET-1) ahead of the server's
+    NiceMock<MockScreen> clientScreen;
+    SocketMultiplexer clientSocketMultiplexer;
+    TCPSocketFactory* clientSocketFactory = new TCPSocketFactory(&m_events, &clientSocketMultiplexer);
+
+    ON_CALL(clientScreen, getShape(_, _, _, _)).WillByDefault(Invoke(getScreenShape));
+    ON_CALL(clientScreen, getCursorPos(_, _)).WillByDefault(Invoke(getCursorPos));
+
+    AddressResolver* resolver = new AddressResolver(&m_events,
+        [](const NetworkAddress& address) {
+            std::vector<NetworkAddress> addresses =
+                NetworkAddress("192.0.2.1", address.getPort()).resolveAll();
+            std::vector<NetworkAddress> server =
+                NetworkAddress("127.0.0.1", address.getPort()).resolveAll();
+            addresses.insert(addresses.end(), server.begin(), server.end());
+            return addresses;
+        });
+
+    ClientArgs clientArgs;
+    clientArgs.m_enableCrypto = false;
+    Client client(&m_events, "stub", NetworkAddress("server", TEST_PORT),
+        clientSocketFactory, &clientScreen, clientArgs, resolver);
+
+    double start = ARCH->time();
+    client.connect();
+
+    // well inside the client's 15s connect timeout
+    m_events.initQuitTimeout(5);
+    m_events.loop();
+    m_events.removeHandler(m_events.forClientListener().connected(), &listener);
+    m_events.cleanupQuitTimeout();
+
+    LOG((CLOG_INFO "connected past an unreachable address in %.2fs", ARCH->time() - start));
+}
+
 TEST_F(NetworkTests, sendToServer_mockData)
 {
     // server and client
@@ -334,6 +425,89 @@ TEST_F(NetworkTests, sendToServer_mockFile)
     m_events.cleanupQuitTimeout();
 }
 
+void
+NetworkTests::benchmarkSendToClient(size_t size)
+{
+    // the receiver writes each chunk to disk as it arrives, so memory
+    // shouldn't grow with the size of the file
+    int filter = CLOG->getFilter();
+
+    // written in pieces so making the file doesn't raise peak memory
+    remove(kMockFilename);
+    {
+        ofstream file(kMockFilename, ios::out | ios::binary);
+        for (size_t written = 0; written < size; written += kMockDataSize) {
+            file.write(reinterpret_cast<char*>(m_mockData),
+                min(kMockDataSize, size - written));
+        }
+    }
+
+    NetworkAddress serverAddress(TEST_HOST, TEST_PORT);
+    serverAddress.resolve();
+
+    // server
+    SocketMultiplexer serverSocketMultiplexer;
+    TCPSocketFactory* serverSocketFactory = new TCPSocketFactory(&m_events, &serverSocketMultiplexer);
+    ClientListener listener(serverAddress, serverSocketFactory, &m_events, false);
+    NiceMock<MockScreen> serverScreen;
+    NiceMock<MockPrimaryClient> primaryClient;
+    NiceMock<MockConfig> serverConfig;
+    NiceMock<MockInputFilter> serverInputFilter;
+
+    m_events.adoptHandler(
+        m_events.forClientListener().connected(), &listener,
+        new TMethodEventJob<NetworkTests>(
+            this, &NetworkTests::sendToClient_mockFile_handleClientConnected, &listener));
+
+    ON_CALL(serverConfig, isScreen(_)).WillByDefault(Return(true));
+    ON_CALL(serverConfig, getInputFilter()).WillByDefault(Return(&serverInputFilter));
+
+    ServerArgs serverArgs;
+    serverArgs.m_enableDragDrop = true;
+    Server server(serverConfig, &primaryClient, &serverScreen, &m_events, serverArgs);
+    server.m_mock = true;
+    listener.setServer(&server);
+
+    // client
+    NiceMock<MockScreen> clientScreen;
+    SocketMultiplexer clientSocketMultiplexer;
+    TCPSocketFactory* clientSocketFactory = new TCPSocketFactory(&m_events, &clientSocketMultiplexer);
+
+    ON_CALL(clientScreen, getShape(_, _, _, _)).WillByDefault(Invoke(getScreenShape));
+    ON_CALL(clientScreen, getCursorPos(_, _)).WillByDefault(Invoke(getCursorPos));
+
+    ClientArgs clientArgs;
+    clientArgs.m_enableDragDrop = true;
+    clientArgs.m_enableCrypto = false;
+    Client client(&m_events, "stub", serverAddress, clientSocketFactory, &clientScreen, clientArgs);
+
+    m_events.adoptHandler(
+        m_events.forFile().fileRecieveCompleted(), &client,
+        new TMethodEventJob<NetworkTests>(
+            this, &NetworkTests::sendToClient_benchmark_fileRecieveCompleted));
+
+    CLOG->setFilter(kINFO);
+    long peakBefore = getPeakMemoryKB();
+    m_receivedTime = 0.0;
+    double start = ARCH->time();
+    client.connect();
+
+    m_events.initQuitTimeout(120);
+    m_events.loop();
+    m_events.removeHandler(m_events.forClientListener().connected(), &listener);
+    m_events.removeHandler(m_events.forFile().fileRecieveCompleted(), &client);
+    m_events.cleanupQuitTimeout();
+    CLOG->setFilter(filter);
+
+    ASSERT_NE(0.0, m_receivedTime);
+    EXPECT_EQ(size, client.getFileReceiver().getSize());
+
+    double elapsed = m_receivedTime - start;
+    LOG((CLOG_INFO "sent %u MB file in %.2fs: %.1f MB/s, peak memory grew %ld KB",
+        static_cast<unsigned int>(size / (1024 * 1024)), elapsed,
+        size / (1024.0 * 1024.0) / elapsed, getPeakMemoryKB() - peakBefore));
+}
+
 void 
 NetworkTests::sendToClient_mockData_handleClientConnected(const Event&, void* vlistener)
 {
@@ -388,6 +562,16 @@ NetworkTests::sendToClient_mockFile_fileRecieveCompleted(const Event& event, voi
     m_events.raiseQuitEvent();
 }
 
+void 
+NetworkTests::sendToClient_benchmark_fileRecieveCompleted(const Event& event, void*)
+{
+    Client* client = static_cast<Client*>(event.getTarget());
+    EXPECT_TRUE(client->isReceivedFileSizeValid());
+
+    m_receivedTime = ARCH->time();
+    m_events.raiseQuitEvent();
+}
+
 void 
 NetworkTests::sendToServer_mockData_handleClientConnected(const Event&, void* vclient)
 {
@@ -420,6 +604,20 @@ NetworkTests::sendToServer_mockFile_fileRecieveCompleted(const Event& event, voi
     m_events.raiseQuitEvent();
 }
 
+void 
+NetworkTests::connect_handleClientConnected(const Event&, void* vlistener)
+{
+    ClientListener* listener = static_cast<ClientListener*>(vlistener);
+    ClientProxy* client = listener->getNextClient();
+    EXPECT_TRUE(client != NULL);
+    if (client != NULL) {
+        BaseClientProxy* bcp = client;
+        listener->getServer()->adoptClient(bcp);
+    }
+
+    m_events.raiseQuitEvent();
+}
+
 void 
 NetworkTests::sendMockData(void* eventTarget)
 {
@@ -427,7 +625,9 @@ NetworkTests::sendMockData(void* eventTarget)
     String size = barrier::string::sizeTypeToString(kMockDataSize);
     FileChunk* sizeMessage = FileChunk::start(size);
     
-    m_events.addEvent(Event(m_events.forFile().fileChunkSending(), eventTarget, sizeMessage));
+    Event sizeEvent(m_events.forFile().fileChunkSending(), eventTarget);
+    sizeEvent.setDataObject(sizeMessage);
+    m_events.addEvent(sizeEvent);
 
     // send chunk messages with incrementing chunk size
     size_t lastSize = 0;
@@ -442,7 +642,9 @@ NetworkTests::sendMockData(void* eventTarget)
 
         // first byte is the chunk mark, last is \0
         FileChunk* chunk = FileChunk::data(m_mockData, dataSize);
-        m_events.addEvent(Event(m_events.forFile().fileChunkSending(), eventTarget, chunk));
+        Event chunkEvent(m_events.forFile().fileChunkSending(), eventTarget);
+        chunkEvent.setDataObject(chunk);
+        m_events.addEvent(chunkEvent);
 
         sentLength += dataSize;
         lastSize = dataSize;
@@ -455,7 +657,9 @@ NetworkTests::sendMockData(void* eventTarget)
     
     // send last message
     FileChunk* transferFinished = FileChunk::end();
-    m_events.addEvent(Event(m_events.forFile().fileChunkSending(), eventTarget, transferFinished));
+    Event finishedEvent(m_events.forFile().fileChunkSending(), eventTarget);
+    finishedEvent.setDataObject(transferFinished);
+    m_events.addEvent(finishedEvent);
 }
 
 UInt8*
@@ -506,6 +710,18 @@ createFile(fstream& file, const char* filename, size_t size)
     delete[] buffer;
 }
 
+long
+getPeakMemoryKB()
+{
+#if SYSAPI_UNIX
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        return usage.ru_maxrss;
+    }
+#endif
+    return 0;
+}
+
 void
 getScreenShape(SInt32& x, SInt32& y, SInt32& w, SInt32& h)
 {
@@ -0,0 +1,199 @@
+/*
+ * barrier -- mouse and keyboard sharing utility
+ * Copyright (C) 2018 Debauchee Open Source Group
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file LICENSE that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test/global/TestEventQueue.h"
+#include "barrier/PacketStreamFilter.h"
+#include "net/SocketMultiplexer.h"
+#include "net/TCPSocket.h"
+#include "mt/Thread.h"
+#include "arch/Arch.h"
+#include "base/Log.h"
+#include "base/TMethodEventJob.h"
+#include "base/TMethodJob.h"
+
+#include "test/global/gtest.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#define TEST_PORT 24805
+
+// receives framed packets through a TCPSocket and a PacketStreamFilter
+class PacketReceiveTests : public ::testing::Test {
+public:
+    PacketReceiveTests() :
+        m_sender(NULL),
+        m_messages(0),
+        m_received(0),
+        m_receivedBytes(0) { }
+
+    // send count packets of size bytes and time their arrival.  logs the
+    // read syscalls per message where the platform can count them.
+    void                receivePackets(UInt32 size, UInt32 count);
+
+private:
+    void                sendPackets(void*);
+    void                handleInputReady(const Event&, void* vfilter);
+
+    // number of read syscalls made by the process so far, or -1
+    static long long    countReadSyscalls();
+
+private:
+    TestEventQueue        m_events;
+    ArchSocket            m_sender;
+    std::vector<UInt8>    m_stream;
+    UInt32                m_messages;
+    UInt32                m_received;
+    UInt32                m_receivedBytes;
+    std::vector<UInt8>    m_message;
+};
+
+void
+PacketReceiveTests::receivePackets(UInt32 size, UInt32 count)
+{
+    // frame the packets up front
+    m_stream.clear();
+    for (UInt32 i = 0; i < count; ++i) {
+        m_stream.push_back((UInt8)((size >> 24) & 0xff));
+        m_stream.push_back((UInt8)((size >> 16) & 0xff));
+        m_stream.push_back((UInt8)((size >>  8) & 0xff));
+        m_stream.push_back((UInt8)( size        & 0xff));
+        for (UInt32 j = 0; j < size; ++j) {
+            m_stream.push_back((UInt8)(i + j));
+        }
+    }
+    m_messages = count;
+    m_message.resize(size);
+
+    // connect a raw sender to a TCPSocket
+    ArchNetAddress addr = ARCH->nameToAddr("127.0.0.1");
+    ARCH->setAddrPort(addr, TEST_PORT);
+    ArchSocket listener = ARCH->newSocket(IArchNetwork::kINET, IArchNetwork::kSTREAM);
+    ARCH->setReuseAddrOnSocket(listener, true);
+    ARCH->bindSocket(listener, addr);
+    ARCH->listenOnSocket(listener);
+    m_sender = ARCH->newSocket(IArchNetwork::kINET, IArchNetwork::kSTREAM);
+    ARCH->connectSocket(m_sender, addr);
+    ArchSocket local = NULL;
+    while (local == NULL) {
+        IArchNetwork::PollEntry pfd = { listener, IArchNetwork::kPOLLIN, 0 };
+        ARCH->pollSocket(&pfd, 1, 1.0);
+        local = ARCH->acceptSocket(listener, NULL);
+    }
+    ARCH->closeSocket(listener);
+    ARCH->closeAddr(addr);
+
+    SocketMultiplexer multiplexer;
+    PacketStreamFilter filter(&m_events,
+                            new TCPSocket(&m_events, &multiplexer, local), true);
+    m_events.adoptHandler(m_events.forIStream().inputReady(),
+                            filter.getEventTarget(),
+                            new TMethodEventJob<PacketReceiveTests>(this,
+                                &PacketReceiveTests::handleInputReady, &filter));
+
+    long long reads = countReadSyscalls();
+    double start = ARCH->time();
+    Thread sender(new TMethodJob<PacketReceiveTests>(
+                            this, &PacketReceiveTests::sendPackets));
+    m_events.initQuitTimeout(30);
+    m_events.loop();
+    m_events.cleanupQuitTimeout();
+    double elapsed = ARCH->time() - start;
+    sender.wait();
+    long long readsAfter = countReadSyscalls();
+
+    m_events.removeHandler(m_events.forIStream().inputReady(),
+                            filter.getEventTarget());
+    ARCH->closeSocket(m_sender);
+
+    EXPECT_EQ(count, m_received);
+    EXPECT_EQ(count * size, m_receivedBytes);
+
+    if (reads >= 0 && readsAfter >= 0) {
+        LOG((CLOG_INFO "%u byte packets: %.2fus per message, %.3f read syscalls per message",
+            size, elapsed * 1.0e+6 / count,
+            (double)(readsAfter - reads) / count));
+    }
+    else {
+        LOG((CLOG_INFO "%u byte packets: %.2fus per message",
+            size, elapsed * 1.0e+6 / count));
+    }
+}
+
+void
+PacketReceiveTests::sendPackets(void*)
+{
+    size_t sent = 0;
+    while (sent < m_stream.size()) {
+        size_t n = ARCH->writeSocket(m_sender,
+                                &m_stream[sent], m_stream.size() - sent);
+        if (n == 0) {
+            IArchNetwork::PollEntry pfd = { m_sender, IArchNetwork::kPOLLOUT, 0 };
+            ARCH->pollSocket(&pfd, 1, 1.0);
+        }
+        sent += n;
+    }
+}
+
+void
+PacketReceiveTests::handleInputReady(const Event&, void* vfilter)
+{
+    PacketStreamFilter* filter = static_cast<PacketStreamFilter*>(vfilter);
+    while (filter->isReady()) {
+        UInt32 n = filter->read(&m_message[0], (UInt32)m_message.size());
+        if (n != m_message.size() || m_message[0] != (UInt8)m_received) {
+            ADD_FAILURE() << "packet " << m_received << " is corrupt";
+            m_events.raiseQuitEvent();
+            return;
+        }
+        m_receivedBytes += n;
+        ++m_received;
+    }
+    if (m_received == m_messages) {
+        m_events.raiseQuitEvent();
+    }
+}
+
+long long
+PacketReceiveTests::countReadSyscalls()
+{
+    long long count = -1;
+#if SYSAPI_UNIX
+    FILE* file = fopen("/proc/self/io", "r");
+    if (file != NULL) {
+        char line[128];
+        while (fgets(line, sizeof(line), file) != NULL) {
+            if (strncmp(line, "syscr:", 6) == 0) {
+                count = atoll(line + 6);
+            }
+        }
+        fclose(file);
+    }
+#endif
+    return count;
+}
+
+TEST_F(PacketReceiveTests, smallMessages_allReceived)
+{
+    receivePackets(12, 100000);
+}
+
+TEST_F(PacketReceiveTests, clipboardChunks_allReceived)
+{
+    receivePackets(32 * 1024, 500);
+}
@@ -0,0 +1,457 @@
+/*
+ * barrier -- mouse and keyboard sharing utility
+ * Copyright (C) 2018 Debauchee Open Source Group
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file LICENSE that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test/global/TestEventQueue.h"
+#include "net/SecureSocket.h"
+#include "net/SecureListenSocket.h"
+#include "net/SocketMultiplexer.h"
+#include "net/NetworkAddress.h"
+#include "common/DataDirectories.h"
+#include "arch/Arch.h"
+#include "base/Log.h"
+#include "base/TMethodEventJob.h"
+
+#include "test/global/gtest.h"
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/rsa.h>
+#include <openssl/x509.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#if SYSAPI_WIN32
+#include <direct.h>
+#include <sys/utime.h>
+#define mkdir(path, mode) _mkdir(path)
+#else
+#include <utime.h>
+#endif
+
+#define TEST_PORT 24806
+
+static const char kProfileDir[] = "SecureSocketTests.profile";
+
+// sets up a profile directory holding a fresh self signed certificate
+// that the client side trusts
+class SecureSocketTests : public ::testing::Test {
+public:
+    SecureSocketTests();
+
+    static void            SetUpTestCase();
+    static void            TearDownTestCase();
+
+    // connect clients to a secure listener over loopback and, once all
+    // are connected, send bytesPerClient from each.  returns the
+    // throughput in MB/s and the time taken to connect.
+    double                sendFromClients(int clients, UInt32 bytesPerClient,
+                            double& connectTime);
+
+    // connect clients to a secure listener over loopback and wait for
+    // each to get a byte from the server, then disconnect them all.
+    // returns the time taken.
+    double                connectClients(int clients);
+
+    // write a new self-signed certificate and trust only it
+    static void            writeCertificate();
+    static std::string    getPath(const char* name);
+
+private:
+
+    void                handleConnecting(const Event&, void*);
+    void                handleSecureConnected(const Event&, void* vsocket);
+    void                handleInputReady(const Event&, void* vsocket);
+    void                handleAccepted(const Event&, void* vsocket);
+    void                handleGreeting(const Event&, void* vsocket);
+
+protected:
+    static std::string    s_oldProfile;
+    TestEventQueue        m_events;
+    SecureListenSocket*    m_listen;
+    std::vector<SecureSocket*> m_senders;
+    int                    m_connected;
+    double                m_start;
+    double                m_connectTime;
+    std::vector<IDataSocket*> m_accepted;
+    std::map<IDataSocket*, size_t> m_offsets;
+    std::vector<UInt8>    m_data;
+    std::vector<UInt8>    m_readBuffer;
+    size_t                m_expectedBytes;
+    size_t                m_receivedBytes;
+    int                    m_greeted;
+};
+
+std::string SecureSocketTests::s_oldProfile;
+
+SecureSocketTests::SecureSocketTests() :
+    m_listen(NULL),
+    m_connected(0),
+    m_start(0.0),
+    m_connectTime(0.0),
+    m_readBuffer(65536),
+    m_expectedBytes(0),
+    m_receivedBytes(0),
+    m_greeted(0)
+{
+}
+
+void
+SecureSocketTests::SetUpTestCase()
+{
+    s_oldProfile = DataDirectories::profile();
+    mkdir(kProfileDir, 0700);
+    mkdir(getPath("SSL").c_str(), 0700);
+    mkdir(getPath("SSL/Fingerprints").c_str(), 0700);
+    DataDirectories::profile(kProfileDir);
+    writeCertificate();
+}
+
+void
+SecureSocketTests::TearDownTestCase()
+{
+    DataDirectories::profile(s_oldProfile);
+    remove(getPath("SSL/Barrier.pem").c_str());
+    remove(getPath("SSL/Fingerprints/TrustedServers.txt").c_str());
+    rmdir(getPath("SSL/Fingerprints").c_str());
+    rmdir(getPath("SSL").c_str());
+    rmdir(kProfileDir);
+}
+
+std::string
+SecureSocketTests::getPath(const char* name)
+{
+    return std::string(kProfileDir) + "/" + name;
+}
+
+void
+SecureSocketTests::writeCertificate()
+{
+    EVP_PKEY* key = NULL;
+    EVP_PKEY_CTX* keyContext = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, NULL);
+    EVP_PKEY_keygen_init(keyContext);
+    EVP_PKEY_CTX_set_rsa_keygen_bits(keyContext, 2048);
+    EVP_PKEY_keygen(keyContext, &key);
+    EVP_PKEY_CTX_free(keyContext);
+    ASSERT_TRUE(key != NULL);
+
+    X509* cert = X509_new();
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_get_notBefore(cert), 0);
+    X509_gmtime_adj(X509_get_notAfter(cert), 24 * 60 * 60);
+    X509_set_pubkey(cert, key);
+    X509_NAME* name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                            (const unsigned char*)"Barrier", -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    X509_sign(cert, key, EVP_sha256());
+
+    FILE* file = fopen(getPath("SSL/Barrier.pem").c_str(), "w");
+    ASSERT_TRUE(file != NULL);
+    PEM_write_PrivateKey(file, key, NULL, NULL, 0, NULL, NULL);
+    PEM_write_X509(file, cert);
+    fclose(file);
+
+    // trust it the way SecureSocket formats fingerprints
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int length = 0;
+    X509_digest(cert, EVP_sha1(), digest, &length);
+    std::string fingerprint;
+    for (unsigned int i = 0; i < length; ++i) {
+        char hex[4];
+        snprintf(hex, sizeof(hex), i == 0 ? "%02X" : ":%02X", digest[i]);
+        fingerprint += hex;
+    }
+    std::ofstream trusted(getPath("SSL/Fingerprints/TrustedServers.txt").c_str());
+    trusted << fingerprint << std::endl;
+
+    X509_free(cert);
+    EVP_PKEY_free(key);
+}
+
+double
+SecureSocketTests::sendFromClients(int clients, UInt32 bytesPerClient,
+                            double& connectTime)
+{
+    m_data.resize(bytesPerClient);
+    for (size_t i = 0; i < m_data.size(); ++i) {
+        m_data[i] = (UInt8)(i * 7 + i / 251);
+    }
+    m_expectedBytes = (size_t)clients * bytesPerClient;
+    m_receivedBytes = 0;
+    m_connected     = 0;
+
+    SocketMultiplexer multiplexer;
+    NetworkAddress address("127.0.0.1", TEST_PORT);
+    address.resolve();
+
+    m_listen = new SecureListenSocket(&m_events, &multiplexer, IArchNetwork::kINET);
+    m_listen->bind(address);
+    m_events.adoptHandler(m_events.forIListenSocket().connecting(), m_listen,
+                            new TMethodEventJob<SecureSocketTests>(this,
+                                &SecureSocketTests::handleConnecting));
+
+    // keep per-record debug logging out of the timing
+    int filter = CLOG->getFilter();
+    CLOG->setFilter(kINFO);
+
+    m_start = ARCH->time();
+    for (int i = 0; i < clients; ++i) {
+        SecureSocket* socket = new SecureSocket(&m_events, &multiplexer,
+                            IArchNetwork::kINET);
+        socket->initSsl(false);
+        m_events.adoptHandler(m_events.forIDataSocket().secureConnected(),
+                            socket->getEventTarget(),
+                            new TMethodEventJob<SecureSocketTests>(this,
+                                &SecureSocketTests::handleSecureConnected));
+        socket->connect(address);
+        m_senders.push_back(socket);
+    }
+
+    m_events.initQuitTimeout(60);
+    m_events.loop();
+    m_events.cleanupQuitTimeout();
+    double elapsed = ARCH->time() - m_start;
+    CLOG->setFilter(filter);
+    connectTime = m_connectTime;
+
+    for (size_t i = 0; i < m_senders.size(); ++i) {
+        m_events.removeHandlers(m_senders[i]->getEventTarget());
+        delete m_senders[i];
+    }
+    m_senders.clear();
+    for (size_t i = 0; i < m_accepted.size(); ++i) {
+        m_events.removeHandlers(m_accepted[i]->getEventTarget());
+        delete m_accepted[i];
+    }
+    m_accepted.clear();
+    m_offsets.clear();
+    m_events.removeHandlers(m_listen);
+    delete m_listen;
+    m_listen = NULL;
+
+    EXPECT_EQ(m_expectedBytes, m_receivedBytes);
+    return (m_receivedBytes / (1024.0 * 1024.0)) / elapsed;
+}
+
+void
+SecureSocketTests::handleConnecting(const Event&, void*)
+{
+    IDataSocket* socket = m_listen->accept();
+    ASSERT_TRUE(socket != NULL);
+    m_accepted.push_back(socket);
+    m_offsets[socket] = 0;
+    m_events.adoptHandler(m_events.forIStream().inputReady(),
+                            socket->getEventTarget(),
+                            new TMethodEventJob<SecureSocketTests>(this,
+                                &SecureSocketTests::handleInputReady, socket));
+    m_events.adoptHandler(m_events.forClientListener().accepted(),
+                            socket->getEventTarget(),
+                            new TMethodEventJob<SecureSocketTests>(this,
+                                &SecureSocketTests::handleAccepted, socket));
+}
+
+void
+SecureSocketTests::handleSecureConnected(const Event&, void*)
+{
+    // leave the handshakes out of the timing
+    if (++m_connected < (int)m_senders.size()) {
+        return;
+    }
+    m_connectTime = ARCH->time() - m_start;
+    m_start       = ARCH->time();
+    for (size_t i = 0; i < m_senders.size(); ++i) {
+        m_senders[i]->write(&m_data[0], (UInt32)m_data.size());
+    }
+}
+
+void
+SecureSocketTests::handleInputReady(const Event&, void* vsocket)
+{
+    IDataSocket* socket = static_cast<IDataSocket*>(vsocket);
+    size_t& offset = m_offsets[socket];
+    UInt32 n;
+    while ((n = socket->read(&m_readBuffer[0],
+                            (UInt32)m_readBuffer.size())) > 0) {
+        if (offset + n > m_data.size() ||
+            memcmp(&m_readBuffer[0], &m_data[offset], n) != 0) {
+            ADD_FAILURE() << "data corrupt at offset " << offset;
+            m_events.raiseQuitEvent();
+            return;
+        }
+        offset          += n;
+        m_receivedBytes += n;
+    }
+    if (m_receivedBytes == m_expectedBytes) {
+        m_events.raiseQuitEvent();
+    }
+}
+
+double
+SecureSocketTests::connectClients(int clients)
+{
+    m_greeted = 0;
+
+    SocketMultiplexer multiplexer;
+    NetworkAddress address("127.0.0.1", TEST_PORT);
+    address.resolve();
+
+    m_listen = new SecureListenSocket(&m_events, &multiplexer, IArchNetwork::kINET);
+    m_listen->bind(address);
+    m_events.adoptHandler(m_events.forIListenSocket().connecting(), m_listen,
+                            new TMethodEventJob<SecureSocketTests>(this,
+                                &SecureSocketTests::handleConnecting));
+
+    int filter = CLOG->getFilter();
+    CLOG->setFilter(kINFO);
+
+    double start = ARCH->time();
+    for (int i = 0; i < clients; ++i) {
+        SecureSocket* socket = new SecureSocket(&m_events, &multiplexer,
+                            IArchNetwork::kINET);
+        socket->initSsl(false);
+        m_events.adoptHandler(m_events.forIStream().inputReady(),
+                            socket->getEventTarget(),
+                            new TMethodEventJob<SecureSocketTests>(this,
+                                &SecureSocketTests::handleGreeting, socket));
+        socket->connect(address);
+        m_senders.push_back(socket);
+    }
+
+    m_events.initQuitTimeout(60);
+    m_events.loop();
+    m_events.cleanupQuitTimeout();
+    double elapsed = ARCH->time() - start;
+    CLOG->setFilter(filter);
+
+    for (size_t i = 0; i < m_senders.size(); ++i) {
+        m_events.removeHandlers(m_senders[i]->getEventTarget());
+        delete m_senders[i];
+    }
+    m_senders.clear();
+    for (size_t i = 0; i < m_accepted.size(); ++i) {
+        m_events.removeHandlers(m_accepted[i]->getEventTarget());
+        delete m_accepted[i];
+    }
+    m_accepted.clear();
+    m_offsets.clear();
+    m_events.removeHandlers(m_listen);
+    delete m_listen;
+    m_listen = NULL;
+
+    EXPECT_EQ(clients, m_greeted);
+    return elapsed;
+}
+
+void
+SecureSocketTests::handleAccepted(const Event&, void* vsocket)
+{
+    IDataSocket* socket = static_cast<IDataSocket*>(vsocket);
+    socket->write("!", 1);
+}
+
+void
+SecureSocketTests::handleGreeting(const Event&, void* vsocket)
+{
+    // any session tickets arrive ahead of the greeting, so by now the
+    // client has what it needs to resume
+    IDataSocket* socket = static_cast<IDataSocket*>(vsocket);
+    char greeting;
+    if (socket->read(&greeting, 1) == 1 && ++m_greeted == (int)m_senders.size()) {
+        m_events.raiseQuitEvent();
+    }
+}
+
+TEST_F(SecureSocketTests, loadCertificates_renewedInPlace_newCertificateUsed)
+{
+    connectClients(1);
+
+    // renew the certificate without changing its size or modification
+    // time.  only the new one is trusted, so clients can only connect
+    // if the server picks it up.
+    std::string path = getPath("SSL/Barrier.pem");
+    struct stat before, after;
+    ASSERT_EQ(0, stat(path.c_str(), &before));
+    for (int tries = 0; ; ++tries) {
+        ASSERT_GT(10, tries);
+        writeCertificate();
+        ASSERT_EQ(0, stat(path.c_str(), &after));
+        if (after.st_size <= before.st_size) {
+            break;
+        }
+    }
+    std::ofstream(path.c_str(), std::ios::app) <<
+        std::string((size_t)(before.st_size - after.st_size), '\n');
+    struct utimbuf times;
+    times.actime  = before.st_atime;
+    times.modtime = before.st_mtime;
+    ASSERT_EQ(0, utime(path.c_str(), &times));
+
+    connectClients(1);
+}
+
+TEST_F(SecureSocketTests, reconnectStorm_sessionsResumed)
+{
+    const int kClients = 32;
+
+    SecureSocket::HandshakeStats before = SecureSocket::getHandshakeStats(true);
+    double fullTime = connectClients(kClients);
+    SecureSocket::HandshakeStats full = SecureSocket::getHandshakeStats(true);
+    double resumedTime = connectClients(kClients);
+    SecureSocket::HandshakeStats after = SecureSocket::getHandshakeStats(true);
+
+    // the first clients may resume sessions from earlier tests
+    EXPECT_EQ((UInt32)kClients, (full.m_full + full.m_resumed) -
+                            (before.m_full + before.m_resumed));
+    EXPECT_EQ(full.m_full, after.m_full);
+    EXPECT_EQ((UInt32)kClients, after.m_resumed - full.m_resumed);
+
+    UInt32 fullCount = full.m_full - before.m_full;
+    LOG((CLOG_INFO "%d clients connecting: %.1fms, %u full handshakes averaging %.2fms",
+        kClients, fullTime * 1000.0, fullCount,
+        fullCount == 0 ? 0.0 : (full.m_fullTime - before.m_fullTime) * 1000.0 / fullCount));
+    LOG((CLOG_INFO "%d clients reconnecting: %.1fms, %d resumed handshakes averaging %.2fms",
+        kClients, resumedTime * 1000.0, kClients,
+        (after.m_resumedTime - full.m_resumedTime) * 1000.0 / kClients));
+}
+
+TEST_F(SecureSocketTests, write_eightClients_dataArrivesIntact)
+{
+    // each client has its own tls state, so interleaved records from
+    // several clients must not corrupt one another
+    double connectTime;
+    sendFromClients(8, 256 * 1024, connectTime);
+}
+
+TEST_F(SecureSocketTests, DISABLED_benchmark_oneClient)
+{
+    double connectTime;
+    double rate = sendFromClients(1, 32 * 1024 * 1024, connectTime);
+    LOG((CLOG_INFO "tls throughput, 1 client: %.0f MB/s, connected in %.1fms",
+        rate, connectTime * 1000.0));
+}
+
+TEST_F(SecureSocketTests, DISABLED_benchmark_eightClients)
+{
+    double connectTime;
+    double rate = sendFromClients(8, 8 * 1024 * 1024, connectTime);
+    LOG((CLOG_INFO "tls throughput, 8 clients: %.0f MB/s, connected in %.1fms",
+        rate, connectTime * 1000.0));
+}
@@ -0,0 +1,318 @@
+/*
+ * barrier -- mouse and keyboard sharing utility
+ * Copyright (C) 2018 Debauchee Open Source Group
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file LICENSE that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "net/SocketMultiplexer.h"
+#include "net/ISocket.h"
+#include "net/TSocketMultiplexerMethodJob.h"
+#include "mt/CondVar.h"
+#include "mt/Lock.h"
+#include "mt/Mutex.h"
+#include "mt/Thread.h"
+#include "arch/Arch.h"
+#include "base/Log.h"
+#include "base/TMethodJob.h"
+
+#include "test/global/gtest.h"
+#include <memory>
+#include <vector>
+
+#define TEST_PORT 24804
+
+const int kWakeups = 2000;
+const int kChurnSockets = 64;
+const int kChurnCycles = 100;
+
+// counts wakeups on one end of a loopback connection
+class WakeupEndpoint : public ISocket {
+public:
+    WakeupEndpoint(ArchSocket socket, CondVar<int>* wakeups) :
+        m_socket(socket),
+        m_drain(true),
+        m_registered(false),
+        m_runs(0),
+        m_lateRuns(0),
+        m_wakeups(wakeups) { }
+    ~WakeupEndpoint() { ARCH->closeSocket(m_socket); }
+
+    // ISocket overrides
+    virtual void bind(const NetworkAddress&) { }
+    virtual void close() { }
+    virtual void* getEventTarget() const { return const_cast<WakeupEndpoint*>(this); }
+
+    std::unique_ptr<ISocketMultiplexerJob> newJob()
+    {
+        return std::make_unique<TSocketMultiplexerMethodJob<WakeupEndpoint>>(
+                                this, &WakeupEndpoint::serviceRead,
+                                m_socket, true, false);
+    }
+
+private:
+    MultiplexerJobStatus serviceRead(ISocketMultiplexerJob*, bool read, bool, bool)
+    {
+        if (read) {
+            char buffer[64];
+            while (m_drain &&
+                    ARCH->readSocket(m_socket, buffer, sizeof(buffer)) > 0) {
+                // drain
+            }
+            Lock lock(m_wakeups);
+            if (!m_registered) {
+                ++m_lateRuns;
+            }
+            ++m_runs;
+            *m_wakeups = *m_wakeups + 1;
+            m_wakeups->broadcast();
+        }
+        return {true, {}};
+    }
+
+public:
+    ArchSocket            m_socket;
+
+    // an undrained socket stays readable so its job runs on every
+    // wakeup while it's registered
+    bool                m_drain;
+
+    // guarded by the wakeups mutex
+    bool                m_registered;
+    int                    m_runs;
+    int                    m_lateRuns;
+
+private:
+    CondVar<int>*        m_wakeups;
+};
+
+class SocketMultiplexerTests : public ::testing::Test {
+public:
+    SocketMultiplexerTests() : m_wakeups(&m_mutex, 0) { }
+    ~SocketMultiplexerTests();
+
+    // connect count loopback socket pairs.  the local ends get wakeup
+    // endpoints, the remote ends are written to by the test.
+    void                connectPairs(int count);
+
+    // time kWakeups single byte round trips through the multiplexer,
+    // returning the average time per wakeup in seconds
+    double                timeWakeups(SocketMultiplexer& multiplexer);
+
+    // add and remove the sockets after the first until kChurnCycles
+    // cycles are done.  runs on its own thread.
+    void                churnSockets(void* vmultiplexer);
+
+    // run the wakeups while other sockets are churned
+    void                stressChurn(bool usePollSet);
+
+public:
+    Mutex                m_mutex;
+    CondVar<int>        m_wakeups;
+    std::vector<std::unique_ptr<WakeupEndpoint>> m_local;
+    std::vector<ArchSocket> m_remote;
+};
+
+SocketMultiplexerTests::~SocketMultiplexerTests()
+{
+    for (ArchSocket socket : m_remote) {
+        ARCH->closeSocket(socket);
+    }
+}
+
+void
+SocketMultiplexerTests::connectPairs(int count)
+{
+    ArchNetAddress addr = ARCH->nameToAddr("127.0.0.1");
+    ARCH->setAddrPort(addr, TEST_PORT);
+
+    ArchSocket listener = ARCH->newSocket(IArchNetwork::kINET, IArchNetwork::kSTREAM);
+    ARCH->setReuseAddrOnSocket(listener, true);
+    ARCH->bindSocket(listener, addr);
+    ARCH->listenOnSocket(listener);
+
+    for (int i = 0; i < count; ++i) {
+        ArchSocket remote = ARCH->newSocket(IArchNetwork::kINET, IArchNetwork::kSTREAM);
+        ARCH->connectSocket(remote, addr);
+
+        ArchSocket local = NULL;
+        while (local == NULL) {
+            IArchNetwork::PollEntry pfd = { listener, IArchNetwork::kPOLLIN, 0 };
+            ARCH->pollSocket(&pfd, 1, 1.0);
+            local = ARCH->acceptSocket(listener, NULL);
+        }
+
+        m_remote.push_back(remote);
+        m_local.push_back(std::make_unique<WakeupEndpoint>(local, &m_wakeups));
+    }
+
+    ARCH->closeSocket(listener);
+    ARCH->closeAddr(addr);
+}
+
+double
+SocketMultiplexerTests::timeWakeups(SocketMultiplexer& multiplexer)
+{
+    for (auto& endpoint : m_local) {
+        endpoint->m_registered = true;
+        multiplexer.addSocket(endpoint.get(), endpoint->newJob());
+    }
+
+    {
+        Lock lock(&m_mutex);
+        m_wakeups = 0;
+    }
+
+    double start = ARCH->time();
+    for (int i = 0; i < kWakeups; ++i) {
+        char byte = 0;
+        ARCH->writeSocket(m_remote[i % m_remote.size()], &byte, 1);
+
+        Lock lock(&m_mutex);
+        while (m_wakeups < i + 1) {
+            if (!m_wakeups.wait(5.0)) {
+                ADD_FAILURE() << "wakeup " << i << " not delivered";
+                return 0.0;
+            }
+        }
+    }
+    double elapsed = ARCH->time() - start;
+
+    for (auto& endpoint : m_local) {
+        multiplexer.removeSocket(endpoint.get());
+    }
+
+    return elapsed / kWakeups;
+}
+
+void
+SocketMultiplexerTests::churnSockets(void* vmultiplexer)
+{
+    SocketMultiplexer* multiplexer = static_cast<SocketMultiplexer*>(vmultiplexer);
+
+    for (int cycle = 0; cycle < kChurnCycles; ++cycle) {
+        for (size_t i = 1; i < m_local.size(); ++i) {
+            {
+                Lock lock(&m_mutex);
+                m_local[i]->m_registered = true;
+            }
+            multiplexer->addSocket(m_local[i].get(), m_local[i]->newJob());
+        }
+        for (size_t i = 1; i < m_local.size(); ++i) {
+            multiplexer->removeSocket(m_local[i].get());
+
+            // the job must never run once removeSocket() returns
+            Lock lock(&m_mutex);
+            m_local[i]->m_registered = false;
+        }
+    }
+}
+
+void
+SocketMultiplexerTests::stressChurn(bool usePollSet)
+{
+    connectPairs(kChurnSockets);
+
+    // keep the churned sockets readable
+    for (size_t i = 1; i < m_local.size(); ++i) {
+        char byte = 0;
+        m_local[i]->m_drain = false;
+        ARCH->writeSocket(m_remote[i], &byte, 1);
+    }
+
+    SocketMultiplexer multiplexer(usePollSet);
+    m_local[0]->m_registered = true;
+    multiplexer.addSocket(m_local[0].get(), m_local[0]->newJob());
+
+    Thread churn(new TMethodJob<SocketMultiplexerTests>(
+                    this, &SocketMultiplexerTests::churnSockets, &multiplexer));
+
+    // traffic on the first socket must keep flowing.  nothing may return
+    // early while churn is using the multiplexer and sockets, so a missed
+    // wakeup stops the traffic and is checked once churn is done.
+    int delivered = 0;
+    bool wokenUp  = true;
+    while (wokenUp && !churn.wait(0.0)) {
+        int runs;
+        {
+            Lock lock(&m_mutex);
+            runs = m_local[0]->m_runs;
+        }
+
+        char byte = 0;
+        ARCH->writeSocket(m_remote[0], &byte, 1);
+        ++delivered;
+
+        Lock lock(&m_mutex);
+        while (m_local[0]->m_runs == runs) {
+            if (!m_wakeups.wait(5.0)) {
+                wokenUp = false;
+                break;
+            }
+        }
+    }
+    churn.wait();
+
+    multiplexer.removeSocket(m_local[0].get());
+    EXPECT_TRUE(wokenUp) << "wakeup not delivered";
+
+    int lateRuns = 0;
+    for (auto& endpoint : m_local) {
+        lateRuns += endpoint->m_lateRuns;
+    }
+    EXPECT_EQ(0, lateRuns);
+    LOG((CLOG_INFO "%d socket changes with %d writes delivered",
+        2 * kChurnCycles * (kChurnSockets - 1), delivered));
+}
+
+static
+void
+compareWakeups(SocketMultiplexerTests& test, int sockets)
+{
+    test.connectPairs(sockets);
+
+    SocketMultiplexer pollMultiplexer(false);
+    double pollTime = test.timeWakeups(pollMultiplexer);
+
+    SocketMultiplexer pollSetMultiplexer(true);
+    double pollSetTime = test.timeWakeups(pollSetMultiplexer);
+
+    LOG((CLOG_INFO "%d sockets: %.1fus per wakeup with poll, %.1fus with %s",
+        sockets, pollTime * 1.0e+6, pollSetTime * 1.0e+6,
+        pollSetMultiplexer.isUsingPollSet() ? "poll set" : "poll"));
+}
+
+TEST_F(SocketMultiplexerTests, wakeup_1Socket_allDelivered)
+{
+    compareWakeups(*this, 1);
+}
+
+TEST_F(SocketMultiplexerTests, wakeup_16Sockets_allDelivered)
+{
+    compareWakeups(*this, 16);
+}
+
+TEST_F(SocketMultiplexerTests, wakeup_256Sockets_allDelivered)
+{
+    compareWakeups(*this, 256);
+}
+
+TEST_F(SocketMultiplexerTests, churn_poll_jobsNeverRunAfterRemove)
+{
+    stressChurn(false);
+}
+
+TEST_F(SocketMultiplexerTests, churn_pollSet_jobsNeverRunAfterRemove)
+{
+    stressChurn(true);
+}
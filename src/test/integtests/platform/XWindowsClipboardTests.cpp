@@ -155,3 +155,265 @@ TEST_F(CXWindowsClipboardTests, get_withFormatAdded_returnsExpected)
 }
 
 #endif
+
+// gtest must come before Xlib, whose macros break it
+#include "test/global/gtest.h"
+
+#include "platform/XWindowsClipboard.h"
+#include "platform/XWindowsImpl.h"
+#include "platform/XWindowsUtil.h"
+#include "base/Log.h"
+#include "base/Stopwatch.h"
+#include "base/TMethodJob.h"
+#include "mt/Thread.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <poll.h>
+
+// these need an X server.  run them under Xvfb, e.g.
+//   xvfb-run bin/integtests --gtest_filter='XWindowsClipboardTests*'
+class XWindowsClipboardTests : public ::testing::Test {
+public:
+    XWindowsClipboardTests() :
+        m_ownerDisplay(NULL),
+        m_readerDisplay(NULL),
+        m_ownerWindow(None),
+        m_readerWindow(None),
+        m_stop(false) { }
+
+    virtual void        SetUp();
+    virtual void        TearDown();
+
+    // take ownership of the clipboard with the given data and start
+    // answering requests for it from another thread
+    void                serve(const std::string& text,
+                            const std::string& html);
+
+    // open the reader's clipboard at the current time
+    bool                open();
+
+    // stop answering requests and say if the owner was asked to
+    // convert to target
+    bool                wasRequested(const char* target);
+
+    void                answer(void*);
+
+public:
+    XWindowsImpl        m_impl;
+    Display*            m_ownerDisplay;
+    Display*            m_readerDisplay;
+    Window                m_ownerWindow;
+    Window                m_readerWindow;
+    std::unique_ptr<XWindowsClipboard> m_owner;
+    std::unique_ptr<XWindowsClipboard> m_reader;
+    std::unique_ptr<Thread> m_answerer;
+    std::atomic<bool>    m_stop;
+    std::mutex            m_requestsMutex;
+    std::vector<Atom>    m_requests;
+};
+
+void
+XWindowsClipboardTests::SetUp()
+{
+    // the owner and reader use separate connections, like separate
+    // applications would
+    m_ownerDisplay  = XOpenDisplay(NULL);
+    m_readerDisplay = XOpenDisplay(NULL);
+    if (m_ownerDisplay == NULL || m_readerDisplay == NULL) {
+        return;
+    }
+    m_ownerWindow  = XCreateSimpleWindow(m_ownerDisplay,
+                            DefaultRootWindow(m_ownerDisplay),
+                            0, 0, 1, 1, 0, 0, 0);
+    m_readerWindow = XCreateSimpleWindow(m_readerDisplay,
+                            DefaultRootWindow(m_readerDisplay),
+                            0, 0, 1, 1, 0, 0, 0);
+    m_owner.reset(new XWindowsClipboard(&m_impl, m_ownerDisplay,
+                            m_ownerWindow, kClipboardClipboard));
+    m_reader.reset(new XWindowsClipboard(&m_impl, m_readerDisplay,
+                            m_readerWindow, kClipboardClipboard));
+}
+
+void
+XWindowsClipboardTests::TearDown()
+{
+    if (m_answerer) {
+        m_stop = true;
+        m_answerer->wait();
+    }
+    m_owner.reset();
+    m_reader.reset();
+    if (m_ownerDisplay != NULL) {
+        if (m_ownerWindow != None) {
+            XDestroyWindow(m_ownerDisplay, m_ownerWindow);
+        }
+        XCloseDisplay(m_ownerDisplay);
+    }
+    if (m_readerDisplay != NULL) {
+        if (m_readerWindow != None) {
+            XDestroyWindow(m_readerDisplay, m_readerWindow);
+        }
+        XCloseDisplay(m_readerDisplay);
+    }
+}
+
+void
+XWindowsClipboardTests::serve(const std::string& text, const std::string& html)
+{
+    Time time = XWindowsUtil::getCurrentTime(m_ownerDisplay, m_ownerWindow);
+    ASSERT_TRUE(m_owner->open(time));
+    ASSERT_TRUE(m_owner->empty());
+    m_owner->add(IClipboard::kText, text);
+    m_owner->add(IClipboard::kHTML, html);
+    m_owner->close();
+
+    m_answerer.reset(new Thread(new TMethodJob<XWindowsClipboardTests>(
+                            this, &XWindowsClipboardTests::answer)));
+}
+
+bool
+XWindowsClipboardTests::open()
+{
+    return m_reader->open(XWindowsUtil::getCurrentTime(
+                            m_readerDisplay, m_readerWindow));
+}
+
+bool
+XWindowsClipboardTests::wasRequested(const char* target)
+{
+    if (m_answerer) {
+        m_stop = true;
+        m_answerer->wait();
+        m_answerer.reset();
+    }
+    Atom atom = XInternAtom(m_ownerDisplay, target, False);
+    std::lock_guard<std::mutex> lock(m_requestsMutex);
+    return (std::find(m_requests.begin(), m_requests.end(), atom) !=
+                            m_requests.end());
+}
+
+void
+XWindowsClipboardTests::answer(void*)
+{
+    // what XWindowsScreen does with selection events for its clipboards
+    while (!m_stop) {
+        while (XPending(m_ownerDisplay) > 0) {
+            XEvent xevent;
+            XNextEvent(m_ownerDisplay, &xevent);
+            switch (xevent.type) {
+            case SelectionRequest:
+                {
+                    std::lock_guard<std::mutex> lock(m_requestsMutex);
+                    m_requests.push_back(xevent.xselectionrequest.target);
+                }
+                m_owner->addRequest(xevent.xselectionrequest.owner,
+                            xevent.xselectionrequest.requestor,
+                            xevent.xselectionrequest.target,
+                            xevent.xselectionrequest.time,
+                            xevent.xselectionrequest.property);
+                break;
+
+            case PropertyNotify:
+                if (xevent.xproperty.state == PropertyDelete) {
+                    m_owner->processRequest(xevent.xproperty.window,
+                            xevent.xproperty.time,
+                            xevent.xproperty.atom);
+                }
+                break;
+
+            case DestroyNotify:
+                m_owner->destroyRequest(xevent.xdestroywindow.window);
+                break;
+            }
+        }
+
+        struct pollfd pfd;
+        pfd.fd     = ConnectionNumber(m_ownerDisplay);
+        pfd.events = POLLIN;
+        poll(&pfd, 1, 10);
+    }
+}
+
+TEST_F(XWindowsClipboardTests, get_largeSelection_transferredIntact)
+{
+    if (m_ownerDisplay == NULL || m_readerDisplay == NULL) {
+        LOG((CLOG_WARN "no X display, skipping"));
+        return;
+    }
+
+    // several times the maximum request size so it goes INCR
+    std::string html(4 * 1024 * 1024, 'x');
+    serve("barrier rocks!", html);
+
+    ASSERT_TRUE(open());
+    EXPECT_TRUE(m_reader->has(IClipboard::kText));
+    EXPECT_TRUE(m_reader->has(IClipboard::kHTML));
+    EXPECT_FALSE(m_reader->has(IClipboard::kBitmap));
+    EXPECT_EQ("barrier rocks!", m_reader->get(IClipboard::kText));
+    EXPECT_TRUE(html == m_reader->get(IClipboard::kHTML));
+    m_reader->close();
+}
+
+TEST_F(XWindowsClipboardTests, get_textOnly_htmlNeverConverted)
+{
+    if (m_ownerDisplay == NULL || m_readerDisplay == NULL) {
+        LOG((CLOG_WARN "no X display, skipping"));
+        return;
+    }
+
+    std::string html(1024 * 1024, 'x');
+    serve("barrier rocks!", html);
+
+    // the owner offers html so has() needn't transfer it
+    ASSERT_TRUE(open());
+    EXPECT_TRUE(m_reader->has(IClipboard::kHTML));
+    EXPECT_EQ("barrier rocks!", m_reader->get(IClipboard::kText));
+    m_reader->close();
+
+    EXPECT_FALSE(wasRequested("text/html"));
+    EXPECT_TRUE(wasRequested("TARGETS"));
+}
+
+TEST_F(XWindowsClipboardTests, DISABLED_benchmark_largeSelection)
+{
+    if (m_ownerDisplay == NULL || m_readerDisplay == NULL) {
+        LOG((CLOG_WARN "no X display, skipping"));
+        return;
+    }
+
+    // html is offered as UTF-16 so twice this goes over the wire
+    const size_t kSizes[] = { 1, 2, 4 };
+    for (size_t i = 0; i < sizeof(kSizes) / sizeof(kSizes[0]); ++i) {
+        if (m_answerer) {
+            m_stop = true;
+            m_answerer->wait();
+            m_stop = false;
+        }
+        std::string html(kSizes[i] * 1024 * 1024, 'x');
+        serve("barrier rocks!", html);
+
+        int filter = CLOG->getFilter();
+        CLOG->setFilter(kINFO);
+        Stopwatch timer;
+        ASSERT_TRUE(open());
+        for (int format = 0; format != IClipboard::kNumFormats; ++format) {
+            m_reader->has(static_cast<IClipboard::EFormat>(format));
+        }
+        double formats = timer.getTime();
+        std::string text = m_reader->get(IClipboard::kText);
+        double textTime = timer.getTime() - formats;
+        bool intact = (html == m_reader->get(IClipboard::kHTML));
+        double htmlTime = timer.getTime() - formats - textTime;
+        m_reader->close();
+        CLOG->setFilter(filter);
+
+        EXPECT_TRUE(intact);
+        LOG((CLOG_INFO "%uMB html selection: formats known after %.1fms, text after %.1fms more, html after %.1fms more",
+            static_cast<unsigned int>(kSizes[i]),
+            1000.0 * formats, 1000.0 * textTime, 1000.0 * htmlTime));
+    }
+}
@@ -0,0 +1,212 @@
+/*
+ * barrier -- mouse and keyboard sharing utility
+ * Copyright (C) 2018 Debauchee Open Source Group
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file LICENSE that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// gtest must come before Xlib, whose macros break it
+#include "test/global/gtest.h"
+
+#include "platform/XWindowsEventQueueBuffer.h"
+#include "platform/XWindowsImpl.h"
+#include "base/EventQueue.h"
+#include "base/Log.h"
+#include "base/TMethodEventJob.h"
+#include "base/TMethodJob.h"
+#include "mt/Thread.h"
+#include "arch/Arch.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+// these need an X server.  run them under Xvfb, e.g.
+//   xvfb-run bin/integtests --gtest_filter='XWindowsEventQueueBuffer*'
+class XWindowsEventQueueBufferTests : public ::testing::Test {
+public:
+    XWindowsEventQueueBufferTests() :
+        m_display(NULL),
+        m_window(None),
+        m_startType(Event::kUnknown),
+        m_type(Event::kUnknown),
+        m_interval(0.0),
+        m_next(0),
+        m_inOrder(true) { }
+
+    virtual void        SetUp();
+    virtual void        TearDown();
+
+    // add count events from another thread, interval seconds apart, and
+    // run the event loop until they've all been dispatched.  returns
+    // false if they didn't arrive in order.
+    bool                run(int count, double interval);
+
+    void                handleStart(const Event&, void*);
+    void                handleNumber(const Event&, void*);
+    void                handleTimeout(const Event&, void*);
+    void                produce(void*);
+
+public:
+    Display*            m_display;
+    Window                m_window;
+    XWindowsImpl        m_impl;
+    std::unique_ptr<EventQueue> m_events;
+    Event::Type            m_startType;
+    Event::Type            m_type;
+    double                m_interval;
+    int                    m_next;
+    bool                m_inOrder;
+    std::unique_ptr<Thread> m_producer;
+
+    // the time each event was added and the latency of each
+    std::vector<double>    m_sent;
+    std::vector<double>    m_latencies;
+};
+
+void
+XWindowsEventQueueBufferTests::SetUp()
+{
+    m_display = XOpenDisplay(NULL);
+    if (m_display == NULL) {
+        return;
+    }
+    m_window = XCreateSimpleWindow(m_display, DefaultRootWindow(m_display),
+                            0, 0, 1, 1, 0, 0, 0);
+
+    m_events.reset(new EventQueue);
+    m_events->adoptBuffer(new XWindowsEventQueueBuffer(&m_impl,
+                            m_display, m_window, m_events.get()));
+    m_events->registerTypeOnce(m_startType, "start");
+    m_events->registerTypeOnce(m_type, "number");
+}
+
+void
+XWindowsEventQueueBufferTests::TearDown()
+{
+    if (m_display != NULL) {
+        m_events.reset();
+        XDestroyWindow(m_display, m_window);
+        XCloseDisplay(m_display);
+    }
+}
+
+bool
+XWindowsEventQueueBufferTests::run(int count, double interval)
+{
+    m_interval = interval;
+    m_next     = 0;
+    m_inOrder  = true;
+    m_sent.assign(count, 0.0);
+    m_latencies.clear();
+
+    m_events->adoptHandler(m_startType, this,
+                            new TMethodEventJob<XWindowsEventQueueBufferTests>(
+                                this, &XWindowsEventQueueBufferTests::handleStart));
+    m_events->adoptHandler(m_type, this,
+                            new TMethodEventJob<XWindowsEventQueueBufferTests>(
+                                this, &XWindowsEventQueueBufferTests::handleNumber));
+    EventQueueTimer* timer = m_events->newOneShotTimer(30.0, NULL);
+    m_events->adoptHandler(Event::kTimer, timer,
+                            new TMethodEventJob<XWindowsEventQueueBufferTests>(
+                                this, &XWindowsEventQueueBufferTests::handleTimeout));
+
+    // added before the loop starts so it's the first event dispatched
+    m_events->addEvent(Event(m_startType, this));
+    m_events->loop();
+
+    m_producer->wait();
+    m_events->removeHandler(Event::kTimer, timer);
+    m_events->deleteTimer(timer);
+    return (m_inOrder && m_next == count);
+}
+
+void
+XWindowsEventQueueBufferTests::handleStart(const Event&, void*)
+{
+    m_producer.reset(new Thread(new TMethodJob<XWindowsEventQueueBufferTests>(
+                            this, &XWindowsEventQueueBufferTests::produce)));
+}
+
+void
+XWindowsEventQueueBufferTests::handleNumber(const Event& event, void*)
+{
+    int number = static_cast<int>(
+                            reinterpret_cast<intptr_t>(event.getData()));
+    if (number != m_next) {
+        m_inOrder = false;
+        m_events->addEvent(Event(Event::kQuit));
+        return;
+    }
+    m_latencies.push_back(ARCH->time() - m_sent[m_next]);
+    if (++m_next == static_cast<int>(m_sent.size())) {
+        m_events->addEvent(Event(Event::kQuit));
+    }
+}
+
+void
+XWindowsEventQueueBufferTests::handleTimeout(const Event&, void*)
+{
+    m_events->addEvent(Event(Event::kQuit));
+}
+
+void
+XWindowsEventQueueBufferTests::produce(void*)
+{
+    for (size_t i = 0; i < m_sent.size(); ++i) {
+        if (m_interval > 0.0) {
+            ARCH->sleep(m_interval);
+        }
+        m_sent[i] = ARCH->time();
+        m_events->addEvent(Event(m_type, this,
+                            reinterpret_cast<void*>(static_cast<intptr_t>(i)),
+                            Event::kDontFreeData));
+    }
+}
+
+static
+double
+percentile(std::vector<double>& latencies, int percent)
+{
+    std::sort(latencies.begin(), latencies.end());
+    return latencies[latencies.size() * percent / 100] * 1.0e+6;
+}
+
+TEST_F(XWindowsEventQueueBufferTests, addEvent_fromOtherThread_dispatchedInOrder)
+{
+    if (m_display == NULL) {
+        LOG((CLOG_WARN "no X display, skipping"));
+        return;
+    }
+
+    // more than fit in the local queue at once
+    EXPECT_TRUE(run(20000, 0.0));
+}
+
+TEST_F(XWindowsEventQueueBufferTests, DISABLED_benchmark_latency)
+{
+    if (m_display == NULL) {
+        LOG((CLOG_WARN "no X display, skipping"));
+        return;
+    }
+
+    // about the rate mouse motion arrives from the server
+    int filter = CLOG->getFilter();
+    CLOG->setFilter(kINFO);
+    bool inOrder = run(2000, 0.001);
+    CLOG->setFilter(filter);
+
+    ASSERT_TRUE(inOrder);
+    LOG((CLOG_INFO "user events at 1 kHz through the X event queue: p50 %.1fus p99 %.1fus",
+        percentile(m_latencies, 50), percentile(m_latencies, 99)));
+}
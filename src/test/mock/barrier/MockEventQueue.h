@@ -41,6 +41,7 @@ public:
     MOCK_METHOD1(dispatchEvent, bool(const Event&));
     MOCK_CONST_METHOD2(getHandler, IEventJob*(Event::Type, void*));
     MOCK_METHOD1(deleteTimer, void(EventQueueTimer*));
+    MOCK_METHOD1(touchTimer, void(EventQueueTimer*));
     MOCK_CONST_METHOD1(getRegisteredType, Event::Type(const std::string&));
     MOCK_METHOD0(getSystemTarget, void*());
     MOCK_METHOD0(forClient, ClientEvents&());
@@ -52,6 +53,7 @@ public:
     MOCK_METHOD0(forIDataSocket, IDataSocketEvents&());
     MOCK_METHOD0(forIListenSocket, IListenSocketEvents&());
     MOCK_METHOD0(forISocket, ISocketEvents&());
+    MOCK_METHOD0(forAddressResolver, AddressResolverEvents&());
     MOCK_METHOD0(forOSXScreen, OSXScreenEvents&());
     MOCK_METHOD0(forClientListener, ClientListenerEvents&());
     MOCK_METHOD0(forClientProxy, ClientProxyEvents&());
@@ -30,7 +30,9 @@ public:
     MockStream() { }
     MOCK_METHOD0(close, void());
     MOCK_METHOD2(read, UInt32(void*, UInt32));
+    MOCK_METHOD1(readAll, UInt32(StreamBuffer&));
     MOCK_METHOD2(write, void(const void*, UInt32));
+    MOCK_METHOD2(writev, void(const StreamBuffer::Span*, UInt32));
     MOCK_METHOD0(flush, void());
     MOCK_METHOD0(shutdownInput, void());
     MOCK_METHOD0(shutdownOutput, void());
@@ -17,6 +17,8 @@
  */
 
 #include "barrier/Clipboard.h"
+#include "base/Log.h"
+#include "base/Stopwatch.h"
 
 #include "test/global/gtest.h"
 
@@ -402,3 +404,130 @@ TEST(ClipboardTests, copy_withSingleText_clipboardsAreEqual)
     String actual = clipboard2.get(Clipboard::kText);
     EXPECT_EQ("barrier rocks!", actual);
 }
+
+TEST(ClipboardTests, copy_clipboardToClipboard_marshalledDataShared)
+{
+    Clipboard clipboard1;
+    clipboard1.open(0);
+    clipboard1.empty();
+    clipboard1.add(Clipboard::kText, "barrier rocks!");
+    clipboard1.close();
+
+    Clipboard clipboard2;
+    Clipboard clipboard3;
+    Clipboard::copy(&clipboard2, &clipboard1);
+    Clipboard::copy(&clipboard3, &clipboard2);
+
+    EXPECT_EQ(clipboard1.marshallShared(), clipboard3.marshallShared());
+    EXPECT_EQ(IClipboard::marshall(&clipboard1), *clipboard3.marshallShared());
+}
+
+TEST(ClipboardTests, marshallShared_afterAdd_dataRebuilt)
+{
+    Clipboard clipboard;
+    clipboard.open(0);
+    clipboard.empty();
+    clipboard.add(Clipboard::kText, "barrier rocks!");
+    clipboard.close();
+    std::shared_ptr<const String> before = clipboard.marshallShared();
+
+    clipboard.open(0);
+    clipboard.add(Clipboard::kHTML, "<b>barrier rocks!</b>");
+    clipboard.close();
+
+    EXPECT_EQ("barrier rocks!", before->substr(12));
+    EXPECT_EQ(IClipboard::marshall(&clipboard), *clipboard.marshallShared());
+}
+
+TEST(ClipboardTests, hasSameData_sameTextAddedSeparately_returnsTrue)
+{
+    Clipboard clipboard1;
+    clipboard1.open(0);
+    clipboard1.empty();
+    clipboard1.add(Clipboard::kText, "barrier rocks!");
+    clipboard1.close();
+
+    Clipboard clipboard2;
+    clipboard2.open(1);
+    clipboard2.empty();
+    clipboard2.add(Clipboard::kText, "barrier rocks!");
+    clipboard2.close();
+
+    EXPECT_TRUE(clipboard1.hasSameData(clipboard2));
+}
+
+TEST(ClipboardTests, hasSameData_differentText_returnsFalse)
+{
+    Clipboard clipboard1;
+    clipboard1.open(0);
+    clipboard1.empty();
+    clipboard1.add(Clipboard::kText, "barrier rocks!");
+    clipboard1.close();
+
+    Clipboard clipboard2;
+    clipboard2.open(0);
+    clipboard2.empty();
+    clipboard2.add(Clipboard::kText, "barrier rolls!");
+    clipboard2.close();
+
+    EXPECT_FALSE(clipboard1.hasSameData(clipboard2));
+}
+
+TEST(ClipboardTests, hasSameData_extraFormat_returnsFalse)
+{
+    Clipboard clipboard1;
+    clipboard1.open(0);
+    clipboard1.empty();
+    clipboard1.add(Clipboard::kText, "barrier rocks!");
+    clipboard1.close();
+
+    Clipboard clipboard2(clipboard1);
+    clipboard2.open(0);
+    clipboard2.add(Clipboard::kHTML, "");
+    clipboard2.close();
+
+    EXPECT_TRUE(clipboard1.hasSameData(Clipboard(clipboard1)));
+    EXPECT_FALSE(clipboard1.hasSameData(clipboard2));
+}
+
+TEST(ClipboardTests, DISABLED_benchmark_changeSentToClients)
+{
+    // what the server does with one change to a large clipboard: check
+    // it changed then send it to each client
+    const size_t kSize    = 50 * 1024 * 1024;
+    const int    kClients = 4;
+
+    Clipboard server;
+    server.open(0);
+    server.empty();
+    server.add(Clipboard::kText, String(kSize, 'x'));
+    server.close();
+
+    // before: compare marshalled copies, copy and marshall per client
+    Stopwatch timer;
+    String last = IClipboard::marshall(&server);
+    String data = IClipboard::marshall(&server);
+    bool changed = (data != last);
+    for (int i = 0; i < kClients; ++i) {
+        Clipboard client;
+        IClipboard::copy(&client, &server);
+        String sent = IClipboard::marshall(&client);
+        changed = changed && !sent.empty();
+    }
+    double copying = timer.getTime();
+
+    // after: compare hashes, share one marshalled buffer
+    timer.reset();
+    Clipboard previous(server);
+    changed = !server.hasSameData(previous);
+    for (int i = 0; i < kClients; ++i) {
+        Clipboard client;
+        Clipboard::copy(&client, &server);
+        changed = changed && !client.marshallShared()->empty();
+    }
+    double sharing = timer.getTime();
+
+    EXPECT_FALSE(changed);
+    LOG((CLOG_INFO "50MB clipboard to %d clients: %.1fms copying, %.1fms sharing",
+        kClients, 1000.0 * copying, 1000.0 * sharing));
+}
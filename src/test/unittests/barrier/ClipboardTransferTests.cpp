@@ -0,0 +1,276 @@
+/*
+ * barrier -- mouse and keyboard sharing utility
+ * Copyright (C) 2018 Debauchee Open Source Group
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file LICENSE that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "barrier/ClipboardSender.h"
+#include "barrier/ClipboardReceiver.h"
+#include "barrier/Clipboard.h"
+#include "barrier/ProtocolMessage.h"
+#include "base/EventQueue.h"
+
+#include "test/global/gtest.h"
+#include <memory>
+#include <vector>
+
+// a stream that keeps what's written for the receiver to read
+class ClipboardTransferStream : public barrier::IStream {
+public:
+    // IStream overrides
+    virtual void        close() { }
+    virtual UInt32        read(void* buffer, UInt32 n)
+    {
+        return m_buffer.read(buffer, n);
+    }
+    virtual UInt32        readAll(StreamBuffer& buffer)
+    {
+        UInt32 n = m_buffer.getSize();
+        buffer.append(m_buffer, n);
+        return n;
+    }
+    virtual void        write(const void* buffer, UInt32 n)
+    {
+        m_buffer.write(buffer, n);
+    }
+    virtual void        writev(const StreamBuffer::Span* buffers,
+                            UInt32 count)
+    {
+        for (UInt32 i = 0; i < count; ++i) {
+            m_buffer.write(buffers[i].m_data, (UInt32)buffers[i].m_size);
+        }
+    }
+    virtual void        flush() { }
+    virtual void        shutdownInput() { }
+    virtual void        shutdownOutput() { }
+    virtual void*        getEventTarget() const
+    {
+        return const_cast<ClipboardTransferStream*>(this);
+    }
+    virtual bool        isReady() const { return m_buffer.getSize() != 0; }
+    virtual UInt32        getSize() const { return m_buffer.getSize(); }
+
+public:
+    StreamBuffer        m_buffer;
+};
+
+class ClipboardTransferTests : public ::testing::Test {
+public:
+    ClipboardTransferTests() : m_sender(&m_stream, &m_events) { }
+
+    // read every message in the stream, returning the results of the
+    // receiver
+    std::vector<int>    receive();
+
+    // tell the sender the stream has been flushed
+    void                flushed();
+
+    static ClipboardSender::Data
+                        marshall(const String& text, const String& html);
+
+public:
+    EventQueue            m_events;
+    ClipboardTransferStream m_stream;
+    ClipboardSender        m_sender;
+    ClipboardReceiver    m_receiver;
+};
+
+std::vector<int>
+ClipboardTransferTests::receive()
+{
+    std::vector<int> results;
+    while (m_stream.isReady()) {
+        UInt32 code;
+        FieldInt<4>::read(&m_stream, &code);
+        EXPECT_EQ(kMsgCodeDClipboard, code);
+        results.push_back(m_receiver.read(&m_stream));
+    }
+    return results;
+}
+
+void
+ClipboardTransferTests::flushed()
+{
+    m_events.addEvent(Event(m_events.forIStream().outputFlushed(),
+                            m_stream.getEventTarget(), NULL,
+                            Event::kDeliverImmediately));
+}
+
+ClipboardSender::Data
+ClipboardTransferTests::marshall(const String& text, const String& html)
+{
+    Clipboard clipboard;
+    clipboard.open(0);
+    clipboard.add(IClipboard::kText, text);
+    if (!html.empty()) {
+        clipboard.add(IClipboard::kHTML, html);
+    }
+    clipboard.close();
+    return clipboard.marshallShared();
+}
+
+TEST_F(ClipboardTransferTests, send_smallClipboard_sentAtOnce)
+{
+    m_sender.send(kClipboardClipboard, 7, marshall("barrier rocks!", ""));
+    EXPECT_FALSE(m_sender.isSending());
+
+    std::vector<int> results = receive();
+    ASSERT_EQ(3u, results.size());
+    EXPECT_EQ(kStart, results[0]);
+    EXPECT_EQ(kNotFinish, results[1]);
+    EXPECT_EQ(kFinish, results[2]);
+    EXPECT_EQ(kClipboardClipboard, m_receiver.getID());
+    EXPECT_EQ(7u, m_receiver.getSequence());
+
+    Clipboard clipboard;
+    m_receiver.takeClipboard(&clipboard, 0);
+    clipboard.open(0);
+    EXPECT_EQ("barrier rocks!", clipboard.get(IClipboard::kText));
+    EXPECT_FALSE(clipboard.has(IClipboard::kHTML));
+    clipboard.close();
+}
+
+TEST_F(ClipboardTransferTests, send_largeClipboard_sentAsStreamFlushes)
+{
+    const String text(4 * 1024 * 1024, 't');
+    const String html(1024 * 1024 + 5, 'h');
+    m_sender.send(kClipboardSelection, 1, marshall(text, html));
+
+    int flushes = 0;
+    int result  = kError;
+    while (m_sender.isSending()) {
+        // only a window is written at a time
+        EXPECT_GT(1024u * 1024u, m_stream.getSize());
+        std::vector<int> results = receive();
+        ASSERT_FALSE(results.empty());
+        result = results.back();
+        EXPECT_NE(kError, result);
+        flushed();
+        ++flushes;
+    }
+    std::vector<int> results = receive();
+    if (!results.empty()) {
+        result = results.back();
+    }
+    ASSERT_EQ(kFinish, result);
+    EXPECT_LT(5, flushes);
+
+    Clipboard clipboard;
+    m_receiver.takeClipboard(&clipboard, 0);
+    clipboard.open(0);
+    EXPECT_TRUE(clipboard.get(IClipboard::kText) == text);
+    EXPECT_TRUE(clipboard.get(IClipboard::kHTML) == html);
+    clipboard.close();
+}
+
+TEST_F(ClipboardTransferTests, send_sameClipboardWhileSending_onlyLatestReceived)
+{
+    m_sender.send(kClipboardClipboard, 1, marshall(String(2 * 1024 * 1024, 'a'), ""));
+    receive();
+    m_sender.send(kClipboardClipboard, 2, marshall("latest", ""));
+
+    int finished = 0;
+    while (m_sender.isSending()) {
+        flushed();
+        std::vector<int> results = receive();
+        for (size_t i = 0; i < results.size(); ++i) {
+            EXPECT_NE(kError, results[i]);
+            finished += (results[i] == kFinish) ? 1 : 0;
+        }
+    }
+    EXPECT_EQ(1, finished);
+    EXPECT_EQ(2u, m_receiver.getSequence());
+
+    Clipboard clipboard;
+    m_receiver.takeClipboard(&clipboard, 0);
+    clipboard.open(0);
+    EXPECT_EQ("latest", clipboard.get(IClipboard::kText));
+    clipboard.close();
+}
+
+TEST_F(ClipboardTransferTests, read_integersSplitAcrossChunks_unmarshalled)
+{
+    ClipboardSender::Data data = marshall("text", "<b>html</b>");
+    MsgDClipboard::write(&m_stream, kClipboardClipboard, 0, kDataStart,
+                            barrier::string::sizeTypeToString(data->size()));
+    for (size_t i = 0; i < data->size(); i += 3) {
+        MsgDClipboard::write(&m_stream, kClipboardClipboard, 0, kDataChunk,
+                            data->substr(i, 3));
+    }
+    MsgDClipboard::write(&m_stream, kClipboardClipboard, 0, kDataEnd, String());
+
+    std::vector<int> results = receive();
+    ASSERT_EQ(kFinish, results.back());
+
+    Clipboard clipboard;
+    m_receiver.takeClipboard(&clipboard, 0);
+    clipboard.open(0);
+    EXPECT_EQ("text", clipboard.get(IClipboard::kText));
+    EXPECT_EQ("<b>html</b>", clipboard.get(IClipboard::kHTML));
+    clipboard.close();
+}
+
+TEST_F(ClipboardTransferTests, read_unknownFormat_skipped)
+{
+    // a format from a newer version followed by text
+    String data;
+    data.append("\0\0\0\2", 4);
+    data.append("\0\0\0\x63", 4);
+    data.append("\0\0\0\3", 4);
+    data.append("new");
+    data.append("\0\0\0\0", 4);
+    data.append("\0\0\0\4", 4);
+    data.append("text");
+    MsgDClipboard::write(&m_stream, kClipboardClipboard, 0, kDataStart,
+                            barrier::string::sizeTypeToString(data.size()));
+    MsgDClipboard::write(&m_stream, kClipboardClipboard, 0, kDataChunk, data);
+    MsgDClipboard::write(&m_stream, kClipboardClipboard, 0, kDataEnd, String());
+
+    std::vector<int> results = receive();
+    ASSERT_EQ(kFinish, results.back());
+
+    Clipboard clipboard;
+    m_receiver.takeClipboard(&clipboard, 0);
+    clipboard.open(0);
+    EXPECT_EQ("text", clipboard.get(IClipboard::kText));
+    clipboard.close();
+}
+
+TEST_F(ClipboardTransferTests, read_formatLongerThanData_returnsError)
+{
+    String data;
+    data.append("\0\0\0\1", 4);
+    data.append("\0\0\0\0", 4);
+    data.append("\0\0\1\0", 4);
+    data.append("short");
+    MsgDClipboard::write(&m_stream, kClipboardClipboard, 0, kDataStart,
+                            barrier::string::sizeTypeToString(data.size()));
+    MsgDClipboard::write(&m_stream, kClipboardClipboard, 0, kDataChunk, data);
+    MsgDClipboard::write(&m_stream, kClipboardClipboard, 0, kDataEnd, String());
+
+    std::vector<int> results = receive();
+    ASSERT_EQ(3u, results.size());
+    EXPECT_EQ(kError, results[1]);
+    EXPECT_EQ(kError, results[2]);
+}
+
+TEST_F(ClipboardTransferTests, read_chunkWithoutStart_returnsError)
+{
+    MsgDClipboard::write(&m_stream, kClipboardClipboard, 0, kDataChunk,
+                            String("\0\0\0\0", 4));
+
+    std::vector<int> results = receive();
+    ASSERT_EQ(1u, results.size());
+    EXPECT_EQ(kError, results[0]);
+}
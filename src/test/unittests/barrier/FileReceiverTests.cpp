@@ -0,0 +1,279 @@
+/*
+ * barrier -- mouse and keyboard sharing utility
+ * Copyright (C) 2018 Debauchee Open Source Group
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file LICENSE that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "barrier/FileReceiver.h"
+#include "barrier/ProtocolMessage.h"
+#include "barrier/protocol_types.h"
+#include "io/IStream.h"
+#include "io/StreamBuffer.h"
+
+#include "test/global/gtest.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if SYSAPI_UNIX
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define TEST_DIR "FileReceiverTests.tmp"
+#define SAVE_PATH "FileReceiverTests.out"
+
+// a stream that keeps what's written for the receiver to read
+class FileReceiverStream : public barrier::IStream {
+public:
+    // IStream overrides
+    virtual void        close() { }
+    virtual UInt32        read(void* buffer, UInt32 n)
+    {
+        return m_buffer.read(buffer, n);
+    }
+    virtual UInt32        readAll(StreamBuffer& buffer)
+    {
+        UInt32 n = m_buffer.getSize();
+        buffer.append(m_buffer, n);
+        return n;
+    }
+    virtual void        write(const void* buffer, UInt32 n)
+    {
+        m_buffer.write(buffer, n);
+    }
+    virtual void        writev(const StreamBuffer::Span* buffers,
+                            UInt32 count)
+    {
+        for (UInt32 i = 0; i < count; ++i) {
+            m_buffer.write(buffers[i].m_data, (UInt32)buffers[i].m_size);
+        }
+    }
+    virtual void        flush() { }
+    virtual void        shutdownInput() { }
+    virtual void        shutdownOutput() { }
+    virtual void*        getEventTarget() const
+    {
+        return const_cast<FileReceiverStream*>(this);
+    }
+    virtual bool        isReady() const { return m_buffer.getSize() != 0; }
+    virtual UInt32        getSize() const { return m_buffer.getSize(); }
+
+public:
+    StreamBuffer        m_buffer;
+};
+
+// the temporary files go in a directory of the test's own so it can
+// check what's left there
+class FileReceiverTests : public ::testing::Test {
+public:
+    virtual void        SetUp();
+    virtual void        TearDown();
+
+    // send a file chunk message to the receiver and return its result
+    int                    receive(UInt8 mark, const String& data);
+
+    // send a whole file to the receiver in chunks of chunkSize
+    void                receiveFile(const String& data, size_t chunkSize);
+
+    // the names of the files in the temporary directory
+    static std::vector<std::string> getTemporaryFiles();
+
+    static String        readFile(const char* path);
+
+public:
+    std::string            m_oldTmpDir;
+    bool                m_hadTmpDir;
+    FileReceiverStream    m_stream;
+    FileReceiver*        m_receiver;
+};
+
+void
+FileReceiverTests::SetUp()
+{
+    const char* dir = getenv("TMPDIR");
+    m_hadTmpDir = (dir != NULL);
+    m_oldTmpDir = m_hadTmpDir ? dir : "";
+    mkdir(TEST_DIR, 0700);
+    setenv("TMPDIR", TEST_DIR, 1);
+    m_receiver = new FileReceiver;
+}
+
+void
+FileReceiverTests::TearDown()
+{
+    delete m_receiver;
+    std::vector<std::string> names = getTemporaryFiles();
+    for (size_t i = 0; i < names.size(); ++i) {
+        remove((std::string(TEST_DIR "/") + names[i]).c_str());
+    }
+    rmdir(TEST_DIR);
+    remove(SAVE_PATH);
+    if (m_hadTmpDir) {
+        setenv("TMPDIR", m_oldTmpDir.c_str(), 1);
+    }
+    else {
+        unsetenv("TMPDIR");
+    }
+}
+
+int
+FileReceiverTests::receive(UInt8 mark, const String& data)
+{
+    MsgDFileTransfer::write(&m_stream, mark, data);
+    UInt32 code;
+    FieldInt<4>::read(&m_stream, &code);
+    EXPECT_EQ(kMsgCodeDFileTransfer, code);
+    return m_receiver->read(&m_stream);
+}
+
+void
+FileReceiverTests::receiveFile(const String& data, size_t chunkSize)
+{
+    std::ostringstream size;
+    size << data.size();
+    ASSERT_EQ(kStart, receive(kDataStart, size.str()));
+    for (size_t i = 0; i < data.size(); i += chunkSize) {
+        ASSERT_EQ(kNotFinish, receive(kDataChunk, data.substr(i, chunkSize)));
+    }
+    ASSERT_EQ(kFinish, receive(kDataEnd, ""));
+}
+
+std::vector<std::string>
+FileReceiverTests::getTemporaryFiles()
+{
+    std::vector<std::string> names;
+    DIR* dir = opendir(TEST_DIR);
+    if (dir != NULL) {
+        while (struct dirent* entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name != "." && name != "..") {
+                names.push_back(name);
+            }
+        }
+        closedir(dir);
+    }
+    return names;
+}
+
+String
+FileReceiverTests::readFile(const char* path)
+{
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    std::ostringstream data;
+    data << file.rdbuf();
+    return data.str();
+}
+
+TEST_F(FileReceiverTests, read_wholeFile_savedIntact)
+{
+    String data(100000, '\0');
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = (char)(i * 7 + i / 251);
+    }
+    receiveFile(data, 4096);
+
+    EXPECT_TRUE(m_receiver->isComplete());
+    EXPECT_EQ(data.size(), m_receiver->getSize());
+    ASSERT_TRUE(m_receiver->save(SAVE_PATH));
+    EXPECT_TRUE(readFile(SAVE_PATH) == data);
+    EXPECT_TRUE(getTemporaryFiles().empty());
+}
+
+TEST_F(FileReceiverTests, read_tooManyBytes_error)
+{
+    ASSERT_EQ(kStart, receive(kDataStart, "4"));
+    EXPECT_EQ(kError, receive(kDataChunk, "12345"));
+    EXPECT_EQ(kError, receive(kDataEnd, ""));
+    EXPECT_FALSE(m_receiver->isComplete());
+    EXPECT_FALSE(m_receiver->save(SAVE_PATH));
+}
+
+TEST_F(FileReceiverTests, read_tooFewBytes_error)
+{
+    ASSERT_EQ(kStart, receive(kDataStart, "10"));
+    EXPECT_EQ(kNotFinish, receive(kDataChunk, "12345"));
+    EXPECT_EQ(kError, receive(kDataEnd, ""));
+    EXPECT_FALSE(m_receiver->isComplete());
+    EXPECT_FALSE(m_receiver->save(SAVE_PATH));
+}
+
+TEST_F(FileReceiverTests, read_chunkWithoutStart_error)
+{
+    EXPECT_EQ(kError, receive(kDataChunk, "12345"));
+    EXPECT_EQ(kError, receive(kDataEnd, ""));
+    EXPECT_FALSE(m_receiver->isComplete());
+    EXPECT_TRUE(getTemporaryFiles().empty());
+}
+
+TEST_F(FileReceiverTests, read_start_temporaryFileOnlyForUs)
+{
+    ASSERT_EQ(kStart, receive(kDataStart, "5"));
+
+    std::vector<std::string> names = getTemporaryFiles();
+    ASSERT_EQ(1u, names.size());
+    struct stat info;
+    ASSERT_EQ(0, stat((std::string(TEST_DIR "/") + names[0]).c_str(), &info));
+    EXPECT_EQ(0, (int)(info.st_mode & 077));
+}
+
+TEST_F(FileReceiverTests, save_existingFile_replaced)
+{
+    std::ofstream(SAVE_PATH) << "an older and longer file";
+    receiveFile("new", 4096);
+
+    ASSERT_TRUE(m_receiver->save(SAVE_PATH));
+    EXPECT_EQ("new", readFile(SAVE_PATH));
+}
+
+TEST_F(FileReceiverTests, save_file_permissionsFromUmask)
+{
+    mode_t mask = umask(027);
+    receiveFile("data", 4096);
+    bool saved = m_receiver->save(SAVE_PATH);
+    umask(mask);
+
+    ASSERT_TRUE(saved);
+    struct stat info;
+    ASSERT_EQ(0, stat(SAVE_PATH, &info));
+    EXPECT_EQ(0640, (int)(info.st_mode & 0777));
+}
+
+TEST_F(FileReceiverTests, read_startDuringFile_partialFileDeleted)
+{
+    ASSERT_EQ(kStart, receive(kDataStart, "10"));
+    ASSERT_EQ(kNotFinish, receive(kDataChunk, "12345"));
+    EXPECT_EQ(1u, getTemporaryFiles().size());
+
+    receiveFile("new", 4096);
+    EXPECT_EQ(1u, getTemporaryFiles().size());
+    ASSERT_TRUE(m_receiver->save(SAVE_PATH));
+    EXPECT_EQ("new", readFile(SAVE_PATH));
+}
+
+TEST_F(FileReceiverTests, destructor_partialFile_temporaryFileDeleted)
+{
+    ASSERT_EQ(kStart, receive(kDataStart, "10"));
+    ASSERT_EQ(kNotFinish, receive(kDataChunk, "12345"));
+    EXPECT_EQ(1u, getTemporaryFiles().size());
+
+    delete m_receiver;
+    m_receiver = NULL;
+    EXPECT_TRUE(getTemporaryFiles().empty());
+}
+
+#endif
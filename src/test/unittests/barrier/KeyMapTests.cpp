@@ -214,5 +214,28 @@ TEST(KeyMapTests, isCommand_superMask_returnTrue)
     
     EXPECT_EQ(true, keyMap.isCommand(mask));
 }
-    
+
+TEST(KeyMapTests, findCompatibleKey_keysAddedAroundFinish_found)
+{
+    KeyMap keyMap;
+    KeyMap::KeyItem item = KeyMap::KeyItem();
+    item.m_id     = 'b';
+    item.m_button = 2;
+    keyMap.addKeyEntry(item);
+    keyMap.finish();
+
+    // added in front of the key already in the index
+    item.m_id     = 'a';
+    item.m_button = 1;
+    keyMap.addKeyEntry(item);
+
+    const KeyMap::KeyItemList* a = keyMap.findCompatibleKey('a', 0, 0, 0);
+    const KeyMap::KeyItemList* b = keyMap.findCompatibleKey('b', 0, 0, 0);
+    ASSERT_TRUE(a != NULL);
+    ASSERT_TRUE(b != NULL);
+    EXPECT_EQ(1, a->back().m_button);
+    EXPECT_EQ(2, b->back().m_button);
+    EXPECT_TRUE(keyMap.findCompatibleKey('c', 0, 0, 0) == NULL);
+}
+
 }
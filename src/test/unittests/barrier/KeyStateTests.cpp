@@ -19,6 +19,9 @@
 #include "test/mock/barrier/MockKeyState.h"
 #include "test/mock/barrier/MockEventQueue.h"
 #include "test/mock/barrier/MockKeyMap.h"
+#include "barrier/key_types.h"
+#include "base/Log.h"
+#include "arch/Arch.h"
 
 #include "test/global/gtest.h"
 #include "test/global/gmock.h"
@@ -463,6 +466,295 @@ TEST(KeyStateTests, isKeyDown_noKeysDown_returnsFalse)
     ASSERT_FALSE(actual);
 }
 
+// a key state with a complete keyboard layout that counts the keystrokes
+// it would synthesize
+class LayoutKeyState : public KeyState {
+public:
+    enum ELayout { kUS, kDE, kJP };
+
+    LayoutKeyState(const MockEventQueue& eventQueue, ELayout layout) :
+        KeyState((IEventQueue*)&eventQueue),
+        m_layout(layout),
+        m_keystrokes(0),
+        m_groupChanges(0) { }
+
+    // press and release each key in text, holding shift for shifted
+    // characters the way a US server keyboard reports them
+    void                type(const std::vector<KeyID>& text);
+
+    // press and release key with control held
+    void                command(KeyID id);
+
+    // KeyState overrides
+    virtual bool        fakeCtrlAltDel() { return false; }
+    virtual bool        fakeMediaKey(KeyID) { return false; }
+    virtual KeyModifierMask
+                        pollActiveModifiers() const { return 0; }
+    virtual SInt32        pollActiveGroup() const { return 0; }
+    virtual void        pollPressedKeys(KeyButtonSet&) const { }
+
+protected:
+    virtual void        getKeyMap(barrier::KeyMap& keyMap);
+    virtual void        fakeKey(const Keystroke& keystroke);
+
+private:
+    static void            addKey(barrier::KeyMap& keyMap, KeyID id,
+                            SInt32 group, KeyButton button,
+                            KeyModifierMask required,
+                            KeyModifierMask sensitive);
+    static void            addRow(barrier::KeyMap& keyMap, SInt32 group,
+                            KeyButton button, const char* lower,
+                            const char* upper, KeyModifierMask sensitive);
+    static void            addModifiers(barrier::KeyMap& keyMap, SInt32 group);
+
+public:
+    ELayout                m_layout;
+    UInt32                m_keystrokes;
+    UInt32                m_groupChanges;
+};
+
+void
+LayoutKeyState::type(const std::vector<KeyID>& text)
+{
+    static const char* s_shifted = "~!@#$%^&*()_+{}|:\"<>?";
+    for (size_t i = 0; i < text.size(); ++i) {
+        KeyID id   = text[i];
+        bool shift = (id >= 'A' && id <= 'Z') ||
+                     (id >= '!' && id < 0x80 && strchr(s_shifted, id) != NULL);
+        if (shift) {
+            fakeKeyDown(kKeyShift_L, 0, 1);
+        }
+        fakeKeyDown(id, shift ? KeyModifierShift : 0, 2);
+        fakeKeyUp(2);
+        if (shift) {
+            fakeKeyUp(1);
+        }
+    }
+}
+
+void
+LayoutKeyState::command(KeyID id)
+{
+    fakeKeyDown(kKeyControl_L, 0, 3);
+    fakeKeyDown(id, KeyModifierControl, 2);
+    fakeKeyUp(2);
+    fakeKeyUp(3);
+}
+
+void
+LayoutKeyState::getKeyMap(barrier::KeyMap& keyMap)
+{
+    const KeyModifierMask levels = (m_layout == kDE) ?
+                            KeyModifierShift | KeyModifierAltGr :
+                            KeyModifierShift;
+    addModifiers(keyMap, 0);
+    addKey(keyMap, kKeyEscape, 0, 9, 0, 0);
+    addKey(keyMap, kKeyBackSpace, 0, 22, 0, 0);
+    addKey(keyMap, kKeyTab, 0, 23, 0, 0);
+    addKey(keyMap, kKeyReturn, 0, 36, 0, 0);
+    addKey(keyMap, ' ', 0, 65, 0, 0);
+    addKey(keyMap, kKeyLeft, 0, 113, 0, 0);
+    addKey(keyMap, kKeyRight, 0, 114, 0, 0);
+
+    if (m_layout != kDE) {
+        addRow(keyMap, 0, 10, "1234567890-=", "!@#$%^&*()_+", levels);
+        addRow(keyMap, 0, 24, "qwertyuiop[]", "QWERTYUIOP{}", levels);
+        addRow(keyMap, 0, 38, "asdfghjkl;'`", "ASDFGHJKL:\"~", levels);
+        addRow(keyMap, 0, 51, "\\zxcvbnm,./", "|ZXCVBNM<>?", levels);
+    }
+    else {
+        addKey(keyMap, kKeyAltGr, 0, 108, 0, 0);
+        addRow(keyMap, 0, 10, "1234567890", "!\"\xa7$%&/()=", levels);
+        addRow(keyMap, 0, 24, "qwertzuiop", "QWERTZUIOP", levels);
+        addRow(keyMap, 0, 38, "asdfghjkl", "ASDFGHJKL", levels);
+        addRow(keyMap, 0, 52, "yxcvbnm,.-", "YXCVBNM;:_", levels);
+        addRow(keyMap, 0, 94, "<", ">", levels);
+        addRow(keyMap, 0, 51, "#", "'", levels);
+        addRow(keyMap, 0, 35, "+", "*", levels);
+        addKey(keyMap, 0xdf, 0, 20, 0, levels);
+        addKey(keyMap, '?', 0, 20, KeyModifierShift, levels);
+        addKey(keyMap, 0xfc, 0, 34, 0, levels);
+        addKey(keyMap, 0xdc, 0, 34, KeyModifierShift, levels);
+        addKey(keyMap, 0xf6, 0, 47, 0, levels);
+        addKey(keyMap, 0xd6, 0, 47, KeyModifierShift, levels);
+        addKey(keyMap, 0xe4, 0, 48, 0, levels);
+        addKey(keyMap, 0xc4, 0, 48, KeyModifierShift, levels);
+        addKey(keyMap, kKeyDeadCircumflex, 0, 49, 0, levels);
+        addKey(keyMap, kKeyDeadAcute, 0, 21, 0, levels);
+        addKey(keyMap, kKeyDeadGrave, 0, 21, KeyModifierShift, levels);
+
+        // third level
+        static const struct { KeyButton m_button; KeyID m_id; } s_altGr[] = {
+            { 11, 0xb2 }, { 12, 0xb3 }, { 16, '{' }, { 17, '[' },
+            { 18, ']' }, { 19, '}' }, { 20, '\\' }, { 24, '@' },
+            { 26, 0x20ac }, { 35, '~' }, { 58, 0xb5 }, { 94, '|' }
+        };
+        for (size_t i = 0; i < sizeof(s_altGr) / sizeof(s_altGr[0]); ++i) {
+            addKey(keyMap, s_altGr[i].m_id, 0, s_altGr[i].m_button,
+                            KeyModifierAltGr, levels);
+        }
+    }
+
+    if (m_layout == kJP) {
+        // a kana group on the same buttons
+        addModifiers(keyMap, 1);
+        addKey(keyMap, kKeyKana, 0, 101, 0, 0);
+        addKey(keyMap, kKeyZenkaku, 0, 49, 0, 0);
+        addKey(keyMap, ' ', 1, 65, 0, 0);
+        addKey(keyMap, kKeyReturn, 1, 36, 0, 0);
+        KeyID kana = 0x3041;
+        for (KeyButton button = 10; button < 62; ++button, ++kana) {
+            addKey(keyMap, kana, 1, button, 0, KeyModifierShift);
+            addKey(keyMap, kana + 0x60, 1, button, KeyModifierShift,
+                            KeyModifierShift);
+        }
+    }
+}
+
+void
+LayoutKeyState::fakeKey(const Keystroke& keystroke)
+{
+    if (keystroke.m_type == Keystroke::kGroup) {
+        ++m_groupChanges;
+    }
+    ++m_keystrokes;
+}
+
+void
+LayoutKeyState::addKey(barrier::KeyMap& keyMap, KeyID id, SInt32 group,
+                KeyButton button, KeyModifierMask required,
+                KeyModifierMask sensitive)
+{
+    barrier::KeyMap::KeyItem item;
+    item.m_id        = id;
+    item.m_group     = group;
+    item.m_button    = button;
+    item.m_required  = required;
+    item.m_sensitive = sensitive;
+    item.m_client    = 0;
+    barrier::KeyMap::initModifierKey(item);
+    keyMap.addKeyEntry(item);
+}
+
+void
+LayoutKeyState::addRow(barrier::KeyMap& keyMap, SInt32 group,
+                KeyButton button, const char* lower, const char* upper,
+                KeyModifierMask sensitive)
+{
+    for (; *lower != '\0'; ++lower, ++upper, ++button) {
+        addKey(keyMap, (unsigned char)*lower, group, button, 0, sensitive);
+        addKey(keyMap, (unsigned char)*upper, group, button,
+                            KeyModifierShift, sensitive);
+    }
+}
+
+void
+LayoutKeyState::addModifiers(barrier::KeyMap& keyMap, SInt32 group)
+{
+    addKey(keyMap, kKeyShift_L, group, 50, 0, 0);
+    addKey(keyMap, kKeyShift_R, group, 62, 0, 0);
+    addKey(keyMap, kKeyControl_L, group, 37, 0, 0);
+    addKey(keyMap, kKeyControl_R, group, 105, 0, 0);
+    addKey(keyMap, kKeyAlt_L, group, 64, 0, 0);
+    addKey(keyMap, kKeySuper_L, group, 133, 0, 0);
+    addKey(keyMap, kKeyCapsLock, group, 66, 0, 0);
+    addKey(keyMap, kKeyNumLock, group, 77, 0, 0);
+}
+
+static std::vector<KeyID>
+toKeyIDs(const char* text)
+{
+    std::vector<KeyID> ids;
+    for (; *text != '\0'; ++text) {
+        ids.push_back((unsigned char)*text);
+    }
+    return ids;
+}
+
+TEST(KeyStateTests, fakeKeyDown_shiftedOnAltGrLayout_modifiersRestored)
+{
+    MockEventQueue eventQueue;
+    LayoutKeyState keyState(eventQueue, LayoutKeyState::kDE);
+    keyState.updateKeyMap();
+
+    // '@' needs AltGr instead of the shift that's down
+    keyState.fakeKeyDown(kKeyShift_L, 0, 1);
+    keyState.fakeKeyDown('@', KeyModifierShift, 2);
+    EXPECT_TRUE(keyState.isKeyDown(24));
+    EXPECT_TRUE(keyState.isKeyDown(50));
+    EXPECT_FALSE(keyState.isKeyDown(108));
+    keyState.fakeKeyUp(2);
+    keyState.fakeKeyUp(1);
+    EXPECT_EQ(0, keyState.getActiveModifiers());
+}
+
+TEST(KeyStateTests, fakeKeyDown_keyInOtherGroup_groupRestored)
+{
+    MockEventQueue eventQueue;
+    LayoutKeyState keyState(eventQueue, LayoutKeyState::kJP);
+    keyState.updateKeyMap();
+
+    keyState.fakeKeyDown(0x3041, 0, 2);
+    EXPECT_TRUE(keyState.isKeyDown(10));
+    EXPECT_EQ(2u, keyState.m_groupChanges);
+    keyState.fakeKeyUp(2);
+}
+
+TEST(KeyStateTests, DISABLED_benchmark_fakeKeyDown)
+{
+    const int kRepeats = 400;
+    std::vector<KeyID> latin = toKeyIDs(
+        "The quick brown fox jumps over the lazy dog. "
+        "Pack my box with five dozen liquor jugs! (1234567890) "
+        "user@example.com {a[0] | b} ~/x ");
+    static const KeyID s_german[] = {
+        'G', 0xfc, 0xdf, 'e', ' ', 0xe4, 0xf6, 0xfc, ' ', 0xc4, 0xd6,
+        0xdc, ' ', 0x20ac, ' ', 0xe9, 0xea, ' '
+    };
+    std::vector<KeyID> german(s_german,
+                            s_german + sizeof(s_german) / sizeof(s_german[0]));
+    std::vector<KeyID> kana;
+    for (KeyID id = 0x3041; id < 0x3061; ++id) {
+        kana.push_back(id);
+        if ((id & 7) == 0) {
+            kana.push_back(' ');
+        }
+    }
+
+    static const char* s_names[] = { "US", "DE", "JP" };
+    for (int layout = LayoutKeyState::kUS;
+                            layout <= LayoutKeyState::kJP; ++layout) {
+        MockEventQueue eventQueue;
+        LayoutKeyState keyState(eventQueue, (LayoutKeyState::ELayout)layout);
+        keyState.updateKeyMap();
+
+        std::vector<KeyID> text = latin;
+        if (layout == LayoutKeyState::kDE) {
+            text.insert(text.end(), german.begin(), german.end());
+        }
+        if (layout == LayoutKeyState::kJP) {
+            text.insert(text.end(), kana.begin(), kana.end());
+        }
+
+        int filter = CLOG->getFilter();
+        CLOG->setFilter(kINFO);
+        double start = ARCH->time();
+        for (int i = 0; i < kRepeats; ++i) {
+            keyState.type(text);
+            keyState.command('c');
+            keyState.command('v');
+        }
+        double elapsed = ARCH->time() - start;
+        CLOG->setFilter(filter);
+
+        EXPECT_EQ(0, keyState.getActiveModifiers());
+        double presses = (double)kRepeats * (text.size() + 2);
+        LOG((CLOG_INFO "%s layout: %.1fns per key press, %u keystrokes",
+            s_names[layout], elapsed * 1.0e+9 / presses,
+            keyState.m_keystrokes));
+    }
+}
+
 void
 stubPollPressedKeys(IKeyState::KeyButtonSet& pressedKeys)
 {
@@ -0,0 +1,112 @@
+/*
+ * barrier -- mouse and keyboard sharing utility
+ * Copyright (C) 2018 Debauchee Open Source Group
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file LICENSE that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "barrier/MotionCoalescer.h"
+
+#include "test/global/gtest.h"
+
+TEST(MotionCoalescerTests, takePosition_burst_returnsLatest)
+{
+    MotionCoalescer motion;
+    motion.addPosition(1, 2);
+    motion.addPosition(3, 4);
+    motion.addPosition(5, 6);
+
+    SInt32 x, y;
+    ASSERT_TRUE(motion.takePosition(x, y));
+    EXPECT_EQ(5, x);
+    EXPECT_EQ(6, y);
+    EXPECT_FALSE(motion.takePosition(x, y));
+    EXPECT_EQ(3u, motion.getEventsIn());
+    EXPECT_EQ(1u, motion.getEventsOut());
+}
+
+TEST(MotionCoalescerTests, takeDelta_burst_returnsSum)
+{
+    MotionCoalescer motion;
+    motion.addDelta(3.0, -1.0);
+    motion.addDelta(2.0, -4.0);
+
+    SInt32 dx, dy;
+    ASSERT_TRUE(motion.takeDelta(dx, dy));
+    EXPECT_EQ(5, dx);
+    EXPECT_EQ(-5, dy);
+    EXPECT_FALSE(motion.takeDelta(dx, dy));
+}
+
+TEST(MotionCoalescerTests, takeDelta_fractions_carriedOver)
+{
+    // slow motion on a high resolution mouse
+    MotionCoalescer motion;
+    SInt32 dx, dy, xTotal = 0, yTotal = 0;
+    for (int i = 0; i < 10; ++i) {
+        motion.addDelta(0.25, -0.5);
+        if (motion.takeDelta(dx, dy)) {
+            xTotal += dx;
+            yTotal += dy;
+        }
+    }
+
+    EXPECT_EQ(2, xTotal);
+    EXPECT_EQ(-5, yTotal);
+}
+
+TEST(MotionCoalescerTests, takeDelta_backAndForth_noDrift)
+{
+    MotionCoalescer motion;
+    SInt32 dx, dy;
+    motion.addDelta(0.75, 0.0);
+    EXPECT_FALSE(motion.takeDelta(dx, dy));
+    motion.addDelta(-0.75, 0.0);
+    EXPECT_FALSE(motion.takeDelta(dx, dy));
+    motion.addDelta(-0.5, 0.0);
+    EXPECT_FALSE(motion.takeDelta(dx, dy));
+}
+
+TEST(MotionCoalescerTests, reset_discardsMotion)
+{
+    MotionCoalescer motion;
+    motion.addPosition(1, 2);
+    motion.addDelta(0.75, 0.75);
+    motion.reset();
+    motion.addDelta(0.5, 0.5);
+
+    SInt32 x, y;
+    EXPECT_FALSE(motion.takePosition(x, y));
+    EXPECT_FALSE(motion.takeDelta(x, y));
+}
+
+TEST(MotionCoalescerTests, takeDelta_lateEventLoop_oneEventPerTake)
+{
+    // a 1000 Hz mouse moving 3.4 pixels per report, with the event loop
+    // getting round to the X connection every period milliseconds
+    const int kReports = 2000;
+    const int kPeriods[] = { 1, 2, 4, 8 };
+    for (size_t i = 0; i < sizeof(kPeriods) / sizeof(kPeriods[0]); ++i) {
+        MotionCoalescer motion;
+        SInt32 dx, dy;
+        for (int report = 0; report < kReports; ++report) {
+            motion.addDelta(3.4, -1.7);
+            if ((report + 1) % kPeriods[i] == 0) {
+                EXPECT_TRUE(motion.takeDelta(dx, dy));
+            }
+        }
+
+        EXPECT_EQ((UInt32)kReports, motion.getEventsIn());
+        EXPECT_EQ((UInt32)(kReports / kPeriods[i]), motion.getEventsOut());
+    }
+}
@@ -0,0 +1,87 @@
+/*
+ * barrier -- mouse and keyboard sharing utility
+ * Copyright (C) 2018 Debauchee Open Source Group
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file LICENSE that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "barrier/PacketStreamFilter.h"
+#include "base/IEventJob.h"
+#include "test/mock/barrier/MockEventQueue.h"
+#include "test/mock/io/MockStream.h"
+
+#include "test/global/gtest.h"
+#include "test/global/gmock.h"
+
+#include <string>
+
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::NiceMock;
+using ::testing::Return;
+
+class PacketStreamFilterTests : public ::testing::Test {
+public:
+    PacketStreamFilterTests() : m_writes(0)
+    {
+        ON_CALL(m_stream, getEventTarget()).WillByDefault(Return(&m_stream));
+        ON_CALL(m_events, adoptHandler(_, _, _)).WillByDefault(
+            Invoke([](Event::Type, void*, IEventJob* job) { delete job; }));
+        ON_CALL(m_stream, writev(_, _)).WillByDefault(
+            Invoke(this, &PacketStreamFilterTests::recordWrite));
+    }
+
+    void                recordWrite(const StreamBuffer::Span* buffers,
+                            UInt32 count)
+    {
+        ++m_writes;
+        for (UInt32 i = 0; i < count; ++i) {
+            const char* data = static_cast<const char*>(buffers[i].m_data);
+            m_written.append(data, buffers[i].m_size);
+        }
+    }
+
+public:
+    NiceMock<MockEventQueue> m_events;
+    NiceMock<MockStream> m_stream;
+    int                    m_writes;
+    std::string            m_written;
+};
+
+TEST_F(PacketStreamFilterTests, write_payload_lengthAndPayloadInOneWrite)
+{
+    PacketStreamFilter filter(&m_events, &m_stream, false);
+
+    filter.write("hello", 5);
+
+    EXPECT_EQ(1, m_writes);
+    EXPECT_EQ(std::string("\0\0\0\5hello", 9), m_written);
+}
+
+TEST_F(PacketStreamFilterTests, writev_manyBuffers_framedAsOnePacket)
+{
+    PacketStreamFilter filter(&m_events, &m_stream, false);
+
+    // 5 x "ab" and 5 x "b" is 15 bytes
+    std::string expected("\0\0\0\x0f", 4);
+    StreamBuffer::Span buffers[10];
+    for (int i = 0; i < 10; ++i) {
+        buffers[i].m_data = "ab" + (i % 2);
+        buffers[i].m_size = 2 - (i % 2);
+        expected.append("ab" + (i % 2), 2 - (i % 2));
+    }
+    filter.writev(buffers, 10);
+
+    EXPECT_EQ(1, m_writes);
+    EXPECT_EQ(expected, m_written);
+}
@@ -0,0 +1,67 @@
+/*
+ * barrier -- mouse and keyboard sharing utility
+ * Copyright (C) 2018 Debauchee Open Source Group
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file LICENSE that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "barrier/protocol_types.h"
+
+#include "test/global/gtest.h"
+
+static
+UInt32
+codeOf(const char* msg)
+{
+    return toMessageCode(reinterpret_cast<const UInt8*>(msg));
+}
+
+#define EXPECT_CODE(name_) \
+    EXPECT_EQ(kMsgCode##name_, codeOf(kMsg##name_)) << #name_
+
+TEST(ProtocolTypesTests, messageCodes_matchMessages)
+{
+    EXPECT_CODE(CNoop);
+    EXPECT_CODE(CClose);
+    EXPECT_CODE(CEnter);
+    EXPECT_CODE(CLeave);
+    EXPECT_CODE(CClipboard);
+    EXPECT_CODE(CScreenSaver);
+    EXPECT_CODE(CResetOptions);
+    EXPECT_CODE(CInfoAck);
+    EXPECT_CODE(CKeepAlive);
+    EXPECT_CODE(DKeyDown);
+    EXPECT_CODE(DKeyRepeat);
+    EXPECT_CODE(DKeyUp);
+    EXPECT_CODE(DMouseDown);
+    EXPECT_CODE(DMouseUp);
+    EXPECT_CODE(DMouseMove);
+    EXPECT_CODE(DMouseRelMove);
+    EXPECT_CODE(DMouseWheel);
+    EXPECT_CODE(DClipboard);
+    EXPECT_CODE(DInfo);
+    EXPECT_CODE(DSetOptions);
+    EXPECT_CODE(DFileTransfer);
+    EXPECT_CODE(DDragInfo);
+    EXPECT_CODE(QInfo);
+    EXPECT_CODE(EIncompatible);
+    EXPECT_CODE(EBusy);
+    EXPECT_CODE(EUnknown);
+    EXPECT_CODE(EBad);
+
+    // older versions of messages have the same code
+    EXPECT_EQ(kMsgCodeDKeyDown, codeOf(kMsgDKeyDown1_0));
+    EXPECT_EQ(kMsgCodeDKeyRepeat, codeOf(kMsgDKeyRepeat1_0));
+    EXPECT_EQ(kMsgCodeDKeyUp, codeOf(kMsgDKeyUp1_0));
+    EXPECT_EQ(kMsgCodeDMouseWheel, codeOf(kMsgDMouseWheel1_0));
+}
@@ -0,0 +1,624 @@
+/*
+ * barrier -- mouse and keyboard sharing utility
+ * Copyright (C) 2018 Debauchee Open Source Group
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file LICENSE that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "base/EventQueue.h"
+#include "base/Log.h"
+#include "base/TMethodEventJob.h"
+#include "base/TMethodJob.h"
+#include "mt/Thread.h"
+#include "arch/Arch.h"
+
+#include "test/global/gtest.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+const int kProducers = 4;
+
+// adds numbered events from several threads and checks that each
+// thread's events are dispatched in order
+class EventQueueTests : public ::testing::Test {
+public:
+    EventQueueTests() :
+        m_startType(Event::kUnknown),
+        m_numberType(Event::kUnknown),
+        m_perProducer(0),
+        m_interval(0.0),
+        m_received(0),
+        m_churning(false) { }
+
+    // start count producers adding perProducer events each, or add them
+    // all from the event thread if count is 0, and run the event loop
+    // until they've all been dispatched.  producers wait interval
+    // seconds between events.
+    void                run(int count, int perProducer, double interval = 0.0);
+
+    void                handleStart(const Event&, void*);
+    void                handleNumber(const Event&, void* vproducer);
+    void                handleTimeout(const Event&, void*);
+    void                handleCount(const Event&, void* vcount);
+    void                produce(void* vproducer);
+    void                churnHandlers(void*);
+
+    // adopt a handler that counts its events in count
+    void                countEvents(Event::Type type, void* target, int& count);
+
+    // wait up to timeout seconds for a timer event and return its timer,
+    // or NULL if there wasn't one
+    EventQueueTimer*    waitForTimer(double timeout,
+                            IEventQueue::TimerEvent* info = NULL);
+
+public:
+    EventQueue            m_events;
+    Event::Type            m_startType;
+    Event::Type            m_numberType;
+    int                    m_perProducer;
+    double                m_interval;
+    int                    m_received;
+    std::vector<std::unique_ptr<Thread>> m_threads;
+
+    // per producer:  the next number expected and the time each number
+    // was added
+    std::vector<int>    m_next;
+    std::vector<std::vector<double>> m_sent;
+    std::vector<double>    m_latencies;
+    std::atomic<bool>    m_churning;
+};
+
+void
+EventQueueTests::run(int count, int perProducer, double interval)
+{
+    int producers = std::max(count, 1);
+    m_perProducer = perProducer;
+    m_interval    = interval;
+    m_next.assign(producers, 0);
+    m_sent.assign(producers, std::vector<double>(perProducer));
+    m_latencies.reserve(producers * perProducer);
+
+    m_events.registerTypeOnce(m_startType, "start");
+    m_events.registerTypeOnce(m_numberType, "number");
+    m_events.adoptHandler(m_startType, this,
+                            new TMethodEventJob<EventQueueTests>(this,
+                                &EventQueueTests::handleStart,
+                                reinterpret_cast<void*>(static_cast<intptr_t>(count))));
+    for (int i = 0; i < producers; ++i) {
+        m_events.adoptHandler(m_numberType, &m_next[i],
+                            new TMethodEventJob<EventQueueTests>(this,
+                                &EventQueueTests::handleNumber,
+                                reinterpret_cast<void*>(static_cast<intptr_t>(i))));
+    }
+    EventQueueTimer* timer = m_events.newOneShotTimer(30.0, NULL);
+    m_events.adoptHandler(Event::kTimer, timer,
+                            new TMethodEventJob<EventQueueTests>(this,
+                                &EventQueueTests::handleTimeout));
+
+    // added before the loop starts so it's the first event dispatched
+    m_events.addEvent(Event(m_startType, this));
+    m_events.loop();
+
+    for (auto& thread : m_threads) {
+        thread->wait();
+    }
+    m_events.deleteTimer(timer);
+    EXPECT_EQ(producers * perProducer, m_received);
+}
+
+void
+EventQueueTests::handleStart(const Event&, void* vcount)
+{
+    int count = static_cast<int>(reinterpret_cast<intptr_t>(vcount));
+    if (count == 0) {
+        produce(NULL);
+    }
+    for (int i = 0; i < count; ++i) {
+        m_threads.push_back(std::make_unique<Thread>(
+                            new TMethodJob<EventQueueTests>(this,
+                                &EventQueueTests::produce,
+                                reinterpret_cast<void*>(static_cast<intptr_t>(i)))));
+    }
+}
+
+void
+EventQueueTests::produce(void* vproducer)
+{
+    intptr_t producer = reinterpret_cast<intptr_t>(vproducer);
+    std::vector<double>& sent = m_sent[producer];
+    for (intptr_t i = 0; i < m_perProducer; ++i) {
+        if (m_interval > 0.0) {
+            ARCH->sleep(m_interval);
+        }
+        sent[i] = ARCH->time();
+        m_events.addEvent(Event(m_numberType, &m_next[producer],
+                            reinterpret_cast<void*>(i), Event::kDontFreeData));
+    }
+}
+
+void
+EventQueueTests::handleNumber(const Event& event, void* vproducer)
+{
+    intptr_t producer = reinterpret_cast<intptr_t>(vproducer);
+    int number = static_cast<int>(reinterpret_cast<intptr_t>(event.getData()));
+    m_latencies.push_back(ARCH->time() - m_sent[producer][number]);
+
+    EXPECT_EQ(m_next[producer], number);
+    m_next[producer] = number + 1;
+
+    if (++m_received == (int)m_sent.size() * m_perProducer) {
+        m_events.addEvent(Event(Event::kQuit));
+    }
+}
+
+void
+EventQueueTests::handleTimeout(const Event&, void*)
+{
+    ADD_FAILURE() << "only " << m_received << " events dispatched";
+    m_events.addEvent(Event(Event::kQuit));
+}
+
+void
+EventQueueTests::handleCount(const Event&, void* vcount)
+{
+    ++*static_cast<int*>(vcount);
+}
+
+void
+EventQueueTests::countEvents(Event::Type type, void* target, int& count)
+{
+    m_events.adoptHandler(type, target,
+                            new TMethodEventJob<EventQueueTests>(this,
+                                &EventQueueTests::handleCount, &count));
+}
+
+void
+EventQueueTests::churnHandlers(void*)
+{
+    std::vector<int> targets(100);
+    int count = 0;
+    while (m_churning) {
+        for (size_t i = 0; i < targets.size(); ++i) {
+            countEvents(m_numberType, &targets[i], count);
+        }
+        for (size_t i = 0; i < targets.size(); ++i) {
+            m_events.removeHandlers(&targets[i]);
+        }
+    }
+}
+
+TEST_F(EventQueueTests, dispatchEvent_typeHandler_runsIt)
+{
+    m_events.registerTypeOnce(m_numberType, "number");
+    int count = 0, other = 0;
+    countEvents(m_numberType, this, count);
+    countEvents(Event::kUnknown, this, other);
+
+    EXPECT_TRUE(m_events.dispatchEvent(Event(m_numberType, this)));
+    EXPECT_EQ(1, count);
+    EXPECT_EQ(0, other);
+}
+
+TEST_F(EventQueueTests, dispatchEvent_noTypeHandler_fallsBackToAnyType)
+{
+    m_events.registerTypeOnce(m_startType, "start");
+    m_events.registerTypeOnce(m_numberType, "number");
+    int count = 0, other = 0;
+    countEvents(m_numberType, this, count);
+    countEvents(Event::kUnknown, this, other);
+
+    EXPECT_TRUE(m_events.dispatchEvent(Event(m_startType, this)));
+    EXPECT_EQ(0, count);
+    EXPECT_EQ(1, other);
+
+    EXPECT_FALSE(m_events.dispatchEvent(Event(m_startType, &count)));
+}
+
+TEST_F(EventQueueTests, adoptHandler_replacesHandler)
+{
+    m_events.registerTypeOnce(m_numberType, "number");
+    int first = 0, second = 0;
+    countEvents(m_numberType, this, first);
+    countEvents(m_numberType, this, second);
+
+    m_events.dispatchEvent(Event(m_numberType, this));
+    EXPECT_EQ(0, first);
+    EXPECT_EQ(1, second);
+}
+
+TEST_F(EventQueueTests, removeHandlers_manyTargets_removesOnlyTarget)
+{
+    m_events.registerTypeOnce(m_startType, "start");
+    m_events.registerTypeOnce(m_numberType, "number");
+    std::vector<int> counts(1000);
+    for (size_t i = 0; i < counts.size(); ++i) {
+        countEvents(m_startType, &counts[i], counts[i]);
+        countEvents(m_numberType, &counts[i], counts[i]);
+    }
+
+    m_events.removeHandlers(&counts[10]);
+    m_events.removeHandler(m_numberType, &counts[11]);
+
+    for (size_t i = 0; i < counts.size(); ++i) {
+        m_events.dispatchEvent(Event(m_startType, &counts[i]));
+        m_events.dispatchEvent(Event(m_numberType, &counts[i]));
+    }
+    EXPECT_EQ(NULL, m_events.getHandler(m_startType, &counts[10]));
+    EXPECT_EQ(0, counts[10]);
+    EXPECT_EQ(1, counts[11]);
+    EXPECT_EQ(2, counts[12]);
+    EXPECT_EQ(2, counts[counts.size() - 1]);
+}
+
+TEST_F(EventQueueTests, removeHandler_manyTimes_keepsOtherHandlers)
+{
+    m_events.registerTypeOnce(m_numberType, "number");
+    std::vector<int> counts(20);
+    for (size_t i = 0; i < counts.size(); i += 2) {
+        countEvents(m_numberType, &counts[i], counts[i]);
+    }
+
+    // leaves removed slots behind until the table is rebuilt
+    for (int round = 0; round < 1000; ++round) {
+        for (size_t i = 1; i < counts.size(); i += 2) {
+            countEvents(m_numberType, &counts[i], counts[i]);
+        }
+        for (size_t i = 1; i < counts.size(); i += 2) {
+            m_events.removeHandler(m_numberType, &counts[i]);
+        }
+    }
+
+    for (size_t i = 0; i < counts.size(); ++i) {
+        m_events.dispatchEvent(Event(m_numberType, &counts[i]));
+    }
+    for (size_t i = 0; i < counts.size(); i += 2) {
+        EXPECT_EQ(1, counts[i]);
+        EXPECT_EQ(0, counts[i + 1]);
+        EXPECT_EQ(NULL, m_events.getHandler(m_numberType, &counts[i + 1]));
+    }
+}
+
+TEST_F(EventQueueTests, dispatchEvent_countsLookupsAndMisses)
+{
+    m_events.registerTypeOnce(m_startType, "start");
+    m_events.registerTypeOnce(m_numberType, "number");
+    int count = 0;
+    countEvents(m_numberType, this, count);
+
+    m_events.dispatchEvent(Event(m_numberType, this));
+    m_events.dispatchEvent(Event(m_numberType, this));
+    m_events.dispatchEvent(Event(m_startType, this));
+
+    UInt32 lookups, misses;
+    m_events.getHandlerStats(m_numberType, lookups, misses);
+    EXPECT_EQ(2, lookups);
+    EXPECT_EQ(0, misses);
+    m_events.getHandlerStats(m_startType, lookups, misses);
+    EXPECT_EQ(1, lookups);
+    EXPECT_EQ(1, misses);
+}
+
+TEST_F(EventQueueTests, dispatchEvent_whileHandlersChange_findsHandler)
+{
+    m_events.registerTypeOnce(m_numberType, "number");
+    int count = 0;
+    countEvents(m_numberType, this, count);
+
+    m_churning = true;
+    Thread thread(new TMethodJob<EventQueueTests>(this,
+                                &EventQueueTests::churnHandlers));
+    for (int i = 0; i < 200000; ++i) {
+        m_events.dispatchEvent(Event(m_numberType, this));
+    }
+    m_churning = false;
+    thread.wait();
+
+    EXPECT_EQ(200000, count);
+}
+
+EventQueueTimer*
+EventQueueTests::waitForTimer(double timeout, IEventQueue::TimerEvent* info)
+{
+    Event event;
+    if (!m_events.getEvent(event, timeout) ||
+        event.getType() != Event::kTimer) {
+        return NULL;
+    }
+    IEventQueue::TimerEvent* timerEvent =
+        static_cast<IEventQueue::TimerEvent*>(event.getData());
+    if (info != NULL) {
+        *info = *timerEvent;
+    }
+    return timerEvent->m_timer;
+}
+
+TEST_F(EventQueueTests, newTimer_repeating_firesEachPeriod)
+{
+    EventQueueTimer* timer = m_events.newTimer(0.01, NULL);
+    double start = ARCH->time();
+    for (int i = 0; i < 5; ++i) {
+        EXPECT_EQ(timer, waitForTimer(1.0));
+    }
+
+    EXPECT_LE(0.05 - 0.001, ARCH->time() - start);
+    m_events.deleteTimer(timer);
+}
+
+TEST_F(EventQueueTests, newTimer_periodsMissed_countedInEvent)
+{
+    EventQueueTimer* timer = m_events.newTimer(0.01, NULL);
+    ARCH->sleep(0.035);
+
+    IEventQueue::TimerEvent info;
+    EXPECT_EQ(timer, waitForTimer(0.0, &info));
+    EXPECT_LE(3u, info.m_count);
+
+    // the next deadline is still on the original schedule
+    EXPECT_EQ(NULL, waitForTimer(0.0));
+    EXPECT_EQ(timer, waitForTimer(1.0, &info));
+    EXPECT_EQ(1u, info.m_count);
+    m_events.deleteTimer(timer);
+}
+
+TEST_F(EventQueueTests, newOneShotTimer_firesOnce)
+{
+    EventQueueTimer* timer = m_events.newOneShotTimer(0.01, NULL);
+
+    EXPECT_EQ(timer, waitForTimer(1.0));
+    EXPECT_EQ(NULL, waitForTimer(0.05));
+    m_events.deleteTimer(timer);
+}
+
+TEST_F(EventQueueTests, deleteTimer_beforeExpiry_neverFires)
+{
+    EventQueueTimer* deleted = m_events.newTimer(0.01, NULL);
+    m_events.deleteTimer(deleted);
+
+    // may well reuse the deleted timer's address
+    EventQueueTimer* timer = m_events.newOneShotTimer(0.03, NULL);
+    double start = ARCH->time();
+
+    EXPECT_EQ(timer, waitForTimer(1.0));
+    EXPECT_LE(0.03 - 0.001, ARCH->time() - start);
+    m_events.deleteTimer(timer);
+}
+
+TEST_F(EventQueueTests, deleteTimer_most_remainingTimerFires)
+{
+    std::vector<EventQueueTimer*> timers;
+    for (int i = 0; i < 1000; ++i) {
+        timers.push_back(m_events.newTimer(0.01 + i * 0.001, NULL));
+    }
+    for (int i = 1; i < 1000; ++i) {
+        m_events.deleteTimer(timers[i]);
+    }
+
+    EXPECT_EQ(timers[0], waitForTimer(1.0));
+    EXPECT_EQ(timers[0], waitForTimer(1.0));
+    m_events.deleteTimer(timers[0]);
+    EXPECT_EQ(NULL, waitForTimer(0.05));
+}
+
+TEST_F(EventQueueTests, touchTimer_beforeExpiry_delaysExpiry)
+{
+    EventQueueTimer* timer = m_events.newOneShotTimer(0.03, NULL);
+    double start = ARCH->time();
+    ARCH->sleep(0.02);
+    m_events.touchTimer(timer);
+
+    EXPECT_EQ(timer, waitForTimer(1.0));
+    EXPECT_LE(0.05 - 0.001, ARCH->time() - start);
+    EXPECT_EQ(NULL, waitForTimer(0.05));
+    m_events.deleteTimer(timer);
+}
+
+TEST_F(EventQueueTests, touchTimer_oneShotExpired_firesAgain)
+{
+    EventQueueTimer* timer = m_events.newOneShotTimer(0.01, NULL);
+    EXPECT_EQ(timer, waitForTimer(1.0));
+
+    m_events.touchTimer(timer);
+    EXPECT_EQ(timer, waitForTimer(1.0));
+    EXPECT_EQ(NULL, waitForTimer(0.05));
+    m_events.deleteTimer(timer);
+}
+
+TEST_F(EventQueueTests, touchTimer_repeating_restartsPeriod)
+{
+    EventQueueTimer* timer = m_events.newTimer(0.03, NULL);
+    double start = ARCH->time();
+    ARCH->sleep(0.02);
+    m_events.touchTimer(timer);
+
+    IEventQueue::TimerEvent info;
+    EXPECT_EQ(timer, waitForTimer(1.0, &info));
+    EXPECT_LE(0.05 - 0.001, ARCH->time() - start);
+    EXPECT_EQ(1u, info.m_count);
+    m_events.deleteTimer(timer);
+}
+
+TEST_F(EventQueueTests, touchTimer_doesNotAllocate)
+{
+    EventQueueTimer* timer = m_events.newOneShotTimer(15.0, NULL);
+    UInt32 allocations = m_events.getStorageAllocations();
+    for (int i = 0; i < 1000; ++i) {
+        m_events.touchTimer(timer);
+    }
+    EXPECT_EQ(allocations, m_events.getStorageAllocations());
+    m_events.deleteTimer(timer);
+}
+
+TEST_F(EventQueueTests, addEvent_fromEventThread_dispatchedInOrder)
+{
+    // more events than fit in the buffer's queue at once
+    run(0, 10000);
+}
+
+TEST_F(EventQueueTests, addEvent_fromManyThreads_dispatchedInOrder)
+{
+    run(kProducers, 10000);
+}
+
+static
+double
+percentile(std::vector<double>& latencies, int percent)
+{
+    std::sort(latencies.begin(), latencies.end());
+    return latencies[latencies.size() * percent / 100] * 1.0e+6;
+}
+
+TEST_F(EventQueueTests, DISABLED_benchmark_throughput)
+{
+    const int kEvents = 250000;
+    double start = ARCH->time();
+    run(kProducers, kEvents);
+    double elapsed = ARCH->time() - start;
+
+    LOG((CLOG_INFO "%d producers flooding: %.0f events/s",
+        kProducers, kProducers * kEvents / elapsed));
+}
+
+TEST_F(EventQueueTests, DISABLED_benchmark_latency)
+{
+    // about the rate of a fast mouse from each producer
+    run(kProducers, 2000, 0.001);
+
+    LOG((CLOG_INFO "%d producers at 1 kHz: enqueue to dispatch p50 %.1fus p99 %.1fus",
+        kProducers, percentile(m_latencies, 50), percentile(m_latencies, 99)));
+}
+
+TEST_F(EventQueueTests, DISABLED_benchmark_dispatch)
+{
+    // about what a server with a few clients has registered
+    m_events.registerTypeOnce(m_startType, "start");
+    m_events.registerTypeOnce(m_numberType, "number");
+    std::vector<int> counts(200);
+    for (size_t i = 0; i < counts.size(); ++i) {
+        countEvents(m_numberType, &counts[i], counts[i]);
+        countEvents(Event::kUnknown, &counts[i], counts[i]);
+    }
+
+    const int kRounds = 5000;
+    double start = ARCH->time();
+    for (int round = 0; round < kRounds; ++round) {
+        for (size_t i = 0; i < counts.size(); ++i) {
+            m_events.dispatchEvent(Event(m_numberType, &counts[i]));
+            m_events.dispatchEvent(Event(m_startType, &counts[i]));
+        }
+    }
+    double elapsed = ARCH->time() - start;
+
+    EXPECT_EQ(2 * kRounds, counts[0]);
+    LOG((CLOG_INFO "dispatch to %d targets: %.1fns per event",
+        (int)counts.size(), elapsed * 1.0e+9 / (2 * kRounds * counts.size())));
+}
+
+TEST_F(EventQueueTests, DISABLED_benchmark_timerAccuracy)
+{
+    // one busy timer among the heartbeats of many clients
+    std::vector<EventQueueTimer*> idle;
+    for (int i = 0; i < 1000; ++i) {
+        idle.push_back(m_events.newTimer(3600.0, NULL));
+    }
+
+    const double kPeriod = 0.005;
+    const int kEvents    = 200;
+    EventQueueTimer* timer = m_events.newTimer(kPeriod, NULL);
+    double start = ARCH->time();
+    double total = 0.0, worst = 0.0;
+    int events = 0;
+    while (events < kEvents) {
+        IEventQueue::TimerEvent info;
+        ASSERT_EQ(timer, waitForTimer(1.0, &info));
+        events += info.m_count;
+        double late = ARCH->time() - (start + events * kPeriod);
+        total += late;
+        worst  = std::max(worst, late);
+    }
+    m_events.deleteTimer(timer);
+    for (size_t i = 0; i < idle.size(); ++i) {
+        m_events.deleteTimer(idle[i]);
+    }
+
+    LOG((CLOG_INFO "%.0fms timer with %d others: %.0fus late on average, %.0fus at worst",
+        kPeriod * 1.0e+3, (int)idle.size(), total * 1.0e+6 / kEvents, worst * 1.0e+6));
+}
+
+TEST_F(EventQueueTests, DISABLED_benchmark_timerScaling)
+{
+    const int kChecks = 20000;
+    std::vector<EventQueueTimer*> timers;
+    for (int count = 10; count <= 10000; count *= 10) {
+        while ((int)timers.size() < count) {
+            timers.push_back(m_events.newTimer(3600.0, NULL));
+        }
+
+        // an idle loop iteration checks the timers and finds none expired
+        double start = ARCH->time();
+        for (int i = 0; i < kChecks; ++i) {
+            ASSERT_EQ(NULL, waitForTimer(0.0));
+        }
+        double elapsed = ARCH->time() - start;
+
+        LOG((CLOG_INFO "%d timers: %.2fus per idle check",
+            count, elapsed * 1.0e+6 / kChecks));
+    }
+    for (size_t i = 0; i < timers.size(); ++i) {
+        m_events.deleteTimer(timers[i]);
+    }
+}
+
+TEST_F(EventQueueTests, DISABLED_benchmark_heartbeatReset)
+{
+    // a heartbeat alarm for each of a few clients, reset after every
+    // batch of messages from that client
+    const int kClients = 16;
+    const int kResets  = 100000;
+    std::vector<EventQueueTimer*> timers;
+    for (int i = 0; i < kClients; ++i) {
+        timers.push_back(m_events.newOneShotTimer(15.0, NULL));
+    }
+
+    UInt32 allocations = m_events.getStorageAllocations();
+    double start = ARCH->time();
+    for (int i = 0; i < kResets; ++i) {
+        EventQueueTimer*& timer = timers[i % kClients];
+        m_events.deleteTimer(timer);
+        timer = m_events.newOneShotTimer(15.0, NULL);
+    }
+    double replace = ARCH->time() - start;
+    UInt32 replaceAllocations = m_events.getStorageAllocations() - allocations;
+
+    allocations = m_events.getStorageAllocations();
+    start = ARCH->time();
+    for (int i = 0; i < kResets; ++i) {
+        m_events.touchTimer(timers[i % kClients]);
+    }
+    double touch = ARCH->time() - start;
+    UInt32 touchAllocations = m_events.getStorageAllocations() - allocations;
+
+    for (size_t i = 0; i < timers.size(); ++i) {
+        m_events.deleteTimer(timers[i]);
+    }
+
+    EXPECT_EQ(0u, touchAllocations);
+    LOG((CLOG_INFO "heartbeat reset: delete and new %.0fns and %.1f storage allocations, touch %.0fns and %.1f storage allocations",
+        replace * 1.0e+9 / kResets, (double)replaceAllocations / kResets,
+        touch * 1.0e+9 / kResets, (double)touchAllocations / kResets));
+
+    // a client sending mouse motion has about a thousand batches a second
+    LOG((CLOG_INFO "heartbeat reset at 1000 batches/s: %.0f allocations/s avoided",
+        1000.0 * (replaceAllocations - touchAllocations) / kResets));
+}
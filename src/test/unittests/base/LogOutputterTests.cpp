@@ -0,0 +1,200 @@
+/*
+ * barrier -- mouse and keyboard sharing utility
+ * Copyright (C) 2018 Debauchee Open Source Group
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file LICENSE that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "base/log_outputters.h"
+#include "base/Log.h"
+#include "base/String.h"
+#include "arch/Arch.h"
+
+#include "test/global/gtest.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#if SYSAPI_UNIX
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#define LOG_FILENAME "LogOutputterTests.log"
+#define OLD_LOG_FILENAME "LogOutputterTests.log.1"
+
+class LogOutputterTests : public ::testing::Test {
+public:
+    LogOutputterTests() { removeFiles(); }
+    ~LogOutputterTests() { removeFiles(); }
+
+    // read the lines of a file
+    static std::vector<std::string> readLines(const char* filename);
+
+    static void            removeFiles();
+};
+
+std::vector<std::string>
+LogOutputterTests::readLines(const char* filename)
+{
+    std::vector<std::string> lines;
+    std::ifstream file(filename);
+    std::string line;
+    while (std::getline(file, line)) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+void
+LogOutputterTests::removeFiles()
+{
+    remove(LOG_FILENAME);
+    remove(OLD_LOG_FILENAME);
+}
+
+TEST_F(LogOutputterTests, write_withoutThread_writtenAtOnce)
+{
+    FileLogOutputter outputter(LOG_FILENAME);
+    outputter.write(kINFO, "first");
+    outputter.write(kDEBUG, "second");
+
+    std::vector<std::string> lines = readLines(LOG_FILENAME);
+    ASSERT_EQ(2u, lines.size());
+    EXPECT_EQ("first", lines[0]);
+    EXPECT_EQ("second", lines[1]);
+}
+
+TEST_F(LogOutputterTests, write_withThread_allWrittenInOrder)
+{
+    {
+        FileLogOutputter outputter(LOG_FILENAME, true);
+        for (int i = 0; i < 1000; ++i) {
+            outputter.write(kINFO, barrier::string::sprintf("message %d", i).c_str());
+        }
+    }
+
+    std::vector<std::string> lines = readLines(LOG_FILENAME);
+    ASSERT_EQ(1000u, lines.size());
+    for (int i = 0; i < 1000; ++i) {
+        EXPECT_EQ(barrier::string::sprintf("message %d", i), lines[i]);
+    }
+}
+
+TEST_F(LogOutputterTests, write_errorWithThread_writtenWithoutWaiting)
+{
+    FileLogOutputter outputter(LOG_FILENAME, true);
+    outputter.write(kINFO, "info");
+    outputter.write(kERROR, "error");
+
+    // the writer is woken for it but not waited for
+    std::vector<std::string> lines;
+    for (double start = ARCH->time(); ARCH->time() - start < 5.0; ) {
+        lines = readLines(LOG_FILENAME);
+        if (lines.size() == 2) {
+            break;
+        }
+        ARCH->sleep(0.01);
+    }
+    ASSERT_EQ(2u, lines.size());
+    EXPECT_EQ("error", lines[1]);
+}
+
+#if SYSAPI_UNIX
+TEST_F(LogOutputterTests, write_withThreadAfterFork_writtenByChild)
+{
+    FileLogOutputter* outputter = new FileLogOutputter(LOG_FILENAME, true);
+    outputter->write(kINFO, "parent");
+
+    pid_t child = fork();
+    ASSERT_NE(-1, child);
+    if (child == 0) {
+        // the parent's writer thread didn't come with us
+        outputter->write(kINFO, "child");
+        delete outputter;
+        _exit(0);
+    }
+    int status;
+    ASSERT_EQ(child, waitpid(child, &status, 0));
+    delete outputter;
+
+    std::vector<std::string> lines = readLines(LOG_FILENAME);
+    ASSERT_EQ(2u, lines.size());
+    EXPECT_EQ("parent", lines[0]);
+    EXPECT_EQ("child", lines[1]);
+}
+#endif
+
+TEST_F(LogOutputterTests, write_pastSizeLimit_fileMovedAside)
+{
+    FileLogOutputter outputter(LOG_FILENAME);
+    const std::string message(1023, 'x');
+    for (int i = 0; i < 1026; ++i) {
+        outputter.write(kINFO, message.c_str());
+    }
+
+    EXPECT_EQ(1025u, readLines(OLD_LOG_FILENAME).size());
+    EXPECT_EQ(1u, readLines(LOG_FILENAME).size());
+}
+
+TEST_F(LogOutputterTests, DISABLED_benchmark_write)
+{
+    // few enough that the file isn't moved aside
+    const int kMessages = 5000;
+    int filter = CLOG->getFilter();
+
+    for (int threaded = 0; threaded < 2; ++threaded) {
+        // keep the messages off the console
+        StopLogOutputter stop;
+        FileLogOutputter* file = new FileLogOutputter(LOG_FILENAME, threaded != 0);
+        CLOG->insert(&stop);
+        CLOG->insert(file);
+        CLOG->setFilter(kINFO);
+
+        // the time each call holds up its caller, which is the latency
+        // logging adds to an input event
+        std::vector<double> latency(kMessages);
+        double start = ARCH->time();
+        for (int i = 0; i < kMessages; ++i) {
+            double before = ARCH->time();
+            LOG((CLOG_INFO "benchmark message %d of %d", i, kMessages));
+            latency[i] = ARCH->time() - before;
+        }
+        double total = ARCH->time() - start;
+        std::sort(latency.begin(), latency.end());
+
+        CLOG->setFilter(filter);
+        CLOG->remove(file);
+        CLOG->remove(&stop);
+        delete file;
+
+        // debug builds put the source line on a line of its own
+        std::vector<std::string> lines = readLines(LOG_FILENAME);
+        int written = 0;
+        for (size_t i = 0; i < lines.size(); ++i) {
+            if (lines[i].find("benchmark message") != std::string::npos) {
+                ++written;
+            }
+        }
+        EXPECT_EQ(kMessages, written);
+        removeFiles();
+
+        LOG((CLOG_INFO "%s file log: %.0f messages/s, added latency mean %.2fus, p50 %.2fus, p99 %.2fus, max %.1fus",
+            threaded ? "threaded" : "synchronous", kMessages / total,
+            total * 1.0e+6 / kMessages, latency[kMessages / 2] * 1.0e+6,
+            latency[kMessages * 99 / 100] * 1.0e+6,
+            latency[kMessages - 1] * 1.0e+6));
+    }
+}
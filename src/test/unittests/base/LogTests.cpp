@@ -0,0 +1,91 @@
+/*
+ * barrier -- mouse and keyboard sharing utility
+ * Copyright (C) 2018 Debauchee Open Source Group
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file LICENSE that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "base/Log.h"
+#include "arch/Arch.h"
+
+#include "test/global/gtest.h"
+#include <string>
+
+class LogTests : public ::testing::Test {
+public:
+    LogTests() : m_filter(CLOG->getFilter()) { }
+    ~LogTests() { CLOG->setFilter(m_filter); }
+
+    // stands in for a screen name lookup in a log argument
+    static std::string    getName(int* calls)
+    {
+        ++*calls;
+        return "screen";
+    }
+
+private:
+    int                    m_filter;
+};
+
+TEST_F(LogTests, getPriority_prefixedFormat_priority)
+{
+    EXPECT_EQ(kDEBUG2, Log::getPriority("%z\067message"));
+    EXPECT_EQ(kPRINT, Log::getPriority("%z\057message"));
+    EXPECT_EQ(kERROR, Log::getPriority("%z\061"));
+    EXPECT_EQ(kINFO, Log::getPriority("message"));
+    EXPECT_EQ(kINFO, Log::getPriority(""));
+}
+
+TEST_F(LogTests, log_filteredOut_argumentsNotEvaluated)
+{
+    int calls = 0;
+    CLOG->setFilter(kINFO);
+    LOG((CLOG_DEBUG2 "move on %s", getName(&calls).c_str()));
+    LOGC(true, (CLOG_DEBUG1 "move on %s", getName(&calls).c_str()));
+    EXPECT_EQ(0, calls);
+
+    CLOG->setFilter(kDEBUG2);
+    if (Log::isEnabled(kDEBUG2)) {
+        LOG((CLOG_DEBUG2 "move on %s", getName(&calls).c_str()));
+        EXPECT_EQ(1, calls);
+    }
+}
+
+TEST_F(LogTests, DISABLED_benchmark_filteredMouseMove)
+{
+    // the log sites on the server's relative mouse move path with the
+    // default filter.  the old way called print() with every argument.
+    const int kMoves = 2000000;
+    CLOG->setFilter(kINFO);
+
+    int calls = 0;
+    double start = ARCH->time();
+    for (int i = 0; i < kMoves; ++i) {
+        CLOG->print(CLOG_DEBUG2 "onMouseMoveSecondary %+d,%+d", i, -i);
+        CLOG->print(CLOG_DEBUG2 "relative move on %s by %d,%d",
+                            getName(&calls).c_str(), i, -i);
+    }
+    double printed = ARCH->time() - start;
+
+    start = ARCH->time();
+    for (int i = 0; i < kMoves; ++i) {
+        LOG((CLOG_DEBUG2 "onMouseMoveSecondary %+d,%+d", i, -i));
+        LOG((CLOG_DEBUG2 "relative move on %s by %d,%d",
+                            getName(&calls).c_str(), i, -i));
+    }
+    double checked = ARCH->time() - start;
+
+    EXPECT_EQ(kMoves, calls);
+    LOG((CLOG_INFO "filtered log sites per mouse move: print %.1fns, LOG %.1fns",
+        printed * 1.0e+9 / kMoves, checked * 1.0e+9 / kMoves));
+}
@@ -0,0 +1,306 @@
+/*
+ * barrier -- mouse and keyboard sharing utility
+ * Copyright (C) 2018 Debauchee Open Source Group
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file LICENSE that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "io/StreamBuffer.h"
+#include "arch/Arch.h"
+#include "base/Log.h"
+
+#include "test/global/gtest.h"
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+static
+void
+fill(std::vector<UInt8>& data, UInt8 seed)
+{
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = (UInt8)(seed + i * 7);
+    }
+}
+
+// leave a single byte in the buffer, placed so that the next write wraps
+// around the end of the ring after n bytes
+static
+void
+wrapAfter(StreamBuffer& buffer, UInt32 n)
+{
+    std::vector<UInt8> data(4096 - n);
+    buffer.write(&data[0], (UInt32)data.size());
+    buffer.pop((UInt32)data.size() - 1);
+}
+
+TEST(StreamBufferTests, write_thenPeek_returnsData)
+{
+    StreamBuffer buffer;
+    buffer.write("hello", 5);
+
+    EXPECT_EQ(5, buffer.getSize());
+    EXPECT_EQ(0, memcmp("hello", buffer.peek(5), 5));
+    EXPECT_EQ(5, buffer.getSize());
+}
+
+TEST(StreamBufferTests, peek_zero_returnsNull)
+{
+    StreamBuffer buffer;
+
+    EXPECT_EQ(NULL, buffer.peek(0));
+}
+
+TEST(StreamBufferTests, pop_moreThanSize_clearsBuffer)
+{
+    StreamBuffer buffer;
+    buffer.write("hello", 5);
+    buffer.pop(10);
+
+    EXPECT_EQ(0, buffer.getSize());
+}
+
+TEST(StreamBufferTests, read_moreThanSize_returnsAvailable)
+{
+    StreamBuffer buffer;
+    buffer.write("hello", 5);
+
+    char data[10];
+    EXPECT_EQ(5, buffer.read(data, sizeof(data)));
+    EXPECT_EQ(0, memcmp("hello", data, 5));
+    EXPECT_EQ(0, buffer.getSize());
+}
+
+TEST(StreamBufferTests, peekSpans_wrapped_returnsTwoSpans)
+{
+    StreamBuffer buffer;
+    wrapAfter(buffer, 3);
+    buffer.write("hello", 5);
+    buffer.pop(1);
+
+    StreamBuffer::Span spans[2];
+    ASSERT_EQ(2, buffer.peekSpans(spans, 5));
+    EXPECT_EQ(3, spans[0].m_size);
+    EXPECT_EQ(0, memcmp("hel", spans[0].m_data, 3));
+    EXPECT_EQ(2, spans[1].m_size);
+    EXPECT_EQ(0, memcmp("lo", spans[1].m_data, 2));
+
+    ASSERT_EQ(1, buffer.peekSpans(spans, 2));
+    EXPECT_EQ(2, spans[0].m_size);
+}
+
+TEST(StreamBufferTests, peek_wrapped_returnsContiguousData)
+{
+    StreamBuffer buffer;
+    wrapAfter(buffer, 3);
+    buffer.write("hello", 5);
+    buffer.pop(1);
+
+    EXPECT_EQ(0, memcmp("hello", buffer.peek(5), 5));
+}
+
+TEST(StreamBufferTests, read_wrapped_returnsData)
+{
+    StreamBuffer buffer;
+    wrapAfter(buffer, 3);
+    buffer.write("hello", 5);
+    buffer.pop(1);
+
+    char data[5];
+    EXPECT_EQ(5, buffer.read(data, sizeof(data)));
+    EXPECT_EQ(0, memcmp("hello", data, 5));
+}
+
+TEST(StreamBufferTests, write_wrappedAndGrown_keepsOrder)
+{
+    StreamBuffer buffer;
+    wrapAfter(buffer, 100);
+
+    std::vector<UInt8> data(10000);
+    fill(data, 1);
+    buffer.write(&data[0], 200);
+    buffer.pop(1);
+    buffer.write(&data[200], (UInt32)data.size() - 200);
+
+    ASSERT_EQ(data.size(), buffer.getSize());
+    EXPECT_EQ(0, memcmp(&data[0], buffer.peek(buffer.getSize()), data.size()));
+}
+
+TEST(StreamBufferTests, reserve_thenCommit_appendsCommittedBytes)
+{
+    StreamBuffer buffer;
+    buffer.write("ab", 2);
+
+    char* space = static_cast<char*>(buffer.reserve(16));
+    memcpy(space, "cdefg", 5);
+    EXPECT_EQ(2, buffer.getSize());
+    buffer.commit(3);
+
+    EXPECT_EQ(5, buffer.getSize());
+    EXPECT_EQ(0, memcmp("abcde", buffer.peek(5), 5));
+}
+
+TEST(StreamBufferTests, reserve_wrapped_isContiguous)
+{
+    StreamBuffer buffer;
+    wrapAfter(buffer, 3);
+    buffer.write("hello", 5);
+    buffer.pop(1);
+
+    std::vector<UInt8> data(4000);
+    fill(data, 2);
+    memcpy(buffer.reserve((UInt32)data.size()), &data[0], data.size());
+    buffer.commit((UInt32)data.size());
+
+    char head[5];
+    buffer.read(head, sizeof(head));
+    EXPECT_EQ(0, memcmp("hello", head, 5));
+    EXPECT_EQ(0, memcmp(&data[0], buffer.peek((UInt32)data.size()), data.size()));
+}
+
+TEST(StreamBufferTests, reserve_endTooSmall_isContiguous)
+{
+    StreamBuffer buffer;
+    wrapAfter(buffer, 10);
+    buffer.write("hello", 5);
+    buffer.pop(1);
+
+    // 5 bytes left at the end of the ring, 4086 at the start
+    memcpy(buffer.reserve(1000), "world", 5);
+    buffer.commit(5);
+
+    EXPECT_EQ(0, memcmp("helloworld", buffer.peek(10), 10));
+}
+
+TEST(StreamBufferTests, append_allIntoEmpty_takesStorage)
+{
+    StreamBuffer source;
+    source.write("hello", 5);
+    const void* data = source.peek(5);
+
+    StreamBuffer buffer;
+    buffer.append(source, 5);
+
+    EXPECT_EQ(0, source.getSize());
+    EXPECT_EQ(5, buffer.getSize());
+    EXPECT_EQ(data, buffer.peek(5));
+}
+
+TEST(StreamBufferTests, append_partial_copiesData)
+{
+    StreamBuffer source;
+    source.write("world!", 6);
+    StreamBuffer buffer;
+    buffer.write("hello", 5);
+
+    buffer.append(source, 5);
+
+    EXPECT_EQ(1, source.getSize());
+    EXPECT_EQ(0, memcmp("!", source.peek(1), 1));
+    EXPECT_EQ(0, memcmp("helloworld", buffer.peek(10), 10));
+}
+
+TEST(StreamBufferTests, randomOperations_matchDeque)
+{
+    StreamBuffer buffer;
+    std::deque<UInt8> expected;
+    std::vector<UInt8> data(70000);
+    fill(data, 3);
+
+    UInt32 seed = 1;
+    for (int i = 0; i < 20000; ++i) {
+        seed = seed * 1103515245 + 12345;
+        UInt32 n = (seed >> 8) % (i % 100 == 0 ? 70000 : 700);
+
+        switch ((seed >> 4) % 4) {
+        case 0:
+            buffer.write(&data[0], n);
+            expected.insert(expected.end(), data.begin(), data.begin() + n);
+            break;
+
+        case 1:
+            memcpy(buffer.reserve(n), &data[0], n);
+            buffer.commit(n / 2);
+            expected.insert(expected.end(), data.begin(), data.begin() + n / 2);
+            break;
+
+        case 2: {
+            n = std::min(n, buffer.getSize());
+            std::vector<UInt8> got(n + 1);
+            ASSERT_EQ(n, buffer.read(&got[0], n));
+            ASSERT_TRUE(std::equal(got.begin(), got.begin() + n, expected.begin()));
+            expected.erase(expected.begin(), expected.begin() + n);
+            break;
+        }
+
+        case 3: {
+            n = std::min(n, buffer.getSize());
+            const UInt8* got = static_cast<const UInt8*>(buffer.peek(n));
+            ASSERT_TRUE(n == 0 || std::equal(got, got + n, expected.begin()));
+            buffer.pop(n / 2);
+            expected.erase(expected.begin(), expected.begin() + n / 2);
+            break;
+        }
+        }
+
+        ASSERT_EQ(expected.size(), buffer.getSize());
+    }
+}
+
+// push messages through the buffer the way a socket and the packet
+// filter do:  read into reserved space, then pull off a 4 byte length
+// and the body.  returns the throughput in MB/s.
+static
+double
+timeMessages(UInt32 messageSize, UInt32 readSize, UInt32 totalBytes)
+{
+    std::vector<UInt8> stream(readSize);
+    for (size_t i = 0; i < stream.size(); ++i) {
+        stream[i] = (UInt8)i;
+    }
+    std::vector<UInt8> message(messageSize);
+
+    StreamBuffer buffer;
+    UInt32 processed = 0;
+    UInt32 checksum = 0;
+    double start = ARCH->time();
+    while (processed < totalBytes) {
+        memcpy(buffer.reserve(readSize), &stream[0], readSize);
+        buffer.commit(readSize);
+        processed += readSize;
+
+        while (buffer.getSize() >= 4 + messageSize) {
+            UInt8 size[4];
+            buffer.read(size, 4);
+            buffer.read(&message[0], messageSize);
+            checksum += message[messageSize - 1];
+        }
+    }
+    double elapsed = ARCH->time() - start;
+
+    EXPECT_NE(0xffffffffu, checksum);
+    return (totalBytes / (1024.0 * 1024.0)) / elapsed;
+}
+
+TEST(StreamBufferTests, DISABLED_benchmark_smallMessages)
+{
+    double rate = timeMessages(12, 4096, 256 * 1024 * 1024);
+    LOG((CLOG_INFO "12 byte messages: %.0f MB/s", rate));
+}
+
+TEST(StreamBufferTests, DISABLED_benchmark_clipboardChunks)
+{
+    double rate = timeMessages(32 * 1024, 4096, 256 * 1024 * 1024);
+    LOG((CLOG_INFO "32 KB clipboard chunks: %.0f MB/s", rate));
+}
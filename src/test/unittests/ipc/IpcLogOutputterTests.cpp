@@ -26,6 +26,9 @@
 
 #include "test/global/gmock.h"
 #include "test/global/gtest.h"
+#include <algorithm>
+#include <atomic>
+#include <ctime>
 
 // HACK: ipc logging only used on windows anyway
 #if WINAPI_MSWINDOWS
@@ -163,3 +166,54 @@ TEST(IpcLogOutputterTests, write_underBufferRateLimit_allLinesAreSent)
 }
 
 #endif // WINAPI_MSWINDOWS
+
+// counts what the outputter would send to the gui
+class CountingIpcServer : public IpcServer {
+public:
+    CountingIpcServer() : m_sends(0), m_lines(0) { }
+
+    virtual bool        hasClients(EIpcClientType) const { return true; }
+    virtual void        send(const IpcMessage& message, EIpcClientType)
+    {
+        const IpcLogLineMessage& logLine =
+            static_cast<const IpcLogLineMessage&>(message);
+        const std::string text = logLine.logLine();
+        ++m_sends;
+        m_lines += static_cast<int>(std::count(text.begin(), text.end(), '\n'));
+    }
+
+public:
+    std::atomic<int>    m_sends;
+    std::atomic<int>    m_lines;
+};
+
+TEST(IpcLogOutputterTests, DISABLED_benchmark_debug2Burst)
+{
+    // a burst of mouse motion at DEBUG2 logs a few lines per event, a
+    // few thousand lines a second
+    const int kEvents = 200, kLinesPerEvent = 4;
+    const char* line = "[2018-01-01T00:00:00] DEBUG2: onMouseMoveSecondary +1,-1";
+    CountingIpcServer server;
+
+    std::clock_t cpuStart = std::clock();
+    double start = ARCH->time();
+    {
+        IpcLogOutputter outputter(server, kIpcClientGui, true);
+        outputter.bufferMaxSize(10000);
+        outputter.bufferRateLimit(10000, 1);
+        for (int i = 0; i < kEvents; ++i) {
+            for (int j = 0; j < kLinesPerEvent; ++j) {
+                outputter.write(kDEBUG2, line);
+            }
+            ARCH->sleep(0.001);
+        }
+        ARCH->sleep(0.2);
+    }
+    double cpu = static_cast<double>(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+    double elapsed = ARCH->time() - start;
+
+    EXPECT_LT(0, server.m_sends.load());
+    LOG((CLOG_INFO "ipc log at DEBUG2: %d of %d lines in %d sends, cpu %.1fms over %.0fms",
+        server.m_lines.load(), kEvents * kLinesPerEvent, server.m_sends.load(),
+        cpu * 1000.0, elapsed * 1000.0));
+}
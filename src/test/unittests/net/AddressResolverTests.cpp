@@ -0,0 +1,270 @@
+/*
+ * barrier -- mouse and keyboard sharing utility
+ * Copyright (C) 2018 Debauchee Open Source Group
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file LICENSE that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "net/AddressResolver.h"
+#include "net/XSocket.h"
+#include "test/global/TestEventQueue.h"
+#include "base/TMethodEventJob.h"
+#include "arch/Arch.h"
+
+#include "test/global/gtest.h"
+#include <atomic>
+#include <memory>
+
+#define TEST_PORT 24803
+
+class AddressResolverTests : public ::testing::Test {
+public:
+    AddressResolverTests() : m_lookups(0), m_fail(false), m_delay(0.0) { }
+
+    // stands in for the system's name service.  resolves every name to
+    // the loopback addresses unless told to fail.
+    std::vector<NetworkAddress>
+                        lookup(const NetworkAddress& address);
+
+    // run the event loop until a resolved event or timeout seconds
+    void                wait(AddressResolver& resolver, double timeout);
+    void                wait(void* target, double timeout);
+
+    void                handleResolved(const Event& event, void*);
+    void                handleTimeout(const Event&, void*);
+
+public:
+    TestEventQueue        m_events;
+    std::atomic<int>    m_lookups;
+    std::atomic<bool>    m_fail;
+    std::atomic<double>    m_delay;
+    std::unique_ptr<AddressResolver::Result> m_result;
+};
+
+std::vector<NetworkAddress>
+AddressResolverTests::lookup(const NetworkAddress& address)
+{
+    ++m_lookups;
+    if (m_delay > 0.0) {
+        ARCH->sleep(m_delay);
+    }
+    if (m_fail) {
+        throw XSocketAddress(XSocketAddress::kNotFound,
+                            address.getHostname(), address.getPort());
+    }
+
+    std::vector<NetworkAddress> addresses =
+        NetworkAddress("::1", address.getPort()).resolveAll();
+    std::vector<NetworkAddress> ipv4 =
+        NetworkAddress("127.0.0.1", address.getPort()).resolveAll();
+    addresses.insert(addresses.end(), ipv4.begin(), ipv4.end());
+    return addresses;
+}
+
+void
+AddressResolverTests::wait(AddressResolver& resolver, double timeout)
+{
+    wait(resolver.getEventTarget(), timeout);
+}
+
+void
+AddressResolverTests::wait(void* target, double timeout)
+{
+    m_result.reset();
+    m_events.adoptHandler(m_events.forAddressResolver().resolved(),
+        target,
+        new TMethodEventJob<AddressResolverTests>(
+            this, &AddressResolverTests::handleResolved));
+    EventQueueTimer* timer = m_events.newOneShotTimer(timeout, NULL);
+    m_events.adoptHandler(Event::kTimer, timer,
+        new TMethodEventJob<AddressResolverTests>(
+            this, &AddressResolverTests::handleTimeout));
+
+    m_events.loop();
+
+    m_events.removeHandler(Event::kTimer, timer);
+    m_events.deleteTimer(timer);
+    m_events.removeHandler(m_events.forAddressResolver().resolved(), target);
+}
+
+void
+AddressResolverTests::handleResolved(const Event& event, void*)
+{
+    // take the result from the event so it outlives it
+    AddressResolver::Result* result =
+        static_cast<AddressResolver::Result*>(event.getDataObject());
+    m_result.reset(new AddressResolver::Result(*result));
+    m_events.raiseQuitEvent();
+}
+
+void
+AddressResolverTests::handleTimeout(const Event&, void*)
+{
+    m_events.raiseQuitEvent();
+}
+
+TEST_F(AddressResolverTests, resolve_stubLookup_allAddressesWithPort)
+{
+    AddressResolver resolver(&m_events,
+        [this](const NetworkAddress& address) { return lookup(address); });
+
+    resolver.resolve(NetworkAddress("server", TEST_PORT));
+    wait(resolver, 5.0);
+
+    ASSERT_TRUE(m_result != NULL);
+    ASSERT_EQ(2u, m_result->m_addresses.size());
+    EXPECT_EQ(IArchNetwork::kINET6,
+        ARCH->getAddrFamily(m_result->m_addresses[0].getAddress()));
+    EXPECT_EQ(IArchNetwork::kINET,
+        ARCH->getAddrFamily(m_result->m_addresses[1].getAddress()));
+    EXPECT_EQ(TEST_PORT, ARCH->getAddrPort(m_result->m_addresses[1].getAddress()));
+    EXPECT_FALSE(resolver.isResolving());
+}
+
+TEST_F(AddressResolverTests, resolve_slowLookup_returnsAtOnce)
+{
+    AddressResolver resolver(&m_events,
+        [this](const NetworkAddress& address) { return lookup(address); });
+    m_delay = 0.5;
+
+    double start = ARCH->time();
+    resolver.resolve(NetworkAddress("server", TEST_PORT));
+    double elapsed = ARCH->time() - start;
+
+    EXPECT_LT(elapsed, 0.25);
+    EXPECT_TRUE(resolver.isResolving());
+    wait(resolver, 5.0);
+    ASSERT_TRUE(m_result != NULL);
+    EXPECT_EQ(2u, m_result->m_addresses.size());
+}
+
+TEST_F(AddressResolverTests, resolve_withinTTL_cached)
+{
+    AddressResolver resolver(&m_events,
+        [this](const NetworkAddress& address) { return lookup(address); });
+
+    resolver.resolve(NetworkAddress("server", TEST_PORT));
+    wait(resolver, 5.0);
+    resolver.resolve(NetworkAddress("server", TEST_PORT));
+    wait(resolver, 5.0);
+
+    ASSERT_TRUE(m_result != NULL);
+    EXPECT_EQ(2u, m_result->m_addresses.size());
+    EXPECT_EQ(1, m_lookups);
+
+    // a different port is a different cache entry
+    resolver.resolve(NetworkAddress("server", TEST_PORT + 1));
+    wait(resolver, 5.0);
+    EXPECT_EQ(2, m_lookups);
+}
+
+TEST_F(AddressResolverTests, invalidate_cachedResult_lookedUpAgain)
+{
+    AddressResolver resolver(&m_events,
+        [this](const NetworkAddress& address) { return lookup(address); });
+
+    resolver.resolve(NetworkAddress("server", TEST_PORT));
+    wait(resolver, 5.0);
+    resolver.invalidate(NetworkAddress("server", TEST_PORT));
+    resolver.resolve(NetworkAddress("server", TEST_PORT));
+    wait(resolver, 5.0);
+
+    ASSERT_TRUE(m_result != NULL);
+    EXPECT_EQ(2u, m_result->m_addresses.size());
+    EXPECT_EQ(2, m_lookups);
+
+    // the new result is cached again
+    resolver.resolve(NetworkAddress("server", TEST_PORT));
+    wait(resolver, 5.0);
+    EXPECT_EQ(2, m_lookups);
+}
+
+TEST_F(AddressResolverTests, invalidate_lookupFails_staleAddressesUsed)
+{
+    AddressResolver resolver(&m_events,
+        [this](const NetworkAddress& address) { return lookup(address); });
+
+    resolver.resolve(NetworkAddress("server", TEST_PORT));
+    wait(resolver, 5.0);
+    resolver.invalidate(NetworkAddress("server", TEST_PORT));
+    m_fail = true;
+    resolver.resolve(NetworkAddress("server", TEST_PORT));
+    wait(resolver, 5.0);
+
+    ASSERT_TRUE(m_result != NULL);
+    EXPECT_EQ(2, m_lookups);
+    EXPECT_EQ(2u, m_result->m_addresses.size());
+}
+
+TEST_F(AddressResolverTests, resolve_expiredAndLookupFails_staleAddressesUsed)
+{
+    AddressResolver resolver(&m_events,
+        [this](const NetworkAddress& address) { return lookup(address); }, 0.0);
+
+    resolver.resolve(NetworkAddress("server", TEST_PORT));
+    wait(resolver, 5.0);
+    m_fail = true;
+    resolver.resolve(NetworkAddress("server", TEST_PORT));
+    wait(resolver, 5.0);
+
+    ASSERT_TRUE(m_result != NULL);
+    EXPECT_EQ(2, m_lookups);
+    EXPECT_EQ(2u, m_result->m_addresses.size());
+}
+
+TEST_F(AddressResolverTests, resolve_lookupFails_errorWithoutAddresses)
+{
+    AddressResolver resolver(&m_events,
+        [this](const NetworkAddress& address) { return lookup(address); });
+    m_fail = true;
+
+    resolver.resolve(NetworkAddress("server", TEST_PORT));
+    wait(resolver, 5.0);
+
+    ASSERT_TRUE(m_result != NULL);
+    EXPECT_TRUE(m_result->m_addresses.empty());
+    EXPECT_FALSE(m_result->m_error.empty());
+}
+
+TEST_F(AddressResolverTests, cancel_lookupInProgress_noEvent)
+{
+    AddressResolver resolver(&m_events,
+        [this](const NetworkAddress& address) { return lookup(address); });
+    m_delay = 0.1;
+
+    resolver.resolve(NetworkAddress("server", TEST_PORT));
+    resolver.cancel();
+    EXPECT_FALSE(resolver.isResolving());
+    wait(resolver, 0.5);
+
+    EXPECT_TRUE(m_result == NULL);
+    EXPECT_EQ(1, m_lookups);
+}
+
+TEST_F(AddressResolverTests, destroy_lookupInProgress_waitsForIt)
+{
+    void* target;
+    {
+        AddressResolver resolver(&m_events,
+            [this](const NetworkAddress& address) { return lookup(address); });
+        target  = resolver.getEventTarget();
+        m_delay = 0.2;
+        resolver.resolve(NetworkAddress("server", TEST_PORT));
+        ARCH->sleep(0.05);
+    }
+
+    // the lookup finished before the resolver was gone and sent nothing
+    EXPECT_EQ(1, m_lookups);
+    wait(target, 0.1);
+    EXPECT_TRUE(m_result == NULL);
+}
@@ -0,0 +1,84 @@
+/*
+ * barrier -- mouse and keyboard sharing utility
+ * Copyright (C) 2018 Debauchee Open Source Group
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file LICENSE that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "server/ClientProxy1_6.h"
+#include "barrier/protocol_types.h"
+#include "base/EventQueue.h"
+#include "base/Log.h"
+#include "arch/Arch.h"
+#include "test/mock/io/MockStream.h"
+#include "test/mock/server/MockServer.h"
+
+#include "test/global/gtest.h"
+#include "test/global/gmock.h"
+
+using ::testing::NiceMock;
+
+class ClientProxyTests : public ::testing::Test {
+public:
+    ClientProxyTests() :
+        m_client("client", new NiceMock<MockStream>, &m_server, &m_events) { }
+
+    // parse code count times and return the time per message in ns
+    double                timeParse(UInt32 code, int count);
+
+public:
+    EventQueue            m_events;
+    MockServer            m_server;
+    ClientProxy1_6        m_client;
+};
+
+double
+ClientProxyTests::timeParse(UInt32 code, int count)
+{
+    // keep the parsers' logging out of the timing
+    int filter = CLOG->getFilter();
+    CLOG->setFilter(kINFO);
+    double start = ARCH->time();
+    for (int i = 0; i < count; ++i) {
+        EXPECT_TRUE(m_client.parseMessage(code));
+    }
+    double elapsed = ARCH->time() - start;
+    CLOG->setFilter(filter);
+    return elapsed * 1.0e+9 / count;
+}
+
+TEST_F(ClientProxyTests, parseMessage_keepAlive_accepted)
+{
+    EXPECT_TRUE(m_client.parseMessage(kMsgCodeCKeepAlive));
+}
+
+TEST_F(ClientProxyTests, parseMessage_noop_acceptedByOldestVersion)
+{
+    EXPECT_TRUE(m_client.parseMessage(kMsgCodeCNoop));
+}
+
+TEST_F(ClientProxyTests, parseMessage_unknownCode_rejected)
+{
+    EXPECT_FALSE(m_client.parseMessage(makeMessageCode('X', 'X', 'X', 'X')));
+    EXPECT_FALSE(m_client.parseMessage(kMsgCodeDMouseMove));
+}
+
+TEST_F(ClientProxyTests, DISABLED_benchmark_parse)
+{
+    const int kMessages = 200000;
+    double keepAlive = timeParse(kMsgCodeCKeepAlive, kMessages);
+    double noop      = timeParse(kMsgCodeCNoop, kMessages);
+
+    LOG((CLOG_INFO "1.6 client proxy decode: keep alive %.1fns, no-op %.1fns per message",
+        keepAlive, noop));
+}
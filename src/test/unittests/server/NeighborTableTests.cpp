@@ -0,0 +1,279 @@
+/*
+ * barrier -- mouse and keyboard sharing utility
+ * Copyright (C) 2018 Debauchee Open Source Group
+ *
+ * This package is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * found in the file LICENSE that should have accompanied this file.
+ *
+ * This package is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "server/NeighborTable.h"
+#include "server/Config.h"
+#include "base/EventQueue.h"
+#include "base/Log.h"
+#include "arch/Arch.h"
+
+#include "test/global/gtest.h"
+#include <map>
+#include <sstream>
+
+class NeighborTableTests : public ::testing::Test {
+public:
+    NeighborTableTests() : m_config(&m_events) { }
+
+    // make a grid of screens, each side split in two links with the
+    // lower half of the right side skipping a column
+    void                makeGrid(int columns, int rows);
+
+    // check the table against the config at every position on every side
+    void                expectSameAsConfig();
+
+    static std::string    gridName(int column, int row);
+
+public:
+    EventQueue            m_events;
+    Config                m_config;
+    NeighborTable        m_table;
+};
+
+std::string
+NeighborTableTests::gridName(int column, int row)
+{
+    std::ostringstream s;
+    s << "screen" << column << "-" << row;
+    return s.str();
+}
+
+void
+NeighborTableTests::makeGrid(int columns, int rows)
+{
+    for (int row = 0; row < rows; ++row) {
+        for (int column = 0; column < columns; ++column) {
+            m_config.addScreen(gridName(column, row));
+        }
+    }
+    for (int row = 0; row < rows; ++row) {
+        for (int column = 0; column < columns; ++column) {
+            const std::string name = gridName(column, row);
+            const int left  = (column + columns - 1) % columns;
+            const int right = (column + 1) % columns;
+            const int skip  = (column + 2) % columns;
+            const int up    = (row + rows - 1) % rows;
+            const int down  = (row + 1) % rows;
+            m_config.connect(name, kLeft, 0.0f, 0.5f,
+                            gridName(left, row), 0.0f, 0.5f);
+            m_config.connect(name, kLeft, 0.5f, 1.0f,
+                            gridName(left, row), 0.5f, 1.0f);
+            m_config.connect(name, kRight, 0.0f, 0.5f,
+                            gridName(right, row), 0.0f, 0.5f);
+            m_config.connect(name, kRight, 0.5f, 1.0f,
+                            gridName(skip, row), 0.25f, 0.75f);
+            m_config.connect(name, kTop, 0.0f, 1.0f,
+                            gridName(column, up), 0.0f, 1.0f);
+            m_config.connect(name, kBottom, 0.1f, 0.9f,
+                            gridName(column, down), 0.0f, 1.0f);
+        }
+    }
+}
+
+void
+NeighborTableTests::expectSameAsConfig()
+{
+    for (SInt32 screen = 0; screen < m_table.getNumScreens(); ++screen) {
+        const std::string& name = m_table.getName(screen);
+        for (SInt32 side = kFirstDirection; side <= kLastDirection; ++side) {
+            const EDirection dir = static_cast<EDirection>(side);
+            for (int i = 0; i <= 40; ++i) {
+                const float t = 0.025f * i;
+                float configOut = -1.0f, tableOut = -1.0f;
+                std::string dst = m_config.getNeighbor(name, dir, t, &configOut);
+                SInt32 dstScreen = m_table.getNeighbor(screen, dir, t, &tableOut);
+                if (dst.empty()) {
+                    EXPECT_EQ(NeighborTable::kNoScreen, dstScreen);
+                }
+                else {
+                    ASSERT_NE(NeighborTable::kNoScreen, dstScreen);
+                    EXPECT_EQ(dst, m_table.getName(dstScreen));
+                    EXPECT_EQ(configOut, tableOut);
+                }
+            }
+        }
+    }
+}
+
+TEST_F(NeighborTableTests, build_emptyConfig_noScreens)
+{
+    m_table.build(m_config);
+    EXPECT_EQ(0, m_table.getNumScreens());
+    EXPECT_EQ(NeighborTable::kNoScreen, m_table.getScreen("missing"));
+}
+
+TEST_F(NeighborTableTests, getScreen_alias_sameScreen)
+{
+    m_config.addScreen("Server");
+    m_config.addAlias("Server", "laptop");
+    m_table.build(m_config);
+
+    SInt32 screen = m_table.getScreen("server");
+    ASSERT_NE(NeighborTable::kNoScreen, screen);
+    EXPECT_EQ(screen, m_table.getScreen("LAPTOP"));
+    EXPECT_EQ("Server", m_table.getName(screen));
+}
+
+TEST_F(NeighborTableTests, getNeighbor_grid_sameAsConfig)
+{
+    makeGrid(4, 3);
+    m_table.build(m_config);
+    ASSERT_EQ(12, m_table.getNumScreens());
+    expectSameAsConfig();
+}
+
+TEST_F(NeighborTableTests, getNeighbor_linkToUnknownScreen_noScreen)
+{
+    m_config.addScreen("server");
+    m_config.connect("server", kRight, 0.0f, 1.0f, "client", 0.0f, 1.0f);
+    m_table.build(m_config);
+
+    SInt32 server = m_table.getScreen("server");
+    ASSERT_NE(NeighborTable::kNoScreen, server);
+    EXPECT_EQ(NeighborTable::kNoScreen,
+                            m_table.getNeighbor(server, kRight, 0.5f, NULL));
+    expectSameAsConfig();
+}
+
+TEST_F(NeighborTableTests, build_twice_replacesTable)
+{
+    makeGrid(3, 3);
+    m_table.build(m_config);
+
+    m_config.disconnect(gridName(0, 0), kRight);
+    m_table.build(m_config);
+    EXPECT_EQ(NeighborTable::kNoScreen, m_table.getNeighbor(
+                            m_table.getScreen(gridName(0, 0)), kRight, 0.25f, NULL));
+    expectSameAsConfig();
+}
+
+TEST_F(NeighborTableTests, getNeighbor_skippingDisconnected_sameAsConfig)
+{
+    // walk right past every other column, the way Server::getNeighbor()
+    // skips screens without a client, and land where the config does
+    const int kColumns = 8, kRows = 3;
+    makeGrid(kColumns, kRows);
+    m_table.build(m_config);
+
+    std::vector<bool> isConnected(m_table.getNumScreens(), false);
+    for (int row = 0; row < kRows; ++row) {
+        for (int column = 0; column < kColumns; column += 2) {
+            isConnected[m_table.getScreen(gridName(column, row))] = true;
+        }
+    }
+
+    for (int row = 0; row < kRows; ++row) {
+        for (int i = 0; i < 1000; ++i) {
+            std::string srcName = gridName(1, row);
+            SInt32 src = m_table.getScreen(srcName);
+            float configT = 0.001f * i, tableT = configT;
+            std::string configDst;
+            SInt32 tableDst = NeighborTable::kNoScreen;
+            for (int n = 0; n < kColumns * kRows; ++n) {
+                configDst = m_config.getNeighbor(srcName, kRight,
+                                configT, &configT);
+                tableDst  = m_table.getNeighbor(src, kRight, tableT, &tableT);
+                ASSERT_FALSE(configDst.empty());
+                ASSERT_NE(NeighborTable::kNoScreen, tableDst);
+                ASSERT_EQ(configDst, m_table.getName(tableDst));
+                ASSERT_EQ(configT, tableT);
+                if (isConnected[tableDst]) {
+                    break;
+                }
+                srcName = configDst;
+                src     = tableDst;
+            }
+            EXPECT_TRUE(isConnected[tableDst]);
+        }
+    }
+}
+
+TEST_F(NeighborTableTests, DISABLED_benchmark_crossings)
+{
+    // every other column is disconnected so most crossings skip a screen
+    // the way Server::getNeighbor() does
+    const int kColumns = 8, kRows = 3, kCrossings = 200000;
+    makeGrid(kColumns, kRows);
+    m_table.build(m_config);
+
+    std::map<std::string, int> connected;
+    std::vector<bool> isConnected(m_table.getNumScreens(), false);
+    for (int row = 0; row < kRows; ++row) {
+        for (int column = 0; column < kColumns; column += 2) {
+            connected[gridName(column, row)] = 1;
+            isConnected[m_table.getScreen(gridName(column, row))] = true;
+        }
+    }
+
+    std::vector<std::string> srcNames;
+    std::vector<SInt32> srcScreens;
+    for (int row = 0; row < kRows; ++row) {
+        srcNames.push_back(gridName(0, row));
+        srcScreens.push_back(m_table.getScreen(srcNames.back()));
+    }
+
+    int filter = CLOG->getFilter();
+    CLOG->setFilter(kINFO);
+
+    // by name through the config
+    int found = 0;
+    double start = ARCH->time();
+    for (int i = 0; i < kCrossings; ++i) {
+        std::string src = srcNames[i % kRows];
+        float t = 0.001f * (i % 1000), tTmp;
+        for (int n = 0; n < kColumns * kRows; ++n) {
+            std::string dst = m_config.getNeighbor(src, kRight, t, &tTmp);
+            if (dst.empty()) {
+                break;
+            }
+            if (connected.find(dst) != connected.end()) {
+                ++found;
+                break;
+            }
+            src = dst;
+            t   = tTmp;
+        }
+    }
+    double byName = ARCH->time() - start;
+
+    // by number through the table
+    int foundTable = 0;
+    start = ARCH->time();
+    for (int i = 0; i < kCrossings; ++i) {
+        SInt32 src = srcScreens[i % kRows];
+        float t = 0.001f * (i % 1000), tTmp;
+        for (int n = 0; n < kColumns * kRows; ++n) {
+            SInt32 dst = m_table.getNeighbor(src, kRight, t, &tTmp);
+            if (dst == NeighborTable::kNoScreen) {
+                break;
+            }
+            if (isConnected[dst]) {
+                ++foundTable;
+                break;
+            }
+            src = dst;
+            t   = tTmp;
+        }
+    }
+    double byNumber = ARCH->time() - start;
+
+    CLOG->setFilter(filter);
+    EXPECT_EQ(found, foundTable);
+
+    LOG((CLOG_INFO "neighbor lookup: config %.1fns, table %.1fns per crossing",
+        byName * 1.0e+9 / kCrossings, byNumber * 1.0e+9 / kCrossings));
+}